@@ -0,0 +1,5 @@
+BENCH_ARGS =
+
+.PHONY: bench
+bench: all
+	$(PHP_EXECUTABLE) $(srcdir)/bench/run.php --extension=$(phplibdir)/mysql_qp.$(SHLIB_DL_SUFFIX_NAME) $(BENCH_ARGS)
@@ -0,0 +1,75 @@
+<?php
+/**
+ * Compares two `make bench` reports.
+ *
+ *   php bench/compare.php base.json new.json [--threshold=5]
+ *
+ * Prints the change in throughput, p99 latency, bytes per call and round
+ * trips per call for every result present in both reports, and exits with
+ * status 1 when throughput drops or p99 latency grows by more than the
+ * threshold (in percent).
+ */
+
+$args = [];
+$threshold = 5.0;
+foreach (array_slice($argv, 1) as $arg) {
+    if (str_starts_with($arg, '--threshold=')) {
+        $threshold = (float) substr($arg, strlen('--threshold='));
+    } else {
+        $args[] = $arg;
+    }
+}
+
+if (count($args) !== 2) {
+    fwrite(STDERR, "Usage: php bench/compare.php base.json new.json [--threshold=5]\n");
+    exit(2);
+}
+
+$base = index_results($args[0]);
+$new = index_results($args[1]);
+$regressions = 0;
+
+printf("%-52s %12s %9s %9s %9s %9s\n", 'benchmark', 'ops/s', 'change', 'p99', 'bytes', 'trips');
+foreach ($new as $name => $result) {
+    if (!isset($base[$name], $result['ops_per_sec'], $base[$name]['ops_per_sec'])) {
+        continue;
+    }
+    $old = $base[$name];
+    $throughput = change($old['ops_per_sec'], $result['ops_per_sec']);
+    $p99 = change($old['latency_ns']['p99'], $result['latency_ns']['p99']);
+    $slower = $throughput < -$threshold || $p99 > $threshold;
+    $regressions += $slower;
+
+    printf("%-52s %12.1f %8.1f%% %8.1f%% %8.1f%% %9s%s\n",
+        $name,
+        $result['ops_per_sec'],
+        $throughput,
+        $p99,
+        change($old['peak_bytes_per_call'], $result['peak_bytes_per_call']),
+        $result['round_trips_per_call'] ?? '-',
+        $slower ? '  REGRESSION' : '');
+}
+
+if ($regressions) {
+    fprintf(STDERR, "%d benchmark(s) regressed by more than %.1f%%\n", $regressions, $threshold);
+    exit(1);
+}
+
+function index_results(string $path): array
+{
+    $report = json_decode((string) @file_get_contents($path), true);
+    if (!isset($report['results'])) {
+        fwrite(STDERR, "$path is not a benchmark report\n");
+        exit(2);
+    }
+    $results = [];
+    foreach ($report['results'] as $result) {
+        $results[$result['function'] . '/' . $result['corpus'] . '/' . $result['cache']] = $result;
+    }
+    return $results;
+}
+
+function change(float $old, float $new): float
+{
+    return $old == 0 ? 0.0 : ($new - $old) / $old * 100;
+}
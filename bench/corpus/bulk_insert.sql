@@ -0,0 +1,6 @@
+-- Multi-row INSERTs as written by bulk loaders and migrations.
+-- The runner repeats the VALUES rows of each statement until it reaches the size below,
+-- so the corpus stays small in git.
+-- bench: expand-values-to=4M
+INSERT INTO events (id, user_id, kind, payload, created_at) VALUES (1, 42, 'click', '{"x":10,"y":20,"target":"#buy"}', '2024-05-01 10:00:00'), (2, 43, 'view', 'it''s a \'quoted\' page, with (parens)', '2024-05-01 10:00:01'), (3, NULL, 'error', NULL, NOW())
+INSERT INTO measurements (sensor_id, taken_at, value, unit) VALUES (7, 1714557600, -12.5, 'C'), (8, 1714557601, 0.000123, 'V'), (9, 1714557602, 1e10, 'Hz')
@@ -0,0 +1,11 @@
+-- Pathological nesting: deep parentheses, subqueries and CASE chains that stress
+-- recursion in the parser and depth tracking in the scanners.
+SELECT ((((((((((((((((1 + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) AS n
+SELECT ((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((1 + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) AS n
+SELECT ((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((1 + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) + 1) AS n
+SELECT id FROM t0 WHERE id IN (SELECT id FROM t1 WHERE id IN (SELECT id FROM t2 WHERE id IN (SELECT id FROM t3 WHERE id IN (SELECT id FROM t4 WHERE id IN (SELECT id FROM t5 WHERE id IN (SELECT id FROM t6 WHERE id IN (SELECT id FROM t7 WHERE id IN (SELECT id FROM t8 WHERE id IN (SELECT 1)))))))))
+SELECT id FROM t0 WHERE id IN (SELECT id FROM t1 WHERE id IN (SELECT id FROM t2 WHERE id IN (SELECT id FROM t3 WHERE id IN (SELECT id FROM t4 WHERE id IN (SELECT id FROM t5 WHERE id IN (SELECT id FROM t6 WHERE id IN (SELECT id FROM t7 WHERE id IN (SELECT id FROM t8 WHERE id IN (SELECT id FROM t9 WHERE id IN (SELECT id FROM t10 WHERE id IN (SELECT id FROM t11 WHERE id IN (SELECT id FROM t12 WHERE id IN (SELECT id FROM t13 WHERE id IN (SELECT id FROM t14 WHERE id IN (SELECT id FROM t15 WHERE id IN (SELECT id FROM t16 WHERE id IN (SELECT id FROM t17 WHERE id IN (SELECT id FROM t18 WHERE id IN (SELECT id FROM t19 WHERE id IN (SELECT id FROM t20 WHERE id IN (SELECT id FROM t21 WHERE id IN (SELECT id FROM t22 WHERE id IN (SELECT id FROM t23 WHERE id IN (SELECT id FROM t24 WHERE id IN (SELECT id FROM t25 WHERE id IN (SELECT id FROM t26 WHERE id IN (SELECT id FROM t27 WHERE id IN (SELECT id FROM t28 WHERE id IN (SELECT id FROM t29 WHERE id IN (SELECT id FROM t30 WHERE id IN (SELECT id FROM t31 WHERE id IN (SELECT id FROM t32 WHERE id IN (SELECT 1)))))))))))))))))))))))))))))))))
+SELECT CASE WHEN status = 0 THEN 'state_0' WHEN status = 1 THEN 'state_1' WHEN status = 2 THEN 'state_2' WHEN status = 3 THEN 'state_3' WHEN status = 4 THEN 'state_4' WHEN status = 5 THEN 'state_5' WHEN status = 6 THEN 'state_6' WHEN status = 7 THEN 'state_7' WHEN status = 8 THEN 'state_8' WHEN status = 9 THEN 'state_9' WHEN status = 10 THEN 'state_10' WHEN status = 11 THEN 'state_11' WHEN status = 12 THEN 'state_12' WHEN status = 13 THEN 'state_13' WHEN status = 14 THEN 'state_14' WHEN status = 15 THEN 'state_15' WHEN status = 16 THEN 'state_16' WHEN status = 17 THEN 'state_17' WHEN status = 18 THEN 'state_18' WHEN status = 19 THEN 'state_19' ELSE 'unknown' END AS label FROM jobs
+SELECT CASE WHEN status = 0 THEN 'state_0' WHEN status = 1 THEN 'state_1' WHEN status = 2 THEN 'state_2' WHEN status = 3 THEN 'state_3' WHEN status = 4 THEN 'state_4' WHEN status = 5 THEN 'state_5' WHEN status = 6 THEN 'state_6' WHEN status = 7 THEN 'state_7' WHEN status = 8 THEN 'state_8' WHEN status = 9 THEN 'state_9' WHEN status = 10 THEN 'state_10' WHEN status = 11 THEN 'state_11' WHEN status = 12 THEN 'state_12' WHEN status = 13 THEN 'state_13' WHEN status = 14 THEN 'state_14' WHEN status = 15 THEN 'state_15' WHEN status = 16 THEN 'state_16' WHEN status = 17 THEN 'state_17' WHEN status = 18 THEN 'state_18' WHEN status = 19 THEN 'state_19' WHEN status = 20 THEN 'state_20' WHEN status = 21 THEN 'state_21' WHEN status = 22 THEN 'state_22' WHEN status = 23 THEN 'state_23' WHEN status = 24 THEN 'state_24' WHEN status = 25 THEN 'state_25' WHEN status = 26 THEN 'state_26' WHEN status = 27 THEN 'state_27' WHEN status = 28 THEN 'state_28' WHEN status = 29 THEN 'state_29' WHEN status = 30 THEN 'state_30' WHEN status = 31 THEN 'state_31' WHEN status = 32 THEN 'state_32' WHEN status = 33 THEN 'state_33' WHEN status = 34 THEN 'state_34' WHEN status = 35 THEN 'state_35' WHEN status = 36 THEN 'state_36' WHEN status = 37 THEN 'state_37' WHEN status = 38 THEN 'state_38' WHEN status = 39 THEN 'state_39' WHEN status = 40 THEN 'state_40' WHEN status = 41 THEN 'state_41' WHEN status = 42 THEN 'state_42' WHEN status = 43 THEN 'state_43' WHEN status = 44 THEN 'state_44' WHEN status = 45 THEN 'state_45' WHEN status = 46 THEN 'state_46' WHEN status = 47 THEN 'state_47' WHEN status = 48 THEN 'state_48' WHEN status = 49 THEN 'state_49' WHEN status = 50 THEN 'state_50' WHEN status = 51 THEN 'state_51' WHEN status = 52 THEN 'state_52' WHEN status = 53 THEN 'state_53' WHEN status = 54 THEN 'state_54' WHEN status = 55 THEN 'state_55' WHEN status = 56 THEN 'state_56' WHEN status = 57 THEN 'state_57' WHEN status = 58 THEN 'state_58' WHEN status = 59 THEN 'state_59' WHEN status = 60 THEN 'state_60' WHEN status = 61 THEN 'state_61' WHEN status = 62 THEN 'state_62' WHEN status = 63 THEN 'state_63' WHEN status = 64 THEN 'state_64' WHEN status = 65 THEN 'state_65' WHEN status = 66 THEN 'state_66' WHEN status = 67 THEN 'state_67' WHEN status = 68 THEN 'state_68' WHEN status = 69 THEN 'state_69' WHEN status = 70 THEN 'state_70' WHEN status = 71 THEN 'state_71' WHEN status = 72 THEN 'state_72' WHEN status = 73 THEN 'state_73' WHEN status = 74 THEN 'state_74' WHEN status = 75 THEN 'state_75' WHEN status = 76 THEN 'state_76' WHEN status = 77 THEN 'state_77' WHEN status = 78 THEN 'state_78' WHEN status = 79 THEN 'state_79' WHEN status = 80 THEN 'state_80' WHEN status = 81 THEN 'state_81' WHEN status = 82 THEN 'state_82' WHEN status = 83 THEN 'state_83' WHEN status = 84 THEN 'state_84' WHEN status = 85 THEN 'state_85' WHEN status = 86 THEN 'state_86' WHEN status = 87 THEN 'state_87' WHEN status = 88 THEN 'state_88' WHEN status = 89 THEN 'state_89' WHEN status = 90 THEN 'state_90' WHEN status = 91 THEN 'state_91' WHEN status = 92 THEN 'state_92' WHEN status = 93 THEN 'state_93' WHEN status = 94 THEN 'state_94' WHEN status = 95 THEN 'state_95' WHEN status = 96 THEN 'state_96' WHEN status = 97 THEN 'state_97' WHEN status = 98 THEN 'state_98' WHEN status = 99 THEN 'state_99' ELSE 'unknown' END AS label FROM jobs
+SELECT ((((((((((((((((((((((((((((((((((((((((((IF(IF(IF(IF(IF(IF(a > 0, COALESCE(a, 0), 0) > 1, COALESCE(IF(a > 0, COALESCE(a, 0), 0), 1), 1) > 2, COALESCE(IF(IF(a > 0, COALESCE(a, 0), 0) > 1, COALESCE(IF(a > 0, COALESCE(a, 0), 0), 1), 1), 2), 2) > 3, COALESCE(IF(IF(IF(a > 0, COALESCE(a, 0), 0) > 1, COALESCE(IF(a > 0, COALESCE(a, 0), 0), 1), 1) > 2, COALESCE(IF(IF(a > 0, COALESCE(a, 0), 0) > 1, COALESCE(IF(a > 0, COALESCE(a, 0), 0), 1), 1), 2), 2), 3), 3) > 4, COALESCE(IF(IF(IF(IF(a > 0, COALESCE(a, 0), 0) > 1, COALESCE(IF(a > 0, COALESCE(a, 0), 0), 1), 1) > 2, COALESCE(IF(IF(a > 0, COALESCE(a, 0), 0) > 1, COALESCE(IF(a > 0, COALESCE(a, 0), 0), 1), 1), 2), 2) > 3, COALESCE(IF(IF(IF(a > 0, COALESCE(a, 0), 0) > 1, COALESCE(IF(a > 0, COALESCE(a, 0), 0), 1), 1) > 2, COALESCE(IF(IF(a > 0, COALESCE(a, 0), 0) > 1, COALESCE(IF(a > 0, COALESCE(a, 0), 0), 1), 1), 2), 2), 3), 3), 4), 4) > 5, COALESCE(IF(IF(IF(IF(IF(a > 0, COALESCE(a, 0), 0) > 1, COALESCE(IF(a > 0, COALESCE(a, 0), 0), 1), 1) > 2, COALESCE(IF(IF(a > 0, COALESCE(a, 0), 0) > 1, COALESCE(IF(a > 0, COALESCE(a, 0), 0), 1), 1), 2), 2) > 3, COALESCE(IF(IF(IF(a > 0, COALESCE(a, 0), 0) > 1, COALESCE(IF(a > 0, COALESCE(a, 0), 0), 1), 1) > 2, COALESCE(IF(IF(a > 0, COALESCE(a, 0), 0) > 1, COALESCE(IF(a > 0, COALESCE(a, 0), 0), 1), 1), 2), 2), 3), 3) > 4, COALESCE(IF(IF(IF(IF(a > 0, COALESCE(a, 0), 0) > 1, COALESCE(IF(a > 0, COALESCE(a, 0), 0), 1), 1) > 2, COALESCE(IF(IF(a > 0, COALESCE(a, 0), 0) > 1, COALESCE(IF(a > 0, COALESCE(a, 0), 0), 1), 1), 2), 2) > 3, COALESCE(IF(IF(IF(a > 0, COALESCE(a, 0), 0) > 1, COALESCE(IF(a > 0, COALESCE(a, 0), 0), 1), 1) > 2, COALESCE(IF(IF(a > 0, COALESCE(a, 0), 0) > 1, COALESCE(IF(a > 0, COALESCE(a, 0), 0), 1), 1), 2), 2), 3), 3), 4), 4), 5), 5) + 6) + 7) + 8) + 9) + 10) + 11) + 12) + 13) + 14) + 15) + 16) + 17) + 18) + 19) + 20) + 21) + 22) + 23) + 24) + 25) + 26) + 27) + 28) + 29) + 30) + 31) + 32) + 33) + 34) + 35) + 36) + 37) + 38) + 39) + 40) + 41) + 42) + 43) + 44) + 45) + 46) + 47) AS v FROM t WHERE b = 1
+SELECT * FROM t WHERE (a = 0 AND (b = 0 OR c = 0)) OR (a = 1 AND (b = 1 OR c = 1)) OR (a = 2 AND (b = 2 OR c = 2)) OR (a = 3 AND (b = 3 OR c = 3)) OR (a = 4 AND (b = 4 OR c = 4)) OR (a = 5 AND (b = 5 OR c = 5)) OR (a = 6 AND (b = 6 OR c = 6)) OR (a = 7 AND (b = 7 OR c = 7)) OR (a = 8 AND (b = 8 OR c = 8)) OR (a = 9 AND (b = 9 OR c = 9)) OR (a = 10 AND (b = 10 OR c = 10)) OR (a = 11 AND (b = 11 OR c = 11)) OR (a = 12 AND (b = 12 OR c = 12)) OR (a = 13 AND (b = 13 OR c = 13)) OR (a = 14 AND (b = 14 OR c = 14)) OR (a = 15 AND (b = 15 OR c = 15)) OR (a = 16 AND (b = 16 OR c = 16)) OR (a = 17 AND (b = 17 OR c = 17)) OR (a = 18 AND (b = 18 OR c = 18)) OR (a = 19 AND (b = 19 OR c = 19)) OR (a = 20 AND (b = 20 OR c = 20)) OR (a = 21 AND (b = 21 OR c = 21)) OR (a = 22 AND (b = 22 OR c = 22)) OR (a = 23 AND (b = 23 OR c = 23)) OR (a = 24 AND (b = 24 OR c = 24)) OR (a = 25 AND (b = 25 OR c = 25)) OR (a = 26 AND (b = 26 OR c = 26)) OR (a = 27 AND (b = 27 OR c = 27)) OR (a = 28 AND (b = 28 OR c = 28)) OR (a = 29 AND (b = 29 OR c = 29)) OR (a = 30 AND (b = 30 OR c = 30)) OR (a = 31 AND (b = 31 OR c = 31)) OR (a = 32 AND (b = 32 OR c = 32)) OR (a = 33 AND (b = 33 OR c = 33)) OR (a = 34 AND (b = 34 OR c = 34)) OR (a = 35 AND (b = 35 OR c = 35)) OR (a = 36 AND (b = 36 OR c = 36)) OR (a = 37 AND (b = 37 OR c = 37)) OR (a = 38 AND (b = 38 OR c = 38)) OR (a = 39 AND (b = 39 OR c = 39)) OR (a = 40 AND (b = 40 OR c = 40)) OR (a = 41 AND (b = 41 OR c = 41)) OR (a = 42 AND (b = 42 OR c = 42)) OR (a = 43 AND (b = 43 OR c = 43)) OR (a = 44 AND (b = 44 OR c = 44)) OR (a = 45 AND (b = 45 OR c = 45)) OR (a = 46 AND (b = 46 OR c = 46)) OR (a = 47 AND (b = 47 OR c = 47)) OR (a = 48 AND (b = 48 OR c = 48)) OR (a = 49 AND (b = 49 OR c = 49)) OR (a = 50 AND (b = 50 OR c = 50)) OR (a = 51 AND (b = 51 OR c = 51)) OR (a = 52 AND (b = 52 OR c = 52)) OR (a = 53 AND (b = 53 OR c = 53)) OR (a = 54 AND (b = 54 OR c = 54)) OR (a = 55 AND (b = 55 OR c = 55)) OR (a = 56 AND (b = 56 OR c = 56)) OR (a = 57 AND (b = 57 OR c = 57)) OR (a = 58 AND (b = 58 OR c = 58)) OR (a = 59 AND (b = 59 OR c = 59)) OR (a = 60 AND (b = 60 OR c = 60)) OR (a = 61 AND (b = 61 OR c = 61)) OR (a = 62 AND (b = 62 OR c = 62)) OR (a = 63 AND (b = 63 OR c = 63)) OR (a = 64 AND (b = 64 OR c = 64)) OR (a = 65 AND (b = 65 OR c = 65)) OR (a = 66 AND (b = 66 OR c = 66)) OR (a = 67 AND (b = 67 OR c = 67)) OR (a = 68 AND (b = 68 OR c = 68)) OR (a = 69 AND (b = 69 OR c = 69)) OR (a = 70 AND (b = 70 OR c = 70)) OR (a = 71 AND (b = 71 OR c = 71)) OR (a = 72 AND (b = 72 OR c = 72)) OR (a = 73 AND (b = 73 OR c = 73)) OR (a = 74 AND (b = 74 OR c = 74)) OR (a = 75 AND (b = 75 OR c = 75)) OR (a = 76 AND (b = 76 OR c = 76)) OR (a = 77 AND (b = 77 OR c = 77)) OR (a = 78 AND (b = 78 OR c = 78)) OR (a = 79 AND (b = 79 OR c = 79)) OR (a = 80 AND (b = 80 OR c = 80)) OR (a = 81 AND (b = 81 OR c = 81)) OR (a = 82 AND (b = 82 OR c = 82)) OR (a = 83 AND (b = 83 OR c = 83)) OR (a = 84 AND (b = 84 OR c = 84)) OR (a = 85 AND (b = 85 OR c = 85)) OR (a = 86 AND (b = 86 OR c = 86)) OR (a = 87 AND (b = 87 OR c = 87)) OR (a = 88 AND (b = 88 OR c = 88)) OR (a = 89 AND (b = 89 OR c = 89)) OR (a = 90 AND (b = 90 OR c = 90)) OR (a = 91 AND (b = 91 OR c = 91)) OR (a = 92 AND (b = 92 OR c = 92)) OR (a = 93 AND (b = 93 OR c = 93)) OR (a = 94 AND (b = 94 OR c = 94)) OR (a = 95 AND (b = 95 OR c = 95)) OR (a = 96 AND (b = 96 OR c = 96)) OR (a = 97 AND (b = 97 OR c = 97)) OR (a = 98 AND (b = 98 OR c = 98)) OR (a = 99 AND (b = 99 OR c = 99)) OR (a = 100 AND (b = 100 OR c = 100)) OR (a = 101 AND (b = 101 OR c = 101)) OR (a = 102 AND (b = 102 OR c = 102)) OR (a = 103 AND (b = 103 OR c = 103)) OR (a = 104 AND (b = 104 OR c = 104)) OR (a = 105 AND (b = 105 OR c = 105)) OR (a = 106 AND (b = 106 OR c = 106)) OR (a = 107 AND (b = 107 OR c = 107)) OR (a = 108 AND (b = 108 OR c = 108)) OR (a = 109 AND (b = 109 OR c = 109)) OR (a = 110 AND (b = 110 OR c = 110)) OR (a = 111 AND (b = 111 OR c = 111)) OR (a = 112 AND (b = 112 OR c = 112)) OR (a = 113 AND (b = 113 OR c = 113)) OR (a = 114 AND (b = 114 OR c = 114)) OR (a = 115 AND (b = 115 OR c = 115)) OR (a = 116 AND (b = 116 OR c = 116)) OR (a = 117 AND (b = 117 OR c = 117)) OR (a = 118 AND (b = 118 OR c = 118)) OR (a = 119 AND (b = 119 OR c = 119)) OR (a = 120 AND (b = 120 OR c = 120)) OR (a = 121 AND (b = 121 OR c = 121)) OR (a = 122 AND (b = 122 OR c = 122)) OR (a = 123 AND (b = 123 OR c = 123)) OR (a = 124 AND (b = 124 OR c = 124)) OR (a = 125 AND (b = 125 OR c = 125)) OR (a = 126 AND (b = 126 OR c = 126)) OR (a = 127 AND (b = 127 OR c = 127)) OR (a = 128 AND (b = 128 OR c = 128)) OR (a = 129 AND (b = 129 OR c = 129)) OR (a = 130 AND (b = 130 OR c = 130)) OR (a = 131 AND (b = 131 OR c = 131)) OR (a = 132 AND (b = 132 OR c = 132)) OR (a = 133 AND (b = 133 OR c = 133)) OR (a = 134 AND (b = 134 OR c = 134)) OR (a = 135 AND (b = 135 OR c = 135)) OR (a = 136 AND (b = 136 OR c = 136)) OR (a = 137 AND (b = 137 OR c = 137)) OR (a = 138 AND (b = 138 OR c = 138)) OR (a = 139 AND (b = 139 OR c = 139)) OR (a = 140 AND (b = 140 OR c = 140)) OR (a = 141 AND (b = 141 OR c = 141)) OR (a = 142 AND (b = 142 OR c = 142)) OR (a = 143 AND (b = 143 OR c = 143)) OR (a = 144 AND (b = 144 OR c = 144)) OR (a = 145 AND (b = 145 OR c = 145)) OR (a = 146 AND (b = 146 OR c = 146)) OR (a = 147 AND (b = 147 OR c = 147)) OR (a = 148 AND (b = 148 OR c = 148)) OR (a = 149 AND (b = 149 OR c = 149)) OR (a = 150 AND (b = 150 OR c = 150)) OR (a = 151 AND (b = 151 OR c = 151)) OR (a = 152 AND (b = 152 OR c = 152)) OR (a = 153 AND (b = 153 OR c = 153)) OR (a = 154 AND (b = 154 OR c = 154)) OR (a = 155 AND (b = 155 OR c = 155)) OR (a = 156 AND (b = 156 OR c = 156)) OR (a = 157 AND (b = 157 OR c = 157)) OR (a = 158 AND (b = 158 OR c = 158)) OR (a = 159 AND (b = 159 OR c = 159)) OR (a = 160 AND (b = 160 OR c = 160)) OR (a = 161 AND (b = 161 OR c = 161)) OR (a = 162 AND (b = 162 OR c = 162)) OR (a = 163 AND (b = 163 OR c = 163)) OR (a = 164 AND (b = 164 OR c = 164)) OR (a = 165 AND (b = 165 OR c = 165)) OR (a = 166 AND (b = 166 OR c = 166)) OR (a = 167 AND (b = 167 OR c = 167)) OR (a = 168 AND (b = 168 OR c = 168)) OR (a = 169 AND (b = 169 OR c = 169)) OR (a = 170 AND (b = 170 OR c = 170)) OR (a = 171 AND (b = 171 OR c = 171)) OR (a = 172 AND (b = 172 OR c = 172)) OR (a = 173 AND (b = 173 OR c = 173)) OR (a = 174 AND (b = 174 OR c = 174)) OR (a = 175 AND (b = 175 OR c = 175)) OR (a = 176 AND (b = 176 OR c = 176)) OR (a = 177 AND (b = 177 OR c = 177)) OR (a = 178 AND (b = 178 OR c = 178)) OR (a = 179 AND (b = 179 OR c = 179)) OR (a = 180 AND (b = 180 OR c = 180)) OR (a = 181 AND (b = 181 OR c = 181)) OR (a = 182 AND (b = 182 OR c = 182)) OR (a = 183 AND (b = 183 OR c = 183)) OR (a = 184 AND (b = 184 OR c = 184)) OR (a = 185 AND (b = 185 OR c = 185)) OR (a = 186 AND (b = 186 OR c = 186)) OR (a = 187 AND (b = 187 OR c = 187)) OR (a = 188 AND (b = 188 OR c = 188)) OR (a = 189 AND (b = 189 OR c = 189)) OR (a = 190 AND (b = 190 OR c = 190)) OR (a = 191 AND (b = 191 OR c = 191)) OR (a = 192 AND (b = 192 OR c = 192)) OR (a = 193 AND (b = 193 OR c = 193)) OR (a = 194 AND (b = 194 OR c = 194)) OR (a = 195 AND (b = 195 OR c = 195)) OR (a = 196 AND (b = 196 OR c = 196)) OR (a = 197 AND (b = 197 OR c = 197)) OR (a = 198 AND (b = 198 OR c = 198)) OR (a = 199 AND (b = 199 OR c = 199))
@@ -0,0 +1,9 @@
+-- Statements shaped like ORM output: long column lists, generated aliases, several joins.
+SELECT t0.id AS id_1, t0.email AS email_2, t0.name AS name_3, t0.created_at AS created_at_4, t0.updated_at AS updated_at_5, t0.status AS status_6, t7.id AS id_8, t7.street AS street_9, t7.city AS city_10, t7.postcode AS postcode_11, t7.country_code AS country_code_12, t13.id AS id_14, t13.plan AS plan_15, t13.renews_at AS renews_at_16 FROM users t0 LEFT JOIN addresses t7 ON t7.user_id = t0.id AND t7.is_primary = 1 LEFT JOIN subscriptions t13 ON t13.user_id = t0.id WHERE t0.status = 'active' AND t0.created_at >= '2024-01-01 00:00:00' ORDER BY t0.created_at DESC LIMIT 50 OFFSET 100
+SELECT `orders`.`id`, `orders`.`number`, `orders`.`total_cents`, `orders`.`currency`, `orders`.`placed_at`, `customers`.`id` AS `customer_id`, `customers`.`name` AS `customer_name`, `order_items`.`sku`, `order_items`.`quantity`, `order_items`.`unit_cents`, `products`.`name` AS `product_name`, `warehouses`.`code` AS `warehouse_code` FROM `orders` INNER JOIN `customers` ON `customers`.`id` = `orders`.`customer_id` INNER JOIN `order_items` ON `order_items`.`order_id` = `orders`.`id` INNER JOIN `products` ON `products`.`id` = `order_items`.`product_id` LEFT JOIN `warehouses` ON `warehouses`.`id` = `order_items`.`warehouse_id` WHERE `orders`.`placed_at` BETWEEN '2024-03-01' AND '2024-03-31' AND `orders`.`status` IN ('paid', 'shipped', 'delivered') AND `customers`.`deleted_at` IS NULL ORDER BY `orders`.`placed_at` DESC, `order_items`.`id` ASC LIMIT 200
+SELECT p.id, p.title, p.excerpt, p.published_at, a.id AS author_id, a.display_name, COUNT(DISTINCT c.id) AS comment_count, COUNT(DISTINCT l.user_id) AS like_count, GROUP_CONCAT(DISTINCT t.name ORDER BY t.name SEPARATOR ',') AS tags FROM posts p JOIN authors a ON a.id = p.author_id LEFT JOIN comments c ON c.post_id = p.id AND c.approved = 1 LEFT JOIN likes l ON l.post_id = p.id LEFT JOIN post_tags pt ON pt.post_id = p.id LEFT JOIN tags t ON t.id = pt.tag_id WHERE p.published_at <= NOW() AND p.visibility = 'public' GROUP BY p.id, p.title, p.excerpt, p.published_at, a.id, a.display_name HAVING comment_count > 0 ORDER BY p.published_at DESC LIMIT 20
+SELECT i.id, i.invoice_no, i.issued_on, i.due_on, i.amount, i.paid_amount, c.legal_name, c.vat_id, ba.iban, ba.bic, (SELECT MAX(pm.received_at) FROM payments pm WHERE pm.invoice_id = i.id) AS last_payment_at, (SELECT COUNT(*) FROM reminders r WHERE r.invoice_id = i.id) AS reminders_sent FROM invoices i INNER JOIN companies c ON c.id = i.company_id LEFT JOIN bank_accounts ba ON ba.company_id = c.id AND ba.is_default = 1 WHERE i.due_on < CURDATE() AND i.paid_amount < i.amount AND c.id IN (SELECT company_id FROM company_users WHERE user_id = 991 AND role IN ('owner', 'accountant')) ORDER BY i.due_on ASC, i.id ASC LIMIT 100
+WITH recent AS (SELECT user_id, MAX(created_at) AS last_seen FROM events WHERE created_at > NOW() - INTERVAL 30 DAY GROUP BY user_id) SELECT u.id, u.email, r.last_seen, ROW_NUMBER() OVER (PARTITION BY u.country ORDER BY r.last_seen DESC) AS country_rank FROM users u JOIN recent r ON r.user_id = u.id WHERE u.marketing_opt_in = 1 ORDER BY r.last_seen DESC LIMIT 500
+SELECT s.id, s.starts_at, s.ends_at, s.room_id, rm.name AS room_name, rm.capacity, b.id AS booking_id, b.guest_count, g.id AS guest_id, g.first_name, g.last_name, g.email, pay.status AS payment_status, pay.amount_cents FROM slots s JOIN rooms rm ON rm.id = s.room_id LEFT JOIN bookings b ON b.slot_id = s.id AND b.cancelled_at IS NULL LEFT JOIN guests g ON g.id = b.guest_id LEFT JOIN payments pay ON pay.booking_id = b.id WHERE s.starts_at >= '2024-06-01 08:00:00' AND s.ends_at <= '2024-06-01 20:00:00' AND rm.venue_id = 12 AND (b.id IS NULL OR pay.status <> 'refunded') ORDER BY rm.name, s.starts_at
+UPDATE inventory inv JOIN order_items oi ON oi.product_id = inv.product_id AND oi.warehouse_id = inv.warehouse_id JOIN orders o ON o.id = oi.order_id SET inv.reserved = inv.reserved - oi.quantity, inv.updated_at = NOW() WHERE o.id = 55012 AND o.status = 'cancelled'
+DELETE n FROM notifications n LEFT JOIN users u ON u.id = n.user_id WHERE u.id IS NULL OR (n.read_at IS NOT NULL AND n.read_at < NOW() - INTERVAL 90 DAY)
@@ -0,0 +1,22 @@
+-- Short primary-key and unique-key lookups, the bulk of typical web traffic.
+-- One statement per line; lines starting with "--" are ignored.
+SELECT * FROM users WHERE id = 42
+SELECT id, email FROM users WHERE email = 'alice@example.com' LIMIT 1
+SELECT name, price FROM products WHERE sku = 'SKU-10293'
+SELECT COUNT(*) FROM sessions WHERE user_id = 17
+SELECT `value` FROM settings WHERE `key` = 'site.name'
+SELECT id FROM orders WHERE customer_id = ? AND status = ? ORDER BY created_at DESC LIMIT 10
+SELECT * FROM posts WHERE slug = :slug AND published = 1
+SELECT token, expires_at FROM password_resets WHERE email = 'bob@example.com' ORDER BY created_at DESC LIMIT 1
+SELECT 1
+SELECT NOW()
+INSERT INTO audit_log (user_id, action, created_at) VALUES (42, 'login', NOW())
+UPDATE users SET last_login_at = NOW() WHERE id = 42
+DELETE FROM sessions WHERE expires_at < NOW()
+REPLACE INTO counters (name, value) VALUES ('page_views', 1)
+SELECT id, name FROM categories WHERE parent_id IS NULL ORDER BY position
+SELECT u.id, u.name FROM users u WHERE u.id IN (1, 2, 3, 4, 5)
+UPDATE products SET stock = stock - 1 WHERE id = 7 AND stock > 0
+SELECT EXISTS(SELECT 1 FROM follows WHERE follower_id = 3 AND followee_id = 9)
+SELECT id FROM jobs WHERE queue = 'default' AND reserved_at IS NULL ORDER BY id LIMIT 1 FOR UPDATE SKIP LOCKED
+INSERT INTO cache (k, v, expires) VALUES ('user:42', '{"name":"Alice"}', 1700000000) ON DUPLICATE KEY UPDATE v = VALUES(v), expires = VALUES(expires)
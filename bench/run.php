@@ -0,0 +1,335 @@
+<?php
+/**
+ * Benchmark runner for the mysql_qp extension.
+ *
+ * Drives mysql_validate_query(), mysql_parse_query(), mysql_decompose_query(),
+ * mysql_reconstruct_query() and mysql_build_query() over the corpus in
+ * bench/corpus and prints one JSON document: throughput, p50/p99/p999
+ * latency, peak bytes per call and server round trips per call, for every
+ * function, corpus file and cache mode.
+ *
+ * Every measurement runs in a fresh PHP process with only the extension
+ * loaded, so results don't leak between runs. Usually started by `make bench`:
+ *
+ *   php bench/run.php --extension=modules/mysql_qp.so [--server=stub|mysql|none]
+ *       [--dsn=...] [--user=...] [--password=...] [--iterations=5]
+ *       [--filter=regex] [--output=file.json]
+ *
+ * --server=stub (the default) starts bench/stub_server.php, a fake MySQL
+ * server that accepts any statement, so the paths that fall back to the
+ * server are exercised without a mysqld and every round trip is counted.
+ * --server=mysql uses the server in --dsn; round trips are then read from
+ * its global status counters when mysqli is available. --server=none
+ * points the extension at an unreachable address, so only CPU-only paths
+ * return useful results.
+ */
+
+const FUNCTIONS = [
+    'mysql_validate_query',
+    'mysql_parse_query',
+    'mysql_decompose_query',
+    'mysql_reconstruct_query',
+    'mysql_build_query',
+];
+
+const CACHE_MODES = ['uncached' => 0, 'cached' => 4096];
+
+$options = getopt('', [
+    'extension:', 'server:', 'dsn:', 'user:', 'password:', 'iterations:', 'filter:', 'output:',
+    'worker', 'function:', 'corpus:', 'counter:',
+]);
+
+if (isset($options['worker'])) {
+    exit(run_worker($options));
+}
+exit(run_all($options));
+
+/* Orchestration */
+
+function run_all(array $options): int
+{
+    $extension = $options['extension'] ?? null;
+    if ($extension === null || !is_file($extension)) {
+        fwrite(STDERR, "Usage: php bench/run.php --extension=path/to/mysql_qp.so [options]\n");
+        return 2;
+    }
+
+    $server = $options['server'] ?? 'stub';
+    $iterations = max(1, (int) ($options['iterations'] ?? 5));
+    $filter = $options['filter'] ?? null;
+    $stub = null;
+    $counter = null;
+
+    switch ($server) {
+        case 'stub':
+            $counter = tempnam(sys_get_temp_dir(), 'mysql_qp_bench');
+            $stub = start_stub($counter);
+            $ini = [
+                'mysql_qp.dsn' => 'mysql:host=127.0.0.1;port=' . $stub['port'] . ';dbname=bench',
+                'mysql_qp.user' => 'bench',
+                'mysql_qp.password' => '',
+            ];
+            break;
+        case 'mysql':
+            $ini = [
+                'mysql_qp.dsn' => $options['dsn'] ?? 'mysql:host=127.0.0.1;dbname=mysql_qp_test',
+                'mysql_qp.user' => $options['user'] ?? 'root',
+                'mysql_qp.password' => $options['password'] ?? '',
+            ];
+            break;
+        case 'none':
+            /* Nothing listens on port 1, so server fallbacks fail fast */
+            $ini = ['mysql_qp.dsn' => 'mysql:host=127.0.0.1;port=1'];
+            break;
+        default:
+            fwrite(STDERR, "Unknown --server=$server; expected stub, mysql or none\n");
+            return 2;
+    }
+
+    $results = [];
+    foreach (glob(__DIR__ . '/corpus/*.sql') as $corpus) {
+        foreach (FUNCTIONS as $function) {
+            foreach (CACHE_MODES as $mode => $cache_size) {
+                $name = $function . '/' . basename($corpus, '.sql') . '/' . $mode;
+                if ($filter !== null && !preg_match('{' . $filter . '}', $name)) {
+                    continue;
+                }
+                fwrite(STDERR, "$name\n");
+                $result = run_child($extension, $ini + ['mysql_qp.cache_size' => $cache_size], [
+                    '--worker',
+                    '--function=' . $function,
+                    '--corpus=' . $corpus,
+                    '--iterations=' . $iterations,
+                    ...($counter !== null ? ['--counter=' . $counter] : []),
+                    ...($server === 'mysql' ? mysql_credentials($ini) : []),
+                ]);
+                $results[] = ['function' => $function, 'corpus' => basename($corpus, '.sql'), 'cache' => $mode] + $result;
+            }
+        }
+    }
+
+    if ($stub !== null) {
+        proc_terminate($stub['process']);
+        proc_close($stub['process']);
+        unlink($counter);
+    }
+
+    $report = json_encode([
+        'meta' => [
+            'php' => PHP_VERSION,
+            'os' => php_uname('s') . ' ' . php_uname('r') . ' ' . php_uname('m'),
+            'server' => $server,
+            'iterations' => $iterations,
+            'date' => gmdate('c'),
+        ],
+        'results' => $results,
+    ], JSON_PRETTY_PRINT | JSON_UNESCAPED_SLASHES) . "\n";
+
+    if (isset($options['output'])) {
+        file_put_contents($options['output'], $report);
+    } else {
+        echo $report;
+    }
+    return 0;
+}
+
+/* The worker reads the server's counters itself, so it needs mysqli and the credentials */
+function mysql_credentials(array $ini): array
+{
+    return [
+        '--dsn=' . $ini['mysql_qp.dsn'],
+        '--user=' . $ini['mysql_qp.user'],
+        '--password=' . $ini['mysql_qp.password'],
+    ];
+}
+
+function run_child(string $extension, array $ini, array $args): array
+{
+    $command = [PHP_BINARY, '-n', '-d', 'extension=' . $extension];
+    if (in_array('--dsn=' . ($ini['mysql_qp.dsn'] ?? ''), $args, true) && extension_loaded('mysqli')) {
+        $command[] = '-d';
+        $command[] = 'extension=mysqli';
+    }
+    foreach ($ini as $name => $value) {
+        $command[] = '-d';
+        $command[] = $name . '=' . $value;
+    }
+    $command[] = __FILE__;
+    array_push($command, ...$args);
+
+    $process = proc_open($command, [1 => ['pipe', 'w'], 2 => STDERR], $pipes);
+    $output = stream_get_contents($pipes[1]);
+    fclose($pipes[1]);
+    $status = proc_close($process);
+
+    $result = json_decode($output, true);
+    if ($status !== 0 || !is_array($result)) {
+        return ['error' => 'worker exited with status ' . $status . ': ' . trim($output)];
+    }
+    return $result;
+}
+
+function start_stub(string $counter): array
+{
+    $process = proc_open(
+        [PHP_BINARY, '-n', __DIR__ . '/stub_server.php', '--counter=' . $counter],
+        [1 => ['pipe', 'w'], 2 => STDERR],
+        $pipes
+    );
+    $port = (int) fgets($pipes[1]);
+    if ($port <= 0) {
+        fwrite(STDERR, "The stub server did not start\n");
+        exit(1);
+    }
+    return ['process' => $process, 'port' => $port, 'stdout' => $pipes[1]];
+}
+
+/* Worker: one function, one corpus file, one cache mode */
+
+function run_worker(array $options): int
+{
+    $function = $options['function'];
+    $queries = load_corpus($options['corpus']);
+    $iterations = (int) $options['iterations'];
+
+    $inputs = prepare_inputs($function, $queries);
+    if (!$inputs) {
+        echo json_encode(['skipped' => 'no input in this corpus supports ' . $function]);
+        return 0;
+    }
+
+    /* Warm up: connections are opened and, in cached mode, the cache is filled */
+    foreach ($inputs as $input) {
+        $function($input);
+    }
+
+    $latencies = [];
+    $peak_bytes = 0;
+    $round_trips = round_trips($options);
+    $started = hrtime(true);
+    $busy = 0;
+
+    for ($i = 0; $i < $iterations; $i++) {
+        foreach ($inputs as $input) {
+            $base = memory_get_usage();
+            memory_reset_peak_usage();
+            $t0 = hrtime(true);
+            $result = $function($input);
+            $elapsed = hrtime(true) - $t0;
+            $peak_bytes += memory_get_peak_usage() - $base;
+            unset($result);
+
+            $latencies[] = $elapsed;
+            $busy += $elapsed;
+        }
+    }
+
+    $wall = hrtime(true) - $started;
+    $after = round_trips($options);
+    $calls = count($latencies);
+    sort($latencies);
+
+    echo json_encode([
+        'inputs' => count($inputs),
+        'calls' => $calls,
+        'ops_per_sec' => round($calls / ($busy / 1e9), 1),
+        'latency_ns' => [
+            'p50' => percentile($latencies, 0.50),
+            'p99' => percentile($latencies, 0.99),
+            'p999' => percentile($latencies, 0.999),
+            'max' => end($latencies),
+        ],
+        'peak_bytes_per_call' => (int) round($peak_bytes / $calls),
+        'round_trips_per_call' => $round_trips === null || $after === null ? null : round(($after - $round_trips) / $calls, 4),
+        'wall_ms' => round($wall / 1e6, 1),
+    ]);
+    return 0;
+}
+
+/* Nearest-rank percentile of sorted values */
+function percentile(array $sorted, float $p): int
+{
+    return $sorted[max(0, (int) ceil($p * count($sorted)) - 1)];
+}
+
+/* Statements of a corpus file: one per line, "--" lines are comments */
+function load_corpus(string $path): array
+{
+    $queries = [];
+    $expand_to = 0;
+
+    foreach (file($path, FILE_IGNORE_NEW_LINES) as $line) {
+        if (preg_match('/^--\s*bench:\s*expand-values-to=(\d+)([KMG]?)/i', $line, $m)) {
+            $expand_to = (int) $m[1] * ['' => 1, 'K' => 1 << 10, 'M' => 1 << 20, 'G' => 1 << 30][strtoupper($m[2])];
+        } elseif (trim($line) !== '' && !str_starts_with(ltrim($line), '--')) {
+            $queries[] = $expand_to ? expand_values($line, $expand_to) : $line;
+        }
+    }
+    return $queries;
+}
+
+/* Repeat the rows after VALUES until the statement is about $size bytes */
+function expand_values(string $query, int $size): string
+{
+    $at = stripos($query, ' VALUES ');
+    if ($at === false) {
+        return $query;
+    }
+    $rows = substr($query, $at + strlen(' VALUES '));
+    $repeat = max(1, intdiv($size, strlen($rows) + 2));
+    return substr($query, 0, $at) . ' VALUES ' . implode(', ', array_fill(0, $repeat, $rows));
+}
+
+/* What each function is called with, derived from the corpus outside the timed loop */
+function prepare_inputs(string $function, array $queries): array
+{
+    switch ($function) {
+        case 'mysql_reconstruct_query':
+            return array_map('mysql_decompose_query', $queries);
+        case 'mysql_build_query':
+            $trees = [];
+            foreach ($queries as $query) {
+                $parsed = mysql_parse_query($query);
+                if (isset($parsed['parse_tree'])) {
+                    $trees[] = $parsed['parse_tree'];
+                }
+            }
+            return $trees;
+        default:
+            return $queries;
+    }
+}
+
+/* Server round trips so far: from the stub's counter file, or the server's status counters */
+function round_trips(array $options): ?int
+{
+    if (isset($options['counter'])) {
+        clearstatcache();
+        return (int) file_get_contents($options['counter']);
+    }
+    if (!isset($options['dsn']) || !extension_loaded('mysqli')) {
+        return null;
+    }
+
+    static $link = null;
+    if ($link === null) {
+        $dsn = [];
+        foreach (explode(';', preg_replace('/^mysql:/i', '', $options['dsn'])) as $part) {
+            [$key, $value] = array_pad(explode('=', $part, 2), 2, null);
+            $dsn[$key] = $value;
+        }
+        $link = @mysqli_connect($dsn['host'] ?? 'localhost', $options['user'] ?? 'root', $options['password'] ?? '',
+            '', (int) ($dsn['port'] ?? 3306), $dsn['unix_socket'] ?? null);
+        if (!$link) {
+            return null;
+        }
+    }
+
+    /* Prepares aren't counted in Questions; our own SHOW is, and is subtracted */
+    $total = -1;
+    $result = mysqli_query($link, "SHOW GLOBAL STATUS WHERE Variable_name IN ('Questions', 'Com_stmt_prepare')");
+    while ($row = mysqli_fetch_row($result)) {
+        $total += (int) $row[1];
+    }
+    return $total;
+}
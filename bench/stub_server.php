@@ -0,0 +1,235 @@
+<?php
+/**
+ * A stand-in MySQL server for the benchmarks.
+ *
+ * Speaks just enough of the client/server protocol for the extension's
+ * server fallbacks: any login is accepted, every query succeeds with an OK
+ * packet and every prepare succeeds with no columns and no parameters. Each
+ * command that gets a reply counts as one round trip; the running total is
+ * written to the --counter file so the benchmark can report round trips
+ * per call without a real mysqld.
+ *
+ *   php bench/stub_server.php [--port=0] [--counter=file]
+ *
+ * The listening port is printed on the first line of stdout.
+ */
+
+const CLIENT_LONG_PASSWORD = 0x00000001;
+const CLIENT_FOUND_ROWS = 0x00000002;
+const CLIENT_LONG_FLAG = 0x00000004;
+const CLIENT_CONNECT_WITH_DB = 0x00000008;
+const CLIENT_PROTOCOL_41 = 0x00000200;
+const CLIENT_TRANSACTIONS = 0x00002000;
+const CLIENT_SECURE_CONNECTION = 0x00008000;
+const CLIENT_MULTI_STATEMENTS = 0x00010000;
+const CLIENT_MULTI_RESULTS = 0x00020000;
+const CLIENT_PS_MULTI_RESULTS = 0x00040000;
+const CLIENT_PLUGIN_AUTH = 0x00080000;
+
+const SERVER_STATUS_AUTOCOMMIT = 0x0002;
+const SERVER_MORE_RESULTS_EXISTS = 0x0008;
+
+const COM_QUIT = 0x01;
+const COM_INIT_DB = 0x02;
+const COM_QUERY = 0x03;
+const COM_PING = 0x0e;
+const COM_STMT_PREPARE = 0x16;
+const COM_STMT_CLOSE = 0x19;
+const COM_STMT_RESET = 0x1a;
+const COM_SET_OPTION = 0x1b;
+const COM_RESET_CONNECTION = 0x1f;
+
+$options = getopt('', ['port:', 'counter:']);
+$server = stream_socket_server('tcp://127.0.0.1:' . (int) ($options['port'] ?? 0), $errno, $errstr);
+if (!$server) {
+    fwrite(STDERR, "stub_server: $errstr\n");
+    exit(1);
+}
+echo parse_url('tcp://' . stream_socket_get_name($server, false), PHP_URL_PORT), "\n";
+fflush(STDOUT);
+
+$counter = $options['counter'] ?? null;
+$round_trips = 0;
+$clients = [];
+$next_statement = 1;
+
+for (;;) {
+    $read = [$server];
+    foreach ($clients as $client) {
+        $read[] = $client['socket'];
+    }
+    $write = $except = null;
+    if (stream_select($read, $write, $except, null) === false) {
+        break;
+    }
+
+    foreach ($read as $socket) {
+        if ($socket === $server) {
+            $socket = stream_socket_accept($server);
+            if ($socket) {
+                stream_set_blocking($socket, true);
+                $clients[(int) $socket] = ['socket' => $socket, 'authenticated' => false, 'buffer' => ''];
+                send_handshake($socket);
+            }
+            continue;
+        }
+
+        $id = (int) $socket;
+        $data = fread($socket, 65536);
+        if ($data === '' || $data === false) {
+            fclose($socket);
+            unset($clients[$id]);
+            continue;
+        }
+        $clients[$id]['buffer'] .= $data;
+
+        while (($packet = take_packet($clients[$id]['buffer'])) !== null) {
+            if (!$clients[$id]['authenticated']) {
+                /* Whatever the client sent as credentials is good enough */
+                $clients[$id]['authenticated'] = true;
+                send_packet($socket, 2, ok_packet());
+                continue;
+            }
+            if (!handle_command($socket, $packet)) {
+                fclose($socket);
+                unset($clients[$id]);
+                break;
+            }
+            $round_trips++;
+        }
+
+        if ($counter !== null) {
+            file_put_contents($counter, (string) $round_trips);
+        }
+    }
+}
+
+/* Returns false when the connection should be closed */
+function handle_command($socket, string $packet): bool
+{
+    global $next_statement;
+
+    switch (ord($packet[0])) {
+        case COM_QUIT:
+            return false;
+
+        case COM_QUERY:
+            $statements = split_statements(substr($packet, 1));
+            $seq = 1;
+            foreach ($statements as $i => $statement) {
+                $more = $i < count($statements) - 1 ? SERVER_MORE_RESULTS_EXISTS : 0;
+                send_packet($socket, $seq++, ok_packet($more));
+            }
+            return true;
+
+        case COM_STMT_PREPARE:
+            /* status, statement id, columns, parameters, filler, warnings */
+            send_packet($socket, 1, pack('CVvvCv', 0, $next_statement++, 0, 0, 0, 0));
+            return true;
+
+        case COM_STMT_CLOSE:
+            /* No reply */
+            return true;
+
+        case COM_SET_OPTION:
+            send_packet($socket, 1, pack('Cvv', 0xfe, 0, SERVER_STATUS_AUTOCOMMIT));
+            return true;
+
+        case COM_INIT_DB:
+        case COM_PING:
+        case COM_STMT_RESET:
+        case COM_RESET_CONNECTION:
+            send_packet($socket, 1, ok_packet());
+            return true;
+
+        default:
+            send_packet($socket, 1, pack('Cv', 0xff, 1047) . '#08S01Unknown command');
+            return true;
+    }
+}
+
+function send_handshake($socket): void
+{
+    $capabilities = CLIENT_LONG_PASSWORD | CLIENT_FOUND_ROWS | CLIENT_LONG_FLAG | CLIENT_CONNECT_WITH_DB
+        | CLIENT_PROTOCOL_41 | CLIENT_TRANSACTIONS | CLIENT_SECURE_CONNECTION | CLIENT_MULTI_STATEMENTS
+        | CLIENT_MULTI_RESULTS | CLIENT_PS_MULTI_RESULTS | CLIENT_PLUGIN_AUTH;
+    $scramble = random_bytes(20);
+    $scramble = strtr($scramble, "\0", "\1");
+
+    $packet = chr(10) . "8.4.0-mysql_qp-stub\0"
+        . pack('V', 1)                      /* connection id */
+        . substr($scramble, 0, 8) . "\0"
+        . pack('v', $capabilities & 0xffff)
+        . chr(255)                          /* utf8mb4_0900_ai_ci */
+        . pack('v', SERVER_STATUS_AUTOCOMMIT)
+        . pack('v', $capabilities >> 16)
+        . chr(21)                           /* scramble length, including the NUL */
+        . str_repeat("\0", 10)
+        . substr($scramble, 8) . "\0"
+        . "caching_sha2_password\0";
+
+    send_packet($socket, 0, $packet);
+}
+
+function ok_packet(int $status = 0): string
+{
+    /* header, affected rows, insert id, status, warnings */
+    return pack('CCCvv', 0x00, 0, 0, SERVER_STATUS_AUTOCOMMIT | $status, 0);
+}
+
+function send_packet($socket, int $seq, string $payload): void
+{
+    fwrite($socket, substr(pack('V', strlen($payload)), 0, 3) . chr($seq & 0xff) . $payload);
+}
+
+/* Removes one whole packet from the buffer, joining 16M continuation packets */
+function take_packet(string &$buffer): ?string
+{
+    $payload = '';
+    $offset = 0;
+    for (;;) {
+        if (strlen($buffer) < $offset + 4) {
+            return null;
+        }
+        $length = unpack('V', substr($buffer, $offset, 3) . "\0")[1];
+        if (strlen($buffer) < $offset + 4 + $length) {
+            return null;
+        }
+        $payload .= substr($buffer, $offset + 4, $length);
+        $offset += 4 + $length;
+        if ($length < 0xffffff) {
+            break;
+        }
+    }
+    $buffer = substr($buffer, $offset);
+    return $payload;
+}
+
+/* Statements of a multi-statement query; semicolons in quotes don't count */
+function split_statements(string $sql): array
+{
+    $statements = [];
+    $start = 0;
+    $quote = null;
+    $length = strlen($sql);
+
+    for ($i = 0; $i < $length; $i++) {
+        $c = $sql[$i];
+        if ($quote !== null) {
+            if ($c === '\\' && $quote !== '`') {
+                $i++;
+            } elseif ($c === $quote) {
+                $quote = null;
+            }
+        } elseif ($c === '\'' || $c === '"' || $c === '`') {
+            $quote = $c;
+        } elseif ($c === ';') {
+            $statements[] = substr($sql, $start, $i - $start);
+            $start = $i + 1;
+        }
+    }
+    if (trim(substr($sql, $start)) !== '' || !$statements) {
+        $statements[] = substr($sql, $start);
+    }
+    return $statements;
+}
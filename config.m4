@@ -28,11 +28,16 @@ if test "$PHP_MYSQL_QP" != "no"; then
   
   dnl Define extension
   AC_DEFINE(HAVE_MYSQL_QP, 1, [Whether you have MySQL Query Parser])
+
+  dnl Static probes for DTrace/bpftrace where <sys/sdt.h> is available
+  MYSQL_QP_USDT_CFLAGS=
+  AC_CHECK_HEADER([sys/sdt.h], [MYSQL_QP_USDT_CFLAGS=-DMYSQL_QP_USDT])
   
   dnl Add source files
   PHP_NEW_EXTENSION(mysql_qp, 
-    src/mysql_qp.c src/query_parser.c src/php_bridge.c src/mysql_client_parser.c src/syntax_only_parser.c src/query_decomposer.c,
-    $ext_shared,, -DZEND_ENABLE_STATIC_TSRMLS_CACHE=1)
+    src/mysql_qp.c src/query_parser.c src/php_bridge.c src/mysql_client_parser.c src/syntax_only_parser.c src/query_decomposer.c src/sql_lexer.c src/sql_arena.c src/query_printer.c src/query_cache.c src/connection_pool.c src/async_validator.c src/query_fingerprint.c src/query_explain.c src/insert_rows.c src/query_template.c src/query_object.c src/shm_cache.c src/query_stats.c src/sql_literal.c src/query_interpolate.c src/query_parameterize.c src/stmt_cache.c src/sql_splitter.c src/sql_script.c src/parallel_validator.c src/query_tables.c src/query_classify.c,
+    $ext_shared,, -DZEND_ENABLE_STATIC_TSRMLS_CACHE=1 $MYSQL_QP_USDT_CFLAGS)
   
   PHP_SUBST(MYSQL_QP_SHARED_LIBADD)
+  PHP_ADD_MAKEFILE_FRAGMENT
 fi
\ No newline at end of file
@@ -0,0 +1,25 @@
+#ifndef ASYNC_VALIDATOR_H
+#define ASYNC_VALIDATOR_H
+
+#include <zend.h>
+#include <mysql.h>
+#include <sys/types.h>
+
+/* Per-thread state of mysql_validate_query_async() */
+typedef struct {
+    HashTable *ops;             /* handle => in-flight or unreported validation; request-scoped */
+    zend_long next_handle;
+    MYSQL **idle;               /* connected, unused connections, kept across requests */
+    size_t idle_count;
+    size_t idle_size;
+    pid_t pid;                  /* process the connections belong to */
+} mysql_qp_async;
+
+/* Function declarations */
+zend_long mysql_async_validate_start(zend_string *query, int flags);
+void mysql_async_poll(double timeout, zval *results);
+int mysql_async_socket(zend_long handle, short *events);
+void mysql_async_end_request(mysql_qp_async *async);
+void mysql_async_destroy(mysql_qp_async *async);
+
+#endif /* ASYNC_VALIDATOR_H */
@@ -0,0 +1,70 @@
+#ifndef CONNECTION_POOL_H
+#define CONNECTION_POOL_H
+
+#include <zend.h>
+#include <zend_atomic.h>
+#include <mysql.h>
+#include <sys/types.h>
+#include <time.h>
+#include "stmt_cache.h"
+
+#define MYSQL_QP_DEFAULT_POOL_SIZE "8"
+#define MYSQL_QP_DEFAULT_DSN "mysql:host=localhost;dbname=mysql_qp_test"
+#define MYSQL_QP_DEFAULT_USER "root"
+
+/* Pooled connections idle for longer than this are pinged before reuse */
+#define MYSQL_QP_PING_INTERVAL 30
+
+/* Server settings from mysql_qp.dsn, .user, .password and .socket */
+typedef struct {
+    char *host;                 /* NULL for the client library default */
+    unsigned int port;
+    char *database;
+    char *socket;
+    char *charset;
+    char *user;
+    char *password;
+} mysql_qp_server;
+
+/* A pooled connection; in_use is claimed with an atomic exchange, never a lock */
+typedef struct {
+    MYSQL *conn;                /* opened lazily by the first thread to claim the slot */
+    time_t last_used;
+    zend_atomic_bool in_use;
+    mysql_stmt_cache stmts;     /* statements prepared on conn; only the lease holder touches it */
+} mysql_qp_pool_slot;
+
+/* Process-wide pool shared by all threads */
+typedef struct {
+    const char *database;       /* NULL for syntax-only connections */
+    unsigned long client_flags; /* passed to mysql_real_connect() */
+    size_t size;
+    mysql_qp_pool_slot *slots;
+    pid_t pid;                  /* owner of the connections; a child reopens them after fork() */
+} mysql_qp_pool;
+
+/* Connection checked out to one thread until the end of its request */
+typedef struct {
+    mysql_qp_pool_slot *slot;   /* NULL when the pool was exhausted and conn is private */
+    MYSQL *conn;
+    pid_t pid;
+} mysql_qp_lease;
+
+extern mysql_qp_server mysql_qp_server_config;
+extern mysql_qp_pool mysql_qp_parser_pool;
+extern mysql_qp_pool mysql_qp_syntax_pool;
+
+/* Function declarations */
+void mysql_qp_server_configure(const char *dsn, const char *user, const char *password, const char *socket);
+void mysql_qp_server_free(void);
+MYSQL* mysql_qp_init_connection(void);
+MYSQL* mysql_qp_connect(const char *database, unsigned long client_flags);
+void mysql_qp_abandon(MYSQL *conn);
+void mysql_qp_pool_init(mysql_qp_pool *pool, size_t size, const char *database, unsigned long client_flags, size_t stmt_cache_size);
+void mysql_qp_pool_destroy(mysql_qp_pool *pool);
+int mysql_qp_pool_acquire(mysql_qp_pool *pool, mysql_qp_lease *lease);
+void mysql_qp_pool_release(mysql_qp_lease *lease);
+void mysql_qp_pool_discard(mysql_qp_lease *lease);
+size_t mysql_qp_pool_in_use(mysql_qp_pool *pool);
+
+#endif /* CONNECTION_POOL_H */
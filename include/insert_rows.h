@@ -0,0 +1,14 @@
+#ifndef INSERT_ROWS_H
+#define INSERT_ROWS_H
+
+#include <zend.h>
+
+/* MysqlQp\InsertRows: the VALUES rows of an INSERT, parsed one per iteration */
+extern zend_class_entry *mysql_qp_insert_rows_ce;
+
+/* Function declarations */
+void mysql_insert_rows_startup(void);
+void mysql_insert_rows_init(zval *rows, zend_string *query, size_t start, size_t end, zend_bool spans);
+int mysql_insert_rows_text(zval *rows, const char **text, size_t *text_len);
+
+#endif /* INSERT_ROWS_H */
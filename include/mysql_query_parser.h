@@ -9,12 +9,29 @@ typedef struct {
     int query_type;
     char *error_message;
     int error_code;
-    char *normalized_query;
+    zend_string *normalized_query;  /* shares the caller's string, never a copy */
     int parameter_count;
     char **parameter_names;
     zval *parse_tree;
+    zval *columns;                  /* result set metadata with MYSQL_QP_METADATA; NULL without a result set */
+    int server_verdict;             /* is_valid came from a PREPARE, so it depends on the schema */
 } mysql_query_result;
 
+/* One statement of a batch validation */
+typedef struct {
+    zend_string *query;
+    int decided;            /* verdict known; undecided items report invalid */
+    int local;              /* decided by the native parser (MYSQL_QP_LOCAL_VERDICT); not cached */
+    int is_valid;
+    int error_code;
+    char *error_message;    /* emalloc'd, may be set for valid syntax too (e.g. unknown table) */
+} mysql_batch_item;
+
+/* Flags for mysql_parse_query(), mysql_decompose_query() and mysql_validate_parallel() */
+#define MYSQL_QP_SPANS (1 << 0)     /* text from the query as [offset, length] instead of a copy */
+#define MYSQL_QP_METADATA (1 << 1)  /* result columns from the server (mysql_parse_query() only) */
+#define MYSQL_QP_LOCAL_VERDICT (1 << 2)   /* the native parser's verdict where it checks the grammar, without the server */
+
 /* Query types enum */
 enum mysql_query_type {
     QUERY_TYPE_UNKNOWN = 0,
@@ -27,19 +44,59 @@ enum mysql_query_type {
     QUERY_TYPE_ALTER = 7,
     QUERY_TYPE_SHOW = 8,
     QUERY_TYPE_DESCRIBE = 9,
-    QUERY_TYPE_EXPLAIN = 10
+    QUERY_TYPE_EXPLAIN = 10,
+    QUERY_TYPE_REPLACE = 11,
+    QUERY_TYPE_CALL = 12,
+    QUERY_TYPE_SET = 13,
+    QUERY_TYPE_BEGIN = 14,          /* BEGIN, START TRANSACTION */
+    QUERY_TYPE_COMMIT = 15,
+    QUERY_TYPE_ROLLBACK = 16,
+    QUERY_TYPE_SAVEPOINT = 17,      /* SAVEPOINT, RELEASE SAVEPOINT */
+    QUERY_TYPE_XA = 18,
+    QUERY_TYPE_LOCK = 19,
+    QUERY_TYPE_UNLOCK = 20,
+    QUERY_TYPE_LOAD = 21,
+    QUERY_TYPE_TRUNCATE = 22,
+    QUERY_TYPE_RENAME = 23,
+    QUERY_TYPE_GRANT = 24,
+    QUERY_TYPE_REVOKE = 25,
+    QUERY_TYPE_USE = 26,
+    QUERY_TYPE_DO = 27,
+    QUERY_TYPE_HANDLER = 28,
+    QUERY_TYPE_PREPARE = 29,
+    QUERY_TYPE_EXECUTE = 30,
+    QUERY_TYPE_DEALLOCATE = 31,     /* DEALLOCATE PREPARE, DROP PREPARE */
+    QUERY_TYPE_MAINTENANCE = 32,    /* ANALYZE, CHECK, CHECKSUM, OPTIMIZE, REPAIR TABLE */
+    QUERY_TYPE_ADMIN = 33,          /* FLUSH, RESET, KILL, replication control, ... */
+    QUERY_TYPE_COUNT
 };
 
 /* Function declarations */
-mysql_query_result* mysql_parse_query_real(const char *query, size_t query_len);
+mysql_query_result* mysql_parse_query_real(zend_string *query, int flags);
 int mysql_validate_query_real(const char *query, size_t query_len);
 char* mysql_build_query_real(zval *parse_tree);
 void mysql_free_query_result(mysql_query_result *result);
-int mysql_get_query_type(const char *query);
+int mysql_get_query_type(const char *query, size_t query_len);
+zend_bool mysql_is_plain_select(const char *query, size_t query_len);
 int mysql_connect_parser(void);
 void mysql_disconnect_parser(void);
 int mysql_connect_syntax_parser(void);
 void mysql_disconnect_syntax_parser(void);
 int mysql_validate_syntax_only(const char *query, size_t query_len);
+int mysql_check_syntax_locally(const char *query, size_t query_len, int flags, int *error_code, char **error_message);
+int mysql_check_syntax(const char *query, size_t query_len, int flags, int *error_code, char **error_message);
+void mysql_validate_batch(mysql_batch_item *items, size_t count, int threads, int flags);
+void mysql_batch_record_error(mysql_batch_item *item, unsigned int error_code, const char *error_message);
+int mysql_is_connection_error(unsigned int error_code);
+void mysql_batch_item_to_zval(mysql_batch_item *item, zval *entry);
+int mysql_parse_query_native(zend_string *query, int flags, mysql_query_result *result, int *unchecked);
+void mysql_span_to_zval(zval *span, size_t offset, size_t length);
+
+/* Cached front ends (see query_cache.h) */
+int mysql_validate_cached(zend_string *query, int flags);
+mysql_query_result* mysql_parse_query_cached(zend_string *query, int flags);
+void mysql_validate_batch_cached(mysql_batch_item *items, size_t count, int threads, int flags);
+int mysql_validate_cache_lookup(mysql_batch_item *item);
+void mysql_validate_cache_store(mysql_batch_item *item);
 
 #endif /* MYSQL_QUERY_PARSER_H */
\ No newline at end of file
@@ -0,0 +1,16 @@
+#ifndef PARALLEL_VALIDATOR_H
+#define PARALLEL_VALIDATOR_H
+
+#include <zend.h>
+#include "mysql_query_parser.h"
+
+/* Upper bound on the worker threads (and server connections) of one mysql_validate_parallel() call */
+#define MYSQL_QP_MAX_VALIDATE_THREADS 64
+
+/* Statements of a Traversable taken from it before validating them */
+#define MYSQL_QP_VALIDATE_CHUNK 1024
+
+/* Function declarations */
+int mysql_validate_parallel(mysql_batch_item **pending, size_t count, int threads);
+
+#endif /* PARALLEL_VALIDATOR_H */
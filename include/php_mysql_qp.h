@@ -18,22 +18,65 @@ extern zend_module_entry mysql_qp_module_entry;
 #include "TSRM.h"
 #endif
 
+#include "query_cache.h"
+#include "connection_pool.h"
+#include "async_validator.h"
+#include "shm_cache.h"
+#include "query_stats.h"
+
 /* Function declarations */
 PHP_MINIT_FUNCTION(mysql_qp);
 PHP_MSHUTDOWN_FUNCTION(mysql_qp);
+PHP_RINIT_FUNCTION(mysql_qp);
+PHP_RSHUTDOWN_FUNCTION(mysql_qp);
 PHP_MINFO_FUNCTION(mysql_qp);
 
 PHP_FUNCTION(mysql_parse_query);
 PHP_FUNCTION(mysql_build_query);
 PHP_FUNCTION(mysql_validate_query);
+PHP_FUNCTION(mysql_validate_queries);
+PHP_FUNCTION(mysql_validate_query_async);
+PHP_FUNCTION(mysql_qp_poll);
+PHP_FUNCTION(mysql_qp_async_socket);
+PHP_FUNCTION(mysql_fingerprint_query);
+PHP_FUNCTION(mysql_explain_query);
 PHP_FUNCTION(mysql_decompose_query);
 PHP_FUNCTION(mysql_reconstruct_query);
+PHP_FUNCTION(mysql_compile_template);
+PHP_FUNCTION(mysql_interpolate_query);
+PHP_FUNCTION(mysql_parameterize_query);
+PHP_FUNCTION(mysql_split_sql);
+PHP_FUNCTION(mysql_split_sql_file);
+PHP_FUNCTION(mysql_validate_parallel);
+PHP_FUNCTION(mysql_extract_tables);
+PHP_FUNCTION(mysql_classify_query);
+PHP_FUNCTION(mysql_qp_stats);
 
 /* Module globals */
 ZEND_BEGIN_MODULE_GLOBALS(mysql_qp)
 	zend_bool initialized;
+	zend_long cache_size;
+	zend_long shm_size;
+	zend_long pool_size;
+	zend_long stmt_cache_size;
+	char *dsn;
+	char *user;
+	char *password;
+	char *socket;
+	zend_bool warmup;
+	query_cache cache;
+	mysql_shm_client shm;
+	mysql_qp_stats stats;
+	mysql_qp_lease parser_lease;
+	mysql_qp_lease syntax_lease;
+	mysql_qp_async async;
 ZEND_END_MODULE_GLOBALS(mysql_qp)
 
+ZEND_EXTERN_MODULE_GLOBALS(mysql_qp)
+
+PHP_GINIT_FUNCTION(mysql_qp);
+PHP_GSHUTDOWN_FUNCTION(mysql_qp);
+
 #ifdef ZTS
 #define MYSQL_QP_G(v) TSRMG(mysql_qp_globals_id, zend_mysql_qp_globals *, v)
 #else
@@ -0,0 +1,64 @@
+#ifndef QUERY_CACHE_H
+#define QUERY_CACHE_H
+
+#include <zend.h>
+#include "query_template.h"
+
+#define QUERY_CACHE_DEFAULT_SIZE "4096"
+
+/* Which call a cached entry answers; the same query can be cached once per kind */
+enum query_cache_kind {
+    QUERY_CACHE_VALIDATE = 0,
+    QUERY_CACHE_PARSE = 1,
+    QUERY_CACHE_EXPLAIN = 2,    /* keyed by digest text, not the query itself */
+    QUERY_CACHE_TEMPLATE = 3
+};
+
+typedef struct query_cache_entry query_cache_entry;
+typedef struct query_cache_tree query_cache_tree;
+
+/* A parse tree kept as an immutable array, returned on a hit without copying */
+struct query_cache_tree {
+    query_cache_tree *next_retired;
+    zval tree;                  /* what it points to follows in the same allocation */
+};
+
+struct query_cache_entry {
+    zend_ulong hash;
+    size_t query_len;
+    enum query_cache_kind kind;
+    int is_valid;
+    int query_type;
+    int error_code;
+    int parameter_count;
+    query_cache_tree *trees[2]; /* persistent; without and with MYSQL_QP_SPANS, each built on first use */
+    char *error_message;        /* persistent */
+    zend_string *plan;          /* persistent; EXPLAIN FORMAT=JSON output */
+    mysql_template *tpl;        /* persistent; one reference, shared with live MysqlQp\Template objects */
+    query_cache_entry *bucket_next;
+    query_cache_entry *lru_prev;
+    query_cache_entry *lru_next;
+    char query[1];
+};
+
+/* Per-worker LRU cache, allocated in persistent memory and owned by the module globals */
+typedef struct {
+    query_cache_entry **buckets;
+    size_t bucket_count;
+    size_t count;
+    query_cache_entry *lru_head;    /* most recently used */
+    query_cache_entry *lru_tail;
+    query_cache_tree *retired;      /* dropped trees a request may still hold; freed when it ends */
+    zend_ulong hits;
+    zend_ulong misses;
+    zend_ulong evictions;
+} query_cache;
+
+/* Function declarations */
+void query_cache_init(query_cache *cache);
+void query_cache_destroy(query_cache *cache);
+void query_cache_end_request(query_cache *cache);
+query_cache_entry* query_cache_find(query_cache *cache, zend_string *query, enum query_cache_kind kind);
+query_cache_entry* query_cache_add(query_cache *cache, zend_string *query, enum query_cache_kind kind, size_t capacity);
+
+#endif /* QUERY_CACHE_H */
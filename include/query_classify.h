@@ -0,0 +1,22 @@
+#ifndef QUERY_CLASSIFY_H
+#define QUERY_CLASSIFY_H
+
+#include <zend.h>
+
+/* Statement flags from mysql_classify_query() */
+#define MYSQL_QP_READ_ONLY        (1 << 0)  /* changes no data */
+#define MYSQL_QP_LOCKING_READ     (1 << 1)  /* FOR UPDATE, FOR SHARE, LOCK IN SHARE MODE */
+#define MYSQL_QP_TRANSACTION      (1 << 2)  /* transaction control */
+#define MYSQL_QP_IMPLICIT_COMMIT  (1 << 3)  /* commits the open transaction first */
+#define MYSQL_QP_NONDETERMINISTIC (1 << 4)  /* calls NOW(), RAND(), LAST_INSERT_ID(), ... */
+
+typedef struct {
+    int type;               /* QUERY_TYPE_* */
+    unsigned int flags;     /* MYSQL_QP_READ_ONLY, ... */
+} mysql_query_class;
+
+/* Function declarations */
+void mysql_classify_query(const char *query, size_t query_len, mysql_query_class *result);
+const char* mysql_query_type_name(int query_type);
+
+#endif /* QUERY_CLASSIFY_H */
@@ -2,30 +2,88 @@
 #define QUERY_DECOMPOSER_H
 
 #include <zend.h>
+#include "sql_arena.h"
 
-/* Query component structure */
+/* Keys of the decomposition array, interned once at MINIT */
+enum query_component_key {
+    COMPONENT_TYPE = 0,
+    COMPONENT_FIELDS,
+    COMPONENT_TABLES,
+    COMPONENT_JOINS,
+    COMPONENT_WHERE,
+    COMPONENT_GROUP_BY,
+    COMPONENT_HAVING,
+    COMPONENT_ORDER_BY,
+    COMPONENT_LIMIT,
+    COMPONENT_VALUES,
+    COMPONENT_PARAMETERS,
+    COMPONENT_ON_DUPLICATE,
+    COMPONENT_TABLE,        /* keys of a "tables" entry */
+    COMPONENT_ALIAS,
+    COMPONENT_KEY_COUNT
+};
+
+/*
+ * Query component structure. Clauses live inline and start out as the shared
+ * immutable empty array; a clause gets its own array when its first item is
+ * added, so most of them never allocate.
+ */
 typedef struct {
-    char *type;          /* SELECT, INSERT, UPDATE, DELETE, etc. */
-    zval *fields;        /* SELECT fields or INSERT/UPDATE columns */
-    zval *tables;        /* FROM/INTO tables with aliases */
-    zval *joins;         /* JOIN clauses */
-    zval *where_conditions;  /* WHERE clause components */
-    zval *group_by;      /* GROUP BY fields */
-    zval *having;        /* HAVING conditions */
-    zval *order_by;      /* ORDER BY clauses */
-    zval *limit_clause;  /* LIMIT/OFFSET */
-    zval *values;        /* INSERT VALUES or UPDATE SET */
-    zval *parameters;    /* Prepared statement parameters */
+    zend_string *type;  /* SELECT, INSERT, UPDATE, DELETE, etc.; interned, or borrowed from the caller */
+    zval fields;        /* SELECT fields or INSERT/UPDATE columns */
+    zval tables;        /* FROM/INTO tables with aliases */
+    zval joins;         /* JOIN clauses */
+    zval where_conditions;  /* WHERE clause components */
+    zval group_by;      /* GROUP BY fields */
+    zval having;        /* HAVING conditions */
+    zval order_by;      /* ORDER BY clauses */
+    zval limit_clause;  /* LIMIT/OFFSET */
+    zval values;        /* INSERT rows (a MysqlQp\InsertRows for VALUES) or UPDATE SET */
+    zval parameters;    /* Prepared statement parameters */
+    zval on_duplicate;  /* ON DUPLICATE KEY UPDATE assignments */
+    const char *spans_base; /* with MYSQL_QP_SPANS, text is returned as [offset, length] from here */
 } query_components;
 
+/* Top-level clauses of a SELECT, in the order they may appear */
+enum select_clause {
+    CLAUSE_SELECT = 0,
+    CLAUSE_FROM,
+    CLAUSE_WHERE,
+    CLAUSE_GROUP_BY,
+    CLAUSE_HAVING,
+    CLAUSE_WINDOW,
+    CLAUSE_ORDER_BY,
+    CLAUSE_LIMIT,
+    CLAUSE_COUNT
+};
+
+/* Clause boundaries and top-level commas, found in one pass over the query */
+typedef struct {
+    const char *start[CLAUSE_COUNT];    /* clause keyword, NULL when absent */
+    const char *body[CLAUSE_COUNT];     /* first byte after the keyword(s) */
+    const char *end;                    /* end of the statement, before any ';' */
+    const char **commas;                /* in query order */
+    size_t comma_count;
+    size_t comma_size;
+    sql_arena arena;                    /* scratch, freed by clause_scan_free() */
+} clause_scan;
+
+extern zend_string *query_component_keys[COMPONENT_KEY_COUNT];
+
 /* Function declarations */
-query_components* mysql_decompose_query(const char *query, size_t query_len);
+void mysql_decomposer_startup(void);
+void init_query_components(query_components *components);
+void mysql_decompose_query(zend_string *query, int flags, query_components *components);
+void mysql_query_components_to_zval(query_components *components, zval *array);
+zval* mysql_query_component(query_components *components, int component);
+zend_string* mysql_decomposed_type(int query_type);
 char* mysql_reconstruct_query(query_components *components);
 void mysql_free_query_components(query_components *components);
 
 /* Helper functions for specific query types */
-int extract_select_components(const char *query, query_components *components);
-int extract_insert_components(const char *query, query_components *components);
+int extract_select_components(const char *query, size_t query_len, query_components *components);
+void extract_select_clause(query_components *components, const clause_scan *scan, int component);
+int extract_insert_components(zend_string *query, query_components *components);
 int extract_update_components(const char *query, query_components *components);
 int extract_delete_components(const char *query, query_components *components);
 
@@ -36,8 +94,14 @@ char* build_update_query(query_components *components);
 char* build_delete_query(query_components *components);
 
 /* Utility functions */
-int parse_field_list(const char *fields_str, zval *fields_array);
-int parse_table_list(const char *tables_str, zval *tables_array);
+void clause_scan_run(clause_scan *scan, const char *query, size_t query_len);
+int clause_scan_body(const clause_scan *scan, int clause, const char **start, const char **end);
+const char* clause_scan_unmodelled(const clause_scan *scan, const char *query, size_t query_len,
+                                   const char **tail, size_t *tail_len);
+void clause_scan_free(clause_scan *scan);
+int parse_field_list(query_components *components, const clause_scan *scan, const char *fields_str, size_t fields_len, zval *fields_array);
+int parse_table_list(query_components *components, const clause_scan *scan, const char *tables_str, size_t tables_len, zval *tables_array);
 int parse_where_clause(const char *where_str, zval *where_array);
+const char* insert_row_next(const char *p, const char *end, const char *spans_base, zval *row);
 
 #endif /* QUERY_DECOMPOSER_H */
\ No newline at end of file
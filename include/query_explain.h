@@ -0,0 +1,11 @@
+#ifndef QUERY_EXPLAIN_H
+#define QUERY_EXPLAIN_H
+
+#include <zend.h>
+
+/* Function declarations */
+zend_string* mysql_explain_real(const char *query, size_t query_len, int *error_code, char **error_message);
+int mysql_explain_decode(const char *json, size_t json_len, zend_bool tree, zval *plan);
+int mysql_explain_cached(zend_string *query, zend_bool tree, zval *plan, int *error_code, char **error_message);
+
+#endif /* QUERY_EXPLAIN_H */
@@ -0,0 +1,18 @@
+#ifndef QUERY_FINGERPRINT_H
+#define QUERY_FINGERPRINT_H
+
+#include <zend.h>
+
+#define MYSQL_DIGEST_SIZE 32
+
+/* Normalized statement and its hash, in the spirit of performance_schema digests */
+typedef struct {
+    zend_string *text;                          /* like STATEMENT_DIGEST_TEXT() */
+    unsigned char digest[MYSQL_DIGEST_SIZE];    /* SHA-256 of text */
+} mysql_fingerprint;
+
+/* Function declarations */
+int mysql_compute_fingerprint(const char *query, size_t query_len, mysql_fingerprint *fingerprint);
+zend_long mysql_fingerprint_hash(const mysql_fingerprint *fingerprint);
+
+#endif /* QUERY_FINGERPRINT_H */
@@ -0,0 +1,10 @@
+#ifndef QUERY_INTERPOLATE_H
+#define QUERY_INTERPOLATE_H
+
+#include <zend.h>
+#include "sql_literal.h"
+
+/* Function declarations */
+zend_string* mysql_interpolate(zend_string *sql, HashTable *params, const mysql_charset *charset, const char **error);
+
+#endif /* QUERY_INTERPOLATE_H */
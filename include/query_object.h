@@ -0,0 +1,12 @@
+#ifndef QUERY_OBJECT_H
+#define QUERY_OBJECT_H
+
+#include <zend.h>
+
+/* MysqlQp\Query: a decomposition held in C, clauses built on first read */
+extern zend_class_entry *mysql_qp_query_ce;
+
+/* Function declarations */
+void mysql_query_object_startup(void);
+
+#endif /* QUERY_OBJECT_H */
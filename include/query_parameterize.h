@@ -0,0 +1,9 @@
+#ifndef QUERY_PARAMETERIZE_H
+#define QUERY_PARAMETERIZE_H
+
+#include <zend.h>
+
+/* Function declarations */
+int mysql_parameterize(zend_string *sql, zval *result, const char **error);
+
+#endif /* QUERY_PARAMETERIZE_H */
@@ -0,0 +1,99 @@
+#ifndef QUERY_PARSER_H
+#define QUERY_PARSER_H
+
+#include <zend.h>
+#include "sql_arena.h"
+
+/*
+ * AST produced by the native parser. Every node is a tagged record with a
+ * list of named attributes, mirroring the array shape handed to PHP as
+ * parse_tree: a node becomes ['type' => ..., <attr> => ...], a list node
+ * becomes a plain list. All nodes live in the caller's arena.
+ */
+enum sql_node_type {
+    SQL_NODE_LIST = 0,
+    SQL_NODE_SELECT,
+    SQL_NODE_UNION,
+    SQL_NODE_INSERT,
+    SQL_NODE_REPLACE,
+    SQL_NODE_UPDATE,
+    SQL_NODE_DELETE,
+    SQL_NODE_CTE,
+    SQL_NODE_TABLE,
+    SQL_NODE_DERIVED,
+    SQL_NODE_JOIN,
+    SQL_NODE_TABLE_GROUP,
+    SQL_NODE_COLUMN,
+    SQL_NODE_STAR,
+    SQL_NODE_LITERAL,
+    SQL_NODE_PLACEHOLDER,
+    SQL_NODE_VARIABLE,
+    SQL_NODE_BINARY,
+    SQL_NODE_UNARY,
+    SQL_NODE_IS,
+    SQL_NODE_IN,
+    SQL_NODE_BETWEEN,
+    SQL_NODE_LIKE,
+    SQL_NODE_EXISTS,
+    SQL_NODE_SUBQUERY,
+    SQL_NODE_FUNCTION,
+    SQL_NODE_KEYWORD,
+    SQL_NODE_DATA_TYPE,
+    SQL_NODE_INTERVAL,
+    SQL_NODE_CASE,
+    SQL_NODE_WHEN,
+    SQL_NODE_ROW,
+    SQL_NODE_COLLATE,
+    SQL_NODE_MATCH,
+    SQL_NODE_WINDOW,
+    SQL_NODE_NAME,          /* bare name, exposed as a plain string */
+    SQL_NODE_TYPE_COUNT
+};
+
+enum sql_attr_kind {
+    SQL_ATTR_NODE = 0,
+    SQL_ATTR_TEXT,      /* copied verbatim */
+    SQL_ATTR_IDENT,     /* identifier, unquoted on output */
+    SQL_ATTR_BOOL
+};
+
+typedef struct sql_node sql_node;
+typedef struct sql_attr sql_attr;
+
+struct sql_attr {
+    const char *key;
+    enum sql_attr_kind kind;
+    sql_node *node;
+    const char *text;
+    size_t text_len;
+    sql_attr *next;
+};
+
+struct sql_node {
+    enum sql_node_type type;
+    sql_attr *attrs;
+    sql_attr **attrs_tail;
+    sql_node *items;        /* SQL_NODE_LIST elements */
+    sql_node **items_tail;
+    size_t count;
+    sql_node *next;         /* sibling inside a list */
+};
+
+/* Outcome of a native parse */
+typedef struct {
+    sql_node *root;
+    int placeholder_count;
+    int unchecked;          /* accepted something the grammar here doesn't check (type names, function forms); only the server can vouch for it */
+    const char *error;      /* static message, NULL on success */
+    const char *error_pos;  /* points into the query */
+} sql_parse_result;
+
+/* Function declarations */
+int mysql_native_parse(const char *query, size_t query_len, sql_arena *arena, sql_parse_result *result);
+const char* sql_node_type_name(enum sql_node_type type);
+sql_node* sql_node_attr(const sql_node *node, const char *key);
+void sql_node_to_zval(const sql_node *node, zval *out);
+void sql_node_to_zval_spans(const sql_node *node, const char *query, size_t query_len, zval *out);
+char* build_mysql_query(zval *parse_tree);
+
+#endif /* QUERY_PARSER_H */
@@ -0,0 +1,102 @@
+#ifndef QUERY_STATS_H
+#define QUERY_STATS_H
+
+#include <zend.h>
+#include <zend_hrtime.h>
+#include <mysql.h>
+
+/*
+ * Static probes for DTrace/bpftrace, compiled in when <sys/sdt.h> is found
+ * (provider "mysql_qp"; "prepare__done" is traced as prepare-done). Disabled
+ * probes are a single nop.
+ */
+#ifdef MYSQL_QP_USDT
+# include <sys/sdt.h>
+# define MYSQL_QP_PROBE2(name, a, b)        DTRACE_PROBE2(mysql_qp, name, a, b)
+# define MYSQL_QP_PROBE4(name, a, b, c, d)  DTRACE_PROBE4(mysql_qp, name, a, b, c, d)
+#else
+# define MYSQL_QP_PROBE2(name, a, b)        do { } while (0)
+# define MYSQL_QP_PROBE4(name, a, b, c, d)  do { } while (0)
+#endif
+
+/* What a latency histogram times: a PHP function, or one kind of server call */
+enum mysql_qp_stat {
+    MYSQL_QP_STAT_PARSE_QUERY = 0,
+    MYSQL_QP_STAT_BUILD_QUERY,
+    MYSQL_QP_STAT_VALIDATE_QUERY,
+    MYSQL_QP_STAT_VALIDATE_QUERIES,
+    MYSQL_QP_STAT_VALIDATE_QUERY_ASYNC,
+    MYSQL_QP_STAT_FINGERPRINT_QUERY,
+    MYSQL_QP_STAT_EXPLAIN_QUERY,
+    MYSQL_QP_STAT_DECOMPOSE_QUERY,
+    MYSQL_QP_STAT_RECONSTRUCT_QUERY,
+    MYSQL_QP_STAT_COMPILE_TEMPLATE,
+    MYSQL_QP_STAT_INTERPOLATE_QUERY,
+    MYSQL_QP_STAT_PARAMETERIZE_QUERY,
+    MYSQL_QP_STAT_SPLIT_SQL,
+    MYSQL_QP_STAT_SPLIT_SQL_FILE,
+    MYSQL_QP_STAT_VALIDATE_PARALLEL,
+    MYSQL_QP_STAT_EXTRACT_TABLES,
+    MYSQL_QP_STAT_CLASSIFY_QUERY,
+    MYSQL_QP_STAT_PREPARE,          /* mysql_stmt_prepare() */
+    MYSQL_QP_STAT_EXPLAIN,          /* EXPLAIN FORMAT=JSON */
+    MYSQL_QP_STAT_CONNECT,
+    MYSQL_QP_STAT_COUNT
+};
+
+#define MYSQL_QP_STAT_FUNCTIONS MYSQL_QP_STAT_PREPARE
+
+/*
+ * Log-linear buckets in nanoseconds, HDR style: values below 8 get their own
+ * bucket, and every power of two above that is split into 8 sub-buckets, so
+ * a bucket is never more than 12.5% wide. Anything from 2^40 ns (about 18
+ * minutes) up lands in the last bucket.
+ */
+#define MYSQL_QP_HIST_SUB_BITS 3
+#define MYSQL_QP_HIST_MAX_BITS 40
+#define MYSQL_QP_HIST_BUCKETS ((MYSQL_QP_HIST_MAX_BITS - MYSQL_QP_HIST_SUB_BITS + 1) << MYSQL_QP_HIST_SUB_BITS)
+
+typedef struct {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+    uint64_t buckets[MYSQL_QP_HIST_BUCKETS];
+} mysql_qp_histogram;
+
+/* Per-worker counters, kept in the module globals; plain increments, no atomics */
+typedef struct {
+    mysql_qp_histogram latency[MYSQL_QP_STAT_COUNT];
+    zend_ulong round_trips;         /* commands sent once connected */
+    zend_ulong reconnects;          /* connections dropped as dead, to be reopened */
+    zend_ulong bytes_allocated;     /* request memory still held when a function returns */
+    zend_ulong stmt_hits;           /* prepares answered by a statement kept on the connection */
+    zend_ulong stmt_misses;
+    zend_ulong stmt_evictions;
+} mysql_qp_stats;
+
+/* Function declarations */
+void mysql_qp_stats_record(enum mysql_qp_stat stat, zend_hrtime_t elapsed);
+void mysql_qp_stats_call(enum mysql_qp_stat stat, zend_hrtime_t elapsed, size_t memory_before);
+zend_hrtime_t mysql_qp_stats_round_trip(enum mysql_qp_stat stat, zend_hrtime_t start);
+void mysql_qp_stats_round_trips(zend_ulong count);
+void mysql_qp_stats_reconnect(void);
+uint64_t mysql_qp_histogram_percentile(const mysql_qp_histogram *hist, double fraction);
+void mysql_qp_stats_to_zval(zval *stats);
+void mysql_qp_stats_reset(void);
+void mysql_qp_stats_info(void);
+
+/* mysql_stmt_prepare() with its latency recorded and probes at every call site */
+static zend_always_inline int mysql_qp_stmt_prepare(MYSQL_STMT *stmt, const char *query, size_t query_len) {
+    zend_hrtime_t start, elapsed;
+    int status;
+
+    MYSQL_QP_PROBE2(prepare__start, query, query_len);
+    start = zend_hrtime();
+    status = mysql_stmt_prepare(stmt, query, query_len);
+    elapsed = mysql_qp_stats_round_trip(MYSQL_QP_STAT_PREPARE, start);
+    MYSQL_QP_PROBE4(prepare__done, query, query_len, status == 0 ? 0 : mysql_stmt_errno(stmt), elapsed);
+    return status;
+}
+
+#endif /* QUERY_STATS_H */
@@ -0,0 +1,9 @@
+#ifndef QUERY_TABLES_H
+#define QUERY_TABLES_H
+
+#include <zend.h>
+
+/* Function declarations */
+int mysql_extract_tables(const char *query, size_t query_len, zval *tables, const char **error);
+
+#endif /* QUERY_TABLES_H */
@@ -0,0 +1,40 @@
+#ifndef QUERY_TEMPLATE_H
+#define QUERY_TEMPLATE_H
+
+#include <zend.h>
+#include "sql_literal.h"
+
+/* A ? or :name placeholder and the fixed SQL around it */
+typedef struct {
+    size_t literal_end;         /* fixed SQL before the placeholder ends here */
+    size_t resume;              /* and continues here after it */
+    zend_string *name;          /* without the colon; NULL for ? */
+    uint32_t position;          /* index into the values list for ? */
+} mysql_template_slot;
+
+/*
+ * SQL split once into fixed fragments and placeholder slots. Compiled
+ * templates live in the per-worker cache in persistent memory and are shared
+ * by every MysqlQp\Template created for the same SQL, so they are reference
+ * counted rather than owned by either.
+ */
+typedef struct {
+    uint32_t refcount;
+    zend_bool persistent;
+    uint32_t slot_count;
+    size_t fixed_len;           /* bytes of SQL outside the placeholders */
+    zend_string *sql;
+    mysql_template_slot slots[1];
+} mysql_template;
+
+extern zend_class_entry *mysql_qp_template_ce;
+
+/* Function declarations */
+void mysql_template_startup(void);
+mysql_template* mysql_template_compile(zend_string *sql, zend_bool persistent, const char **error);
+void mysql_template_release(mysql_template *tpl);
+zend_string* mysql_template_render(const mysql_template *tpl, HashTable *values, const mysql_charset *charset);
+mysql_template* mysql_template_cached(zend_string *sql, const char **error);
+void mysql_template_object_init(zval *object, mysql_template *tpl);
+
+#endif /* QUERY_TEMPLATE_H */
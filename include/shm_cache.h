@@ -0,0 +1,42 @@
+#ifndef SHM_CACHE_H
+#define SHM_CACHE_H
+
+#include <zend.h>
+
+#define MYSQL_QP_SHM_DEFAULT_SIZE "0"
+
+/* Which call a shared entry answers; the call's flags are part of the key too */
+enum mysql_shm_kind {
+    MYSQL_SHM_DECOMPOSE = 0,
+    MYSQL_SHM_PARSE = 1
+};
+
+/* A worker's use of the shared segment, kept in the module globals */
+typedef struct {
+    zend_bool attached;         /* this request holds results from the current generation */
+    zend_bool reclaimed;        /* this request already looked for dead workers holding up a restart */
+    int holder;                 /* the process's holder slot it is counted in */
+    zend_ulong hits;
+    zend_ulong misses;
+} mysql_shm_client;
+
+/* Segment-wide figures for phpinfo() */
+typedef struct {
+    size_t size;
+    size_t used;
+    zend_ulong entries;
+    zend_ulong restarts;
+    zend_bool restart_pending;
+} mysql_shm_stats;
+
+/* Function declarations */
+void mysql_shm_startup(zend_long size);
+void mysql_shm_shutdown(void);
+void mysql_shm_end_request(mysql_shm_client *client);
+int mysql_shm_find(mysql_shm_client *client, zend_string *query, enum mysql_shm_kind kind, int flags, zval *result);
+void mysql_shm_store(mysql_shm_client *client, zend_string *query, enum mysql_shm_kind kind, int flags, zval *result);
+int mysql_shm_get_stats(mysql_shm_stats *stats);
+int mysql_immutable_measure(zval *value, size_t *size);
+void mysql_immutable_copy(zval *value, char **pos);
+
+#endif /* SHM_CACHE_H */
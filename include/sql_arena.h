@@ -0,0 +1,28 @@
+#ifndef SQL_ARENA_H
+#define SQL_ARENA_H
+
+#include <stddef.h>
+
+/* Bump allocator: everything allocated from an arena is released at once by sql_arena_free() */
+typedef struct sql_arena_chunk {
+    struct sql_arena_chunk *prev;
+    size_t used;
+    size_t size;
+    char data[1];
+} sql_arena_chunk;
+
+typedef struct {
+    sql_arena_chunk *head;
+    size_t chunk_size;
+} sql_arena;
+
+#define SQL_ARENA_DEFAULT_CHUNK 8192
+
+/* Function declarations */
+void sql_arena_init(sql_arena *arena, size_t chunk_size);
+void* sql_arena_alloc(sql_arena *arena, size_t size);
+void* sql_arena_calloc(sql_arena *arena, size_t size);
+char* sql_arena_strndup(sql_arena *arena, const char *str, size_t len);
+void sql_arena_free(sql_arena *arena);
+
+#endif /* SQL_ARENA_H */
@@ -0,0 +1,544 @@
+#ifndef SQL_LEXER_H
+#define SQL_LEXER_H
+
+#include <stddef.h>
+
+/*
+ * MySQL keywords known to the native lexer, kept in strcmp() order so the
+ * lexer can binary-search them. The second column marks words that are
+ * reserved in MySQL 8.0 and therefore can't be used as bare identifiers.
+ */
+#define MYSQL_KEYWORD_LIST(X) \
+    X(ACCESSIBLE, 1) \
+    X(ACTION, 0) \
+    X(ADD, 1) \
+    X(AFTER, 0) \
+    X(AGAINST, 0) \
+    X(ALGORITHM, 0) \
+    X(ALL, 1) \
+    X(ALTER, 1) \
+    X(ANALYZE, 1) \
+    X(AND, 1) \
+    X(ANY, 0) \
+    X(AS, 1) \
+    X(ASC, 1) \
+    X(ASENSITIVE, 1) \
+    X(AT, 0) \
+    X(AUTO_INCREMENT, 0) \
+    X(AVG, 0) \
+    X(BEFORE, 1) \
+    X(BEGIN, 0) \
+    X(BETWEEN, 1) \
+    X(BIGINT, 1) \
+    X(BINARY, 1) \
+    X(BINLOG, 0) \
+    X(BIT, 0) \
+    X(BLOB, 1) \
+    X(BOOL, 0) \
+    X(BOOLEAN, 0) \
+    X(BOTH, 1) \
+    X(BTREE, 0) \
+    X(BY, 1) \
+    X(CACHE, 0) \
+    X(CALL, 1) \
+    X(CASCADE, 1) \
+    X(CASCADED, 0) \
+    X(CASE, 1) \
+    X(CAST, 0) \
+    X(CHANGE, 1) \
+    X(CHAR, 1) \
+    X(CHARACTER, 1) \
+    X(CHARSET, 0) \
+    X(CHECK, 1) \
+    X(CHECKSUM, 0) \
+    X(CLONE, 0) \
+    X(COLLATE, 1) \
+    X(COLLATION, 0) \
+    X(COLUMN, 1) \
+    X(COLUMNS, 0) \
+    X(COMMENT, 0) \
+    X(COMMIT, 0) \
+    X(COMMITTED, 0) \
+    X(COMPACT, 0) \
+    X(COMPRESSED, 0) \
+    X(CONDITION, 1) \
+    X(CONSISTENT, 0) \
+    X(CONSTRAINT, 1) \
+    X(CONTINUE, 1) \
+    X(CONVERT, 1) \
+    X(COUNT, 0) \
+    X(CREATE, 1) \
+    X(CROSS, 1) \
+    X(CUBE, 1) \
+    X(CUME_DIST, 1) \
+    X(CURRENT, 0) \
+    X(CURRENT_DATE, 1) \
+    X(CURRENT_TIME, 1) \
+    X(CURRENT_TIMESTAMP, 1) \
+    X(CURRENT_USER, 1) \
+    X(CURSOR, 1) \
+    X(DATA, 0) \
+    X(DATABASE, 1) \
+    X(DATABASES, 1) \
+    X(DATE, 0) \
+    X(DATETIME, 0) \
+    X(DAY, 0) \
+    X(DAY_HOUR, 1) \
+    X(DAY_MICROSECOND, 1) \
+    X(DAY_MINUTE, 1) \
+    X(DAY_SECOND, 1) \
+    X(DEALLOCATE, 0) \
+    X(DEC, 1) \
+    X(DECIMAL, 1) \
+    X(DECLARE, 1) \
+    X(DEFAULT, 1) \
+    X(DEFINER, 0) \
+    X(DELAYED, 1) \
+    X(DELETE, 1) \
+    X(DENSE_RANK, 1) \
+    X(DESC, 1) \
+    X(DESCRIBE, 1) \
+    X(DETERMINISTIC, 1) \
+    X(DIRECTORY, 0) \
+    X(DISABLE, 0) \
+    X(DISTINCT, 1) \
+    X(DISTINCTROW, 1) \
+    X(DIV, 1) \
+    X(DO, 0) \
+    X(DOUBLE, 1) \
+    X(DROP, 1) \
+    X(DUAL, 1) \
+    X(DUPLICATE, 0) \
+    X(DYNAMIC, 0) \
+    X(EACH, 1) \
+    X(ELSE, 1) \
+    X(ELSEIF, 1) \
+    X(EMPTY, 1) \
+    X(ENABLE, 0) \
+    X(ENCLOSED, 1) \
+    X(END, 0) \
+    X(ENGINE, 0) \
+    X(ENGINES, 0) \
+    X(ENUM, 0) \
+    X(ESCAPE, 0) \
+    X(ESCAPED, 1) \
+    X(EVENT, 0) \
+    X(EVENTS, 0) \
+    X(EVERY, 0) \
+    X(EXCEPT, 1) \
+    X(EXCHANGE, 0) \
+    X(EXCLUDE, 0) \
+    X(EXECUTE, 0) \
+    X(EXISTS, 1) \
+    X(EXIT, 1) \
+    X(EXPLAIN, 1) \
+    X(EXTENDED, 0) \
+    X(FALSE, 1) \
+    X(FETCH, 1) \
+    X(FIELDS, 0) \
+    X(FIRST, 0) \
+    X(FIRST_VALUE, 1) \
+    X(FIXED, 0) \
+    X(FLOAT, 1) \
+    X(FLOAT4, 1) \
+    X(FLOAT8, 1) \
+    X(FLUSH, 0) \
+    X(FOLLOWING, 0) \
+    X(FOR, 1) \
+    X(FORCE, 1) \
+    X(FOREIGN, 1) \
+    X(FORMAT, 0) \
+    X(FROM, 1) \
+    X(FULL, 0) \
+    X(FULLTEXT, 1) \
+    X(FUNCTION, 1) \
+    X(GENERATED, 1) \
+    X(GEOMETRY, 0) \
+    X(GET, 1) \
+    X(GLOBAL, 0) \
+    X(GRANT, 1) \
+    X(GROUP, 1) \
+    X(GROUPING, 1) \
+    X(GROUPS, 1) \
+    X(HANDLER, 0) \
+    X(HASH, 0) \
+    X(HAVING, 1) \
+    X(HELP, 0) \
+    X(HIGH_PRIORITY, 1) \
+    X(HOUR, 0) \
+    X(HOUR_MICROSECOND, 1) \
+    X(HOUR_MINUTE, 1) \
+    X(HOUR_SECOND, 1) \
+    X(IDENTIFIED, 0) \
+    X(IF, 1) \
+    X(IGNORE, 1) \
+    X(IMPORT, 0) \
+    X(IN, 1) \
+    X(INDEX, 1) \
+    X(INDEXES, 0) \
+    X(INFILE, 1) \
+    X(INNER, 1) \
+    X(INOUT, 1) \
+    X(INSENSITIVE, 1) \
+    X(INSERT, 1) \
+    X(INSTALL, 0) \
+    X(INT, 1) \
+    X(INT1, 1) \
+    X(INT2, 1) \
+    X(INT3, 1) \
+    X(INT4, 1) \
+    X(INT8, 1) \
+    X(INTEGER, 1) \
+    X(INTERSECT, 1) \
+    X(INTERVAL, 1) \
+    X(INTO, 1) \
+    X(INVOKER, 0) \
+    X(IO_AFTER_GTIDS, 1) \
+    X(IO_BEFORE_GTIDS, 1) \
+    X(IS, 1) \
+    X(ISOLATION, 0) \
+    X(ITERATE, 1) \
+    X(JOIN, 1) \
+    X(JSON, 0) \
+    X(JSON_TABLE, 1) \
+    X(KEY, 1) \
+    X(KEYS, 1) \
+    X(KEY_BLOCK_SIZE, 0) \
+    X(KILL, 1) \
+    X(LAG, 1) \
+    X(LAST, 0) \
+    X(LAST_VALUE, 1) \
+    X(LATERAL, 1) \
+    X(LEAD, 1) \
+    X(LEADING, 1) \
+    X(LEAVE, 1) \
+    X(LEFT, 1) \
+    X(LESS, 0) \
+    X(LEVEL, 0) \
+    X(LIKE, 1) \
+    X(LIMIT, 1) \
+    X(LINEAR, 1) \
+    X(LINES, 1) \
+    X(LOAD, 1) \
+    X(LOCAL, 0) \
+    X(LOCALTIME, 1) \
+    X(LOCALTIMESTAMP, 1) \
+    X(LOCK, 1) \
+    X(LOCKED, 0) \
+    X(LOGS, 0) \
+    X(LONG, 1) \
+    X(LONGBLOB, 1) \
+    X(LONGTEXT, 1) \
+    X(LOOP, 1) \
+    X(LOW_PRIORITY, 1) \
+    X(MASTER_BIND, 1) \
+    X(MASTER_SSL_VERIFY_SERVER_CERT, 1) \
+    X(MATCH, 1) \
+    X(MAX, 0) \
+    X(MAXVALUE, 1) \
+    X(MEDIUMBLOB, 1) \
+    X(MEDIUMINT, 1) \
+    X(MEDIUMTEXT, 1) \
+    X(MICROSECOND, 0) \
+    X(MIDDLEINT, 1) \
+    X(MIN, 0) \
+    X(MINUTE, 0) \
+    X(MINUTE_MICROSECOND, 1) \
+    X(MINUTE_SECOND, 1) \
+    X(MOD, 1) \
+    X(MODE, 0) \
+    X(MODIFIES, 1) \
+    X(MODIFY, 0) \
+    X(MONTH, 0) \
+    X(NAMES, 0) \
+    X(NATIONAL, 0) \
+    X(NATURAL, 1) \
+    X(NCHAR, 0) \
+    X(NEXT, 0) \
+    X(NO, 0) \
+    X(NONE, 0) \
+    X(NOT, 1) \
+    X(NOWAIT, 0) \
+    X(NO_WRITE_TO_BINLOG, 1) \
+    X(NTH_VALUE, 1) \
+    X(NTILE, 1) \
+    X(NULL, 1) \
+    X(NULLS, 0) \
+    X(NUMERIC, 1) \
+    X(NVARCHAR, 0) \
+    X(OF, 1) \
+    X(OFFSET, 0) \
+    X(ON, 1) \
+    X(ONLY, 0) \
+    X(OPEN, 0) \
+    X(OPTIMIZE, 1) \
+    X(OPTIMIZER_COSTS, 1) \
+    X(OPTION, 1) \
+    X(OPTIONALLY, 1) \
+    X(OR, 1) \
+    X(ORDER, 1) \
+    X(OTHERS, 0) \
+    X(OUT, 1) \
+    X(OUTER, 1) \
+    X(OUTFILE, 1) \
+    X(OVER, 1) \
+    X(PARSER, 0) \
+    X(PARTIAL, 0) \
+    X(PARTITION, 1) \
+    X(PARTITIONS, 0) \
+    X(PASSWORD, 0) \
+    X(PERCENT_RANK, 1) \
+    X(PERSIST, 0) \
+    X(PERSIST_ONLY, 0) \
+    X(PLUGIN, 0) \
+    X(PRECEDING, 0) \
+    X(PRECISION, 1) \
+    X(PREPARE, 0) \
+    X(PREV, 0) \
+    X(PRIMARY, 1) \
+    X(PRIVILEGES, 0) \
+    X(PROCEDURE, 1) \
+    X(PROCESSLIST, 0) \
+    X(PROFILE, 0) \
+    X(PURGE, 1) \
+    X(QUARTER, 0) \
+    X(QUERY, 0) \
+    X(QUICK, 0) \
+    X(RANGE, 1) \
+    X(RANK, 1) \
+    X(READ, 1) \
+    X(READS, 1) \
+    X(READ_WRITE, 1) \
+    X(REAL, 1) \
+    X(REBUILD, 0) \
+    X(RECURSIVE, 1) \
+    X(REDUNDANT, 0) \
+    X(REFERENCES, 1) \
+    X(REGEXP, 1) \
+    X(RELEASE, 1) \
+    X(RELOAD, 0) \
+    X(RENAME, 1) \
+    X(REORGANIZE, 0) \
+    X(REPAIR, 0) \
+    X(REPEAT, 1) \
+    X(REPEATABLE, 0) \
+    X(REPLACE, 1) \
+    X(REPLICA, 0) \
+    X(REQUIRE, 1) \
+    X(RESET, 0) \
+    X(RESIGNAL, 1) \
+    X(RESTART, 0) \
+    X(RESTRICT, 1) \
+    X(RETURN, 1) \
+    X(RETURNS, 0) \
+    X(REVOKE, 1) \
+    X(RIGHT, 1) \
+    X(RLIKE, 1) \
+    X(ROLE, 0) \
+    X(ROLLBACK, 0) \
+    X(ROLLUP, 0) \
+    X(ROW, 1) \
+    X(ROWS, 1) \
+    X(ROW_FORMAT, 0) \
+    X(ROW_NUMBER, 1) \
+    X(SAVEPOINT, 0) \
+    X(SCHEMA, 1) \
+    X(SCHEMAS, 1) \
+    X(SECOND, 0) \
+    X(SECOND_MICROSECOND, 1) \
+    X(SECURITY, 0) \
+    X(SELECT, 1) \
+    X(SENSITIVE, 1) \
+    X(SEPARATOR, 1) \
+    X(SERIAL, 0) \
+    X(SERIALIZABLE, 0) \
+    X(SESSION, 0) \
+    X(SET, 1) \
+    X(SHARE, 0) \
+    X(SHOW, 1) \
+    X(SHUTDOWN, 0) \
+    X(SIGNAL, 1) \
+    X(SIGNED, 0) \
+    X(SKIP, 0) \
+    X(SLAVE, 0) \
+    X(SMALLINT, 1) \
+    X(SNAPSHOT, 0) \
+    X(SOME, 0) \
+    X(SOURCE, 0) \
+    X(SPATIAL, 1) \
+    X(SPECIFIC, 1) \
+    X(SQL, 1) \
+    X(SQLEXCEPTION, 1) \
+    X(SQLSTATE, 1) \
+    X(SQLWARNING, 1) \
+    X(SQL_BIG_RESULT, 1) \
+    X(SQL_BUFFER_RESULT, 0) \
+    X(SQL_CACHE, 0) \
+    X(SQL_CALC_FOUND_ROWS, 1) \
+    X(SQL_NO_CACHE, 0) \
+    X(SQL_SMALL_RESULT, 1) \
+    X(SSL, 1) \
+    X(START, 0) \
+    X(STARTING, 1) \
+    X(STATUS, 0) \
+    X(STOP, 0) \
+    X(STORAGE, 0) \
+    X(STORED, 1) \
+    X(STRAIGHT_JOIN, 1) \
+    X(STRING, 0) \
+    X(SUBJECT, 0) \
+    X(SUM, 0) \
+    X(SUPER, 0) \
+    X(SYSTEM, 1) \
+    X(TABLE, 1) \
+    X(TABLES, 0) \
+    X(TEMPORARY, 0) \
+    X(TEMPTABLE, 0) \
+    X(TERMINATED, 1) \
+    X(TEXT, 0) \
+    X(THAN, 0) \
+    X(THEN, 1) \
+    X(TIES, 0) \
+    X(TIME, 0) \
+    X(TIMESTAMP, 0) \
+    X(TINYBLOB, 1) \
+    X(TINYINT, 1) \
+    X(TINYTEXT, 1) \
+    X(TO, 1) \
+    X(TRAILING, 1) \
+    X(TRANSACTION, 0) \
+    X(TRIGGER, 1) \
+    X(TRIGGERS, 0) \
+    X(TRUE, 1) \
+    X(TRUNCATE, 0) \
+    X(TYPE, 0) \
+    X(UNBOUNDED, 0) \
+    X(UNCOMMITTED, 0) \
+    X(UNDEFINED, 0) \
+    X(UNDO, 1) \
+    X(UNINSTALL, 0) \
+    X(UNION, 1) \
+    X(UNIQUE, 1) \
+    X(UNKNOWN, 0) \
+    X(UNLOCK, 1) \
+    X(UNSIGNED, 1) \
+    X(UPDATE, 1) \
+    X(USAGE, 1) \
+    X(USE, 1) \
+    X(USER, 0) \
+    X(USING, 1) \
+    X(UTC_DATE, 1) \
+    X(UTC_TIME, 1) \
+    X(UTC_TIMESTAMP, 1) \
+    X(VALUE, 0) \
+    X(VALUES, 1) \
+    X(VARBINARY, 1) \
+    X(VARCHAR, 1) \
+    X(VARCHARACTER, 1) \
+    X(VARIABLES, 0) \
+    X(VARYING, 1) \
+    X(VIEW, 0) \
+    X(VIRTUAL, 1) \
+    X(WAIT, 0) \
+    X(WARNINGS, 0) \
+    X(WEEK, 0) \
+    X(WHEN, 1) \
+    X(WHERE, 1) \
+    X(WHILE, 1) \
+    X(WINDOW, 1) \
+    X(WITH, 1) \
+    X(WORK, 0) \
+    X(WRITE, 1) \
+    X(XA, 0) \
+    X(XOR, 1) \
+    X(YEAR, 0) \
+    X(YEAR_MONTH, 1) \
+    X(ZEROFILL, 1)
+
+/* Keyword ids: MYSQL_KW_SELECT, MYSQL_KW_FROM, ... (MYSQL_KEYWORD_NONE means "not a keyword") */
+enum mysql_keyword {
+    MYSQL_KEYWORD_NONE = 0,
+#define X(name, reserved) MYSQL_KW_##name,
+    MYSQL_KEYWORD_LIST(X)
+#undef X
+    MYSQL_KEYWORD_COUNT
+};
+
+/* Token types produced by the lexer */
+enum mysql_token_type {
+    TOKEN_EOF = 0,
+    TOKEN_ERROR,
+    TOKEN_KEYWORD,            /* SELECT, FROM, ... (see token->keyword) */
+    TOKEN_IDENTIFIER,         /* users, t1, _utf8mb4 */
+    TOKEN_QUOTED_IDENTIFIER,  /* `users` */
+    TOKEN_STRING,             /* 'abc', "abc", N'abc', _utf8mb4'abc' */
+    TOKEN_HEX_STRING,         /* X'4D', 0x4D */
+    TOKEN_BIT_STRING,         /* B'101', 0b101 */
+    TOKEN_INTEGER,            /* 42 */
+    TOKEN_DECIMAL,            /* 4.2, .5 */
+    TOKEN_FLOAT,              /* 4.2e10 */
+    TOKEN_PLACEHOLDER,        /* ? */
+    TOKEN_NAMED_PLACEHOLDER,  /* :name */
+    TOKEN_VARIABLE,           /* @var, @@session.sql_mode */
+    TOKEN_OPERATOR,           /* = <=> <> != >= && || := -> ->> ... */
+    TOKEN_LPAREN,
+    TOKEN_RPAREN,
+    TOKEN_COMMA,
+    TOKEN_DOT,
+    TOKEN_SEMICOLON,
+    TOKEN_LBRACE,             /* ODBC escape { ... } */
+    TOKEN_RBRACE,
+    TOKEN_COMMENT,            /* only returned with MYSQL_LEX_KEEP_COMMENTS */
+    TOKEN_HINT,               /* optimizer hint, only with MYSQL_LEX_KEEP_COMMENTS */
+    TOKEN_VERSION_COMMENT,    /* opening of a version comment, only with MYSQL_LEX_KEEP_COMMENTS */
+    TOKEN_VERSION_COMMENT_END
+};
+
+/* Token flags */
+#define TOKEN_FLAG_VERSIONED    (1 << 0)  /* token sits inside a version comment */
+#define TOKEN_FLAG_NATIONAL     (1 << 1)  /* N'...' string */
+#define TOKEN_FLAG_INTRODUCER   (1 << 2)  /* _charset'...' string */
+#define TOKEN_FLAG_DOUBLE_QUOTE (1 << 3)  /* "..." string */
+#define TOKEN_FLAG_RESERVED     (1 << 4)  /* keyword is reserved */
+
+/* Lexer flags */
+#define MYSQL_LEX_KEEP_COMMENTS (1 << 0)  /* return comments, hints and version comment markers */
+
+typedef struct {
+    enum mysql_token_type type;
+    int keyword;            /* MYSQL_KW_* for TOKEN_KEYWORD */
+    const char *start;      /* points into the query, not NUL-terminated */
+    size_t length;
+    unsigned int flags;
+} mysql_token;
+
+typedef struct {
+    const char *query;
+    const char *pos;
+    const char *end;
+    unsigned int flags;
+    int in_version_comment;
+    enum mysql_token_type last_type;
+    const char *error;      /* static message when TOKEN_ERROR is returned */
+} mysql_lexer;
+
+/* Local validation verdicts */
+#define MYSQL_LEX_UNDECIDED 0
+#define MYSQL_LEX_VALID     1
+#define MYSQL_LEX_INVALID   2
+
+/* MySQL error codes reported by local validation */
+#define MYSQL_ER_EMPTY_QUERY 1065
+#define MYSQL_ER_PARSE_ERROR 1064
+
+/* Function declarations */
+void mysql_lexer_init(mysql_lexer *lexer, const char *query, size_t query_len, unsigned int flags);
+enum mysql_token_type mysql_lexer_next(mysql_lexer *lexer, mysql_token *token);
+int mysql_lookup_keyword(const char *word, size_t word_len);
+const char* mysql_keyword_name(int keyword);
+int mysql_keyword_is_reserved(int keyword);
+int mysql_token_is_keyword(const mysql_token *token, int keyword);
+int mysql_lex_validate(const char *query, size_t query_len, int *error_code, char **error_message);
+char* mysql_syntax_error_message(const char *query, size_t query_len, const char *near);
+
+#endif /* SQL_LEXER_H */
@@ -0,0 +1,38 @@
+#ifndef SQL_LITERAL_H
+#define SQL_LITERAL_H
+
+#include <zend.h>
+
+/* How a connection charset's bytes have to be walked when escaping */
+enum mysql_charset_kind {
+    MYSQL_CHARSET_BYTES = 0,    /* single-byte and EUC sets: no byte of a multibyte character is ASCII */
+    MYSQL_CHARSET_UTF8MB3,
+    MYSQL_CHARSET_UTF8MB4,
+    MYSQL_CHARSET_BIG5,         /* these four have ASCII trail bytes, backslash among them */
+    MYSQL_CHARSET_GBK,
+    MYSQL_CHARSET_SJIS,
+    MYSQL_CHARSET_GB18030
+};
+
+typedef struct {
+    const char *name;
+    enum mysql_charset_kind kind;
+} mysql_charset;
+
+/* A value measured as an SQL literal, ready to be written */
+typedef struct {
+    zval *value;
+    size_t len;
+    zend_bool hex;              /* string that isn't valid text in the charset, written as X'...' */
+} mysql_literal;
+
+extern const mysql_charset mysql_charset_binary;
+
+/* Function declarations */
+const mysql_charset* mysql_charset_find(const char *name, size_t name_len);
+const mysql_charset* mysql_charset_resolve(zend_string *name, uint32_t arg_num);
+int mysql_literal_measure(mysql_literal *literal, zval *value, const mysql_charset *charset);
+void mysql_literal_throw(zval *value, const char *label);
+char* mysql_literal_write(char *out, const mysql_literal *literal, const mysql_charset *charset);
+
+#endif /* SQL_LITERAL_H */
@@ -0,0 +1,14 @@
+#ifndef SQL_SCRIPT_H
+#define SQL_SCRIPT_H
+
+#include <zend.h>
+
+/* MysqlQp\SqlScript: the statements of a script or dump, split one per iteration */
+extern zend_class_entry *mysql_qp_sql_script_ce;
+
+/* Function declarations */
+void mysql_sql_script_startup(void);
+void mysql_sql_script_init(zval *script, zend_string *sql, zend_bool spans);
+int mysql_sql_script_open(zval *script, const char *path, zend_bool spans);
+
+#endif /* SQL_SCRIPT_H */
@@ -0,0 +1,23 @@
+#ifndef SQL_SPLITTER_H
+#define SQL_SPLITTER_H
+
+#include <zend.h>
+
+/* The mysql client allows delimiters up to this long */
+#define MYSQL_SPLIT_MAX_DELIMITER 16
+
+/* Splits a script into statements the way the mysql command-line client does */
+typedef struct {
+    const char *script;
+    const char *pos;            /* where the next statement is looked for */
+    const char *end;
+    char delimiter[MYSQL_SPLIT_MAX_DELIMITER];
+    size_t delimiter_len;
+    const char *error;          /* static message once mysql_splitter_next() fails */
+} mysql_splitter;
+
+/* Function declarations */
+void mysql_splitter_init(mysql_splitter *splitter, const char *script, size_t script_len);
+int mysql_splitter_next(mysql_splitter *splitter, size_t *offset, size_t *length);
+
+#endif /* SQL_SPLITTER_H */
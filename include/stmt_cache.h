@@ -0,0 +1,64 @@
+#ifndef STMT_CACHE_H
+#define STMT_CACHE_H
+
+#include <zend.h>
+#include <mysql.h>
+
+#define MYSQL_QP_DEFAULT_STMT_CACHE_SIZE "0"
+
+/* A result column of a prepared statement, copied out of mysql_stmt_result_metadata() */
+typedef struct {
+    char *name;                 /* persistent */
+    char *org_table;            /* persistent; empty for expressions */
+    enum enum_field_types type;
+    unsigned long length;
+    unsigned int flags;
+    unsigned int charsetnr;
+} mysql_stmt_column;
+
+typedef struct mysql_stmt_entry mysql_stmt_entry;
+
+/* A live server-side statement and what the server told us when preparing it */
+struct mysql_stmt_entry {
+    zend_ulong hash;
+    size_t query_len;
+    MYSQL_STMT *stmt;
+    zend_bool cached;           /* owned by a cache; otherwise closed on release */
+    unsigned int param_count;
+    unsigned int column_count;
+    mysql_stmt_column *columns; /* persistent; NULL for statements without a result set */
+    mysql_stmt_entry *bucket_next;
+    mysql_stmt_entry *lru_prev;
+    mysql_stmt_entry *lru_next;
+    char query[1];
+};
+
+/*
+ * Statements kept prepared on one pooled connection, keyed by their text.
+ * Only the thread holding the connection's lease touches it, so there is
+ * no locking. The server limits prepared statements across all sessions
+ * (max_prepared_stmt_count), so each connection keeps at most its share,
+ * and fewer for as long as the server has no room for more.
+ */
+typedef struct {
+    mysql_stmt_entry **buckets;
+    size_t bucket_count;
+    size_t count;
+    size_t configured;          /* mysql_qp.stmt_cache_size */
+    size_t limit;               /* configured, lowered to the server's limit on first use */
+    size_t capacity;            /* limit, or fewer while the server is out of statement slots */
+    size_t share;               /* connections splitting max_prepared_stmt_count */
+    zend_bool sized;
+    mysql_stmt_entry *lru_head;     /* most recently used */
+    mysql_stmt_entry *lru_tail;
+} mysql_stmt_cache;
+
+/* Function declarations */
+void mysql_stmt_cache_init(mysql_stmt_cache *cache, size_t capacity, size_t share);
+void mysql_stmt_cache_destroy(mysql_stmt_cache *cache, zend_bool close_handles);
+mysql_stmt_entry* mysql_stmt_cache_acquire(mysql_stmt_cache *cache, MYSQL *conn, const char *query, size_t query_len,
+                                           int *error_code, char **error_message);
+void mysql_stmt_cache_release(mysql_stmt_entry *entry);
+void mysql_stmt_columns_to_zval(const mysql_stmt_entry *entry, zval *columns);
+
+#endif /* STMT_CACHE_H */
@@ -0,0 +1,370 @@
+#include "php.h"
+#include "zend_hrtime.h"
+#include "../include/php_mysql_qp.h"
+#include "../include/mysql_query_parser.h"
+#include "../include/async_validator.h"
+#include "../include/connection_pool.h"
+#include "../include/query_stats.h"
+#include "../include/sql_lexer.h"
+#include <mysql.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+
+#define ASYNC_STATEMENT_NAME "mysql_qp_async"
+
+enum async_state {
+    ASYNC_CONNECTING,
+    ASYNC_QUERYING,
+    ASYNC_DONE
+};
+
+/* One validation started by mysql_validate_query_async() */
+typedef struct {
+    zend_long handle;
+    enum async_state state;
+    MYSQL *conn;
+    zend_bool reused;           /* conn came from the idle list and may have gone stale */
+    zend_string *sql;           /* PREPARE statement sent to the server */
+    short events;               /* POLLIN or POLLOUT: what the unfinished operation waits for */
+    mysql_batch_item item;
+} async_op;
+
+/* Arguments threaded through one polling pass */
+typedef struct {
+    zval *results;
+    struct pollfd *fds;
+    nfds_t nfds;
+} async_pass;
+
+/* Idle connections */
+
+static MYSQL* take_connection(mysql_qp_async *async, zend_bool *reused) {
+    if (async->idle_count > 0) {
+        *reused = 1;
+        return async->idle[--async->idle_count];
+    }
+    *reused = 0;
+    return mysql_qp_init_connection();
+}
+
+/* Keep up to mysql_qp.pool_size connections for later validations */
+static void return_connection(mysql_qp_async *async, MYSQL *conn) {
+    size_t limit = MYSQL_QP_G(pool_size) > 0 ? (size_t) MYSQL_QP_G(pool_size) : 1;
+
+    if (async->idle_count >= limit) {
+        mysql_close(conn);
+        return;
+    }
+    if (async->idle_count == async->idle_size) {
+        async->idle_size = async->idle_size ? async->idle_size * 2 : 4;
+        async->idle = perealloc(async->idle, async->idle_size * sizeof(MYSQL *), 1);
+    }
+    async->idle[async->idle_count++] = conn;
+}
+
+/* Connections opened before fork() belong to the parent; drop them without a COM_QUIT */
+static int abandon_op(zval *zv) {
+    async_op *op = Z_PTR_P(zv);
+
+    if (op->conn) {
+        mysql_qp_abandon(op->conn);
+        op->conn = NULL;
+        if (op->sql) {
+            zend_string_release(op->sql);
+            op->sql = NULL;
+        }
+        op->state = ASYNC_DONE;
+    }
+    return ZEND_HASH_APPLY_KEEP;
+}
+
+static void check_fork(mysql_qp_async *async) {
+    pid_t pid = getpid();
+
+    if (EXPECTED(async->pid == pid)) {
+        return;
+    }
+    while (async->idle_count > 0) {
+        mysql_qp_abandon(async->idle[--async->idle_count]);
+    }
+    if (async->ops) {
+        zend_hash_apply(async->ops, abandon_op);
+    }
+    async->pid = pid;
+}
+
+/* Operations */
+
+static void free_op(zval *zv) {
+    async_op *op = Z_PTR_P(zv);
+
+    /* A connection still owned by an op is mid-protocol and can't be reused */
+    if (op->conn) mysql_close(op->conn);
+    if (op->sql) zend_string_release(op->sql);
+    if (op->item.error_message) efree(op->item.error_message);
+    zend_string_release(op->item.query);
+    efree(op);
+}
+
+static void finish(async_op *op, zend_bool keep_connection) {
+    if (op->conn) {
+        if (keep_connection) {
+            return_connection(&MYSQL_QP_G(async), op->conn);
+        } else {
+            mysql_close(op->conn);
+        }
+        op->conn = NULL;
+    }
+    if (op->sql) {
+        zend_string_release(op->sql);
+        op->sql = NULL;
+    }
+    op->state = ASYNC_DONE;
+    mysql_validate_cache_store(&op->item);
+}
+
+static zend_string* build_prepare(MYSQL *conn, zend_string *query) {
+    static const char prefix[] = "PREPARE " ASYNC_STATEMENT_NAME " FROM '";
+    zend_string *sql = zend_string_safe_alloc(ZSTR_LEN(query), 2, sizeof(prefix) + 1, 0);
+    size_t len = sizeof(prefix) - 1;
+
+    memcpy(ZSTR_VAL(sql), prefix, len);
+    len += mysql_real_escape_string(conn, ZSTR_VAL(sql) + len, ZSTR_VAL(query), ZSTR_LEN(query));
+    ZSTR_VAL(sql)[len++] = '\'';
+    ZSTR_VAL(sql)[len] = '\0';
+    ZSTR_LEN(sql) = len;
+    return sql;
+}
+
+/* A stale idle connection gets one fresh connection before the verdict is left undecided */
+static void connection_lost(async_op *op) {
+    if (!op->reused) {
+        finish(op, 0);
+        return;
+    }
+    mysql_close(op->conn);
+    zend_string_release(op->sql);
+    op->sql = NULL;
+    op->reused = 0;
+    if (!(op->conn = mysql_qp_init_connection())) {
+        finish(op, 0);
+        return;
+    }
+    op->state = ASYNC_CONNECTING;
+}
+
+static enum net_async_status call_library(async_op *op) {
+    if (op->state == ASYNC_CONNECTING) {
+        mysql_qp_server *server = &mysql_qp_server_config;
+        return mysql_real_connect_nonblocking(op->conn, server->host, server->user, server->password,
+                                              NULL, server->port, server->socket, 0);
+    }
+    return mysql_real_query_nonblocking(op->conn, ZSTR_VAL(op->sql), ZSTR_LEN(op->sql));
+}
+
+static zend_bool socket_writable(async_op *op) {
+    struct pollfd pfd = {op->conn->net.fd, POLLOUT, 0};
+
+    return poll(&pfd, 1, 0) == 1 && (pfd.revents & POLLOUT);
+}
+
+/*
+ * Make the nonblocking call for the operation's state and, when it returns
+ * NET_ASYNC_NOT_READY, set op->events. The client library doesn't say which
+ * way it is blocked. A socket that isn't writable has a connect in progress
+ * or our data still queued, so it waits for POLLOUT. A writable one gets one
+ * more call, in case the library's write was blocked and the buffer has
+ * drained since; if that doesn't finish it either, the library is waiting
+ * for the server.
+ */
+static enum net_async_status call_until_blocked(async_op *op) {
+    enum net_async_status status = call_library(op);
+
+    if (status == NET_ASYNC_NOT_READY) {
+        if (!socket_writable(op)) {
+            op->events = POLLOUT;
+        } else if ((status = call_library(op)) == NET_ASYNC_NOT_READY) {
+            op->events = socket_writable(op) ? POLLIN : POLLOUT;
+        }
+    }
+    return status;
+}
+
+/*
+ * Advance an operation as far as it can go without blocking. Every
+ * nonblocking call is repeated with the same arguments until it stops
+ * returning NET_ASYNC_NOT_READY.
+ */
+static void step(async_op *op) {
+    enum net_async_status status;
+
+    if (op->state == ASYNC_CONNECTING) {
+        status = call_until_blocked(op);
+        if (status == NET_ASYNC_NOT_READY) {
+            return;
+        }
+        if (status == NET_ASYNC_ERROR) {
+            finish(op, 0);
+            return;
+        }
+        op->sql = build_prepare(op->conn, op->item.query);
+        op->state = ASYNC_QUERYING;
+    }
+
+    if (op->state == ASYNC_QUERYING) {
+        status = call_until_blocked(op);
+        if (status == NET_ASYNC_NOT_READY) {
+            return;
+        }
+        mysql_qp_stats_round_trips(1);
+        if (status == NET_ASYNC_ERROR) {
+            unsigned int error_code = mysql_errno(op->conn);
+            if (mysql_is_connection_error(error_code)) {
+                connection_lost(op);
+                if (op->state == ASYNC_CONNECTING) step(op);
+                return;
+            }
+            mysql_batch_record_error(&op->item, error_code, mysql_error(op->conn));
+        } else {
+            op->item.decided = op->item.is_valid = 1;
+        }
+        finish(op, 1);
+    }
+}
+
+/* Start validating a query and return its handle; local verdicts finish immediately */
+zend_long mysql_async_validate_start(zend_string *query, int flags) {
+    mysql_qp_async *async = &MYSQL_QP_G(async);
+    async_op *op = ecalloc(1, sizeof(async_op));
+    int verdict;
+
+    check_fork(async);
+    if (!async->ops) {
+        ALLOC_HASHTABLE(async->ops);
+        zend_hash_init(async->ops, 8, NULL, free_op, 0);
+    }
+
+    op->handle = ++async->next_handle;
+    op->item.query = zend_string_copy(query);
+    op->state = ASYNC_DONE;
+    zend_hash_index_add_new_ptr(async->ops, op->handle, op);
+
+    if (mysql_validate_cache_lookup(&op->item)) {
+        return op->handle;
+    }
+
+    verdict = mysql_check_syntax_locally(ZSTR_VAL(query), ZSTR_LEN(query), flags, &op->item.error_code, &op->item.error_message);
+    if (verdict != MYSQL_LEX_UNDECIDED) {
+        op->item.decided = 1;
+        op->item.is_valid = op->item.local = verdict == MYSQL_LEX_VALID;
+        mysql_validate_cache_store(&op->item);
+        return op->handle;
+    }
+
+    if (!(op->conn = take_connection(async, &op->reused))) {
+        return op->handle;
+    }
+    if (op->reused) {
+        op->sql = build_prepare(op->conn, query);
+        op->state = ASYNC_QUERYING;
+    } else {
+        op->state = ASYNC_CONNECTING;
+    }
+    step(op);
+    return op->handle;
+}
+
+static int poll_op(zval *zv, void *arg) {
+    async_op *op = Z_PTR_P(zv);
+    async_pass *pass = arg;
+    zval entry;
+
+    step(op);
+    if (op->state != ASYNC_DONE) {
+        pass->fds[pass->nfds].fd = op->conn->net.fd;
+        pass->fds[pass->nfds].events = op->events;
+        pass->fds[pass->nfds].revents = 0;
+        pass->nfds++;
+        return ZEND_HASH_APPLY_KEEP;
+    }
+
+    mysql_batch_item_to_zval(&op->item, &entry);
+    add_index_zval(pass->results, op->handle, &entry);
+    return ZEND_HASH_APPLY_REMOVE;
+}
+
+/*
+ * Collect finished validations into results (handle => verdict). With a
+ * timeout, wait on the connections' sockets until at least one validation
+ * finishes or the timeout (in seconds; negative waits forever) expires.
+ */
+void mysql_async_poll(double timeout, zval *results) {
+    HashTable *ops = MYSQL_QP_G(async).ops;
+    zend_hrtime_t deadline = 0;
+    async_pass pass;
+
+    array_init(results);
+    if (!ops || zend_hash_num_elements(ops) == 0) {
+        return;
+    }
+    check_fork(&MYSQL_QP_G(async));
+    if (timeout > 0) {
+        deadline = zend_hrtime() + (zend_hrtime_t) (timeout * ZEND_NANO_IN_SEC);
+    }
+
+    pass.results = results;
+    pass.fds = safe_emalloc(zend_hash_num_elements(ops), sizeof(struct pollfd), 0);
+
+    for (;;) {
+        int wait_ms = -1;
+
+        pass.nfds = 0;
+        zend_hash_apply_with_argument(ops, poll_op, &pass);
+        if (zend_hash_num_elements(Z_ARRVAL_P(results)) > 0 || pass.nfds == 0 || timeout == 0) {
+            break;
+        }
+        if (timeout > 0) {
+            zend_hrtime_t now = zend_hrtime();
+            if (now >= deadline) {
+                break;
+            }
+            wait_ms = (int) ((deadline - now + 999999) / 1000000);
+        }
+        poll(pass.fds, pass.nfds, wait_ms);
+    }
+
+    efree(pass.fds);
+}
+
+/* Socket of a pending validation and the POLLIN/POLLOUT it waits for, or -1 once it has finished */
+int mysql_async_socket(zend_long handle, short *events) {
+    HashTable *ops = MYSQL_QP_G(async).ops;
+    async_op *op;
+
+    check_fork(&MYSQL_QP_G(async));
+    if (!ops || !(op = zend_hash_index_find_ptr(ops, handle)) || op->state == ASYNC_DONE) {
+        return -1;
+    }
+    *events = op->events;
+    return op->conn->net.fd;
+}
+
+/* Abandon validations the request didn't collect */
+void mysql_async_end_request(mysql_qp_async *async) {
+    check_fork(async);
+    if (async->ops) {
+        zend_hash_destroy(async->ops);
+        FREE_HASHTABLE(async->ops);
+        async->ops = NULL;
+    }
+}
+
+void mysql_async_destroy(mysql_qp_async *async) {
+    check_fork(async);
+    while (async->idle_count > 0) {
+        mysql_close(async->idle[--async->idle_count]);
+    }
+    if (async->idle) pefree(async->idle, 1);
+    memset(async, 0, sizeof(mysql_qp_async));
+}
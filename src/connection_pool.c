@@ -0,0 +1,285 @@
+#include "php.h"
+#include "../include/php_mysql_qp.h"
+#include "../include/connection_pool.h"
+#include "../include/query_stats.h"
+#include <string.h>
+#include <unistd.h>
+
+mysql_qp_server mysql_qp_server_config;
+
+/* Parser connections select the configured database; syntax-only connections don't */
+mysql_qp_pool mysql_qp_parser_pool;
+mysql_qp_pool mysql_qp_syntax_pool;
+
+/* Server settings */
+
+static char* server_string(const char *value, size_t len) {
+    return len > 0 ? pestrndup(value, len, 1) : NULL;
+}
+
+/* Parse a PDO-style DSN ("mysql:host=...;port=...;dbname=...;unix_socket=...;charset=..."); called once from MINIT */
+void mysql_qp_server_configure(const char *dsn, const char *user, const char *password, const char *socket) {
+    mysql_qp_server *server = &mysql_qp_server_config;
+    const char *part = dsn;
+
+    mysql_qp_server_free();
+
+    if (strncasecmp(part, "mysql:", sizeof("mysql:") - 1) == 0) {
+        part += sizeof("mysql:") - 1;
+    }
+
+    while (*part) {
+        const char *end = strchr(part, ';'), *eq;
+        size_t len = end ? (size_t) (end - part) : strlen(part);
+
+        eq = memchr(part, '=', len);
+        if (eq) {
+            size_t key_len = eq - part, value_len = len - key_len - 1;
+            const char *value = eq + 1;
+
+            if (key_len == 4 && strncasecmp(part, "host", 4) == 0) {
+                server->host = server_string(value, value_len);
+            } else if (key_len == 4 && strncasecmp(part, "port", 4) == 0) {
+                server->port = (unsigned int) ZEND_STRTOUL(value, NULL, 10);
+            } else if (key_len == 6 && strncasecmp(part, "dbname", 6) == 0) {
+                server->database = server_string(value, value_len);
+            } else if (key_len == 11 && strncasecmp(part, "unix_socket", 11) == 0) {
+                server->socket = server_string(value, value_len);
+            } else if (key_len == 7 && strncasecmp(part, "charset", 7) == 0) {
+                server->charset = server_string(value, value_len);
+            } else {
+                php_error_docref(NULL, E_WARNING, "Ignoring unknown key \"%.*s\" in mysql_qp.dsn", (int) key_len, part);
+            }
+        } else if (len > 0) {
+            php_error_docref(NULL, E_WARNING, "Ignoring malformed component \"%.*s\" in mysql_qp.dsn", (int) len, part);
+        }
+
+        if (!end) break;
+        part = end + 1;
+    }
+
+    /* mysql_qp.socket wins over unix_socket in the DSN */
+    if (socket && *socket) {
+        if (server->socket) pefree(server->socket, 1);
+        server->socket = pestrdup(socket, 1);
+    }
+    server->user = user ? pestrdup(user, 1) : NULL;
+    server->password = password ? pestrdup(password, 1) : NULL;
+}
+
+void mysql_qp_server_free(void) {
+    mysql_qp_server *server = &mysql_qp_server_config;
+
+    if (server->host) pefree(server->host, 1);
+    if (server->database) pefree(server->database, 1);
+    if (server->socket) pefree(server->socket, 1);
+    if (server->charset) pefree(server->charset, 1);
+    if (server->user) pefree(server->user, 1);
+    if (server->password) pefree(server->password, 1);
+    memset(server, 0, sizeof(mysql_qp_server));
+}
+
+/* A handle with the configured client options, not yet connected */
+MYSQL* mysql_qp_init_connection(void) {
+    MYSQL *conn = mysql_init(NULL);
+
+    if (conn && mysql_qp_server_config.charset) {
+        mysql_options(conn, MYSQL_SET_CHARSET_NAME, mysql_qp_server_config.charset);
+    }
+    return conn;
+}
+
+/* Open a blocking connection to the configured server */
+MYSQL* mysql_qp_connect(const char *database, unsigned long client_flags) {
+    mysql_qp_server *server = &mysql_qp_server_config;
+    MYSQL *conn = mysql_qp_init_connection();
+    zend_hrtime_t start;
+
+    if (conn == NULL) {
+        return NULL;
+    }
+    start = zend_hrtime();
+    if (!mysql_real_connect(conn, server->host, server->user, server->password, database,
+                            server->port, server->socket, client_flags)) {
+        mysql_close(conn);
+        return NULL;
+    }
+    mysql_qp_stats_record(MYSQL_QP_STAT_CONNECT, zend_hrtime() - start);
+    return conn;
+}
+
+/*
+ * Drop a connection inherited across fork(). mysql_close() would send
+ * COM_QUIT and end the parent's session on the shared socket, so only our
+ * copy of the descriptor is closed and the handle itself is leaked.
+ */
+void mysql_qp_abandon(MYSQL *conn) {
+    if (conn->net.fd >= 0) {
+        close(conn->net.fd);
+    }
+}
+
+/* Pool */
+
+void mysql_qp_pool_init(mysql_qp_pool *pool, size_t size, const char *database, unsigned long client_flags, size_t stmt_cache_size) {
+    pool->database = database;
+    pool->client_flags = client_flags;
+    pool->size = size;
+    pool->slots = pecalloc(pool->size, sizeof(mysql_qp_pool_slot), 1);
+    pool->pid = getpid();
+    for (size_t i = 0; i < pool->size; i++) {
+        zend_atomic_bool_init(&pool->slots[i].in_use, false);
+        mysql_stmt_cache_init(&pool->slots[i].stmts, stmt_cache_size, pool->size);
+    }
+}
+
+/* Only called once no thread can hold a lease any more */
+void mysql_qp_pool_destroy(mysql_qp_pool *pool) {
+    zend_bool inherited = pool->pid != getpid();
+
+    if (!pool->slots) return;
+
+    for (size_t i = 0; i < pool->size; i++) {
+        mysql_stmt_cache_destroy(&pool->slots[i].stmts, !inherited);
+        if (!pool->slots[i].conn) continue;
+        if (inherited) {
+            mysql_qp_abandon(pool->slots[i].conn);
+        } else {
+            mysql_close(pool->slots[i].conn);
+        }
+    }
+    pefree(pool->slots, 1);
+    memset(pool, 0, sizeof(mysql_qp_pool));
+}
+
+/*
+ * First use after fork(): only the forking thread survives, so every slot
+ * is free again, and the parent's connections must not be touched.
+ */
+static void reset_after_fork(mysql_qp_pool *pool, mysql_qp_lease *lease) {
+    for (size_t i = 0; i < pool->size; i++) {
+        mysql_qp_pool_slot *slot = &pool->slots[i];
+        mysql_stmt_cache_destroy(&slot->stmts, 0);
+        if (slot->conn) {
+            mysql_qp_abandon(slot->conn);
+            slot->conn = NULL;
+        }
+        zend_atomic_bool_store(&slot->in_use, false);
+    }
+    if (lease->conn && !lease->slot) {
+        mysql_qp_abandon(lease->conn);
+    }
+    lease->slot = NULL;
+    lease->conn = NULL;
+    pool->pid = getpid();
+}
+
+/* Make sure a claimed slot holds a live connection, reconnecting a stale one */
+static int ensure_connected(mysql_qp_pool *pool, mysql_qp_pool_slot *slot) {
+    time_t now = time(NULL);
+
+    if (slot->conn && now - slot->last_used >= MYSQL_QP_PING_INTERVAL) {
+        mysql_qp_stats_round_trips(1);
+        if (mysql_ping(slot->conn) != 0) {
+            mysql_qp_stats_reconnect();
+            mysql_stmt_cache_destroy(&slot->stmts, 1);
+            mysql_close(slot->conn);
+            slot->conn = NULL;
+        }
+    }
+    if (!slot->conn && !(slot->conn = mysql_qp_connect(pool->database, pool->client_flags))) {
+        return FAILURE;
+    }
+    slot->last_used = now;
+    return SUCCESS;
+}
+
+/*
+ * Give the calling thread a connection. A thread keeps its lease for the
+ * rest of the request, so after the first call this is a pid check and a
+ * load. Slots are claimed with an atomic exchange, starting from a
+ * per-thread offset so concurrent threads rarely probe the same slot.
+ */
+int mysql_qp_pool_acquire(mysql_qp_pool *pool, mysql_qp_lease *lease) {
+    pid_t pid = getpid();
+    size_t start;
+
+    if (UNEXPECTED(pool->pid != pid)) {
+        reset_after_fork(pool, lease);
+    }
+    if (lease->conn) {
+        return SUCCESS;
+    }
+
+    lease->pid = pid;
+    start = pool->size > 1 ? ((uintptr_t) lease >> 6) % pool->size : 0;
+    for (size_t i = 0; i < pool->size; i++) {
+        mysql_qp_pool_slot *slot = &pool->slots[(start + i) % pool->size];
+
+        if (zend_atomic_bool_load(&slot->in_use) || zend_atomic_bool_exchange(&slot->in_use, true)) {
+            continue;
+        }
+        if (ensure_connected(pool, slot) != SUCCESS) {
+            zend_atomic_bool_store(&slot->in_use, false);
+            return FAILURE;
+        }
+        lease->slot = slot;
+        lease->conn = slot->conn;
+        return SUCCESS;
+    }
+
+    /* More threads than slots: fall back to a private connection for this request */
+    if (!(lease->conn = mysql_qp_connect(pool->database, pool->client_flags))) {
+        return FAILURE;
+    }
+    lease->slot = NULL;
+    return SUCCESS;
+}
+
+/* Hand the connection back; pooled connections stay open for the next thread */
+void mysql_qp_pool_release(mysql_qp_lease *lease) {
+    if (!lease->conn) return;
+
+    if (lease->pid != getpid()) {
+        /* Taken before fork(); the pool resets itself on its next use */
+        if (!lease->slot) mysql_qp_abandon(lease->conn);
+    } else if (lease->slot) {
+        lease->slot->last_used = time(NULL);
+        zend_atomic_bool_store(&lease->slot->in_use, false);
+    } else {
+        mysql_close(lease->conn);
+    }
+    lease->slot = NULL;
+    lease->conn = NULL;
+}
+
+/* Close a connection that failed, so the slot reconnects on its next use */
+void mysql_qp_pool_discard(mysql_qp_lease *lease) {
+    if (!lease->conn) return;
+
+    if (lease->pid != getpid()) {
+        mysql_qp_pool_release(lease);
+        return;
+    }
+    mysql_qp_stats_reconnect();
+    if (lease->slot) {
+        mysql_stmt_cache_destroy(&lease->slot->stmts, 1);
+    }
+    mysql_close(lease->conn);
+    if (lease->slot) {
+        lease->slot->conn = NULL;
+        zend_atomic_bool_store(&lease->slot->in_use, false);
+    }
+    lease->slot = NULL;
+    lease->conn = NULL;
+}
+
+/* Slots currently leased; a snapshot, since other threads keep running */
+size_t mysql_qp_pool_in_use(mysql_qp_pool *pool) {
+    size_t in_use = 0;
+
+    for (size_t i = 0; i < pool->size; i++) {
+        in_use += zend_atomic_bool_load(&pool->slots[i].in_use);
+    }
+    return in_use;
+}
@@ -0,0 +1,189 @@
+#include "php.h"
+#include "zend_interfaces.h"
+#include "../include/php_mysql_qp.h"
+#include "../include/query_decomposer.h"
+#include "../include/insert_rows.h"
+
+zend_class_entry *mysql_qp_insert_rows_ce;
+static zend_object_handlers insert_rows_handlers;
+
+/* The rows stay in the caller's query string, which is shared, never copied */
+typedef struct {
+    zend_string *query;
+    size_t start;               /* first byte after VALUES */
+    size_t end;                 /* byte after the last row */
+    zend_bool spans;            /* items as [offset, length] into the query */
+    zend_object std;
+} insert_rows_object;
+
+/* One foreach over the rows; only the current row is ever held */
+typedef struct {
+    zend_object_iterator it;
+    const char *pos;            /* next row, NULL once the list is exhausted */
+    zend_long key;
+    zval row;
+} insert_rows_iterator;
+
+static zend_always_inline insert_rows_object* insert_rows_from_obj(zend_object *obj) {
+    return (insert_rows_object *) ((char *) obj - XtOffsetOf(insert_rows_object, std));
+}
+
+static zend_object* insert_rows_create(zend_class_entry *ce) {
+    insert_rows_object *rows = zend_object_alloc(sizeof(insert_rows_object), ce);
+
+    zend_object_std_init(&rows->std, ce);
+    object_properties_init(&rows->std, ce);
+    rows->std.handlers = &insert_rows_handlers;
+    return &rows->std;
+}
+
+static void insert_rows_free(zend_object *obj) {
+    insert_rows_object *rows = insert_rows_from_obj(obj);
+
+    if (rows->query) {
+        zend_string_release(rows->query);
+    }
+    zend_object_std_dtor(obj);
+}
+
+/* Iterator */
+
+static void insert_rows_fetch(insert_rows_iterator *iter) {
+    insert_rows_object *rows = insert_rows_from_obj(Z_OBJ(iter->it.data));
+    const char *base = ZSTR_VAL(rows->query);
+
+    zval_ptr_dtor(&iter->row);
+    ZVAL_UNDEF(&iter->row);
+    if (iter->pos) {
+        iter->pos = insert_row_next(iter->pos, base + rows->end, rows->spans ? base : NULL, &iter->row);
+    }
+    iter->key++;
+}
+
+static void insert_rows_it_dtor(zend_object_iterator *it) {
+    insert_rows_iterator *iter = (insert_rows_iterator *) it;
+
+    zval_ptr_dtor(&iter->row);
+    zval_ptr_dtor(&it->data);
+}
+
+static zend_result insert_rows_it_valid(zend_object_iterator *it) {
+    return Z_TYPE(((insert_rows_iterator *) it)->row) != IS_UNDEF ? SUCCESS : FAILURE;
+}
+
+static zval* insert_rows_it_current(zend_object_iterator *it) {
+    return &((insert_rows_iterator *) it)->row;
+}
+
+static void insert_rows_it_key(zend_object_iterator *it, zval *key) {
+    ZVAL_LONG(key, ((insert_rows_iterator *) it)->key);
+}
+
+static void insert_rows_it_move_forward(zend_object_iterator *it) {
+    insert_rows_fetch((insert_rows_iterator *) it);
+}
+
+static void insert_rows_it_rewind(zend_object_iterator *it) {
+    insert_rows_iterator *iter = (insert_rows_iterator *) it;
+    insert_rows_object *rows = insert_rows_from_obj(Z_OBJ(it->data));
+
+    iter->pos = ZSTR_VAL(rows->query) + rows->start;
+    iter->key = -1;
+    insert_rows_fetch(iter);
+}
+
+static const zend_object_iterator_funcs insert_rows_it_funcs = {
+    insert_rows_it_dtor,
+    insert_rows_it_valid,
+    insert_rows_it_current,
+    insert_rows_it_key,
+    insert_rows_it_move_forward,
+    insert_rows_it_rewind,
+    NULL,                       /* invalidate_current */
+    NULL                        /* get_gc */
+};
+
+static zend_object_iterator* insert_rows_get_iterator(zend_class_entry *ce, zval *object, int by_ref) {
+    insert_rows_iterator *iter;
+
+    if (by_ref) {
+        zend_throw_error(NULL, "An iterator cannot be used with foreach by reference");
+        return NULL;
+    }
+
+    iter = ecalloc(1, sizeof(insert_rows_iterator));
+    zend_iterator_init(&iter->it);
+    ZVAL_OBJ_COPY(&iter->it.data, Z_OBJ_P(object));
+    iter->it.funcs = &insert_rows_it_funcs;
+    ZVAL_UNDEF(&iter->row);
+    return &iter->it;
+}
+
+/* Methods */
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_insert_rows_construct, 0, 0, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_insert_rows_get_iterator, 0, 0, Iterator, 0)
+ZEND_END_ARG_INFO()
+
+/* Only mysql_decompose_query() hands these out */
+PHP_METHOD(MysqlQp_InsertRows, __construct)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+}
+
+PHP_METHOD(MysqlQp_InsertRows, getIterator)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    zend_create_internal_iterator_zval(return_value, ZEND_THIS);
+}
+
+static const zend_function_entry insert_rows_methods[] = {
+    PHP_ME(MysqlQp_InsertRows, __construct, arginfo_insert_rows_construct, ZEND_ACC_PRIVATE)
+    PHP_ME(MysqlQp_InsertRows, getIterator, arginfo_insert_rows_get_iterator, ZEND_ACC_PUBLIC)
+    PHP_FE_END
+};
+
+/* Register the class; called from MINIT */
+void mysql_insert_rows_startup(void) {
+    zend_class_entry ce;
+
+    INIT_CLASS_ENTRY(ce, "MysqlQp\\InsertRows", insert_rows_methods);
+    mysql_qp_insert_rows_ce = zend_register_internal_class(&ce);
+    mysql_qp_insert_rows_ce->ce_flags |= ZEND_ACC_FINAL | ZEND_ACC_NO_DYNAMIC_PROPERTIES | ZEND_ACC_NOT_SERIALIZABLE;
+    mysql_qp_insert_rows_ce->create_object = insert_rows_create;
+    zend_class_implements(mysql_qp_insert_rows_ce, 1, zend_ce_aggregate);
+    /* foreach goes straight to the C iterator; getIterator() wraps the same one */
+    mysql_qp_insert_rows_ce->get_iterator = insert_rows_get_iterator;
+
+    memcpy(&insert_rows_handlers, zend_get_std_object_handlers(), sizeof(zend_object_handlers));
+    insert_rows_handlers.offset = XtOffsetOf(insert_rows_object, std);
+    insert_rows_handlers.free_obj = insert_rows_free;
+    insert_rows_handlers.clone_obj = NULL;
+}
+
+/* Rows [start, end) of query; the string is shared with the object */
+void mysql_insert_rows_init(zval *rows, zend_string *query, size_t start, size_t end, zend_bool spans) {
+    insert_rows_object *object;
+
+    object_init_ex(rows, mysql_qp_insert_rows_ce);
+    object = insert_rows_from_obj(Z_OBJ_P(rows));
+    object->query = zend_string_copy(query);
+    object->start = start;
+    object->end = end;
+    object->spans = spans;
+}
+
+/* The VALUES text behind a MysqlQp\InsertRows, for rebuilding the statement */
+int mysql_insert_rows_text(zval *rows, const char **text, size_t *text_len) {
+    insert_rows_object *object;
+
+    if (Z_TYPE_P(rows) != IS_OBJECT || Z_OBJCE_P(rows) != mysql_qp_insert_rows_ce) {
+        return FAILURE;
+    }
+    object = insert_rows_from_obj(Z_OBJ_P(rows));
+    *text = ZSTR_VAL(object->query) + object->start;
+    *text_len = object->end - object->start;
+    return SUCCESS;
+}
@@ -1,147 +1,157 @@
 #include "php.h"
 #include "../include/php_mysql_qp.h"
 #include "../include/mysql_query_parser.h"
+#include "../include/sql_lexer.h"
+#include "../include/query_parser.h"
+#include "../include/connection_pool.h"
+#include "../include/stmt_cache.h"
+#include "../include/query_stats.h"
 #include <mysql.h>
 #include <string.h>
 
-/* Global MySQL connection for parsing */
-static MYSQL *parser_mysql = NULL;
-static int parser_initialized = 0;
-
-/* Initialize parser connection */
+/* Lease the current thread a parser connection from the pool */
 int mysql_connect_parser(void) {
-    if (parser_initialized) {
-        return SUCCESS;
-    }
-    
-    parser_mysql = mysql_init(NULL);
-    if (parser_mysql == NULL) {
-        return FAILURE;
-    }
-    
-    /* Connect to a local MySQL instance for parsing */
-    /* Note: In production, this should be configurable */
-    if (!mysql_real_connect(parser_mysql, "localhost", "root", "", "mysql_qp_test", 0, NULL, 0)) {
-        mysql_close(parser_mysql);
-        parser_mysql = NULL;
-        return FAILURE;
-    }
-    
-    parser_initialized = 1;
-    return SUCCESS;
+    return mysql_qp_pool_acquire(&mysql_qp_parser_pool, &MYSQL_QP_G(parser_lease));
 }
 
-/* Cleanup parser connection */
+/* Close the current thread's parser connection */
 void mysql_disconnect_parser(void) {
-    if (parser_mysql) {
-        mysql_close(parser_mysql);
-        parser_mysql = NULL;
-    }
-    parser_initialized = 0;
+    mysql_qp_pool_discard(&MYSQL_QP_G(parser_lease));
 }
 
-/* Determine query type from SQL statement */
-int mysql_get_query_type(const char *query) {
-    if (!query) return QUERY_TYPE_UNKNOWN;
-    
-    /* Skip whitespace */
-    while (*query && isspace(*query)) query++;
-    
-    if (strncasecmp(query, "SELECT", 6) == 0) return QUERY_TYPE_SELECT;
-    if (strncasecmp(query, "INSERT", 6) == 0) return QUERY_TYPE_INSERT;
-    if (strncasecmp(query, "UPDATE", 6) == 0) return QUERY_TYPE_UPDATE;
-    if (strncasecmp(query, "DELETE", 6) == 0) return QUERY_TYPE_DELETE;
-    if (strncasecmp(query, "CREATE", 6) == 0) return QUERY_TYPE_CREATE;
-    if (strncasecmp(query, "DROP", 4) == 0) return QUERY_TYPE_DROP;
-    if (strncasecmp(query, "ALTER", 5) == 0) return QUERY_TYPE_ALTER;
-    if (strncasecmp(query, "SHOW", 4) == 0) return QUERY_TYPE_SHOW;
-    if (strncasecmp(query, "DESCRIBE", 8) == 0) return QUERY_TYPE_DESCRIBE;
-    if (strncasecmp(query, "EXPLAIN", 7) == 0) return QUERY_TYPE_EXPLAIN;
-    
-    return QUERY_TYPE_UNKNOWN;
+/* Prepare on the parser connection, reusing the statement its pool slot keeps for the same text */
+static mysql_stmt_entry* prepare_on_parser(const char *query, size_t query_len, int *error_code, char **error_message) {
+    mysql_qp_lease *lease = &MYSQL_QP_G(parser_lease);
+
+    return mysql_stmt_cache_acquire(lease->slot ? &lease->slot->stmts : NULL, lease->conn,
+                                    query, query_len, error_code, error_message);
 }
 
 /* Validate query using MySQL PREPARE */
 int mysql_validate_query_real(const char *query, size_t query_len) {
-    MYSQL_STMT *stmt;
-    int result = 0;
+    mysql_stmt_entry *stmt;
+    int error_code;
+    char *error_message;
     
-    if (!parser_initialized && mysql_connect_parser() != SUCCESS) {
+    if (mysql_lex_validate(query, query_len, NULL, NULL) == MYSQL_LEX_INVALID) {
         return 0;
     }
     
-    stmt = mysql_stmt_init(parser_mysql);
-    if (!stmt) {
+    if (mysql_connect_parser() != SUCCESS) {
         return 0;
     }
     
     /* Try to prepare the statement - this validates the syntax */
-    if (mysql_stmt_prepare(stmt, query, query_len) == 0) {
-        result = 1;  /* Valid */
+    if (!(stmt = prepare_on_parser(query, query_len, &error_code, &error_message))) {
+        if (error_message) efree(error_message);
+        return 0;
     }
     
-    mysql_stmt_close(stmt);
-    return result;
+    mysql_stmt_cache_release(stmt);
+    return 1;
+}
+
+/* Drop what a native parse filled in, leaving an invalid result with its query type */
+static void mysql_query_result_reset(mysql_query_result *result) {
+    if (result->normalized_query) {
+        zend_string_release(result->normalized_query);
+        result->normalized_query = NULL;
+    }
+    if (result->parse_tree) {
+        zval_ptr_dtor(result->parse_tree);
+        efree(result->parse_tree);
+        result->parse_tree = NULL;
+    }
+    if (result->columns) {
+        zval_ptr_dtor(result->columns);
+        efree(result->columns);
+        result->columns = NULL;
+    }
+    result->is_valid = 0;
+    result->parameter_count = 0;
 }
 
-/* Parse query using MySQL PREPARE + EXPLAIN */
-mysql_query_result* mysql_parse_query_real(const char *query, size_t query_len) {
+/* Fill result from the native parser; FAILURE leaves result untouched. unchecked (may be NULL) is
+ * set when the parse accepted something only the server can vouch for */
+int mysql_parse_query_native(zend_string *query, int flags, mysql_query_result *result, int *unchecked) {
+    sql_arena arena;
+    sql_parse_result parsed;
+    
+    sql_arena_init(&arena, SQL_ARENA_DEFAULT_CHUNK);
+    if (mysql_native_parse(ZSTR_VAL(query), ZSTR_LEN(query), &arena, &parsed) != SUCCESS) {
+        sql_arena_free(&arena);
+        return FAILURE;
+    }
+    
+    if (unchecked) *unchecked = parsed.unchecked;
+    result->is_valid = 1;
+    result->parameter_count = parsed.placeholder_count;
+    result->normalized_query = zend_string_copy(query);
+    result->parse_tree = emalloc(sizeof(zval));
+    if (flags & MYSQL_QP_SPANS) {
+        sql_node_to_zval_spans(parsed.root, ZSTR_VAL(query), ZSTR_LEN(query), result->parse_tree);
+    } else {
+        sql_node_to_zval(parsed.root, result->parse_tree);
+    }
+    
+    sql_arena_free(&arena);
+    return SUCCESS;
+}
+
+/* Parse query using MySQL PREPARE; plans are opt-in through mysql_explain_query() */
+mysql_query_result* mysql_parse_query_real(zend_string *query, int flags) {
+    const char *query_str = ZSTR_VAL(query);
+    size_t query_len = ZSTR_LEN(query);
     mysql_query_result *result;
-    MYSQL_STMT *stmt;
-    MYSQL_RES *res;
-    char explain_query[4096];
+    mysql_stmt_entry *stmt;
+    int unchecked = 0;
     
     result = emalloc(sizeof(mysql_query_result));
     memset(result, 0, sizeof(mysql_query_result));
     
     /* Always determine query type first, regardless of validity */
-    result->query_type = mysql_get_query_type(query);
+    result->query_type = mysql_get_query_type(query_str, query_len);
     
-    if (!parser_initialized && mysql_connect_parser() != SUCCESS) {
+    /* Errors the lexer can prove don't need a server round trip */
+    if (mysql_lex_validate(query_str, query_len, &result->error_code, &result->error_message) == MYSQL_LEX_INVALID) {
         result->is_valid = 0;
-        result->error_message = estrdup("Could not connect to MySQL for parsing");
         return result;
     }
     
-    /* Then validate with PREPARE */
-    stmt = mysql_stmt_init(parser_mysql);
-    if (!stmt) {
-        result->is_valid = 0;
-        result->error_message = estrdup("Could not create MySQL statement");
+    /* The native parser supplies the tree; the verdict stays the server's (unknown
+     * tables and columns, constructs the parser doesn't check) unless the caller
+     * asked for the local one and doesn't want result columns, which only the
+     * server knows */
+    if (mysql_parse_query_native(query, flags, result, &unchecked) == SUCCESS &&
+        (flags & MYSQL_QP_LOCAL_VERDICT) && !unchecked && !(flags & MYSQL_QP_METADATA)) {
         return result;
     }
     
-    if (mysql_stmt_prepare(stmt, query, query_len) != 0) {
-        result->is_valid = 0;
-        result->error_code = mysql_stmt_errno(stmt);
-        result->error_message = estrdup(mysql_stmt_error(stmt));
-        mysql_stmt_close(stmt);
+    if (mysql_connect_parser() != SUCCESS) {
+        mysql_query_result_reset(result);
+        result->error_message = estrdup("Could not connect to MySQL for parsing");
+        return result;
+    }
+    
+    /* Then validate with PREPARE */
+    if (!(stmt = prepare_on_parser(query_str, query_len, &result->error_code, &result->error_message))) {
+        mysql_query_result_reset(result);
+        result->server_verdict = 1;
         return result;
     }
     
     result->is_valid = 1;
-    result->parameter_count = mysql_stmt_param_count(stmt);
-    result->normalized_query = estrndup(query, query_len);
-    
-    mysql_stmt_close(stmt);
-    
-    /* For SELECT queries, get EXPLAIN information */
-    if (result->query_type == QUERY_TYPE_SELECT) {
-        snprintf(explain_query, sizeof(explain_query), "EXPLAIN FORMAT=JSON %.*s", (int)query_len, query);
-        
-        if (mysql_real_query(parser_mysql, explain_query, strlen(explain_query)) == 0) {
-            res = mysql_store_result(parser_mysql);
-            if (res) {
-                MYSQL_ROW row = mysql_fetch_row(res);
-                if (row && row[0]) {
-                    /* TODO: Parse JSON explain output into parse_tree zval */
-                    /* For now, just store it as a string */
-                }
-                mysql_free_result(res);
-            }
-        }
+    result->server_verdict = 1;
+    result->parameter_count = stmt->param_count;
+    if (!result->normalized_query) {
+        result->normalized_query = zend_string_copy(query);
+    }
+    if ((flags & MYSQL_QP_METADATA) && stmt->columns) {
+        result->columns = emalloc(sizeof(zval));
+        mysql_stmt_columns_to_zval(stmt, result->columns);
     }
     
+    mysql_stmt_cache_release(stmt);
     return result;
 }
 
@@ -150,23 +160,17 @@ void mysql_free_query_result(mysql_query_result *result) {
     if (!result) return;
     
     if (result->error_message) efree(result->error_message);
-    if (result->normalized_query) efree(result->normalized_query);
     if (result->parameter_names) {
         for (int i = 0; i < result->parameter_count; i++) {
             if (result->parameter_names[i]) efree(result->parameter_names[i]);
         }
         efree(result->parameter_names);
     }
-    if (result->parse_tree) {
-        zval_ptr_dtor(result->parse_tree);
-        efree(result->parse_tree);
-    }
-    
+    mysql_query_result_reset(result);
     efree(result);
 }
 
-/* Build query from parse tree (placeholder) */
+/* Build query from parse tree */
 char* mysql_build_query_real(zval *parse_tree) {
-    /* TODO: Implement query reconstruction from parse tree */
-    return estrdup("SELECT 1 /* reconstructed */");
+    return build_mysql_query(parse_tree);
 }
\ No newline at end of file
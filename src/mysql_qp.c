@@ -5,16 +5,75 @@
 #include "php.h"
 #include "php_ini.h"
 #include "ext/standard/info.h"
+#include "ext/standard/md5.h"
+#include "php_network.h"
 #include "../include/php_mysql_qp.h"
 #include "../include/mysql_query_parser.h"
 #include "../include/query_decomposer.h"
+#include "../include/async_validator.h"
+#include "../include/query_fingerprint.h"
+#include "../include/query_explain.h"
+#include "../include/insert_rows.h"
+#include "../include/query_template.h"
+#include "../include/query_object.h"
+#include "../include/query_interpolate.h"
+#include "../include/query_parameterize.h"
+#include "../include/sql_script.h"
+#include "../include/parallel_validator.h"
+#include "../include/query_tables.h"
+#include "../include/query_classify.h"
+#include <poll.h>
+#include <unistd.h>
 
 /* Module globals */
 ZEND_DECLARE_MODULE_GLOBALS(mysql_qp)
 
+/*
+ * Define PHP_FUNCTION(name) as a wrapper that times the body following the
+ * macro, counts the memory its result holds and fires the call-done probe.
+ */
+#define MYSQL_QP_TIMED_FUNCTION(name, stat) \
+	static void name##_body(INTERNAL_FUNCTION_PARAMETERS); \
+	PHP_FUNCTION(name) \
+	{ \
+		size_t memory = zend_memory_usage(0); \
+		zend_hrtime_t start = zend_hrtime(), elapsed; \
+		name##_body(INTERNAL_FUNCTION_PARAM_PASSTHRU); \
+		elapsed = zend_hrtime() - start; \
+		mysql_qp_stats_call(stat, elapsed, memory); \
+		MYSQL_QP_PROBE2(call__done, #name, elapsed); \
+	} \
+	static void name##_body(INTERNAL_FUNCTION_PARAMETERS)
+
+/* Keep the password out of phpinfo() */
+static ZEND_INI_DISP(display_password)
+{
+	zend_string *value = type == ZEND_INI_DISPLAY_ORIG && ini_entry->modified ? ini_entry->orig_value : ini_entry->value;
+
+	if (value && ZSTR_LEN(value)) {
+		PUTS("********");
+	} else {
+		PUTS("no value");
+	}
+}
+
+/* INI entries */
+PHP_INI_BEGIN()
+	STD_PHP_INI_ENTRY("mysql_qp.cache_size", QUERY_CACHE_DEFAULT_SIZE, PHP_INI_ALL, OnUpdateLong, cache_size, zend_mysql_qp_globals, mysql_qp_globals)
+	STD_PHP_INI_ENTRY("mysql_qp.shm_size", MYSQL_QP_SHM_DEFAULT_SIZE, PHP_INI_SYSTEM, OnUpdateLong, shm_size, zend_mysql_qp_globals, mysql_qp_globals)
+	STD_PHP_INI_ENTRY("mysql_qp.stmt_cache_size", MYSQL_QP_DEFAULT_STMT_CACHE_SIZE, PHP_INI_SYSTEM, OnUpdateLong, stmt_cache_size, zend_mysql_qp_globals, mysql_qp_globals)
+	STD_PHP_INI_ENTRY("mysql_qp.pool_size", MYSQL_QP_DEFAULT_POOL_SIZE, PHP_INI_SYSTEM, OnUpdateLong, pool_size, zend_mysql_qp_globals, mysql_qp_globals)
+	STD_PHP_INI_ENTRY("mysql_qp.dsn", MYSQL_QP_DEFAULT_DSN, PHP_INI_SYSTEM, OnUpdateString, dsn, zend_mysql_qp_globals, mysql_qp_globals)
+	STD_PHP_INI_ENTRY("mysql_qp.user", MYSQL_QP_DEFAULT_USER, PHP_INI_SYSTEM, OnUpdateString, user, zend_mysql_qp_globals, mysql_qp_globals)
+	STD_PHP_INI_ENTRY_EX("mysql_qp.password", "", PHP_INI_SYSTEM, OnUpdateString, password, zend_mysql_qp_globals, mysql_qp_globals, display_password)
+	STD_PHP_INI_ENTRY("mysql_qp.socket", "", PHP_INI_SYSTEM, OnUpdateString, socket, zend_mysql_qp_globals, mysql_qp_globals)
+	STD_PHP_INI_BOOLEAN("mysql_qp.warmup", "0", PHP_INI_PERDIR, OnUpdateBool, warmup, zend_mysql_qp_globals, mysql_qp_globals)
+PHP_INI_END()
+
 /* Argument info for functions */
 ZEND_BEGIN_ARG_INFO_EX(arginfo_mysql_parse_query, 0, 0, 1)
 	ZEND_ARG_TYPE_INFO(0, query, IS_STRING, 0)
+	ZEND_ARG_TYPE_INFO(0, flags, IS_LONG, 0)
 ZEND_END_ARG_INFO()
 
 ZEND_BEGIN_ARG_INFO_EX(arginfo_mysql_build_query, 0, 0, 1)
@@ -23,23 +82,110 @@ ZEND_END_ARG_INFO()
 
 ZEND_BEGIN_ARG_INFO_EX(arginfo_mysql_validate_query, 0, 0, 1)
 	ZEND_ARG_TYPE_INFO(0, query, IS_STRING, 0)
+	ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, flags, IS_LONG, 0, "0")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_mysql_validate_queries, 0, 0, 1)
+	ZEND_ARG_TYPE_INFO(0, queries, IS_ARRAY, 0)
+	ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, flags, IS_LONG, 0, "0")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_mysql_validate_query_async, 0, 0, 1)
+	ZEND_ARG_TYPE_INFO(0, query, IS_STRING, 0)
+	ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, flags, IS_LONG, 0, "0")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_mysql_qp_poll, 0, 0, 0)
+	ZEND_ARG_TYPE_INFO(0, timeout, IS_DOUBLE, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_mysql_qp_async_socket, 0, 0, 1)
+	ZEND_ARG_TYPE_INFO(0, handle, IS_LONG, 0)
+	ZEND_ARG_INFO_WITH_DEFAULT_VALUE(1, writable, "null")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_mysql_fingerprint_query, 0, 0, 1)
+	ZEND_ARG_TYPE_INFO(0, query, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_mysql_explain_query, 0, 0, 1)
+	ZEND_ARG_TYPE_INFO(0, query, IS_STRING, 0)
+	ZEND_ARG_TYPE_INFO(0, tree, _IS_BOOL, 0)
 ZEND_END_ARG_INFO()
 
 ZEND_BEGIN_ARG_INFO_EX(arginfo_mysql_decompose_query, 0, 0, 1)
 	ZEND_ARG_TYPE_INFO(0, query, IS_STRING, 0)
+	ZEND_ARG_TYPE_INFO(0, flags, IS_LONG, 0)
 ZEND_END_ARG_INFO()
 
 ZEND_BEGIN_ARG_INFO_EX(arginfo_mysql_reconstruct_query, 0, 0, 1)
 	ZEND_ARG_TYPE_INFO(0, components, IS_ARRAY, 0)
 ZEND_END_ARG_INFO()
 
+ZEND_BEGIN_ARG_INFO_EX(arginfo_mysql_compile_template, 0, 0, 1)
+	ZEND_ARG_TYPE_MASK(0, components, MAY_BE_ARRAY|MAY_BE_STRING, NULL)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_mysql_interpolate_query, 0, 0, 2)
+	ZEND_ARG_TYPE_INFO(0, sql, IS_STRING, 0)
+	ZEND_ARG_TYPE_INFO(0, params, IS_ARRAY, 0)
+	ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, charset, IS_STRING, 1, "null")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_mysql_parameterize_query, 0, 0, 1)
+	ZEND_ARG_TYPE_INFO(0, sql, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_mysql_split_sql, 0, 0, 1)
+	ZEND_ARG_TYPE_INFO(0, sql, IS_STRING, 0)
+	ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, flags, IS_LONG, 0, "0")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_mysql_split_sql_file, 0, 0, 1)
+	ZEND_ARG_TYPE_INFO(0, path, IS_STRING, 0)
+	ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, flags, IS_LONG, 0, "0")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_mysql_validate_parallel, 0, 0, 1)
+	ZEND_ARG_TYPE_INFO(0, queries, IS_ITERABLE, 0)
+	ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, threads, IS_LONG, 0, "4")
+	ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, flags, IS_LONG, 0, "0")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_mysql_extract_tables, 0, 0, 1)
+	ZEND_ARG_TYPE_INFO(0, sql, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_mysql_classify_query, 0, 0, 1)
+	ZEND_ARG_TYPE_INFO(0, sql, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_mysql_qp_stats, 0, 0, 0)
+	ZEND_ARG_TYPE_INFO(0, reset, _IS_BOOL, 0)
+ZEND_END_ARG_INFO()
+
 /* Function entries */
 static const zend_function_entry mysql_qp_functions[] = {
 	PHP_FE(mysql_parse_query, arginfo_mysql_parse_query)
 	PHP_FE(mysql_build_query, arginfo_mysql_build_query)
 	PHP_FE(mysql_validate_query, arginfo_mysql_validate_query)
+	PHP_FE(mysql_validate_queries, arginfo_mysql_validate_queries)
+	PHP_FE(mysql_validate_query_async, arginfo_mysql_validate_query_async)
+	PHP_FE(mysql_qp_poll, arginfo_mysql_qp_poll)
+	PHP_FE(mysql_qp_async_socket, arginfo_mysql_qp_async_socket)
+	PHP_FE(mysql_fingerprint_query, arginfo_mysql_fingerprint_query)
+	PHP_FE(mysql_explain_query, arginfo_mysql_explain_query)
 	PHP_FE(mysql_decompose_query, arginfo_mysql_decompose_query)
 	PHP_FE(mysql_reconstruct_query, arginfo_mysql_reconstruct_query)
+	PHP_FE(mysql_compile_template, arginfo_mysql_compile_template)
+	PHP_FE(mysql_interpolate_query, arginfo_mysql_interpolate_query)
+	PHP_FE(mysql_parameterize_query, arginfo_mysql_parameterize_query)
+	PHP_FE(mysql_split_sql, arginfo_mysql_split_sql)
+	PHP_FE(mysql_split_sql_file, arginfo_mysql_split_sql_file)
+	PHP_FE(mysql_validate_parallel, arginfo_mysql_validate_parallel)
+	PHP_FE(mysql_extract_tables, arginfo_mysql_extract_tables)
+	PHP_FE(mysql_classify_query, arginfo_mysql_classify_query)
+	PHP_FE(mysql_qp_stats, arginfo_mysql_qp_stats)
 	PHP_FE_END
 };
 
@@ -50,11 +196,15 @@ zend_module_entry mysql_qp_module_entry = {
 	mysql_qp_functions,
 	PHP_MINIT(mysql_qp),
 	PHP_MSHUTDOWN(mysql_qp),
-	NULL,
-	NULL,
+	PHP_RINIT(mysql_qp),
+	PHP_RSHUTDOWN(mysql_qp),
 	PHP_MINFO(mysql_qp),
 	PHP_MYSQL_QP_VERSION,
-	STANDARD_MODULE_PROPERTIES
+	PHP_MODULE_GLOBALS(mysql_qp),
+	PHP_GINIT(mysql_qp),
+	PHP_GSHUTDOWN(mysql_qp),
+	NULL,
+	STANDARD_MODULE_PROPERTIES_EX
 };
 
 #ifdef COMPILE_DL_MYSQL_QP
@@ -64,45 +214,187 @@ ZEND_TSRMLS_CACHE_DEFINE()
 ZEND_GET_MODULE(mysql_qp)
 #endif
 
+/* Per-worker globals: each thread (or process) gets its own result cache */
+PHP_GINIT_FUNCTION(mysql_qp)
+{
+#if defined(COMPILE_DL_MYSQL_QP) && defined(ZTS)
+	ZEND_TSRMLS_CACHE_UPDATE();
+#endif
+	memset(mysql_qp_globals, 0, sizeof(*mysql_qp_globals));
+	query_cache_init(&mysql_qp_globals->cache);
+}
+
+PHP_GSHUTDOWN_FUNCTION(mysql_qp)
+{
+	mysql_qp_pool_release(&mysql_qp_globals->parser_lease);
+	mysql_qp_pool_release(&mysql_qp_globals->syntax_lease);
+	mysql_async_destroy(&mysql_qp_globals->async);
+	query_cache_destroy(&mysql_qp_globals->cache);
+#ifdef ZTS
+	mysql_thread_end();
+#endif
+}
+
 /* Module initialization */
 PHP_MINIT_FUNCTION(mysql_qp)
 {
-	MYSQL_QP_G(initialized) = 1;
-	if (mysql_connect_parser() != SUCCESS) {
-		php_error_docref(NULL, E_WARNING, "Failed to initialize MySQL parser connection");
+	size_t pool_size;
+
+	REGISTER_INI_ENTRIES();
+	REGISTER_LONG_CONSTANT("MYSQL_QP_SPANS", MYSQL_QP_SPANS, CONST_PERSISTENT);
+	REGISTER_LONG_CONSTANT("MYSQL_QP_METADATA", MYSQL_QP_METADATA, CONST_PERSISTENT);
+	REGISTER_LONG_CONSTANT("MYSQL_QP_LOCAL_VERDICT", MYSQL_QP_LOCAL_VERDICT, CONST_PERSISTENT);
+	REGISTER_LONG_CONSTANT("MYSQL_QP_READ_ONLY", MYSQL_QP_READ_ONLY, CONST_PERSISTENT);
+	REGISTER_LONG_CONSTANT("MYSQL_QP_LOCKING_READ", MYSQL_QP_LOCKING_READ, CONST_PERSISTENT);
+	REGISTER_LONG_CONSTANT("MYSQL_QP_TRANSACTION", MYSQL_QP_TRANSACTION, CONST_PERSISTENT);
+	REGISTER_LONG_CONSTANT("MYSQL_QP_IMPLICIT_COMMIT", MYSQL_QP_IMPLICIT_COMMIT, CONST_PERSISTENT);
+	REGISTER_LONG_CONSTANT("MYSQL_QP_NONDETERMINISTIC", MYSQL_QP_NONDETERMINISTIC, CONST_PERSISTENT);
+
+	/* Must run before any thread touches libmysqlclient */
+	if (mysql_library_init(0, NULL, NULL)) {
+		php_error_docref(NULL, E_WARNING, "Failed to initialize the MySQL client library");
+		return FAILURE;
 	}
+
+	/* Connections are opened lazily, by the first request that needs one, so a
+	 * forking SAPI's master never holds a socket its children would share */
+	mysql_qp_server_configure(MYSQL_QP_G(dsn), MYSQL_QP_G(user), MYSQL_QP_G(password), MYSQL_QP_G(socket));
+	pool_size = MYSQL_QP_G(pool_size) > 0 ? (size_t) MYSQL_QP_G(pool_size) : 1;
+	mysql_qp_pool_init(&mysql_qp_parser_pool, pool_size, mysql_qp_server_config.database, 0,
+		MYSQL_QP_G(stmt_cache_size) > 0 ? (size_t) MYSQL_QP_G(stmt_cache_size) : 0);
+	/* Syntax connections batch their PREPAREs into multi-statement packets */
+	mysql_qp_pool_init(&mysql_qp_syntax_pool, pool_size, NULL, CLIENT_MULTI_STATEMENTS, 0);
+
+	/* Mapped here, before a forking SAPI starts its workers, so they all share it */
+	mysql_shm_startup(MYSQL_QP_G(shm_size));
+
+	mysql_decomposer_startup();
+	mysql_insert_rows_startup();
+	mysql_template_startup();
+	mysql_query_object_startup();
+	mysql_sql_script_startup();
+
+	MYSQL_QP_G(initialized) = 1;
 	return SUCCESS;
 }
 
 /* Module shutdown */
 PHP_MSHUTDOWN_FUNCTION(mysql_qp)
 {
-	mysql_disconnect_parser();
+	mysql_qp_pool_release(&MYSQL_QP_G(parser_lease));
+	mysql_qp_pool_release(&MYSQL_QP_G(syntax_lease));
+	mysql_async_destroy(&MYSQL_QP_G(async));
+	mysql_qp_pool_destroy(&mysql_qp_parser_pool);
+	mysql_qp_pool_destroy(&mysql_qp_syntax_pool);
+	mysql_shm_shutdown();
+	mysql_qp_server_free();
+	mysql_library_end();
 	MYSQL_QP_G(initialized) = 0;
+	UNREGISTER_INI_ENTRIES();
+	return SUCCESS;
+}
+
+/* Request startup: optionally claim this thread's connections before the script needs them */
+PHP_RINIT_FUNCTION(mysql_qp)
+{
+#if defined(COMPILE_DL_MYSQL_QP) && defined(ZTS)
+	ZEND_TSRMLS_CACHE_UPDATE();
+#endif
+	if (MYSQL_QP_G(warmup)) {
+		mysql_connect_parser();
+		mysql_connect_syntax_parser();
+	}
+	return SUCCESS;
+}
+
+/* Request shutdown: return this thread's connections to the pool, drop uncollected async validations,
+ * let go of shared results and of cached parse trees dropped during the request */
+PHP_RSHUTDOWN_FUNCTION(mysql_qp)
+{
+	mysql_qp_pool_release(&MYSQL_QP_G(parser_lease));
+	mysql_qp_pool_release(&MYSQL_QP_G(syntax_lease));
+	mysql_async_end_request(&MYSQL_QP_G(async));
+	mysql_shm_end_request(&MYSQL_QP_G(shm));
+	query_cache_end_request(&MYSQL_QP_G(cache));
 	return SUCCESS;
 }
 
+static void print_counter_row(const char *name, zend_ulong value)
+{
+	char buf[32];
+	snprintf(buf, sizeof(buf), ZEND_ULONG_FMT, value);
+	php_info_print_table_row(2, name, buf);
+}
+
 /* Module info */
 PHP_MINFO_FUNCTION(mysql_qp)
 {
+	mysql_shm_stats shm_stats;
+
 	php_info_print_table_start();
 	php_info_print_table_header(2, "MySQL Query Parser", "enabled");
 	php_info_print_table_row(2, "Version", PHP_MYSQL_QP_VERSION);
 	php_info_print_table_end();
+
+	php_info_print_table_start();
+	php_info_print_table_header(2, "Result cache", MYSQL_QP_G(cache_size) > 0 ? "enabled" : "disabled");
+	print_counter_row("Entries", MYSQL_QP_G(cache).count);
+	print_counter_row("Hits", MYSQL_QP_G(cache).hits);
+	print_counter_row("Misses", MYSQL_QP_G(cache).misses);
+	print_counter_row("Evictions", MYSQL_QP_G(cache).evictions);
+	php_info_print_table_end();
+
+	php_info_print_table_start();
+	if (mysql_shm_get_stats(&shm_stats) == SUCCESS) {
+		php_info_print_table_header(2, "Shared result cache", shm_stats.restart_pending ? "restart pending" : "enabled");
+		print_counter_row("Size", shm_stats.size);
+		print_counter_row("Used", shm_stats.used);
+		print_counter_row("Entries", shm_stats.entries);
+		print_counter_row("Restarts", shm_stats.restarts);
+		print_counter_row("Hits (this worker)", MYSQL_QP_G(shm).hits);
+		print_counter_row("Misses (this worker)", MYSQL_QP_G(shm).misses);
+	} else {
+		php_info_print_table_header(2, "Shared result cache", "disabled");
+	}
+	php_info_print_table_end();
+
+	php_info_print_table_start();
+	php_info_print_table_header(2, "Connection pool", "");
+	print_counter_row("Slots per pool", mysql_qp_parser_pool.size);
+	print_counter_row("Parser connections in use", mysql_qp_pool_in_use(&mysql_qp_parser_pool));
+	print_counter_row("Syntax connections in use", mysql_qp_pool_in_use(&mysql_qp_syntax_pool));
+	php_info_print_table_end();
+
+	php_info_print_table_start();
+	php_info_print_table_header(2, "Prepared statement cache", MYSQL_QP_G(stmt_cache_size) > 0 ? "enabled" : "disabled");
+	print_counter_row("Hits (this worker)", MYSQL_QP_G(stats).stmt_hits);
+	print_counter_row("Misses (this worker)", MYSQL_QP_G(stats).stmt_misses);
+	print_counter_row("Evictions (this worker)", MYSQL_QP_G(stats).stmt_evictions);
+	php_info_print_table_end();
+
+	mysql_qp_stats_info();
+
+	DISPLAY_INI_ENTRIES();
 }
 
 /* Function implementations using real MySQL parser */
-PHP_FUNCTION(mysql_parse_query)
+MYSQL_QP_TIMED_FUNCTION(mysql_parse_query, MYSQL_QP_STAT_PARSE_QUERY)
 {
-	char *query;
-	size_t query_len;
+	zend_string *query;
+	zend_long flags = 0;
 	mysql_query_result *result;
 
-	ZEND_PARSE_PARAMETERS_START(1, 1)
-		Z_PARAM_STRING(query, query_len)
+	ZEND_PARSE_PARAMETERS_START(1, 2)
+		Z_PARAM_STR(query)
+		Z_PARAM_OPTIONAL
+		Z_PARAM_LONG(flags)
 	ZEND_PARSE_PARAMETERS_END();
 
-	result = mysql_parse_query_real(query, query_len);
+	if (mysql_shm_find(&MYSQL_QP_G(shm), query, MYSQL_SHM_PARSE, (int) flags, return_value)) {
+		return;
+	}
+
+	result = mysql_parse_query_cached(query, (int) flags);
 	
 	array_init(return_value);
 	add_assoc_bool(return_value, "is_valid", result->is_valid);
@@ -113,114 +405,590 @@ PHP_FUNCTION(mysql_parse_query)
 		add_assoc_long(return_value, "error_code", result->error_code);
 	}
 	
+	/* The caller's string itself, with one more reference */
 	if (result->normalized_query) {
-		add_assoc_string(return_value, "normalized_query", result->normalized_query);
+		add_assoc_str(return_value, "normalized_query", result->normalized_query);
+		result->normalized_query = NULL;
 	}
 	
 	add_assoc_long(return_value, "parameter_count", result->parameter_count);
 	
+	/* Hand the tree over to the return value instead of copying it */
+	if (result->parse_tree) {
+		add_assoc_zval(return_value, "parse_tree", result->parse_tree);
+		efree(result->parse_tree);
+		result->parse_tree = NULL;
+	}
+	
+	if (flags & MYSQL_QP_METADATA) {
+		if (result->columns) {
+			add_assoc_zval(return_value, "columns", result->columns);
+			efree(result->columns);
+			result->columns = NULL;
+		} else if (result->is_valid) {
+			add_assoc_null(return_value, "columns");
+		}
+	}
+	
+	/* Only verdicts that hold for every schema are shared: the server's depend on the
+	 * worker's database and grants, and connection failures are transient */
+	if (!result->server_verdict && (result->is_valid || result->error_code != 0)) {
+		mysql_shm_store(&MYSQL_QP_G(shm), query, MYSQL_SHM_PARSE, (int) flags, return_value);
+	}
+	
 	mysql_free_query_result(result);
 }
 
-PHP_FUNCTION(mysql_build_query)
+MYSQL_QP_TIMED_FUNCTION(mysql_build_query, MYSQL_QP_STAT_BUILD_QUERY)
 {
 	zval *parse_tree;
+	char *query;
 
 	ZEND_PARSE_PARAMETERS_START(1, 1)
 		Z_PARAM_ARRAY(parse_tree)
 	ZEND_PARSE_PARAMETERS_END();
 
-	/* TODO: Implement query building from parse tree */
-	RETURN_STRING("SELECT 1");
+	query = mysql_build_query_real(parse_tree);
+	if (!query) {
+		php_error_docref(NULL, E_WARNING, "Malformed parse tree");
+		RETURN_FALSE;
+	}
+
+	RETVAL_STRING(query);
+	efree(query);
 }
 
-PHP_FUNCTION(mysql_validate_query)
+MYSQL_QP_TIMED_FUNCTION(mysql_validate_query, MYSQL_QP_STAT_VALIDATE_QUERY)
 {
-	char *query;
-	size_t query_len;
+	zend_string *query;
+	zend_long flags = 0;
 	int is_valid;
 
-	ZEND_PARSE_PARAMETERS_START(1, 1)
-		Z_PARAM_STRING(query, query_len)
+	ZEND_PARSE_PARAMETERS_START(1, 2)
+		Z_PARAM_STR(query)
+		Z_PARAM_OPTIONAL
+		Z_PARAM_LONG(flags)
 	ZEND_PARSE_PARAMETERS_END();
 
-	is_valid = mysql_validate_syntax_only(query, query_len);
+	is_valid = mysql_validate_cached(query, (int) flags);
 	RETURN_BOOL(is_valid);
 }
 
-PHP_FUNCTION(mysql_decompose_query)
+/* Validate every string in queries over up to threads connections; results keep the input keys */
+static void validate_queries(HashTable *queries, int threads, int flags, zval *return_value)
 {
-	char *query;
-	size_t query_len;
-	query_components *components;
+	zval *query, entry;
+	zend_string *key;
+	zend_ulong index;
+	mysql_batch_item *items;
+	size_t count = 0, i = 0;
+
+	ZEND_HASH_FOREACH_VAL(queries, query) {
+		ZVAL_DEREF(query);
+		if (Z_TYPE_P(query) != IS_STRING) {
+			php_error_docref(NULL, E_WARNING, "All queries must be strings");
+			RETURN_FALSE;
+		}
+		count++;
+	} ZEND_HASH_FOREACH_END();
+
+	array_init_size(return_value, (uint32_t) count);
+	if (count == 0) {
+		return;
+	}
+
+	items = ecalloc(count, sizeof(mysql_batch_item));
+	ZEND_HASH_FOREACH_VAL(queries, query) {
+		ZVAL_DEREF(query);
+		items[i++].query = Z_STR_P(query);
+	} ZEND_HASH_FOREACH_END();
+
+	mysql_validate_batch_cached(items, count, threads, flags);
+
+	i = 0;
+	ZEND_HASH_FOREACH_KEY(queries, index, key) {
+		mysql_batch_item *item = &items[i++];
+
+		mysql_batch_item_to_zval(item, &entry);
+		if (item->error_message) {
+			efree(item->error_message);
+		}
+
+		if (key) {
+			zend_hash_update(Z_ARRVAL_P(return_value), key, &entry);
+		} else {
+			zend_hash_index_update(Z_ARRVAL_P(return_value), index, &entry);
+		}
+	} ZEND_HASH_FOREACH_END();
+
+	efree(items);
+}
+
+MYSQL_QP_TIMED_FUNCTION(mysql_validate_queries, MYSQL_QP_STAT_VALIDATE_QUERIES)
+{
+	zval *queries;
+	zend_long flags = 0;
+
+	ZEND_PARSE_PARAMETERS_START(1, 2)
+		Z_PARAM_ARRAY(queries)
+		Z_PARAM_OPTIONAL
+		Z_PARAM_LONG(flags)
+	ZEND_PARSE_PARAMETERS_END();
+
+	validate_queries(Z_ARRVAL_P(queries), 1, (int) flags, return_value);
+}
+
+MYSQL_QP_TIMED_FUNCTION(mysql_validate_query_async, MYSQL_QP_STAT_VALIDATE_QUERY_ASYNC)
+{
+	zend_string *query;
+	zend_long flags = 0;
+
+	ZEND_PARSE_PARAMETERS_START(1, 2)
+		Z_PARAM_STR(query)
+		Z_PARAM_OPTIONAL
+		Z_PARAM_LONG(flags)
+	ZEND_PARSE_PARAMETERS_END();
+
+	RETURN_LONG(mysql_async_validate_start(query, (int) flags));
+}
+
+PHP_FUNCTION(mysql_qp_poll)
+{
+	double timeout = 0;
+
+	ZEND_PARSE_PARAMETERS_START(0, 1)
+		Z_PARAM_OPTIONAL
+		Z_PARAM_DOUBLE(timeout)
+	ZEND_PARSE_PARAMETERS_END();
+
+	mysql_async_poll(timeout, return_value);
+}
+
+/* A stream on a duplicate of the validation's socket, for stream_select() and event loops;
+ * writable tells which way to wait */
+PHP_FUNCTION(mysql_qp_async_socket)
+{
+	zend_long handle;
+	zval *writable = NULL;
+	php_stream *stream;
+	short events = POLLIN;
+	int fd;
+
+	ZEND_PARSE_PARAMETERS_START(1, 2)
+		Z_PARAM_LONG(handle)
+		Z_PARAM_OPTIONAL
+		Z_PARAM_ZVAL(writable)
+	ZEND_PARSE_PARAMETERS_END();
+
+	fd = mysql_async_socket(handle, &events);
+	if (writable) {
+		if (fd < 0) {
+			ZEND_TRY_ASSIGN_REF_NULL(writable);
+		} else {
+			ZEND_TRY_ASSIGN_REF_BOOL(writable, events == POLLOUT);
+		}
+	}
+	if (fd < 0 || (fd = dup(fd)) < 0) {
+		RETURN_NULL();
+	}
+	if (!(stream = php_stream_sock_open_from_socket(fd, NULL))) {
+		close(fd);
+		RETURN_NULL();
+	}
+	php_stream_to_zval(stream, return_value);
+}
+
+MYSQL_QP_TIMED_FUNCTION(mysql_fingerprint_query, MYSQL_QP_STAT_FINGERPRINT_QUERY)
+{
+	zend_string *query;
+	mysql_fingerprint fingerprint;
+	char digest[MYSQL_DIGEST_SIZE * 2 + 1];
 
 	ZEND_PARSE_PARAMETERS_START(1, 1)
-		Z_PARAM_STRING(query, query_len)
+		Z_PARAM_STR(query)
 	ZEND_PARSE_PARAMETERS_END();
 
-	components = mysql_decompose_query(query, query_len);
-	
-	array_init(return_value);
-	add_assoc_string(return_value, "type", components->type ? components->type : "UNKNOWN");
-	add_assoc_zval(return_value, "fields", components->fields);
-	add_assoc_zval(return_value, "tables", components->tables);
-	add_assoc_zval(return_value, "joins", components->joins);
-	add_assoc_zval(return_value, "where_conditions", components->where_conditions);
-	add_assoc_zval(return_value, "group_by", components->group_by);
-	add_assoc_zval(return_value, "having", components->having);
-	add_assoc_zval(return_value, "order_by", components->order_by);
-	add_assoc_zval(return_value, "limit_clause", components->limit_clause);
-	add_assoc_zval(return_value, "values", components->values);
-	add_assoc_zval(return_value, "parameters", components->parameters);
-	
-	/* Clean up the components structure - PHP now owns the zval data */
-	if (components->type) efree(components->type);
-	
-	/* Free the zval containers (PHP owns the array data now) */
-	if (components->fields) efree(components->fields);
-	if (components->tables) efree(components->tables);
-	if (components->joins) efree(components->joins);
-	if (components->where_conditions) efree(components->where_conditions);
-	if (components->group_by) efree(components->group_by);
-	if (components->having) efree(components->having);
-	if (components->order_by) efree(components->order_by);
-	if (components->limit_clause) efree(components->limit_clause);
-	if (components->values) efree(components->values);
-	if (components->parameters) efree(components->parameters);
-	
-	efree(components);
+	if (mysql_compute_fingerprint(ZSTR_VAL(query), ZSTR_LEN(query), &fingerprint) != SUCCESS) {
+		RETURN_FALSE;
+	}
+
+	make_digest_ex(digest, fingerprint.digest, MYSQL_DIGEST_SIZE);
+
+	array_init_size(return_value, 3);
+	add_assoc_str(return_value, "digest_text", fingerprint.text);
+	add_assoc_stringl(return_value, "digest", digest, MYSQL_DIGEST_SIZE * 2);
+	add_assoc_long(return_value, "hash", mysql_fingerprint_hash(&fingerprint));
+}
+
+MYSQL_QP_TIMED_FUNCTION(mysql_explain_query, MYSQL_QP_STAT_EXPLAIN_QUERY)
+{
+	zend_string *query;
+	zend_bool tree = 0;
+	int error_code;
+	char *error_message;
+
+	ZEND_PARSE_PARAMETERS_START(1, 2)
+		Z_PARAM_STR(query)
+		Z_PARAM_OPTIONAL
+		Z_PARAM_BOOL(tree)
+	ZEND_PARSE_PARAMETERS_END();
+
+	if (mysql_explain_cached(query, tree, return_value, &error_code, &error_message) != SUCCESS) {
+		if (error_code) {
+			php_error_docref(NULL, E_WARNING, "EXPLAIN failed (%d): %s", error_code, error_message);
+		} else {
+			php_error_docref(NULL, E_WARNING, "%s", error_message);
+		}
+		efree(error_message);
+		RETURN_FALSE;
+	}
+}
+
+MYSQL_QP_TIMED_FUNCTION(mysql_decompose_query, MYSQL_QP_STAT_DECOMPOSE_QUERY)
+{
+	zend_string *query;
+	zend_long flags = 0;
+	query_components components;
+
+	ZEND_PARSE_PARAMETERS_START(1, 2)
+		Z_PARAM_STR(query)
+		Z_PARAM_OPTIONAL
+		Z_PARAM_LONG(flags)
+	ZEND_PARSE_PARAMETERS_END();
+
+	if (mysql_shm_find(&MYSQL_QP_G(shm), query, MYSQL_SHM_DECOMPOSE, (int) flags, return_value)) {
+		return;
+	}
+
+	init_query_components(&components);
+	mysql_decompose_query(query, (int) flags, &components);
+
+	/* The clause arrays move into the return value without copying */
+	mysql_query_components_to_zval(&components, return_value);
+	mysql_shm_store(&MYSQL_QP_G(shm), query, MYSQL_SHM_DECOMPOSE, (int) flags, return_value);
+}
+
+/* Borrow the clauses of a decomposition array; nothing here is copied or freed */
+static void borrow_components(HashTable *array, query_components *components)
+{
+	zval *clause;
+
+	init_query_components(components);
+
+	clause = zend_hash_find(array, query_component_keys[COMPONENT_TYPE]);
+	if (clause && Z_TYPE_P(clause) == IS_STRING) {
+		components->type = Z_STR_P(clause);
+	}
+	if ((clause = zend_hash_find(array, query_component_keys[COMPONENT_FIELDS]))) {
+		ZVAL_COPY_VALUE(&components->fields, clause);
+	}
+	if ((clause = zend_hash_find(array, query_component_keys[COMPONENT_TABLES]))) {
+		ZVAL_COPY_VALUE(&components->tables, clause);
+	}
+	if ((clause = zend_hash_find(array, query_component_keys[COMPONENT_WHERE]))) {
+		ZVAL_COPY_VALUE(&components->where_conditions, clause);
+	}
+	if ((clause = zend_hash_find(array, query_component_keys[COMPONENT_GROUP_BY]))) {
+		ZVAL_COPY_VALUE(&components->group_by, clause);
+	}
+	if ((clause = zend_hash_find(array, query_component_keys[COMPONENT_HAVING]))) {
+		ZVAL_COPY_VALUE(&components->having, clause);
+	}
+	if ((clause = zend_hash_find(array, query_component_keys[COMPONENT_ORDER_BY]))) {
+		ZVAL_COPY_VALUE(&components->order_by, clause);
+	}
+	if ((clause = zend_hash_find(array, query_component_keys[COMPONENT_LIMIT]))) {
+		ZVAL_COPY_VALUE(&components->limit_clause, clause);
+	}
+	if ((clause = zend_hash_find(array, query_component_keys[COMPONENT_VALUES]))) {
+		ZVAL_COPY_VALUE(&components->values, clause);
+	}
+	if ((clause = zend_hash_find(array, query_component_keys[COMPONENT_ON_DUPLICATE]))) {
+		ZVAL_COPY_VALUE(&components->on_duplicate, clause);
+	}
 }
 
-PHP_FUNCTION(mysql_reconstruct_query)
+MYSQL_QP_TIMED_FUNCTION(mysql_reconstruct_query, MYSQL_QP_STAT_RECONSTRUCT_QUERY)
 {
-	zval *components_array;
-	query_components *components;
+	HashTable *components_array;
+	query_components components;
 	char *rebuilt_query;
 
 	ZEND_PARSE_PARAMETERS_START(1, 1)
-		Z_PARAM_ARRAY(components_array)
+		Z_PARAM_ARRAY_HT(components_array)
 	ZEND_PARSE_PARAMETERS_END();
 
-	/* Convert PHP array back to components structure */
-	components = emalloc(sizeof(query_components));
-	memset(components, 0, sizeof(query_components));
-	
-	zval *type = zend_hash_str_find(Z_ARRVAL_P(components_array), "type", 4);
-	if (type && Z_TYPE_P(type) == IS_STRING) {
-		components->type = estrdup(Z_STRVAL_P(type));
-	}
-	
-	components->fields = zend_hash_str_find(Z_ARRVAL_P(components_array), "fields", 6);
-	components->tables = zend_hash_str_find(Z_ARRVAL_P(components_array), "tables", 6);
-	components->where_conditions = zend_hash_str_find(Z_ARRVAL_P(components_array), "where_conditions", 16);
-	components->order_by = zend_hash_str_find(Z_ARRVAL_P(components_array), "order_by", 8);
-	components->limit_clause = zend_hash_str_find(Z_ARRVAL_P(components_array), "limit_clause", 12);
+	borrow_components(components_array, &components);
 
-	rebuilt_query = mysql_reconstruct_query(components);
+	rebuilt_query = mysql_reconstruct_query(&components);
 	
 	RETVAL_STRING(rebuilt_query);
-	
-	if (components->type) efree(components->type);
-	efree(components);
 	efree(rebuilt_query);
-}
\ No newline at end of file
+}
+
+MYSQL_QP_TIMED_FUNCTION(mysql_compile_template, MYSQL_QP_STAT_COMPILE_TEMPLATE)
+{
+	HashTable *components_array;
+	zend_string *sql;
+	query_components components;
+	mysql_template *tpl;
+	const char *error = NULL;
+
+	ZEND_PARSE_PARAMETERS_START(1, 1)
+		Z_PARAM_ARRAY_HT_OR_STR(components_array, sql)
+	ZEND_PARSE_PARAMETERS_END();
+
+	if (components_array) {
+		char *rebuilt_query;
+
+		borrow_components(components_array, &components);
+		rebuilt_query = mysql_reconstruct_query(&components);
+		sql = zend_string_init(rebuilt_query, strlen(rebuilt_query), 0);
+		efree(rebuilt_query);
+	} else {
+		zend_string_addref(sql);
+	}
+
+	/* Compiled once per worker; later requests get the cached fragments */
+	tpl = mysql_template_cached(sql, &error);
+	zend_string_release(sql);
+
+	if (!tpl) {
+		php_error_docref(NULL, E_WARNING, "Cannot compile template: %s", error ? error : "invalid SQL");
+		RETURN_FALSE;
+	}
+	mysql_template_object_init(return_value, tpl);
+}
+
+/* Emulated prepare: placeholders replaced by escaped literals, no connection needed */
+MYSQL_QP_TIMED_FUNCTION(mysql_interpolate_query, MYSQL_QP_STAT_INTERPOLATE_QUERY)
+{
+	zend_string *sql, *charset_name = NULL, *result;
+	HashTable *params;
+	const mysql_charset *charset;
+	const char *error;
+
+	ZEND_PARSE_PARAMETERS_START(2, 3)
+		Z_PARAM_STR(sql)
+		Z_PARAM_ARRAY_HT(params)
+		Z_PARAM_OPTIONAL
+		Z_PARAM_STR_OR_NULL(charset_name)
+	ZEND_PARSE_PARAMETERS_END();
+
+	/* Without a charset, the one in mysql_qp.dsn, else utf8mb4 */
+	if (!(charset = mysql_charset_resolve(charset_name, 3))) {
+		RETURN_THROWS();
+	}
+
+	if (!(result = mysql_interpolate(sql, params, charset, &error))) {
+		if (error) {
+			php_error_docref(NULL, E_WARNING, "Cannot interpolate query: %s", error);
+			RETURN_FALSE;
+		}
+		RETURN_THROWS();
+	}
+	RETURN_STR(result);
+}
+
+/* Literals lifted out into typed parameters, the reverse of mysql_interpolate_query() */
+MYSQL_QP_TIMED_FUNCTION(mysql_parameterize_query, MYSQL_QP_STAT_PARAMETERIZE_QUERY)
+{
+	zend_string *sql;
+	const char *error;
+
+	ZEND_PARSE_PARAMETERS_START(1, 1)
+		Z_PARAM_STR(sql)
+	ZEND_PARSE_PARAMETERS_END();
+
+	if (mysql_parameterize(sql, return_value, &error) != SUCCESS) {
+		php_error_docref(NULL, E_WARNING, "Cannot parameterize query: %s", error);
+		RETURN_FALSE;
+	}
+}
+
+/* The statements of a script, one per iteration, split as the mysql client would */
+MYSQL_QP_TIMED_FUNCTION(mysql_split_sql, MYSQL_QP_STAT_SPLIT_SQL)
+{
+	zend_string *sql;
+	zend_long flags = 0;
+
+	ZEND_PARSE_PARAMETERS_START(1, 2)
+		Z_PARAM_STR(sql)
+		Z_PARAM_OPTIONAL
+		Z_PARAM_LONG(flags)
+	ZEND_PARSE_PARAMETERS_END();
+
+	mysql_sql_script_init(return_value, sql, (flags & MYSQL_QP_SPANS) != 0);
+}
+
+/* Same for a file, which is mapped instead of read */
+MYSQL_QP_TIMED_FUNCTION(mysql_split_sql_file, MYSQL_QP_STAT_SPLIT_SQL_FILE)
+{
+	char *path;
+	size_t path_len;
+	zend_long flags = 0;
+
+	ZEND_PARSE_PARAMETERS_START(1, 2)
+		Z_PARAM_PATH(path, path_len)
+		Z_PARAM_OPTIONAL
+		Z_PARAM_LONG(flags)
+	ZEND_PARSE_PARAMETERS_END();
+
+	if (mysql_sql_script_open(return_value, path, (flags & MYSQL_QP_SPANS) != 0) != SUCCESS) {
+		RETURN_FALSE;
+	}
+}
+
+/* Validate count owned items and append their results to results, freeing the items */
+static void validate_chunk(mysql_batch_item *items, size_t count, int threads, int flags, HashTable *results)
+{
+	zval entry;
+
+	mysql_validate_batch_cached(items, count, threads, flags);
+	for (size_t i = 0; i < count; i++) {
+		mysql_batch_item_to_zval(&items[i], &entry);
+		zend_hash_next_index_insert(results, &entry);
+		if (items[i].error_message) {
+			efree(items[i].error_message);
+		}
+		zend_string_release(items[i].query);
+	}
+	memset(items, 0, count * sizeof(mysql_batch_item));
+}
+
+/*
+ * validate_queries() for a Traversable, consumed as it is validated, up to
+ * MYSQL_QP_VALIDATE_CHUNK statements at a time. Iterator keys can repeat
+ * (generators, yield from), so the results are a list in iteration order.
+ */
+static void validate_traversable(zval *object, int threads, int flags, zval *return_value)
+{
+	zend_class_entry *ce = Z_OBJCE_P(object);
+	zend_object_iterator *it;
+	mysql_batch_item *items;
+	size_t count = 0;
+	zend_bool failed = 0;
+
+	if (!(it = ce->get_iterator(ce, object, 0)) || EG(exception)) {
+		return;
+	}
+	array_init(return_value);
+	items = ecalloc(MYSQL_QP_VALIDATE_CHUNK, sizeof(mysql_batch_item));
+	if (it->funcs->rewind) {
+		it->funcs->rewind(it);
+	}
+	while (!EG(exception) && it->funcs->valid(it) == SUCCESS) {
+		zval *value = it->funcs->get_current_data(it);
+
+		if (EG(exception) || !value) {
+			break;
+		}
+		ZVAL_DEREF(value);
+		if (Z_TYPE_P(value) != IS_STRING) {
+			php_error_docref(NULL, E_WARNING, "All queries must be strings");
+			failed = 1;
+			break;
+		}
+		items[count++].query = zend_string_copy(Z_STR_P(value));
+		if (count == MYSQL_QP_VALIDATE_CHUNK) {
+			validate_chunk(items, count, threads, flags, Z_ARRVAL_P(return_value));
+			count = 0;
+		}
+		it->funcs->move_forward(it);
+	}
+	if (!failed && !EG(exception) && count > 0) {
+		validate_chunk(items, count, threads, flags, Z_ARRVAL_P(return_value));
+		count = 0;
+	}
+	for (size_t i = 0; i < count; i++) {
+		zend_string_release(items[i].query);
+	}
+	efree(items);
+	zend_iterator_dtor(it);
+
+	if (failed || EG(exception)) {
+		zval_ptr_dtor(return_value);
+		if (failed) {
+			RETVAL_FALSE;
+		} else {
+			ZVAL_NULL(return_value);
+		}
+	}
+}
+
+/* mysql_validate_queries() for any iterable, with the server round trips spread over worker threads */
+MYSQL_QP_TIMED_FUNCTION(mysql_validate_parallel, MYSQL_QP_STAT_VALIDATE_PARALLEL)
+{
+	zval *queries;
+	zend_long threads = 4, flags = 0;
+
+	ZEND_PARSE_PARAMETERS_START(1, 3)
+		Z_PARAM_ITERABLE(queries)
+		Z_PARAM_OPTIONAL
+		Z_PARAM_LONG(threads)
+		Z_PARAM_LONG(flags)
+	ZEND_PARSE_PARAMETERS_END();
+
+	if (threads < 1) {
+		zend_argument_value_error(2, "must be greater than 0");
+		RETURN_THROWS();
+	}
+	if (threads > MYSQL_QP_MAX_VALIDATE_THREADS) {
+		threads = MYSQL_QP_MAX_VALIDATE_THREADS;
+	}
+
+	if (Z_TYPE_P(queries) == IS_ARRAY) {
+		validate_queries(Z_ARRVAL_P(queries), (int) threads, (int) flags, return_value);
+		return;
+	}
+	validate_traversable(queries, (int) threads, (int) flags, return_value);
+}
+
+/* The tables a query reads and writes, for routing and sharding; no server round trip */
+MYSQL_QP_TIMED_FUNCTION(mysql_extract_tables, MYSQL_QP_STAT_EXTRACT_TABLES)
+{
+	zend_string *sql;
+	const char *error;
+
+	ZEND_PARSE_PARAMETERS_START(1, 1)
+		Z_PARAM_STR(sql)
+	ZEND_PARSE_PARAMETERS_END();
+
+	if (mysql_extract_tables(ZSTR_VAL(sql), ZSTR_LEN(sql), return_value, &error) != SUCCESS) {
+		php_error_docref(NULL, E_WARNING, "Cannot extract tables: %s", error);
+		RETURN_FALSE;
+	}
+}
+
+/* Statement kind and routing flags, from the first words and one pass over the rest */
+MYSQL_QP_TIMED_FUNCTION(mysql_classify_query, MYSQL_QP_STAT_CLASSIFY_QUERY)
+{
+	zend_string *sql;
+	mysql_query_class result;
+
+	ZEND_PARSE_PARAMETERS_START(1, 1)
+		Z_PARAM_STR(sql)
+	ZEND_PARSE_PARAMETERS_END();
+
+	mysql_classify_query(ZSTR_VAL(sql), ZSTR_LEN(sql), &result);
+	array_init_size(return_value, 3);
+	add_assoc_long(return_value, "type", result.type);
+	add_assoc_string(return_value, "name", mysql_query_type_name(result.type));
+	add_assoc_long(return_value, "flags", result.flags);
+}
+
+/* This worker's counters and latency histograms; reset starts them over */
+PHP_FUNCTION(mysql_qp_stats)
+{
+	zend_bool reset = 0;
+
+	ZEND_PARSE_PARAMETERS_START(0, 1)
+		Z_PARAM_OPTIONAL
+		Z_PARAM_BOOL(reset)
+	ZEND_PARSE_PARAMETERS_END();
+
+	mysql_qp_stats_to_zval(return_value);
+	if (reset) {
+		mysql_qp_stats_reset();
+	}
+}
@@ -0,0 +1,326 @@
+#include "php.h"
+#include "../include/php_mysql_qp.h"
+#include "../include/mysql_query_parser.h"
+#include "../include/parallel_validator.h"
+#include "../include/connection_pool.h"
+#include "../include/query_stats.h"
+#include <mysql.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Parallel batch validation. The statements the local checks left undecided
+ * are split into one contiguous range per worker. Every worker opens its own
+ * syntax-only connection and prepares its range a chunk at a time, packed
+ * into multi-statement packets as validate_batch_on_server() does. A worker
+ * whose range runs dry steals the back half of the largest range left, so a
+ * slow connection doesn't hold up the batch.
+ *
+ * Workers run outside the engine: they touch neither the Zend allocator nor
+ * the module globals, only malloc() and the client library. The calling
+ * thread is worker 0; the verdicts are copied into the batch items and the
+ * statistics updated once the other workers have been joined.
+ */
+
+#define PARALLEL_STATEMENT_NAME "mysql_qp_batch"
+#define PARALLEL_PREFIX "PREPARE " PARALLEL_STATEMENT_NAME " FROM '"
+#define PARALLEL_MAX_PACKET (1024 * 1024)
+#define PARALLEL_CHUNK 16           /* statements claimed from a range at a time */
+
+/* A range of statement indexes as next << 32 | end; both ends move with compare-and-swap */
+#define RANGE(next, end) (((uint64_t) (next) << 32) | (uint32_t) (end))
+#define RANGE_NEXT(range) ((uint32_t) ((range) >> 32))
+#define RANGE_END(range) ((uint32_t) (range))
+
+/* What a worker found out about one statement */
+typedef struct {
+    int decided;
+    unsigned int error_code;
+    char *error_message;        /* malloc'd; NULL when the statement prepared */
+} parallel_verdict;
+
+typedef struct parallel_job parallel_job;
+
+typedef struct {
+    parallel_job *job;
+    uint64_t range;             /* owner claims from the front, thieves from the back */
+    pthread_t thread;
+    int started;
+    int connected;
+    zend_hrtime_t connect_time;
+    zend_ulong round_trips;
+    char *sql;                  /* packet buffer, malloc'd */
+    size_t sql_size;
+} parallel_worker;
+
+struct parallel_job {
+    mysql_batch_item **pending;     /* read-only while the workers run */
+    parallel_verdict *verdicts;
+    parallel_worker *workers;
+    int worker_count;
+};
+
+/* Claim the next chunk from the front of the worker's own range; 0 when it is empty */
+static int claim(parallel_worker *worker, uint32_t *from, uint32_t *to) {
+    uint64_t range = __atomic_load_n(&worker->range, __ATOMIC_ACQUIRE), claimed;
+
+    do {
+        uint32_t next = RANGE_NEXT(range), end = RANGE_END(range);
+
+        if (next >= end) {
+            return 0;
+        }
+        *from = next;
+        *to = end - next > PARALLEL_CHUNK ? next + PARALLEL_CHUNK : end;
+        claimed = RANGE(*to, end);
+    } while (!__atomic_compare_exchange_n(&worker->range, &range, claimed, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+    return 1;
+}
+
+/* Move the back half of the largest range left into the worker's own; 0 when there is nothing to take */
+static int steal(parallel_worker *worker) {
+    parallel_job *job = worker->job;
+
+    for (;;) {
+        parallel_worker *victim = NULL;
+        uint64_t range = 0;
+        uint32_t left = 0, split;
+
+        for (int i = 0; i < job->worker_count; i++) {
+            uint64_t r = __atomic_load_n(&job->workers[i].range, __ATOMIC_ACQUIRE);
+
+            if (&job->workers[i] != worker && RANGE_END(r) > RANGE_NEXT(r) && RANGE_END(r) - RANGE_NEXT(r) > left) {
+                victim = &job->workers[i];
+                range = r;
+                left = RANGE_END(r) - RANGE_NEXT(r);
+            }
+        }
+        if (!victim) {
+            return 0;
+        }
+
+        /* The owner only moves the front, so the back half stays contiguous with what it keeps */
+        split = RANGE_END(range) - (left + 1) / 2;
+        if (__atomic_compare_exchange_n(&victim->range, &range, RANGE(RANGE_NEXT(range), split),
+                                        0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            __atomic_store_n(&worker->range, RANGE(split, RANGE_END(range)), __ATOMIC_RELEASE);
+            return 1;
+        }
+    }
+}
+
+/* Put [from, ...) back at the front of the worker's range for someone else to pick up */
+static void give_back(parallel_worker *worker, uint32_t from) {
+    uint64_t range = __atomic_load_n(&worker->range, __ATOMIC_ACQUIRE);
+
+    while (!__atomic_compare_exchange_n(&worker->range, &range, RANGE(from, RANGE_END(range)),
+                                        0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+}
+
+static int reserve(parallel_worker *worker, size_t size) {
+    char *sql;
+
+    if (size <= worker->sql_size) {
+        return 1;
+    }
+    if (!(sql = realloc(worker->sql, size))) {
+        return 0;
+    }
+    worker->sql = sql;
+    worker->sql_size = size;
+    return 1;
+}
+
+static void record(parallel_verdict *verdict, unsigned int error_code, const char *error_message) {
+    verdict->decided = 1;
+    verdict->error_code = error_code;
+    verdict->error_message = strdup(error_message);
+}
+
+/*
+ * Prepare statements [from, to) over conn. Returns the first one left
+ * undecided because the connection failed, or to. The server stops a
+ * multi-statement at the first failure, so the next packet resumes with the
+ * statement after it. The statement itself goes away with the connection.
+ */
+static uint32_t validate_range(parallel_worker *worker, MYSQL *conn, uint32_t from, uint32_t to) {
+    parallel_job *job = worker->job;
+    uint32_t start = from;
+
+    while (start < to) {
+        uint32_t end = start, current = start;
+        size_t len = 0;
+        int status;
+
+        while (end < to && (end == start || len < PARALLEL_MAX_PACKET)) {
+            zend_string *query = job->pending[end]->query;
+
+            if (!reserve(worker, len + sizeof(PARALLEL_PREFIX) + ZSTR_LEN(query) * 2 + 2)) {
+                if (end == start) {
+                    return start;
+                }
+                break;
+            }
+            memcpy(worker->sql + len, PARALLEL_PREFIX, sizeof(PARALLEL_PREFIX) - 1);
+            len += sizeof(PARALLEL_PREFIX) - 1;
+            len += mysql_real_escape_string(conn, worker->sql + len, ZSTR_VAL(query), ZSTR_LEN(query));
+            worker->sql[len++] = '\'';
+            worker->sql[len++] = ';';
+            end++;
+        }
+
+        status = mysql_real_query(conn, worker->sql, len);
+        worker->round_trips++;
+        while (current < end) {
+            MYSQL_RES *res;
+
+            if (status != 0) {
+                unsigned int error_code = mysql_errno(conn);
+                if (status < 0 || mysql_is_connection_error(error_code)) {
+                    return current;
+                }
+                record(&job->verdicts[current++], error_code, mysql_error(conn));
+                break;
+            }
+
+            job->verdicts[current++].decided = 1;
+            if ((res = mysql_store_result(conn))) {
+                mysql_free_result(res);
+            }
+            status = mysql_next_result(conn);
+        }
+
+        while (mysql_more_results(conn) && mysql_next_result(conn) == 0) {
+            MYSQL_RES *res = mysql_store_result(conn);
+            if (res) mysql_free_result(res);
+        }
+
+        start = current;
+    }
+    return to;
+}
+
+/* Validate chunks of the worker's own range, then of others', until none are left or the connection fails */
+static void worker_run(parallel_worker *worker) {
+    mysql_qp_server *server = &mysql_qp_server_config;
+    MYSQL *conn = mysql_qp_init_connection();
+    zend_hrtime_t start;
+    uint32_t from, to, done;
+
+    if (conn == NULL) {
+        return;
+    }
+    start = zend_hrtime();
+    if (!mysql_real_connect(conn, server->host, server->user, server->password, NULL,
+                            server->port, server->socket, CLIENT_MULTI_STATEMENTS)) {
+        /* Our range is left for the others to steal */
+        mysql_close(conn);
+        return;
+    }
+    worker->connected = 1;
+    worker->connect_time = zend_hrtime() - start;
+
+    for (;;) {
+        if (!claim(worker, &from, &to)) {
+            if (!steal(worker)) {
+                break;
+            }
+            continue;
+        }
+        if ((done = validate_range(worker, conn, from, to)) < to) {
+            give_back(worker, done);
+            break;
+        }
+    }
+
+    mysql_close(conn);
+}
+
+static void* worker_main(void *arg) {
+    mysql_thread_init();
+    worker_run((parallel_worker *) arg);
+    mysql_thread_end();
+    return NULL;
+}
+
+/*
+ * Validate the pending statements of a batch over up to threads connections.
+ * Statements still undecided afterwards (no connection could be opened, or
+ * all were lost) are left that way. FAILURE, with nothing done, if the
+ * batch is too small to be worth splitting (or too large to be), for the
+ * caller to validate it over its pooled connection instead.
+ */
+int mysql_validate_parallel(mysql_batch_item **pending, size_t count, int threads) {
+    parallel_job job;
+    sigset_t all, saved;
+    zend_ulong round_trips = 0;
+    size_t per_worker, extra, next = 0;
+
+    /* No more workers than chunks */
+    if ((size_t) threads > (count + PARALLEL_CHUNK - 1) / PARALLEL_CHUNK) {
+        threads = (int) ((count + PARALLEL_CHUNK - 1) / PARALLEL_CHUNK);
+    }
+    if (threads < 2 || count > UINT32_MAX) {
+        return FAILURE;
+    }
+
+    job.pending = pending;
+    job.verdicts = ecalloc(count, sizeof(parallel_verdict));
+    job.workers = ecalloc(threads, sizeof(parallel_worker));
+    job.worker_count = threads;
+
+    per_worker = count / threads;
+    extra = count % threads;
+    for (int i = 0; i < threads; i++) {
+        size_t size = per_worker + ((size_t) i < extra);
+
+        job.workers[i].job = &job;
+        job.workers[i].range = RANGE(next, next + size);
+        next += size;
+    }
+
+    /* Signals such as the max_execution_time timer belong to the calling thread */
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &saved);
+    for (int i = 1; i < threads; i++) {
+        job.workers[i].started = pthread_create(&job.workers[i].thread, NULL, worker_main, &job.workers[i]) == 0;
+    }
+    pthread_sigmask(SIG_SETMASK, &saved, NULL);
+
+    worker_run(&job.workers[0]);
+
+    for (int i = 0; i < threads; i++) {
+        parallel_worker *worker = &job.workers[i];
+
+        if (worker->started) {
+            pthread_join(worker->thread, NULL);
+        }
+        if (worker->connected) {
+            mysql_qp_stats_record(MYSQL_QP_STAT_CONNECT, worker->connect_time);
+        }
+        round_trips += worker->round_trips;
+        free(worker->sql);
+    }
+    mysql_qp_stats_round_trips(round_trips);
+
+    for (size_t i = 0; i < count; i++) {
+        parallel_verdict *verdict = &job.verdicts[i];
+
+        if (!verdict->decided) {
+            continue;
+        }
+        if (verdict->error_code) {
+            mysql_batch_record_error(pending[i], verdict->error_code, verdict->error_message ? verdict->error_message : "");
+            free(verdict->error_message);
+        } else {
+            pending[i]->decided = pending[i]->is_valid = 1;
+        }
+    }
+
+    efree(job.workers);
+    efree(job.verdicts);
+    return SUCCESS;
+}
@@ -1,5 +1,6 @@
 #include "php.h"
 #include "../include/php_mysql_qp.h"
+#include "../include/mysql_query_parser.h"
 
 /* PHP-MySQL bridge functions - placeholders for now */
 
@@ -22,4 +23,30 @@ int mysql_to_php_array(void *mysql_result, zval *php_array)
     array_init(php_array);
     add_assoc_string(php_array, "status", "placeholder");
     return SUCCESS;
-}
\ No newline at end of file
+}
+
+/* Convert a validation verdict to the array returned by the batch and async APIs */
+void mysql_batch_item_to_zval(mysql_batch_item *item, zval *entry)
+{
+    array_init(entry);
+    add_assoc_bool(entry, "is_valid", item->decided && item->is_valid);
+    add_assoc_long(entry, "error_code", item->error_code);
+    if (item->error_message) {
+        add_assoc_string(entry, "error", item->error_message);
+    } else if (!item->decided) {
+        add_assoc_string(entry, "error", "Could not connect to MySQL for validation");
+    }
+}
+
+/* A range of the caller's query as [offset, length], returned instead of a copy of the text */
+void mysql_span_to_zval(zval *span, size_t offset, size_t length)
+{
+    array_init_size(span, 2);
+    zend_hash_real_init_packed(Z_ARRVAL_P(span));
+    ZEND_HASH_FILL_PACKED(Z_ARRVAL_P(span)) {
+        ZEND_HASH_FILL_SET_LONG((zend_long) offset);
+        ZEND_HASH_FILL_NEXT();
+        ZEND_HASH_FILL_SET_LONG((zend_long) length);
+        ZEND_HASH_FILL_NEXT();
+    } ZEND_HASH_FILL_END();
+}
@@ -0,0 +1,429 @@
+#include "php.h"
+#include "../include/php_mysql_qp.h"
+#include "../include/mysql_query_parser.h"
+#include "../include/query_cache.h"
+#include "../include/query_explain.h"
+#include "../include/query_fingerprint.h"
+#include "../include/sql_lexer.h"
+#include "../include/shm_cache.h"
+#include <string.h>
+
+#define QUERY_CACHE_MIN_BUCKETS 64
+
+/* Cache structure */
+
+void query_cache_init(query_cache *cache) {
+    memset(cache, 0, sizeof(query_cache));
+}
+
+/* Trees handed out during this request may still be referenced, so they outlive their entry until it ends */
+static void entry_free_payload(query_cache *cache, query_cache_entry *entry) {
+    if (entry->error_message) pefree(entry->error_message, 1);
+    if (entry->plan) zend_string_release(entry->plan);
+    if (entry->tpl) mysql_template_release(entry->tpl);
+    for (int i = 0; i < 2; i++) {
+        if (entry->trees[i]) {
+            entry->trees[i]->next_retired = cache->retired;
+            cache->retired = entry->trees[i];
+            entry->trees[i] = NULL;
+        }
+    }
+    entry->error_message = NULL;
+    entry->plan = NULL;
+    entry->tpl = NULL;
+}
+
+/* Called from RSHUTDOWN */
+void query_cache_end_request(query_cache *cache) {
+    query_cache_tree *tree = cache->retired, *next;
+
+    while (tree) {
+        next = tree->next_retired;
+        pefree(tree, 1);
+        tree = next;
+    }
+    cache->retired = NULL;
+}
+
+void query_cache_destroy(query_cache *cache) {
+    query_cache_entry *entry = cache->lru_head, *next;
+
+    while (entry) {
+        next = entry->lru_next;
+        entry_free_payload(cache, entry);
+        pefree(entry, 1);
+        entry = next;
+    }
+    query_cache_end_request(cache);
+    if (cache->buckets) pefree(cache->buckets, 1);
+    memset(cache, 0, sizeof(query_cache));
+}
+
+static size_t bucket_index(const query_cache *cache, zend_ulong hash, enum query_cache_kind kind) {
+    return (size_t) (hash ^ kind) & (cache->bucket_count - 1);
+}
+
+static void lru_unlink(query_cache *cache, query_cache_entry *entry) {
+    if (entry->lru_prev) entry->lru_prev->lru_next = entry->lru_next;
+    else cache->lru_head = entry->lru_next;
+    if (entry->lru_next) entry->lru_next->lru_prev = entry->lru_prev;
+    else cache->lru_tail = entry->lru_prev;
+    entry->lru_prev = entry->lru_next = NULL;
+}
+
+static void lru_push_front(query_cache *cache, query_cache_entry *entry) {
+    entry->lru_prev = NULL;
+    entry->lru_next = cache->lru_head;
+    if (cache->lru_head) cache->lru_head->lru_prev = entry;
+    cache->lru_head = entry;
+    if (!cache->lru_tail) cache->lru_tail = entry;
+}
+
+/* Grow the bucket array so chains stay short; entries are relinked in place */
+static void resize_buckets(query_cache *cache, size_t bucket_count) {
+    query_cache_entry *entry;
+
+    if (cache->buckets) pefree(cache->buckets, 1);
+    cache->buckets = pecalloc(bucket_count, sizeof(query_cache_entry *), 1);
+    cache->bucket_count = bucket_count;
+
+    for (entry = cache->lru_head; entry; entry = entry->lru_next) {
+        size_t index = bucket_index(cache, entry->hash, entry->kind);
+        entry->bucket_next = cache->buckets[index];
+        cache->buckets[index] = entry;
+    }
+}
+
+static void evict_tail(query_cache *cache) {
+    query_cache_entry *victim = cache->lru_tail, **link;
+
+    link = &cache->buckets[bucket_index(cache, victim->hash, victim->kind)];
+    while (*link != victim) link = &(*link)->bucket_next;
+    *link = victim->bucket_next;
+
+    lru_unlink(cache, victim);
+    entry_free_payload(cache, victim);
+    pefree(victim, 1);
+    cache->count--;
+    cache->evictions++;
+}
+
+static query_cache_entry* lookup(query_cache *cache, zend_string *query, enum query_cache_kind kind) {
+    zend_ulong hash = zend_string_hash_val(query);
+    query_cache_entry *entry;
+
+    if (cache->count == 0) {
+        return NULL;
+    }
+    for (entry = cache->buckets[bucket_index(cache, hash, kind)]; entry; entry = entry->bucket_next) {
+        if (entry->hash == hash && entry->query_len == ZSTR_LEN(query) && entry->kind == kind &&
+            memcmp(entry->query, ZSTR_VAL(query), ZSTR_LEN(query)) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static void touch(query_cache *cache, query_cache_entry *entry) {
+    if (entry != cache->lru_head) {
+        lru_unlink(cache, entry);
+        lru_push_front(cache, entry);
+    }
+}
+
+/* Look up a query; a hit becomes the most recently used entry */
+query_cache_entry* query_cache_find(query_cache *cache, zend_string *query, enum query_cache_kind kind) {
+    query_cache_entry *entry = lookup(cache, query, kind);
+
+    if (!entry) {
+        cache->misses++;
+        return NULL;
+    }
+    touch(cache, entry);
+    cache->hits++;
+    return entry;
+}
+
+/* Insert a blank entry for the caller to fill, evicting least recently used entries beyond capacity */
+query_cache_entry* query_cache_add(query_cache *cache, zend_string *query, enum query_cache_kind kind, size_t capacity) {
+    query_cache_entry *entry;
+    size_t index;
+
+    if (capacity == 0) {
+        return NULL;
+    }
+
+    /* Re-adding a cached query resets its entry */
+    if ((entry = lookup(cache, query, kind))) {
+        entry_free_payload(cache, entry);
+        entry->is_valid = entry->query_type = entry->error_code = 0;
+        entry->parameter_count = 0;
+        touch(cache, entry);
+        return entry;
+    }
+
+    while (cache->count >= capacity) {
+        evict_tail(cache);
+    }
+
+    if (cache->count >= cache->bucket_count) {
+        resize_buckets(cache, cache->bucket_count ? cache->bucket_count * 2 : QUERY_CACHE_MIN_BUCKETS);
+    }
+
+    entry = pecalloc(1, sizeof(query_cache_entry) + ZSTR_LEN(query), 1);
+    entry->hash = zend_string_hash_val(query);
+    entry->query_len = ZSTR_LEN(query);
+    entry->kind = kind;
+    memcpy(entry->query, ZSTR_VAL(query), ZSTR_LEN(query));
+
+    index = bucket_index(cache, entry->hash, kind);
+    entry->bucket_next = cache->buckets[index];
+    cache->buckets[index] = entry;
+    lru_push_front(cache, entry);
+    cache->count++;
+
+    return entry;
+}
+
+/* Cached front ends for validation and parsing */
+
+static size_t cache_capacity(void) {
+    zend_long size = MYSQL_QP_G(cache_size);
+    return size > 0 ? (size_t) size : 0;
+}
+
+int mysql_validate_cached(zend_string *query, int flags) {
+    query_cache *cache = &MYSQL_QP_G(cache);
+    query_cache_entry *entry;
+    int verdict, error_code;
+    char *error_message;
+
+    if (cache_capacity() == 0) {
+        return mysql_check_syntax(ZSTR_VAL(query), ZSTR_LEN(query), flags, NULL, NULL) == MYSQL_LEX_VALID;
+    }
+
+    if ((entry = query_cache_find(cache, query, QUERY_CACHE_VALIDATE))) {
+        return entry->is_valid;
+    }
+
+    /* Only the native parser accepts locally (MYSQL_QP_LOCAL_VERDICT); its verdicts aren't kept */
+    verdict = mysql_check_syntax_locally(ZSTR_VAL(query), ZSTR_LEN(query), flags, &error_code, &error_message);
+    if (verdict == MYSQL_LEX_VALID) {
+        return 1;
+    }
+    if (verdict == MYSQL_LEX_UNDECIDED) {
+        verdict = mysql_check_syntax(ZSTR_VAL(query), ZSTR_LEN(query), 0, &error_code, &error_message);
+    }
+    if (verdict != MYSQL_LEX_UNDECIDED &&
+        (entry = query_cache_add(cache, query, QUERY_CACHE_VALIDATE, cache_capacity()))) {
+        entry->is_valid = verdict == MYSQL_LEX_VALID;
+        entry->error_code = error_code;
+        if (error_message) {
+            entry->error_message = pestrdup(error_message, 1);
+        }
+    }
+    if (error_message) efree(error_message);
+    return verdict == MYSQL_LEX_VALID;
+}
+
+/* An immutable copy of a freshly built tree, or NULL when it can't have one */
+static query_cache_tree* tree_keep(zval *tree) {
+    size_t size = ZEND_MM_ALIGNED_SIZE(sizeof(query_cache_tree));
+    query_cache_tree *kept;
+    char *pos;
+
+    if (mysql_immutable_measure(tree, &size) != SUCCESS) {
+        return NULL;
+    }
+    kept = pemalloc(size, 1);
+    kept->next_retired = NULL;
+    ZVAL_COPY_VALUE(&kept->tree, tree);
+    pos = (char *) kept + ZEND_MM_ALIGNED_SIZE(sizeof(query_cache_tree));
+    mysql_immutable_copy(&kept->tree, &pos);
+    return kept;
+}
+
+mysql_query_result* mysql_parse_query_cached(zend_string *query, int flags) {
+    query_cache *cache = &MYSQL_QP_G(cache);
+    query_cache_entry *entry;
+    mysql_query_result *result;
+    int spans = (flags & MYSQL_QP_SPANS) != 0;
+
+    /* Entries don't keep result columns (the prepared statement cache answers
+     * those), and hold the server's verdicts, which differ from the native
+     * parser's for the same statement (1146 is invalid here) */
+    if (cache_capacity() == 0 || (flags & (MYSQL_QP_METADATA | MYSQL_QP_LOCAL_VERDICT))) {
+        return mysql_parse_query_real(query, flags);
+    }
+
+    if ((entry = query_cache_find(cache, query, QUERY_CACHE_PARSE))) {
+        result = emalloc(sizeof(mysql_query_result));
+        memset(result, 0, sizeof(mysql_query_result));
+        result->query_type = entry->query_type;
+        /* Entries hold lexer errors too, but don't say which they are */
+        result->server_verdict = 1;
+
+        if (entry->trees[spans]) {
+            /* Immutable, so the caller gets it as is */
+            result->parse_tree = emalloc(sizeof(zval));
+            ZVAL_COPY_VALUE(result->parse_tree, &entry->trees[spans]->tree);
+        } else if (entry->trees[!spans]) {
+            /* Only the other shape was kept: build this one once, which makes the lookup a miss */
+            cache->hits--;
+            cache->misses++;
+            if (mysql_parse_query_native(query, flags, result, NULL) == SUCCESS) {
+                entry->trees[spans] = tree_keep(result->parse_tree);
+                return result;
+            }
+        }
+
+        result->is_valid = entry->is_valid;
+        result->error_code = entry->error_code;
+        result->parameter_count = entry->parameter_count;
+        if (entry->error_message) {
+            result->error_message = estrdup(entry->error_message);
+        }
+        if (entry->is_valid) {
+            result->normalized_query = zend_string_copy(query);
+        }
+        return result;
+    }
+
+    result = mysql_parse_query_real(query, flags);
+
+    /* Connection failures are transient and must not be remembered */
+    if (!result->is_valid && result->error_code == 0) {
+        return result;
+    }
+
+    if ((entry = query_cache_add(cache, query, QUERY_CACHE_PARSE, cache_capacity()))) {
+        entry->is_valid = result->is_valid;
+        entry->query_type = result->query_type;
+        entry->error_code = result->error_code;
+        entry->parameter_count = result->parameter_count;
+        if (result->parse_tree) {
+            entry->trees[spans] = tree_keep(result->parse_tree);
+        }
+        if (result->error_message) {
+            entry->error_message = pestrdup(result->error_message, 1);
+        }
+    }
+    return result;
+}
+
+/* Fill a validation item from the cache; returns 1 on a hit */
+int mysql_validate_cache_lookup(mysql_batch_item *item) {
+    query_cache_entry *entry;
+
+    if (cache_capacity() == 0 ||
+        !(entry = query_cache_find(&MYSQL_QP_G(cache), item->query, QUERY_CACHE_VALIDATE))) {
+        return 0;
+    }
+    item->decided = 1;
+    item->is_valid = entry->is_valid;
+    item->error_code = entry->error_code;
+    if (entry->error_message) {
+        item->error_message = estrdup(entry->error_message);
+    }
+    return 1;
+}
+
+/* Remember a decided validation item, unless the server wasn't asked */
+void mysql_validate_cache_store(mysql_batch_item *item) {
+    query_cache_entry *entry;
+
+    if (!item->decided || item->local ||
+        !(entry = query_cache_add(&MYSQL_QP_G(cache), item->query, QUERY_CACHE_VALIDATE, cache_capacity()))) {
+        return;
+    }
+    entry->is_valid = item->is_valid;
+    entry->error_code = item->error_code;
+    if (item->error_message) {
+        entry->error_message = pestrdup(item->error_message, 1);
+    }
+}
+
+void mysql_validate_batch_cached(mysql_batch_item *items, size_t count, int threads, int flags) {
+    zend_bool *hit;
+
+    if (cache_capacity() == 0) {
+        mysql_validate_batch(items, count, threads, flags);
+        return;
+    }
+
+    hit = ecalloc(count, sizeof(zend_bool));
+    for (size_t i = 0; i < count; i++) {
+        hit[i] = mysql_validate_cache_lookup(&items[i]);
+    }
+
+    mysql_validate_batch(items, count, threads, flags);
+
+    /* Duplicates within the batch are stored once */
+    for (size_t i = 0; i < count; i++) {
+        if (!hit[i]) {
+            mysql_validate_cache_store(&items[i]);
+        }
+    }
+    efree(hit);
+}
+
+/*
+ * EXPLAIN through the cache. Plans are keyed by fingerprint, so statements
+ * that differ only in their literals share the plan of the first one seen.
+ */
+int mysql_explain_cached(zend_string *query, zend_bool tree, zval *plan, int *error_code, char **error_message) {
+    query_cache *cache = &MYSQL_QP_G(cache);
+    query_cache_entry *entry;
+    mysql_fingerprint fingerprint;
+    zend_string *json;
+    int result;
+
+    *error_code = 0;
+    *error_message = NULL;
+
+    if (cache_capacity() == 0 ||
+        mysql_compute_fingerprint(ZSTR_VAL(query), ZSTR_LEN(query), &fingerprint) != SUCCESS) {
+        fingerprint.text = NULL;
+    }
+
+    if (fingerprint.text && (entry = query_cache_find(cache, fingerprint.text, QUERY_CACHE_EXPLAIN))) {
+        json = zend_string_copy(entry->plan);
+    } else if (!(json = mysql_explain_real(ZSTR_VAL(query), ZSTR_LEN(query), error_code, error_message))) {
+        if (fingerprint.text) zend_string_release(fingerprint.text);
+        return FAILURE;
+    } else if (fingerprint.text &&
+               (entry = query_cache_add(cache, fingerprint.text, QUERY_CACHE_EXPLAIN, cache_capacity()))) {
+        entry->plan = zend_string_init(ZSTR_VAL(json), ZSTR_LEN(json), 1);
+    }
+
+    if ((result = mysql_explain_decode(ZSTR_VAL(json), ZSTR_LEN(json), tree, plan)) != SUCCESS) {
+        *error_message = estrdup("Malformed EXPLAIN output");
+    }
+
+    if (fingerprint.text) zend_string_release(fingerprint.text);
+    zend_string_release(json);
+    return result;
+}
+
+/* Compiled template for sql, shared through the cache; the caller gets its own reference */
+mysql_template* mysql_template_cached(zend_string *sql, const char **error) {
+    query_cache *cache = &MYSQL_QP_G(cache);
+    query_cache_entry *entry;
+    mysql_template *tpl;
+
+    if (cache_capacity() == 0) {
+        return mysql_template_compile(sql, 0, error);
+    }
+
+    if ((entry = query_cache_find(cache, sql, QUERY_CACHE_TEMPLATE))) {
+        entry->tpl->refcount++;
+        return entry->tpl;
+    }
+
+    if ((tpl = mysql_template_compile(sql, 1, error)) &&
+        (entry = query_cache_add(cache, sql, QUERY_CACHE_TEMPLATE, cache_capacity()))) {
+        tpl->refcount++;
+        entry->tpl = tpl;
+    }
+    return tpl;
+}
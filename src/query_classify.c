@@ -0,0 +1,591 @@
+#include "php.h"
+#include "../include/php_mysql_qp.h"
+#include "../include/mysql_query_parser.h"
+#include "../include/query_classify.h"
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Statement classification for routing. The kind comes from the first
+ * words, after comments, optimizer hints and opening parentheses; WITH is
+ * resolved to the statement after its CTEs. The flags come from one more
+ * pass over the statement, up to its ";". Statements after that aren't
+ * classified, so a string with more than one is never read-only.
+ *
+ * The scan only knows quoting, comments and words, and words are looked up
+ * in a perfect hash table, so a statement costs one pass, two table loads
+ * and a short compare per word, and nothing is allocated.
+ */
+
+/* What a word means to the classifier */
+enum classify_word_id {
+    CW_NONE = 0,            /* empty slot */
+    CW_STATEMENT,           /* a statement whose first word says it all */
+    CW_WITH,
+    CW_DESCRIBE,            /* DESCRIBE, DESC, EXPLAIN */
+    CW_START,
+    CW_SET,
+    CW_LOAD,
+    CW_CREATE,
+    CW_DROP,
+    CW_LOCK,                /* LOCK, UNLOCK */
+    CW_UPDATE,
+    CW_ANALYZE,
+    CW_PREPARE,
+    CW_FOR,
+    CW_IN,
+    CW_SHARE,
+    CW_TEMPORARY,
+    CW_TRANSACTION,
+    CW_AUTOCOMMIT,
+    CW_PASSWORD,
+    CW_INDEX,
+    CW_INSTANCE,
+    CW_FORMAT,
+    CW_EXPLAIN_OPTION,      /* EXTENDED, PARTITIONS */
+    CW_FUNCTION,            /* non-deterministic when called */
+    CW_FUNCTION_BARE,       /* ... or just named, as CURRENT_TIMESTAMP can be */
+    CW_FUNCTION_NO_ARGS     /* ... only without arguments: UNIX_TIMESTAMP() */
+};
+
+typedef struct {
+    char name[20];
+    unsigned char len;
+    unsigned char id;       /* CW_* */
+    unsigned char type;     /* QUERY_TYPE_* as the first word of a statement */
+    unsigned char flags;    /* MYSQL_QP_* as the first word, or for a call */
+} classify_word;
+
+#define CLASSIFY_MAX_WORD 17
+#define CLASSIFY_SLOT_BITS 7
+#define CLASSIFY_BUCKET_BITS 5
+#define CLASSIFY_HASH_MULTIPLIER 0xCDCC69292F45E679ULL
+#define CLASSIFY_LOWER(c) ((unsigned char) (c) | 0x20)
+
+/*
+ * Hash and displace: a word's key (its first two, middle and last two
+ * characters, case-folded, and its length) times the multiplier picks a
+ * bucket from the top bits and a slot from the next ones; the bucket's
+ * displacement moves its words to slots no other word takes. Multiplier and
+ * displacements were searched for offline over exactly the words below;
+ * adding a word means searching again.
+ */
+static const unsigned char classify_displacements[1 << CLASSIFY_BUCKET_BITS] = {
+    3, 6, 1, 4, 1, 0, 19, 31, 64, 0, 0, 0, 64, 2, 0, 1, 1, 6, 3, 0, 11, 19, 1, 35, 34, 25, 21, 16, 4, 8, 6, 0
+};
+
+static const classify_word classify_words[1 << CLASSIFY_SLOT_BITS] = {
+    [  1] = {"REVOKE", 6, CW_STATEMENT, QUERY_TYPE_REVOKE, MYSQL_QP_IMPLICIT_COMMIT},
+    [  2] = {"GRANT", 5, CW_STATEMENT, QUERY_TYPE_GRANT, MYSQL_QP_IMPLICIT_COMMIT},
+    [  3] = {"SLEEP", 5, CW_FUNCTION, 0, MYSQL_QP_NONDETERMINISTIC},
+    [  4] = {"INDEX", 5, CW_INDEX, 0, 0},
+    [  5] = {"FOUND_ROWS", 10, CW_FUNCTION, 0, MYSQL_QP_NONDETERMINISTIC},
+    [  6] = {"UPDATE", 6, CW_UPDATE, QUERY_TYPE_UPDATE, 0},
+    [  8] = {"EXTENDED", 8, CW_EXPLAIN_OPTION, 0, 0},
+    [  9] = {"IMPORT", 6, CW_STATEMENT, QUERY_TYPE_ADMIN, 0},
+    [ 10] = {"LOCALTIMESTAMP", 14, CW_FUNCTION_BARE, 0, MYSQL_QP_NONDETERMINISTIC},
+    [ 11] = {"INSTANCE", 8, CW_INSTANCE, 0, 0},
+    [ 12] = {"CREATE", 6, CW_CREATE, QUERY_TYPE_CREATE, MYSQL_QP_IMPLICIT_COMMIT},
+    [ 13] = {"BINLOG", 6, CW_STATEMENT, QUERY_TYPE_ADMIN, 0},
+    [ 14] = {"RESET", 5, CW_STATEMENT, QUERY_TYPE_ADMIN, MYSQL_QP_IMPLICIT_COMMIT},
+    [ 15] = {"UTC_TIMESTAMP", 13, CW_FUNCTION_BARE, 0, MYSQL_QP_NONDETERMINISTIC},
+    [ 16] = {"HANDLER", 7, CW_STATEMENT, QUERY_TYPE_HANDLER, MYSQL_QP_READ_ONLY},
+    [ 17] = {"CALL", 4, CW_STATEMENT, QUERY_TYPE_CALL, 0},
+    [ 19] = {"PREPARE", 7, CW_PREPARE, QUERY_TYPE_PREPARE, 0},
+    [ 20] = {"KILL", 4, CW_STATEMENT, QUERY_TYPE_ADMIN, 0},
+    [ 21] = {"SHARE", 5, CW_SHARE, 0, 0},
+    [ 22] = {"USER", 4, CW_FUNCTION, 0, MYSQL_QP_NONDETERMINISTIC},
+    [ 23] = {"INSERT", 6, CW_STATEMENT, QUERY_TYPE_INSERT, 0},
+    [ 24] = {"FORMAT", 6, CW_FORMAT, 0, 0},
+    [ 25] = {"TRUNCATE", 8, CW_STATEMENT, QUERY_TYPE_TRUNCATE, MYSQL_QP_IMPLICIT_COMMIT},
+    [ 26] = {"RAND", 4, CW_FUNCTION, 0, MYSQL_QP_NONDETERMINISTIC},
+    [ 27] = {"CLONE", 5, CW_STATEMENT, QUERY_TYPE_ADMIN, 0},
+    [ 28] = {"COMMIT", 6, CW_STATEMENT, QUERY_TYPE_COMMIT, MYSQL_QP_TRANSACTION},
+    [ 29] = {"SELECT", 6, CW_STATEMENT, QUERY_TYPE_SELECT, MYSQL_QP_READ_ONLY},
+    [ 30] = {"DELETE", 6, CW_STATEMENT, QUERY_TYPE_DELETE, 0},
+    [ 31] = {"LAST_INSERT_ID", 14, CW_FUNCTION, 0, MYSQL_QP_NONDETERMINISTIC},
+    [ 32] = {"AUTOCOMMIT", 10, CW_AUTOCOMMIT, 0, 0},
+    [ 35] = {"REPAIR", 6, CW_STATEMENT, QUERY_TYPE_MAINTENANCE, MYSQL_QP_IMPLICIT_COMMIT},
+    [ 36] = {"TABLE", 5, CW_STATEMENT, QUERY_TYPE_SELECT, MYSQL_QP_READ_ONLY},
+    [ 39] = {"IS_USED_LOCK", 12, CW_FUNCTION, 0, MYSQL_QP_NONDETERMINISTIC},
+    [ 40] = {"SET", 3, CW_SET, QUERY_TYPE_SET, 0},
+    [ 41] = {"SESSION_USER", 12, CW_FUNCTION, 0, MYSQL_QP_NONDETERMINISTIC},
+    [ 44] = {"SHOW", 4, CW_STATEMENT, QUERY_TYPE_SHOW, MYSQL_QP_READ_ONLY},
+    [ 45] = {"SCHEMA", 6, CW_FUNCTION, 0, MYSQL_QP_NONDETERMINISTIC},
+    [ 48] = {"CHECK", 5, CW_STATEMENT, QUERY_TYPE_MAINTENANCE, MYSQL_QP_IMPLICIT_COMMIT},
+    [ 49] = {"ROLLBACK", 8, CW_STATEMENT, QUERY_TYPE_ROLLBACK, MYSQL_QP_TRANSACTION},
+    [ 50] = {"START", 5, CW_START, QUERY_TYPE_ADMIN, MYSQL_QP_IMPLICIT_COMMIT},
+    [ 54] = {"RELEASE_ALL_LOCKS", 17, CW_FUNCTION, 0, MYSQL_QP_NONDETERMINISTIC},
+    [ 57] = {"TEMPORARY", 9, CW_TEMPORARY, 0, 0},
+    [ 59] = {"UTC_TIME", 8, CW_FUNCTION_BARE, 0, MYSQL_QP_NONDETERMINISTIC},
+    [ 61] = {"SAVEPOINT", 9, CW_STATEMENT, QUERY_TYPE_SAVEPOINT, MYSQL_QP_TRANSACTION},
+    [ 62] = {"CURTIME", 7, CW_FUNCTION, 0, MYSQL_QP_NONDETERMINISTIC},
+    [ 64] = {"DEALLOCATE", 10, CW_STATEMENT, QUERY_TYPE_DEALLOCATE, 0},
+    [ 65] = {"CACHE", 5, CW_STATEMENT, QUERY_TYPE_ADMIN, MYSQL_QP_IMPLICIT_COMMIT},
+    [ 66] = {"RELEASE_LOCK", 12, CW_FUNCTION, 0, MYSQL_QP_NONDETERMINISTIC},
+    [ 67] = {"PARTITIONS", 10, CW_EXPLAIN_OPTION, 0, 0},
+    [ 69] = {"FOR", 3, CW_FOR, 0, 0},
+    [ 70] = {"UNIX_TIMESTAMP", 14, CW_FUNCTION_NO_ARGS, 0, MYSQL_QP_NONDETERMINISTIC},
+    [ 71] = {"TRANSACTION", 11, CW_TRANSACTION, 0, 0},
+    [ 72] = {"UUID_SHORT", 10, CW_FUNCTION, 0, MYSQL_QP_NONDETERMINISTIC},
+    [ 73] = {"CONNECTION_ID", 13, CW_FUNCTION, 0, MYSQL_QP_NONDETERMINISTIC},
+    [ 74] = {"SYSTEM_USER", 11, CW_FUNCTION, 0, MYSQL_QP_NONDETERMINISTIC},
+    [ 75] = {"ROW_COUNT", 9, CW_FUNCTION, 0, MYSQL_QP_NONDETERMINISTIC},
+    [ 76] = {"BENCHMARK", 9, CW_FUNCTION, 0, MYSQL_QP_NONDETERMINISTIC},
+    [ 77] = {"CURRENT_TIMESTAMP", 17, CW_FUNCTION_BARE, 0, MYSQL_QP_NONDETERMINISTIC},
+    [ 78] = {"SHUTDOWN", 8, CW_STATEMENT, QUERY_TYPE_ADMIN, 0},
+    [ 79] = {"PASSWORD", 8, CW_PASSWORD, 0, 0},
+    [ 80] = {"STOP", 4, CW_STATEMENT, QUERY_TYPE_ADMIN, MYSQL_QP_IMPLICIT_COMMIT},
+    [ 81] = {"REPLACE", 7, CW_STATEMENT, QUERY_TYPE_REPLACE, 0},
+    [ 83] = {"RESTART", 7, CW_STATEMENT, QUERY_TYPE_ADMIN, 0},
+    [ 84] = {"CHANGE", 6, CW_STATEMENT, QUERY_TYPE_ADMIN, MYSQL_QP_IMPLICIT_COMMIT},
+    [ 85] = {"UTC_DATE", 8, CW_FUNCTION_BARE, 0, MYSQL_QP_NONDETERMINISTIC},
+    [ 86] = {"ANALYZE", 7, CW_ANALYZE, QUERY_TYPE_MAINTENANCE, MYSQL_QP_IMPLICIT_COMMIT},
+    [ 87] = {"WITH", 4, CW_WITH, 0, 0},
+    [ 88] = {"DROP", 4, CW_DROP, QUERY_TYPE_DROP, MYSQL_QP_IMPLICIT_COMMIT},
+    [ 89] = {"LOCK", 4, CW_LOCK, QUERY_TYPE_LOCK, MYSQL_QP_IMPLICIT_COMMIT},
+    [ 90] = {"CURRENT_USER", 12, CW_FUNCTION_BARE, 0, MYSQL_QP_NONDETERMINISTIC},
+    [ 92] = {"FLUSH", 5, CW_STATEMENT, QUERY_TYPE_ADMIN, MYSQL_QP_IMPLICIT_COMMIT},
+    [ 93] = {"DO", 2, CW_STATEMENT, QUERY_TYPE_DO, MYSQL_QP_READ_ONLY},
+    [ 94] = {"SYSDATE", 7, CW_FUNCTION, 0, MYSQL_QP_NONDETERMINISTIC},
+    [ 95] = {"IN", 2, CW_IN, 0, 0},
+    [ 96] = {"LOCALTIME", 9, CW_FUNCTION_BARE, 0, MYSQL_QP_NONDETERMINISTIC},
+    [ 97] = {"EXPLAIN", 7, CW_DESCRIBE, QUERY_TYPE_EXPLAIN, MYSQL_QP_READ_ONLY},
+    [ 98] = {"HELP", 4, CW_STATEMENT, QUERY_TYPE_ADMIN, MYSQL_QP_READ_ONLY},
+    [ 99] = {"OPTIMIZE", 8, CW_STATEMENT, QUERY_TYPE_MAINTENANCE, MYSQL_QP_IMPLICIT_COMMIT},
+    [100] = {"LOAD", 4, CW_LOAD, QUERY_TYPE_LOAD, 0},
+    [101] = {"RENAME", 6, CW_STATEMENT, QUERY_TYPE_RENAME, MYSQL_QP_IMPLICIT_COMMIT},
+    [102] = {"CURRENT_DATE", 12, CW_FUNCTION_BARE, 0, MYSQL_QP_NONDETERMINISTIC},
+    [103] = {"CURRENT_ROLE", 12, CW_FUNCTION, 0, MYSQL_QP_NONDETERMINISTIC},
+    [105] = {"IS_FREE_LOCK", 12, CW_FUNCTION, 0, MYSQL_QP_NONDETERMINISTIC},
+    [106] = {"DESC", 4, CW_DESCRIBE, QUERY_TYPE_DESCRIBE, MYSQL_QP_READ_ONLY},
+    [107] = {"RELEASE", 7, CW_STATEMENT, QUERY_TYPE_SAVEPOINT, MYSQL_QP_TRANSACTION},
+    [108] = {"UNLOCK", 6, CW_LOCK, QUERY_TYPE_UNLOCK, MYSQL_QP_IMPLICIT_COMMIT},
+    [110] = {"PURGE", 5, CW_STATEMENT, QUERY_TYPE_ADMIN, 0},
+    [111] = {"NOW", 3, CW_FUNCTION, 0, MYSQL_QP_NONDETERMINISTIC},
+    [112] = {"CURRENT_TIME", 12, CW_FUNCTION_BARE, 0, MYSQL_QP_NONDETERMINISTIC},
+    [113] = {"RANDOM_BYTES", 12, CW_FUNCTION, 0, MYSQL_QP_NONDETERMINISTIC},
+    [114] = {"INSTALL", 7, CW_STATEMENT, QUERY_TYPE_ADMIN, MYSQL_QP_IMPLICIT_COMMIT},
+    [115] = {"BEGIN", 5, CW_STATEMENT, QUERY_TYPE_BEGIN, MYSQL_QP_TRANSACTION | MYSQL_QP_IMPLICIT_COMMIT},
+    [116] = {"VALUES", 6, CW_STATEMENT, QUERY_TYPE_SELECT, MYSQL_QP_READ_ONLY},
+    [117] = {"DATABASE", 8, CW_FUNCTION, 0, MYSQL_QP_NONDETERMINISTIC},
+    [118] = {"EXECUTE", 7, CW_STATEMENT, QUERY_TYPE_EXECUTE, 0},
+    [119] = {"CURDATE", 7, CW_FUNCTION, 0, MYSQL_QP_NONDETERMINISTIC},
+    [120] = {"DESCRIBE", 8, CW_DESCRIBE, QUERY_TYPE_DESCRIBE, MYSQL_QP_READ_ONLY},
+    [121] = {"CHECKSUM", 8, CW_STATEMENT, QUERY_TYPE_MAINTENANCE, MYSQL_QP_READ_ONLY},
+    [122] = {"XA", 2, CW_STATEMENT, QUERY_TYPE_XA, MYSQL_QP_TRANSACTION},
+    [123] = {"USE", 3, CW_STATEMENT, QUERY_TYPE_USE, 0},
+    [124] = {"UUID", 4, CW_FUNCTION, 0, MYSQL_QP_NONDETERMINISTIC},
+    [125] = {"ALTER", 5, CW_STATEMENT, QUERY_TYPE_ALTER, MYSQL_QP_IMPLICIT_COMMIT},
+    [126] = {"UNINSTALL", 9, CW_STATEMENT, QUERY_TYPE_ADMIN, MYSQL_QP_IMPLICIT_COMMIT},
+    [127] = {"GET_LOCK", 8, CW_FUNCTION, 0, MYSQL_QP_NONDETERMINISTIC},
+};
+
+static const char *const query_type_names[QUERY_TYPE_COUNT] = {
+    "UNKNOWN", "SELECT", "INSERT", "UPDATE", "DELETE", "CREATE", "DROP", "ALTER", "SHOW", "DESCRIBE",
+    "EXPLAIN", "REPLACE", "CALL", "SET", "BEGIN", "COMMIT", "ROLLBACK", "SAVEPOINT", "XA", "LOCK",
+    "UNLOCK", "LOAD", "TRUNCATE", "RENAME", "GRANT", "REVOKE", "USE", "DO", "HANDLER", "PREPARE",
+    "EXECUTE", "DEALLOCATE", "MAINTENANCE", "ADMIN"
+};
+
+static zend_always_inline const classify_word* classify_lookup(const char *word, size_t len) {
+    const classify_word *entry;
+    uint64_t hash;
+
+    if (len < 2 || len > CLASSIFY_MAX_WORD) {
+        return NULL;
+    }
+    hash = ((uint64_t) CLASSIFY_LOWER(word[0]) | (uint64_t) CLASSIFY_LOWER(word[1]) << 8 |
+            (uint64_t) CLASSIFY_LOWER(word[len / 2]) << 16 | (uint64_t) CLASSIFY_LOWER(word[len - 2]) << 24 |
+            (uint64_t) CLASSIFY_LOWER(word[len - 1]) << 32 | (uint64_t) len << 40) * CLASSIFY_HASH_MULTIPLIER;
+    entry = &classify_words[((hash >> (64 - CLASSIFY_BUCKET_BITS - CLASSIFY_SLOT_BITS)) ^
+                             classify_displacements[hash >> (64 - CLASSIFY_BUCKET_BITS)]) &
+                            ((1 << CLASSIFY_SLOT_BITS) - 1)];
+    if (entry->len != len) {
+        return NULL;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (CLASSIFY_LOWER(word[i]) != CLASSIFY_LOWER(entry->name[i])) {
+            return NULL;
+        }
+    }
+    return entry;
+}
+
+/* The scan: words, and single bytes for everything else (a quoted string or identifier is one item) */
+
+enum { ITEM_END = 0, ITEM_WORD, ITEM_OTHER };
+
+typedef struct {
+    const char *p;
+    const char *end;
+    zend_bool in_version_comment;
+    char previous;              /* first byte of the previous item, 'a' for a word */
+} classify_scan;
+
+typedef struct {
+    int kind;
+    const char *start;
+    size_t len;
+    char c;                     /* first byte */
+    char before;                /* first byte of the item before: '.' or '@' mean a qualified name or a variable */
+} classify_item;
+
+#define CLASS_WORD    1
+#define CLASS_SPACE   2
+#define CLASS_QUOTE   3
+#define CLASS_COMMENT 4     /* may start or end a comment: - # / * */
+
+static const unsigned char classify_bytes[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 2, 2, 2, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    2, 0, 3, 4, 1, 0, 0, 3, 0, 0, 4, 0, 0, 4, 0, 4,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0,
+    0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 1,
+    3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+};
+
+static const char* skip_quoted(const char *p, const char *end) {
+    char quote = *p++;
+
+    while (p < end) {
+        if (*p == '\\' && quote != '`') {
+            p += 2;
+        } else if (*p++ == quote) {
+            return p;       /* a doubled quote scans as two strings */
+        }
+    }
+    return end;
+}
+
+static int classify_next(classify_scan *s, classify_item *item) {
+    const char *p = s->p, *end = s->end;
+
+    while (p < end && classify_bytes[(unsigned char) *p] >= CLASS_SPACE) {
+        if (classify_bytes[(unsigned char) *p] == CLASS_SPACE) {
+            p++;
+        } else if (*p == '#' || (*p == '-' && p + 1 < end && p[1] == '-' && (p + 2 == end || (unsigned char) p[2] <= ' '))) {
+            while (p < end && *p != '\n') p++;
+        } else if (*p == '/' && p + 1 < end && p[1] == '*') {
+            if (p + 2 < end && p[2] == '!' && !s->in_version_comment) {
+                /* Version comment: the content is live SQL */
+                p += 3;
+                while (p < end && *p >= '0' && *p <= '9') p++;
+                s->in_version_comment = 1;
+            } else {
+                /* Comment or optimizer hint */
+                for (p += 2; p < end && !(*p == '*' && p + 1 < end && p[1] == '/'); p++);
+                p = p < end ? p + 2 : end;
+            }
+        } else if (*p == '*' && s->in_version_comment && p + 1 < end && p[1] == '/') {
+            s->in_version_comment = 0;
+            p += 2;
+        } else {
+            break;
+        }
+    }
+
+    item->before = s->previous;
+    if (p >= end) {
+        s->p = end;
+        return item->kind = ITEM_END;
+    }
+    item->start = p;
+    item->c = *p;
+    if (classify_bytes[(unsigned char) *p] == CLASS_WORD) {
+        while (p < end && classify_bytes[(unsigned char) *p] == CLASS_WORD) p++;
+        item->kind = ITEM_WORD;
+    } else {
+        p = classify_bytes[(unsigned char) *p] == CLASS_QUOTE ? skip_quoted(p, end) : p + 1;
+        item->kind = ITEM_OTHER;
+    }
+    item->len = p - item->start;
+    s->previous = item->kind == ITEM_WORD ? 'a' : item->c;
+    s->p = p;
+    return item->kind;
+}
+
+/* The next item as a known word, or NULL */
+static const classify_word* classify_next_word(classify_scan *s) {
+    classify_item item;
+
+    if (classify_next(s, &item) != ITEM_WORD) {
+        return NULL;
+    }
+    return classify_lookup(item.start, item.len);
+}
+
+static zend_always_inline zend_bool is_word_id(const classify_word *word, int id) {
+    return word && word->id == id;
+}
+
+/* Whether a word can begin the statement that a WITH or an EXPLAIN is for */
+static zend_always_inline zend_bool is_dml(const classify_word *word) {
+    switch (word ? word->type : QUERY_TYPE_UNKNOWN) {
+        case QUERY_TYPE_SELECT:
+        case QUERY_TYPE_INSERT:
+        case QUERY_TYPE_REPLACE:
+        case QUERY_TYPE_UPDATE:
+        case QUERY_TYPE_DELETE:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static int classify_kind(classify_scan *s, unsigned int *flags);
+
+/* WITH: the first statement word outside the CTE bodies */
+static int classify_with(classify_scan *s, unsigned int *flags) {
+    classify_item item;
+    int depth = 0;
+
+    while (classify_next(s, &item) != ITEM_END) {
+        if (item.kind == ITEM_OTHER) {
+            depth += (item.c == '(') - (item.c == ')');
+            if (item.c == ';') {
+                /* Left for classify_flags() to stop at */
+                s->p = item.start;
+                break;
+            }
+        } else if (depth == 0) {
+            const classify_word *word = classify_lookup(item.start, item.len);
+
+            if (is_dml(word)) {
+                *flags = word->flags;
+                return word->type;
+            }
+        }
+    }
+    *flags = 0;
+    return QUERY_TYPE_UNKNOWN;
+}
+
+/*
+ * DESCRIBE/EXPLAIN keep the kind their first word names, whether they are
+ * for a table or a statement. Only EXPLAIN ANALYZE of a write changes data.
+ */
+static void classify_explain(classify_scan *s, unsigned int *flags) {
+    classify_scan start = *s, before;
+    classify_item item;
+    const classify_word *word;
+    zend_bool analyze = 0;
+    unsigned int inner;
+
+    for (;;) {
+        before = *s;
+        word = classify_next(s, &item) == ITEM_WORD ? classify_lookup(item.start, item.len) : NULL;
+        if (is_word_id(word, CW_ANALYZE)) {
+            analyze = 1;
+        } else if (is_word_id(word, CW_FORMAT)) {
+            /* FORMAT = JSON */
+            classify_next(s, &item);
+            classify_next(s, &item);
+        } else if (!is_word_id(word, CW_EXPLAIN_OPTION)) {
+            break;
+        }
+    }
+
+    if (!analyze) {
+        *s = start;
+        return;
+    }
+    /* EXPLAIN ANALYZE runs what it explains */
+    *s = before;
+    *flags = classify_kind(s, &inner) == QUERY_TYPE_SELECT ? MYSQL_QP_READ_ONLY : 0;
+}
+
+/* SET: transaction characteristics, autocommit and passwords, from the first assignment's target */
+static void classify_set(classify_scan *s, unsigned int *flags) {
+    classify_item item;
+
+    while (classify_next(s, &item) == ITEM_WORD || (item.kind == ITEM_OTHER && (item.c == '@' || item.c == '.'))) {
+        const classify_word *word = item.kind == ITEM_WORD ? classify_lookup(item.start, item.len) : NULL;
+
+        if (is_word_id(word, CW_TRANSACTION) || is_word_id(word, CW_AUTOCOMMIT)) {
+            *flags |= MYSQL_QP_TRANSACTION;
+            return;
+        }
+        if (is_word_id(word, CW_PASSWORD)) {
+            *flags |= MYSQL_QP_IMPLICIT_COMMIT;
+            return;
+        }
+    }
+}
+
+/* The statement kind from its first words, with the flags those imply; the scan is left after them */
+static int classify_kind(classify_scan *s, unsigned int *flags) {
+    const classify_word *word, *next;
+    classify_item item;
+
+    /* (SELECT ...) UNION (SELECT ...) */
+    while (classify_next(s, &item) == ITEM_OTHER && item.c == '(');
+
+    word = item.kind == ITEM_WORD ? classify_lookup(item.start, item.len) : NULL;
+    if (!word || (!word->type && word->id != CW_WITH)) {
+        *flags = 0;
+        return QUERY_TYPE_UNKNOWN;
+    }
+    *flags = word->flags;
+
+    switch (word->id) {
+        case CW_WITH:
+            return classify_with(s, flags);
+        case CW_DESCRIBE:
+            classify_explain(s, flags);
+            break;
+        case CW_START:
+            /* START TRANSACTION, or START REPLICA and friends */
+            if (is_word_id(classify_next_word(s), CW_TRANSACTION)) {
+                *flags = MYSQL_QP_TRANSACTION | MYSQL_QP_IMPLICIT_COMMIT;
+                return QUERY_TYPE_BEGIN;
+            }
+            break;
+        case CW_LOAD:
+            if (is_word_id(classify_next_word(s), CW_INDEX)) {
+                *flags = MYSQL_QP_IMPLICIT_COMMIT;
+                return QUERY_TYPE_ADMIN;
+            }
+            break;
+        case CW_CREATE:
+        case CW_DROP:
+            /* Temporary tables don't end the transaction */
+            next = classify_next_word(s);
+            if (is_word_id(next, CW_TEMPORARY)) {
+                *flags = 0;
+            } else if (word->id == CW_DROP && is_word_id(next, CW_PREPARE)) {
+                *flags = 0;
+                return QUERY_TYPE_DEALLOCATE;
+            }
+            break;
+        case CW_LOCK:
+            /* LOCK INSTANCE FOR BACKUP doesn't either */
+            if (is_word_id(classify_next_word(s), CW_INSTANCE)) {
+                *flags = 0;
+            }
+            break;
+        case CW_SET:
+            classify_set(s, flags);
+            break;
+    }
+    return word->type;
+}
+
+/* After a function name: 0 if no call follows, 1 for a call, 2 for one without arguments */
+static int classify_call(const classify_scan *s) {
+    const char *p = s->p;
+
+    while (p < s->end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) p++;
+    if (p >= s->end || *p != '(') {
+        return 0;
+    }
+    for (p++; p < s->end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'); p++);
+    return p < s->end && *p == ')' ? 2 : 1;
+}
+
+/* Whether another statement follows the ";" classify_flags() stopped at */
+static zend_bool classify_more(classify_scan *s) {
+    classify_item item;
+
+    while (classify_next(s, &item) == ITEM_OTHER && item.c == ';');
+    return item.kind != ITEM_END;
+}
+
+/* Locking reads and non-deterministic calls, up to the end of the statement */
+static unsigned int classify_flags(classify_scan *s) {
+    const classify_word *word, *previous = NULL;
+    classify_item item;
+    unsigned int flags = 0;
+
+    while (classify_next(s, &item) != ITEM_END) {
+        if (item.kind != ITEM_WORD) {
+            if (item.c == ';') {
+                break;
+            }
+            previous = NULL;
+            continue;
+        }
+        /* t.now() and @rand are not the functions */
+        word = item.before == '.' || item.before == '@' ? NULL : classify_lookup(item.start, item.len);
+        if (!word) {
+            previous = NULL;
+            continue;
+        }
+        switch (word->id) {
+            case CW_UPDATE:
+            case CW_SHARE:
+                if (is_word_id(previous, CW_FOR)) {
+                    flags |= MYSQL_QP_LOCKING_READ;
+                }
+                break;
+            case CW_IN:
+                /* LOCK IN SHARE MODE */
+                if (is_word_id(previous, CW_LOCK)) {
+                    flags |= MYSQL_QP_LOCKING_READ;
+                }
+                break;
+            case CW_FUNCTION:
+                flags |= classify_call(s) ? word->flags : 0;
+                break;
+            case CW_FUNCTION_BARE:
+                flags |= word->flags;
+                break;
+            case CW_FUNCTION_NO_ARGS:
+                flags |= classify_call(s) == 2 ? word->flags : 0;
+                break;
+        }
+        previous = word;
+    }
+    return flags;
+}
+
+/* The kind and flags of the first statement in query; the statements after it can write */
+void mysql_classify_query(const char *query, size_t query_len, mysql_query_class *result) {
+    classify_scan s = {query, query + query_len, 0, 0};
+
+    result->type = classify_kind(&s, &result->flags);
+    result->flags |= classify_flags(&s);
+    if (classify_more(&s)) {
+        result->flags &= ~MYSQL_QP_READ_ONLY;
+    }
+}
+
+/* The kind alone, which only takes the first words */
+int mysql_get_query_type(const char *query, size_t query_len) {
+    classify_scan s = {query, query + query_len, 0, 0};
+    unsigned int flags;
+
+    if (!query) {
+        return QUERY_TYPE_UNKNOWN;
+    }
+    return classify_kind(&s, &flags);
+}
+
+/*
+ * Whether the statement starts with SELECT itself. WITH, TABLE, VALUES and
+ * a parenthesized SELECT are SELECTs too, but don't have its clause layout.
+ */
+zend_bool mysql_is_plain_select(const char *query, size_t query_len) {
+    classify_scan s = {query, query + query_len, 0, 0};
+    classify_item item;
+
+    return query && classify_next(&s, &item) == ITEM_WORD &&
+           zend_binary_strcasecmp(item.start, item.len, "SELECT", sizeof("SELECT") - 1) == 0;
+}
+
+const char* mysql_query_type_name(int query_type) {
+    if (query_type < 0 || query_type >= QUERY_TYPE_COUNT) {
+        query_type = QUERY_TYPE_UNKNOWN;
+    }
+    return query_type_names[query_type];
+}
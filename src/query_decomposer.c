@@ -3,272 +3,974 @@
 #include "../include/php_mysql_qp.h"
 #include "../include/query_decomposer.h"
 #include "../include/mysql_query_parser.h"
+#include "../include/sql_lexer.h"
+#include "../include/sql_arena.h"
+#include "../include/insert_rows.h"
 #include <mysql.h>
 #include <string.h>
 #include <ctype.h>
 
-/* strcasestr is available on macOS, no need to implement */
-
-/* Initialize query components structure */
-query_components* init_query_components() {
-    query_components *components = emalloc(sizeof(query_components));
-    memset(components, 0, sizeof(query_components));
-    
-    components->fields = emalloc(sizeof(zval));
-    components->tables = emalloc(sizeof(zval));
-    components->joins = emalloc(sizeof(zval));
-    components->where_conditions = emalloc(sizeof(zval));
-    components->group_by = emalloc(sizeof(zval));
-    components->having = emalloc(sizeof(zval));
-    components->order_by = emalloc(sizeof(zval));
-    components->limit_clause = emalloc(sizeof(zval));
-    components->values = emalloc(sizeof(zval));
-    components->parameters = emalloc(sizeof(zval));
-    
-    array_init(components->fields);
-    array_init(components->tables);
-    array_init(components->joins);
-    array_init(components->where_conditions);
-    array_init(components->group_by);
-    array_init(components->having);
-    array_init(components->order_by);
-    array_init(components->limit_clause);
-    array_init(components->values);
-    array_init(components->parameters);
-    
-    return components;
-}
-
-/* Free query components structure */
+zend_string *query_component_keys[COMPONENT_KEY_COUNT];
+
+static const char *component_key_names[COMPONENT_KEY_COUNT] = {
+    "type", "fields", "tables", "joins", "where_conditions", "group_by",
+    "having", "order_by", "limit_clause", "values", "parameters",
+    "on_duplicate_key_update", "table", "alias"
+};
+
+/* Statement types the decomposer reports */
+enum {
+    DECOMPOSED_SELECT = 0,
+    DECOMPOSED_INSERT,
+    DECOMPOSED_UPDATE,
+    DECOMPOSED_DELETE,
+    DECOMPOSED_REPLACE,
+    DECOMPOSED_UNKNOWN,
+    DECOMPOSED_TYPE_COUNT
+};
+
+static zend_string *type_names[DECOMPOSED_TYPE_COUNT];
+
+static const char *type_name_strings[DECOMPOSED_TYPE_COUNT] = {
+    "SELECT", "INSERT", "UPDATE", "DELETE", "REPLACE", "UNKNOWN"
+};
+
+/* Intern the array keys and type names once per process; called from MINIT */
+void mysql_decomposer_startup(void) {
+    for (int i = 0; i < COMPONENT_KEY_COUNT; i++) {
+        query_component_keys[i] = zend_string_init_interned(component_key_names[i], strlen(component_key_names[i]), 1);
+    }
+    for (int i = 0; i < DECOMPOSED_TYPE_COUNT; i++) {
+        type_names[i] = zend_string_init_interned(type_name_strings[i], strlen(type_name_strings[i]), 1);
+    }
+}
+
+/* Initialize query components structure; every clause starts as the shared empty array */
+void init_query_components(query_components *components) {
+    components->type = NULL;
+    components->spans_base = NULL;
+    ZVAL_EMPTY_ARRAY(&components->fields);
+    ZVAL_EMPTY_ARRAY(&components->tables);
+    ZVAL_EMPTY_ARRAY(&components->joins);
+    ZVAL_EMPTY_ARRAY(&components->where_conditions);
+    ZVAL_EMPTY_ARRAY(&components->group_by);
+    ZVAL_EMPTY_ARRAY(&components->having);
+    ZVAL_EMPTY_ARRAY(&components->order_by);
+    ZVAL_EMPTY_ARRAY(&components->limit_clause);
+    ZVAL_EMPTY_ARRAY(&components->values);
+    ZVAL_EMPTY_ARRAY(&components->parameters);
+    ZVAL_EMPTY_ARRAY(&components->on_duplicate);
+}
+
+/* Free the clauses of a decomposition that was not handed over to PHP */
 void mysql_free_query_components(query_components *components) {
     if (!components) return;
     
-    if (components->type) efree(components->type);
+    zval_ptr_dtor(&components->fields);
+    zval_ptr_dtor(&components->tables);
+    zval_ptr_dtor(&components->joins);
+    zval_ptr_dtor(&components->where_conditions);
+    zval_ptr_dtor(&components->group_by);
+    zval_ptr_dtor(&components->having);
+    zval_ptr_dtor(&components->order_by);
+    zval_ptr_dtor(&components->limit_clause);
+    zval_ptr_dtor(&components->values);
+    zval_ptr_dtor(&components->parameters);
+    zval_ptr_dtor(&components->on_duplicate);
+    init_query_components(components);
+}
+
+/* Move the clauses into a PHP array under the interned keys; components is left empty */
+void mysql_query_components_to_zval(query_components *components, zval *array) {
+    HashTable *ht;
+    zval type;
+    
+    array_init_size(array, COMPONENT_TABLE);    /* keys before COMPONENT_TABLE are the top level */
+    ht = Z_ARRVAL_P(array);
+    zend_hash_real_init_mixed(ht);
+    
+    ZVAL_INTERNED_STR(&type, components->type ? components->type : type_names[DECOMPOSED_UNKNOWN]);
+    _zend_hash_append(ht, query_component_keys[COMPONENT_TYPE], &type);
+    _zend_hash_append(ht, query_component_keys[COMPONENT_FIELDS], &components->fields);
+    _zend_hash_append(ht, query_component_keys[COMPONENT_TABLES], &components->tables);
+    _zend_hash_append(ht, query_component_keys[COMPONENT_JOINS], &components->joins);
+    _zend_hash_append(ht, query_component_keys[COMPONENT_WHERE], &components->where_conditions);
+    _zend_hash_append(ht, query_component_keys[COMPONENT_GROUP_BY], &components->group_by);
+    _zend_hash_append(ht, query_component_keys[COMPONENT_HAVING], &components->having);
+    _zend_hash_append(ht, query_component_keys[COMPONENT_ORDER_BY], &components->order_by);
+    _zend_hash_append(ht, query_component_keys[COMPONENT_LIMIT], &components->limit_clause);
+    _zend_hash_append(ht, query_component_keys[COMPONENT_VALUES], &components->values);
+    _zend_hash_append(ht, query_component_keys[COMPONENT_PARAMETERS], &components->parameters);
+    _zend_hash_append(ht, query_component_keys[COMPONENT_ON_DUPLICATE], &components->on_duplicate);
     
-    if (components->fields) {
-        zval_ptr_dtor(components->fields);
-        efree(components->fields);
+    init_query_components(components);
+}
+
+/* The clause stored for a top-level key; NULL for "type" and nested keys */
+zval* mysql_query_component(query_components *components, int component) {
+    switch (component) {
+        case COMPONENT_FIELDS: return &components->fields;
+        case COMPONENT_TABLES: return &components->tables;
+        case COMPONENT_JOINS: return &components->joins;
+        case COMPONENT_WHERE: return &components->where_conditions;
+        case COMPONENT_GROUP_BY: return &components->group_by;
+        case COMPONENT_HAVING: return &components->having;
+        case COMPONENT_ORDER_BY: return &components->order_by;
+        case COMPONENT_LIMIT: return &components->limit_clause;
+        case COMPONENT_VALUES: return &components->values;
+        case COMPONENT_PARAMETERS: return &components->parameters;
+        case COMPONENT_ON_DUPLICATE: return &components->on_duplicate;
+        default: return NULL;
     }
-    if (components->tables) {
-        zval_ptr_dtor(components->tables);
-        efree(components->tables);
+}
+
+/* The interned "type" a decomposition reports for a QUERY_TYPE_* */
+zend_string* mysql_decomposed_type(int query_type) {
+    switch (query_type) {
+        case QUERY_TYPE_SELECT: return type_names[DECOMPOSED_SELECT];
+        case QUERY_TYPE_INSERT: return type_names[DECOMPOSED_INSERT];
+        case QUERY_TYPE_REPLACE: return type_names[DECOMPOSED_REPLACE];
+        case QUERY_TYPE_UPDATE: return type_names[DECOMPOSED_UPDATE];
+        case QUERY_TYPE_DELETE: return type_names[DECOMPOSED_DELETE];
+        default: return type_names[DECOMPOSED_UNKNOWN];
     }
-    if (components->joins) {
-        zval_ptr_dtor(components->joins);
-        efree(components->joins);
+}
+
+/* Append to a clause, giving it its own array on first use */
+static zend_always_inline void component_append(zval *clause, zval *value) {
+    if (!Z_REFCOUNTED_P(clause)) {
+        array_init(clause);
     }
-    if (components->where_conditions) {
-        zval_ptr_dtor(components->where_conditions);
-        efree(components->where_conditions);
+    zend_hash_next_index_insert_new(Z_ARRVAL_P(clause), value);
+}
+
+/* Text from the query: a string, or a span from spans_base when the caller asked for MYSQL_QP_SPANS */
+static zend_always_inline void query_text(const char *spans_base, const char *str, size_t len, zval *value) {
+    if (spans_base) {
+        mysql_span_to_zval(value, str - spans_base, len);
+    } else {
+        ZVAL_STRINGL_FAST(value, str, len);
     }
-    if (components->group_by) {
-        zval_ptr_dtor(components->group_by);
-        efree(components->group_by);
+}
+
+static zend_always_inline void component_text(query_components *components, const char *str, size_t len, zval *value) {
+    query_text(components->spans_base, str, len, value);
+}
+
+static zend_always_inline void component_append_text(query_components *components, zval *clause, const char *str, size_t len) {
+    zval value;
+    component_text(components, str, len, &value);
+    component_append(clause, &value);
+}
+
+/* Clause scanner */
+
+/* Words the scanner acts on besides the clause keywords themselves */
+enum {
+    SCAN_WORD_NONE = -1,
+    SCAN_WORD_BY = CLAUSE_COUNT,
+    SCAN_WORD_GROUP,
+    SCAN_WORD_ORDER,
+    SCAN_WORD_END               /* UNION, EXCEPT, INTERSECT, FOR, LOCK, INTO */
+};
+
+/* Scanner keywords bucketed by first letter, so a word costs one switch and a compare or two */
+static const struct {
+    const char *name;
+    size_t len;
+    int word;
+} scan_words[] = {
+    {"BY", 2, SCAN_WORD_BY},
+    {"EXCEPT", 6, SCAN_WORD_END},
+    {"FROM", 4, CLAUSE_FROM}, {"FOR", 3, SCAN_WORD_END},
+    {"GROUP", 5, SCAN_WORD_GROUP},
+    {"HAVING", 6, CLAUSE_HAVING},
+    {"INTERSECT", 9, SCAN_WORD_END}, {"INTO", 4, SCAN_WORD_END},
+    {"LIMIT", 5, CLAUSE_LIMIT}, {"LOCK", 4, SCAN_WORD_END},
+    {"ORDER", 5, SCAN_WORD_ORDER},
+    {"SELECT", 6, CLAUSE_SELECT},
+    {"UNION", 5, SCAN_WORD_END},
+    {"WHERE", 5, CLAUSE_WHERE}, {"WINDOW", 6, CLAUSE_WINDOW},
+};
+
+/* First and one-past-last scan_words index for each letter */
+static zend_always_inline void scan_word_range(unsigned char c, int *first, int *last) {
+    switch (c | 0x20) {
+        case 'b': *first = 0;  *last = 1;  return;
+        case 'e': *first = 1;  *last = 2;  return;
+        case 'f': *first = 2;  *last = 4;  return;
+        case 'g': *first = 4;  *last = 5;  return;
+        case 'h': *first = 5;  *last = 6;  return;
+        case 'i': *first = 6;  *last = 8;  return;
+        case 'l': *first = 8;  *last = 10; return;
+        case 'o': *first = 10; *last = 11; return;
+        case 's': *first = 11; *last = 12; return;
+        case 'u': *first = 12; *last = 13; return;
+        case 'w': *first = 13; *last = 15; return;
+        default:  *first = *last = 0;      return;
     }
-    if (components->having) {
-        zval_ptr_dtor(components->having);
-        efree(components->having);
+}
+
+static int scan_word(const char *word, size_t len) {
+    int first, last;
+
+    if (len < 2 || len > 9) {
+        return SCAN_WORD_NONE;
     }
-    if (components->order_by) {
-        zval_ptr_dtor(components->order_by);
-        efree(components->order_by);
+    scan_word_range((unsigned char) *word, &first, &last);
+    for (int i = first; i < last; i++) {
+        if (scan_words[i].len == len && strncasecmp(word, scan_words[i].name, len) == 0) {
+            return scan_words[i].word;
+        }
     }
-    if (components->limit_clause) {
-        zval_ptr_dtor(components->limit_clause);
-        efree(components->limit_clause);
+    return SCAN_WORD_NONE;
+}
+
+#define SCAN_IDENT_CHAR(c) (isalnum((unsigned char) (c)) || (c) == '_' || (c) == '$' || (unsigned char) (c) >= 0x80)
+
+/* Position after the quoted string or identifier at p, or NULL when it is unterminated */
+static const char* skip_quoted(const char *p, const char *end) {
+    char quote = *p++;
+    
+    while (p < end) {
+        if (*p == '\\' && quote != '`') {
+            p += 2;
+        } else if (*p != quote) {
+            p++;
+        } else if (p + 1 < end && p[1] == quote) {
+            p += 2;
+        } else {
+            return p + 1;
+        }
     }
-    if (components->values) {
-        zval_ptr_dtor(components->values);
-        efree(components->values);
+    return NULL;
+}
+
+/* Position after the comment at p, p itself when none starts there, or NULL when it is unterminated */
+static const char* skip_comment(const char *p, const char *end) {
+    if (*p == '#' || (*p == '-' && p + 1 < end && p[1] == '-' && (p + 2 == end || (unsigned char) p[2] <= ' '))) {
+        while (p < end && *p != '\n') p++;
+        return p;
     }
-    if (components->parameters) {
-        zval_ptr_dtor(components->parameters);
-        efree(components->parameters);
+    if (*p == '/' && p + 1 < end && p[1] == '*') {
+        for (p += 2; p + 1 < end && !(p[0] == '*' && p[1] == '/'); p++);
+        return p + 1 < end ? p + 2 : NULL;
     }
-    
-    efree(components);
+    return p;
 }
 
-/* Skip whitespace */
-const char* skip_whitespace(const char *str) {
-    while (*str && isspace(*str)) str++;
-    return str;
+static void scan_add_comma(clause_scan *scan, const char *comma) {
+    if (scan->comma_count == scan->comma_size) {
+        const char **commas = sql_arena_alloc(&scan->arena, sizeof(const char *) * (scan->comma_size ? scan->comma_size * 2 : 16));
+        if (scan->comma_count) {
+            memcpy(commas, scan->commas, sizeof(const char *) * scan->comma_count);
+        }
+        scan->commas = commas;
+        scan->comma_size = scan->comma_size ? scan->comma_size * 2 : 16;
+    }
+    scan->commas[scan->comma_count++] = comma;
 }
 
-/* Find keyword in string (case insensitive) */
-const char* find_keyword(const char *str, const char *keyword) {
-    size_t keyword_len = strlen(keyword);
-    const char *pos = str;
-    
-    while ((pos = strcasestr(pos, keyword)) != NULL) {
-        /* Check if this is a word boundary */
-        if ((pos == str || isspace(*(pos-1))) && 
-            (isspace(*(pos + keyword_len)) || *(pos + keyword_len) == '\0' || 
-             *(pos + keyword_len) == '(' || *(pos + keyword_len) == ',' || 
-             *(pos + keyword_len) == ';')) {
-            return pos;
+/*
+ * One pass over the bytes, tracking quote, comment and parenthesis state, so
+ * keywords inside strings, comments and quoted identifiers are never seen.
+ * Clause keywords are only recorded at depth 0, which keeps subqueries,
+ * function arguments and window definitions inside the clause they belong
+ * to. Top-level commas are kept for splitting the field and table lists.
+ * An unterminated quote or comment ends the scan where it opens.
+ */
+void clause_scan_run(clause_scan *scan, const char *query, size_t query_len) {
+    const char *p = query, *end = query + query_len;
+    const char *pending_start = NULL;
+    int depth = 0, pending = SCAN_WORD_NONE, in_version_comment = 0;
+
+    memset(scan, 0, sizeof(clause_scan));
+    sql_arena_init(&scan->arena, 1024);
+    scan->end = end;
+
+    while (p < end) {
+        const char *word, *next;
+        int clause;
+
+        switch (*p) {
+            case ' ': case '\t': case '\n': case '\r': case '\f': case '\v':
+                p++;
+                continue;
+            case '\'': case '"': case '`':
+                if (!(p = skip_quoted(p, end))) {
+                    return;
+                }
+                break;
+            case '/':
+                if (p + 2 < end && p[1] == '*' && p[2] == '!' && !in_version_comment) {
+                    /* Version comment: the content is live SQL */
+                    p += 3;
+                    while (p < end && isdigit((unsigned char) *p)) p++;
+                    in_version_comment = 1;
+                    continue;
+                }
+                /* fall through */
+            case '#': case '-':
+                if ((next = skip_comment(p, end)) != p) {
+                    if (!next) {
+                        return;
+                    }
+                    p = next;
+                    continue;
+                }
+                p++;
+                break;
+            case '*':
+                if (in_version_comment && p + 1 < end && p[1] == '/') {
+                    in_version_comment = 0;
+                    p += 2;
+                    continue;
+                }
+                p++;
+                break;
+            case '(':
+                depth++;
+                p++;
+                break;
+            case ')':
+                if (depth > 0) depth--;
+                p++;
+                break;
+            case ',':
+                if (depth == 0) scan_add_comma(scan, p);
+                p++;
+                break;
+            case ';':
+                if (depth == 0) {
+                    scan->end = p;
+                    return;
+                }
+                p++;
+                break;
+            default:
+                if (!SCAN_IDENT_CHAR(*p)) {
+                    p++;
+                    break;
+                }
+                word = p;
+                while (p < end && SCAN_IDENT_CHAR(*p)) p++;
+                clause = depth == 0 ? scan_word(word, p - word) : SCAN_WORD_NONE;
+
+                /* GROUP and ORDER only start a clause when BY follows */
+                if (pending != SCAN_WORD_NONE && clause == SCAN_WORD_BY) {
+                    if (!scan->start[pending]) {
+                        scan->start[pending] = pending_start;
+                        scan->body[pending] = p;
+                    }
+                    pending = SCAN_WORD_NONE;
+                    continue;
+                }
+                pending = SCAN_WORD_NONE;
+
+                if (clause == SCAN_WORD_GROUP || clause == SCAN_WORD_ORDER) {
+                    pending = clause == SCAN_WORD_GROUP ? CLAUSE_GROUP_BY : CLAUSE_ORDER_BY;
+                    pending_start = word;
+                } else if (clause == SCAN_WORD_END) {
+                    if (scan->start[CLAUSE_SELECT]) {
+                        scan->end = word;
+                        return;
+                    }
+                } else if (clause >= 0 && clause < CLAUSE_COUNT && !scan->start[clause]) {
+                    scan->start[clause] = word;
+                    scan->body[clause] = p;
+                }
+                continue;
         }
-        pos++;
+        /* Any other token between GROUP/ORDER and BY cancels the clause */
+        pending = SCAN_WORD_NONE;
     }
-    return NULL;
 }
 
-/* Extract field list from SELECT clause */
-int parse_field_list(const char *fields_str, zval *fields_array) {
-    char *fields_copy = estrdup(fields_str);
-    char *token = strtok(fields_copy, ",");
-    
-    while (token != NULL) {
-        /* Trim whitespace */
-        while (isspace(*token)) token++;
-        char *end = token + strlen(token) - 1;
-        while (end > token && isspace(*end)) end--;
-        *(end + 1) = '\0';
-        
-        add_next_index_string(fields_array, token);
-        token = strtok(NULL, ",");
-    }
+void clause_scan_free(clause_scan *scan) {
+    sql_arena_free(&scan->arena);
+}
+
+/* Text of a clause after its keyword, up to the next clause; FAILURE if it is absent */
+int clause_scan_body(const clause_scan *scan, int clause, const char **start, const char **end) {
+    const char *next = scan->end;
     
-    efree(fields_copy);
+    if (!scan->start[clause]) {
+        return FAILURE;
+    }
+    for (int i = 0; i < CLAUSE_COUNT; i++) {
+        if (scan->start[i] && scan->start[i] > scan->start[clause] && scan->start[i] < next) {
+            next = scan->start[i];
+        }
+    }
+    *start = scan->body[clause];
+    *end = next > scan->body[clause] ? next : scan->body[clause];
     return SUCCESS;
 }
 
-/* Extract table list from FROM clause */
-int parse_table_list(const char *tables_str, zval *tables_array) {
-    char *tables_copy = estrdup(tables_str);
-    char *token = strtok(tables_copy, ",");
-    
-    while (token != NULL) {
-        /* Trim whitespace */
-        while (isspace(*token)) token++;
-        char *end = token + strlen(token) - 1;
-        while (end > token && isspace(*end)) end--;
-        *(end + 1) = '\0';
-        
-        /* Parse table with potential alias */
-        char *alias_pos = strstr(token, " AS ");
-        if (!alias_pos) {
-            alias_pos = strrchr(token, ' ');
+/* Position after whitespace and plain comments from p; version comments are live SQL and stop it */
+static const char* skip_blank(const char *p, const char *end) {
+    while (p < end) {
+        const char *next;
+
+        if (isspace((unsigned char) *p)) {
+            p++;
+        } else if (!(p + 2 < end && p[0] == '/' && p[1] == '*' && p[2] == '!') &&
+                   (next = skip_comment(p, end)) != p && next) {
+            p = next;
+        } else {
+            break;
         }
+    }
+    return p;
+}
+
+/*
+ * What the clauses of a scanned SELECT leave out, as a phrase for an error
+ * message, or NULL when rebuilding from them keeps the whole statement. A
+ * trailing locking clause (FOR UPDATE, FOR SHARE, LOCK IN SHARE MODE) is
+ * kept: *tail is set to it, or to an empty range when there is none.
+ */
+const char* clause_scan_unmodelled(const clause_scan *scan, const char *query, size_t query_len,
+                                   const char **tail, size_t *tail_len) {
+    const char *end = query + query_len, *p;
+
+    *tail = scan->end;
+    *tail_len = 0;
+    if (!scan->start[CLAUSE_SELECT] || skip_blank(query, end) != scan->start[CLAUSE_SELECT]) {
+        return "text before SELECT";
+    }
+    if (scan->start[CLAUSE_WINDOW]) {
+        return "a WINDOW clause";
+    }
+    if (scan->end == end || *scan->end == ';') {
+        return NULL;
+    }
+    if ((end - scan->end >= 3 && strncasecmp(scan->end, "FOR", 3) == 0) ||
+        (end - scan->end >= 4 && strncasecmp(scan->end, "LOCK", 4) == 0)) {
+        /* Up to the statement's ';', if any; the scanner stopped before it */
+        for (p = scan->end; p < end; p++) {
+            if (*p == '\'' || *p == '"' || *p == '`') {
+                if (!(p = skip_quoted(p, end))) break;
+                p--;
+            } else if (*p == ';') {
+                break;
+            }
+        }
+        *tail_len = (p ? p : end) - scan->end;
+        while (*tail_len > 0 && isspace((unsigned char) (*tail)[*tail_len - 1])) (*tail_len)--;
+        return NULL;
+    }
+    return "text after its last clause (UNION, INTO, ...)";
+}
+
+/*
+ * Call item() for each item of [str, str + len) between top-level commas,
+ * trimmed, working on the query's own bytes. Empty items between adjacent
+ * commas are skipped.
+ */
+static void split_list(query_components *components, const clause_scan *scan, const char *str, size_t len, zval *array,
+                       void (*item)(query_components *components, const char *start, const char *end, zval *array)) {
+    const char *pos = str, *limit = str + len;
+    size_t comma = 0;
+    
+    while (comma < scan->comma_count && scan->commas[comma] < str) comma++;
+    
+    while (pos < limit) {
+        const char *start = pos, *end;
         
-        zval table_info;
-        array_init(&table_info);
-        
-        if (alias_pos && alias_pos > token) {
-            *alias_pos = '\0';
-            add_assoc_string(&table_info, "table", token);
-            add_assoc_string(&table_info, "alias", alias_pos + (strncmp(alias_pos + 1, "AS ", 3) == 0 ? 4 : 1));
+        if (comma < scan->comma_count && scan->commas[comma] < limit) {
+            end = scan->commas[comma++];
+            pos = end + 1;
         } else {
-            add_assoc_string(&table_info, "table", token);
-            add_assoc_string(&table_info, "alias", "");
+            end = pos = limit;
         }
+        if (end == start) continue;
         
-        add_next_index_zval(tables_array, &table_info);
-        token = strtok(NULL, ",");
+        while (start < end && isspace((unsigned char) *start)) start++;
+        while (end > start && isspace((unsigned char) *(end - 1))) end--;
+        item(components, start, end, array);
+    }
+}
+
+static void add_field(query_components *components, const char *start, const char *end, zval *fields_array) {
+    component_append_text(components, fields_array, start, end - start);
+}
+
+/*
+ * Split "table [AS] alias" on its top-level tokens: the alias is a trailing
+ * identifier after AS, or one that directly follows a table name or a
+ * parenthesized subquery. Anything else is all table, e.g. a JOIN chain.
+ */
+static void add_table(query_components *components, const char *start, const char *end, zval *tables_array) {
+    mysql_lexer lexer;
+    mysql_token token, last, previous;
+    const char *table_end = end, *alias = end;
+    int depth = 0, count = 0;
+    zval table_info, value;
+    HashTable *ht;
+    
+    memset(&last, 0, sizeof(mysql_token));
+    memset(&previous, 0, sizeof(mysql_token));
+    mysql_lexer_init(&lexer, start, end - start, 0);
+    while (mysql_lexer_next(&lexer, &token) != TOKEN_EOF && token.type != TOKEN_ERROR) {
+        if (token.type == TOKEN_LPAREN) depth++;
+        else if (token.type == TOKEN_RPAREN && depth > 0) depth--;
+        else if (depth > 0) continue;
+        previous = last;
+        last = token;
+        count++;
+    }
+    
+    if (count >= 2 && depth == 0 &&
+        (last.type == TOKEN_IDENTIFIER || last.type == TOKEN_QUOTED_IDENTIFIER || last.type == TOKEN_STRING) &&
+        ((previous.type == TOKEN_KEYWORD && previous.keyword == MYSQL_KW_AS) ||
+         previous.type == TOKEN_IDENTIFIER || previous.type == TOKEN_QUOTED_IDENTIFIER || previous.type == TOKEN_RPAREN)) {
+        alias = last.start;
+        table_end = previous.type == TOKEN_KEYWORD && previous.keyword == MYSQL_KW_AS ? previous.start : last.start;
+        while (table_end > start && isspace((unsigned char) *(table_end - 1))) table_end--;
+        if (table_end == start) {
+            table_end = end;
+            alias = end;
+        }
     }
     
-    efree(tables_copy);
+    array_init_size(&table_info, 2);
+    ht = Z_ARRVAL(table_info);
+    zend_hash_real_init_mixed(ht);
+    
+    component_text(components, start, table_end - start, &value);
+    _zend_hash_append(ht, query_component_keys[COMPONENT_TABLE], &value);
+    component_text(components, alias, end - alias, &value);
+    _zend_hash_append(ht, query_component_keys[COMPONENT_ALIAS], &value);
+    
+    component_append(tables_array, &table_info);
+}
+
+/* Extract field list from SELECT clause */
+int parse_field_list(query_components *components, const clause_scan *scan, const char *fields_str, size_t fields_len, zval *fields_array) {
+    split_list(components, scan, fields_str, fields_len, fields_array, add_field);
+    return SUCCESS;
+}
+
+/* Extract table list from FROM clause */
+int parse_table_list(query_components *components, const clause_scan *scan, const char *tables_str, size_t tables_len, zval *tables_array) {
+    split_list(components, scan, tables_str, tables_len, tables_array, add_table);
     return SUCCESS;
 }
 
+/* Decompose one clause of a scanned SELECT; clauses a SELECT doesn't have are left alone */
+void extract_select_clause(query_components *components, const clause_scan *scan, int component) {
+    const char *start, *end;
+    
+    switch (component) {
+        case COMPONENT_FIELDS:
+            if (clause_scan_body(scan, CLAUSE_SELECT, &start, &end) == SUCCESS) {
+                parse_field_list(components, scan, start, end - start, &components->fields);
+            }
+            break;
+        case COMPONENT_TABLES:
+            if (clause_scan_body(scan, CLAUSE_FROM, &start, &end) == SUCCESS) {
+                parse_table_list(components, scan, start, end - start, &components->tables);
+            }
+            break;
+        case COMPONENT_WHERE:
+            if (clause_scan_body(scan, CLAUSE_WHERE, &start, &end) == SUCCESS) {
+                component_append_text(components, &components->where_conditions, start, end - start);
+            }
+            break;
+        case COMPONENT_GROUP_BY:
+            if (clause_scan_body(scan, CLAUSE_GROUP_BY, &start, &end) == SUCCESS) {
+                parse_field_list(components, scan, start, end - start, &components->group_by);
+            }
+            break;
+        case COMPONENT_HAVING:
+            if (clause_scan_body(scan, CLAUSE_HAVING, &start, &end) == SUCCESS) {
+                component_append_text(components, &components->having, start, end - start);
+            }
+            break;
+        case COMPONENT_ORDER_BY:
+            if (clause_scan_body(scan, CLAUSE_ORDER_BY, &start, &end) == SUCCESS) {
+                component_append_text(components, &components->order_by, start, end - start);
+            }
+            break;
+        case COMPONENT_LIMIT:
+            if (clause_scan_body(scan, CLAUSE_LIMIT, &start, &end) == SUCCESS) {
+                component_append_text(components, &components->limit_clause, start, end - start);
+            }
+            break;
+    }
+}
+
 /* Decompose SELECT query */
-int extract_select_components(const char *query, query_components *components) {
-    const char *select_pos = find_keyword(query, "SELECT");
-    const char *from_pos = find_keyword(query, "FROM");
-    const char *where_pos = find_keyword(query, "WHERE");
-    const char *group_pos = find_keyword(query, "GROUP BY");
-    const char *having_pos = find_keyword(query, "HAVING");
-    const char *order_pos = find_keyword(query, "ORDER BY");
-    const char *limit_pos = find_keyword(query, "LIMIT");
-    
-    components->type = estrdup("SELECT");
-    
-    /* Extract fields */
-    if (select_pos && from_pos) {
-        size_t fields_len = from_pos - select_pos - 6; /* Skip "SELECT" */
-        char *fields_str = estrndup(select_pos + 6, fields_len);
-        parse_field_list(fields_str, components->fields);
-        efree(fields_str);
-    }
-    
-    /* Extract tables */
-    if (from_pos) {
-        const char *end_pos = where_pos;
-        if (!end_pos) end_pos = group_pos;
-        if (!end_pos) end_pos = order_pos;
-        if (!end_pos) end_pos = limit_pos;
-        if (!end_pos) end_pos = query + strlen(query);
+int extract_select_components(const char *query, size_t query_len, query_components *components) {
+    clause_scan scan;
+    
+    components->type = type_names[DECOMPOSED_SELECT];
+    clause_scan_run(&scan, query, query_len);
+    
+    for (int component = COMPONENT_FIELDS; component < COMPONENT_TABLE; component++) {
+        extract_select_clause(components, &scan, component);
+    }
+    
+    clause_scan_free(&scan);
+    return SUCCESS;
+}
+
+/* INSERT and REPLACE */
+
+/* Skip whitespace and comments; the first significant byte, or end */
+static const char* skip_noise(const char *p, const char *end) {
+    const char *next;
+    
+    while (p < end) {
+        if (isspace((unsigned char) *p)) {
+            p++;
+        } else if ((next = skip_comment(p, end)) != p) {
+            p = next ? next : end;
+        } else {
+            break;
+        }
+    }
+    return p;
+}
+
+static void add_row_item(zval *row, const char *start, const char *end, const char *spans_base) {
+    zval value;
+    
+    while (start < end && isspace((unsigned char) *start)) start++;
+    while (end > start && isspace((unsigned char) *(end - 1))) end--;
+    query_text(spans_base, start, end - start, &value);
+    zend_hash_next_index_insert_new(Z_ARRVAL_P(row), &value);
+}
+
+/*
+ * Scan the "(...)" or "ROW(...)" tuple of a VALUES list at p, after any
+ * separating comma, and put its items in row unless row is NULL. Returns the
+ * position after the tuple, or NULL when none starts at p. Nothing is
+ * allocated beyond the row itself, so a list of any length is walked in
+ * constant memory.
+ */
+const char* insert_row_next(const char *p, const char *end, const char *spans_base, zval *row) {
+    const char *item, *next;
+    int depth = 1;
+    
+    p = skip_noise(p, end);
+    if (p < end && *p == ',') {
+        p = skip_noise(p + 1, end);
+    }
+    if (end - p > 3 && strncasecmp(p, "ROW", 3) == 0 && !SCAN_IDENT_CHAR(p[3])) {
+        p = skip_noise(p + 3, end);
+    }
+    if (p >= end || *p != '(') {
+        return NULL;
+    }
+    
+    if (row) {
+        array_init(row);
+    }
+    item = ++p;
+    while (p < end) {
+        switch (*p) {
+            case '\'': case '"': case '`':
+                p = (next = skip_quoted(p, end)) ? next : end;
+                continue;
+            case '#': case '-': case '/':
+                if ((next = skip_comment(p, end)) != p) {
+                    p = next ? next : end;
+                    continue;
+                }
+                break;
+            case '(':
+                depth++;
+                break;
+            case ')':
+                if (--depth > 0) break;
+                /* "()" is a row of defaults, not one empty item */
+                if (row && (zend_hash_num_elements(Z_ARRVAL_P(row)) > 0 || skip_noise(item, p) < p)) {
+                    add_row_item(row, item, p, spans_base);
+                }
+                return p + 1;
+            case ',':
+                if (depth == 1) {
+                    if (row) add_row_item(row, item, p, spans_base);
+                    item = p + 1;
+                }
+                break;
+        }
+        p++;
+    }
+    
+    /* Unterminated: hand out what there is */
+    if (row && skip_noise(item, end) < end) {
+        add_row_item(row, item, end, spans_base);
+    }
+    return end;
+}
+
+/* The byte after the last tuple of the VALUES list at p */
+static const char* insert_values_end(const char *p, const char *end) {
+    const char *next;
+    
+    while ((next = insert_row_next(p, end, NULL, NULL)) != NULL) {
+        p = next;
+    }
+    return p;
+}
+
+static zend_always_inline int is_keyword(const mysql_token *token, int keyword) {
+    return token->type == TOKEN_KEYWORD && token->keyword == keyword;
+}
+
+/* Move token past a parenthesized group whose '(' it is on; returns the end of the group */
+static const char* skip_group(mysql_lexer *lexer, mysql_token *token) {
+    const char *group_end;
+    int depth = 0;
+    
+    do {
+        if (token->type == TOKEN_LPAREN) depth++;
+        else if (token->type == TOKEN_RPAREN) depth--;
+        group_end = token->start + token->length;
+        mysql_lexer_next(lexer, token);
+    } while (depth > 0 && token->type != TOKEN_EOF && token->type != TOKEN_ERROR);
+    return group_end;
+}
+
+/* Move token to the ON of a top-level ON DUPLICATE KEY UPDATE, or to the end of the statement */
+static void find_on_duplicate(mysql_lexer *lexer, mysql_token *token) {
+    int depth = 0;
+    
+    while (token->type != TOKEN_EOF && token->type != TOKEN_ERROR) {
+        if (token->type == TOKEN_LPAREN) {
+            depth++;
+        } else if (token->type == TOKEN_RPAREN) {
+            if (depth > 0) depth--;
+        } else if (depth == 0 && token->type == TOKEN_SEMICOLON) {
+            return;
+        } else if (depth == 0 && is_keyword(token, MYSQL_KW_ON)) {
+            mysql_lexer peek = *lexer;
+            mysql_token next;
+            if (mysql_lexer_next(&peek, &next) == TOKEN_KEYWORD && next.keyword == MYSQL_KW_DUPLICATE) {
+                return;
+            }
+        }
+        mysql_lexer_next(lexer, token);
+    }
+}
+
+/* The item list of "(a, b, c)", token on the '('; leaves token after the ')' */
+static void parse_column_list(query_components *components, mysql_lexer *lexer, mysql_token *token, zval *columns) {
+    const char *item = NULL, *item_end = NULL;
+    int depth = 0;
+    
+    for (;;) {
+        mysql_lexer_next(lexer, token);
+        if (token->type == TOKEN_EOF || token->type == TOKEN_ERROR) {
+            return;
+        }
+        if (token->type == TOKEN_LPAREN) {
+            depth++;
+        } else if (token->type == TOKEN_RPAREN && depth > 0) {
+            depth--;
+        } else if (depth == 0 && (token->type == TOKEN_COMMA || token->type == TOKEN_RPAREN)) {
+            if (item) {
+                component_append_text(components, columns, item, item_end - item);
+            }
+            if (token->type == TOKEN_RPAREN) {
+                mysql_lexer_next(lexer, token);
+                return;
+            }
+            item = NULL;
+            continue;
+        }
+        if (!item) item = token->start;
+        item_end = token->start + token->length;
+    }
+}
+
+/* "col = expr" of INSERT ... SET: the column goes to fields, the expression to the row */
+static void add_assignment(query_components *components, const char *start, const char *end, zval *row) {
+    const char *eq = NULL, *p = start, *next;
+    
+    while (p < end && !eq) {
+        switch (*p) {
+            case '\'': case '"': case '`':
+                p = (next = skip_quoted(p, end)) ? next : end;
+                continue;
+            case '=':
+                eq = p;
+                continue;
+        }
+        p++;
+    }
+    if (!eq) {
+        component_append_text(components, row, start, end - start);
+        return;
+    }
+    
+    next = eq;
+    while (next > start && isspace((unsigned char) *(next - 1))) next--;
+    component_append_text(components, &components->fields, start, next - start);
+    for (eq++; eq < end && isspace((unsigned char) *eq); eq++);
+    component_append_text(components, row, eq, end - eq);
+}
+
+/*
+ * Decompose INSERT or REPLACE into the target table, the column list, the
+ * rows and the ON DUPLICATE KEY UPDATE assignments. A VALUES list is not
+ * materialized: "values" becomes a MysqlQp\InsertRows over the query's own
+ * bytes that parses one row per iteration. INSERT ... SET gives a single row
+ * array, and INSERT ... SELECT/TABLE leaves the source statement as text.
+ */
+int extract_insert_components(zend_string *query, query_components *components) {
+    const char *sql = ZSTR_VAL(query), *end = sql + ZSTR_LEN(query);
+    const char *table = NULL, *table_end = NULL, *alias = NULL, *alias_end = NULL, *start;
+    mysql_lexer lexer, peek;
+    mysql_token token, next;
+    zval table_info, value;
+    
+    mysql_lexer_init(&lexer, sql, ZSTR_LEN(query), 0);
+    mysql_lexer_next(&lexer, &token);
+    components->type = type_names[is_keyword(&token, MYSQL_KW_REPLACE) ? DECOMPOSED_REPLACE : DECOMPOSED_INSERT];
+    
+    do {
+        mysql_lexer_next(&lexer, &token);
+    } while (is_keyword(&token, MYSQL_KW_LOW_PRIORITY) || is_keyword(&token, MYSQL_KW_DELAYED) ||
+             is_keyword(&token, MYSQL_KW_HIGH_PRIORITY) || is_keyword(&token, MYSQL_KW_IGNORE) ||
+             is_keyword(&token, MYSQL_KW_INTO));
+    
+    if (token.type == TOKEN_EOF || token.type == TOKEN_ERROR) {
+        return FAILURE;
+    }
+    
+    /* Table, possibly schema-qualified */
+    table = token.start;
+    table_end = token.start + token.length;
+    for (;;) {
+        peek = lexer;
+        if (mysql_lexer_next(&peek, &next) != TOKEN_DOT || mysql_lexer_next(&peek, &next) == TOKEN_EOF) {
+            break;
+        }
+        table_end = next.start + next.length;
+        lexer = peek;
+    }
+    mysql_lexer_next(&lexer, &token);
+    
+    if (is_keyword(&token, MYSQL_KW_PARTITION)) {
+        mysql_lexer_next(&lexer, &token);
+        skip_group(&lexer, &token);
+    }
+    
+    /* Column list, unless the parenthesis opens the source query */
+    if (token.type == TOKEN_LPAREN) {
+        peek = lexer;
+        mysql_lexer_next(&peek, &next);
+        if (!is_keyword(&next, MYSQL_KW_SELECT) && !is_keyword(&next, MYSQL_KW_WITH) &&
+            !is_keyword(&next, MYSQL_KW_TABLE) && !is_keyword(&next, MYSQL_KW_VALUES) && next.type != TOKEN_LPAREN) {
+            parse_column_list(components, &lexer, &token, &components->fields);
+        }
+    }
+    
+    if (is_keyword(&token, MYSQL_KW_VALUES) || is_keyword(&token, MYSQL_KW_VALUE)) {
+        const char *rows = token.start + token.length;
+        const char *rows_end = insert_values_end(rows, end);
         
-        size_t tables_len = end_pos - from_pos - 4; /* Skip "FROM" */
-        char *tables_str = estrndup(from_pos + 4, tables_len);
-        parse_table_list(tables_str, components->tables);
-        efree(tables_str);
-    }
-    
-    /* Extract WHERE clause */
-    if (where_pos) {
-        const char *end_pos = group_pos;
-        if (!end_pos) end_pos = order_pos;
-        if (!end_pos) end_pos = limit_pos;
-        if (!end_pos) end_pos = query + strlen(query);
+        mysql_insert_rows_init(&components->values, query, rows - sql, rows_end - sql, components->spans_base != NULL);
         
-        size_t where_len = end_pos - where_pos - 5; /* Skip "WHERE" */
-        char *where_str = estrndup(where_pos + 5, where_len);
-        add_next_index_string(components->where_conditions, where_str);
-        efree(where_str);
+        /* Row alias: VALUES (...) AS new [(a, b)] */
+        mysql_lexer_init(&lexer, rows_end, end - rows_end, 0);
+        mysql_lexer_next(&lexer, &token);
+        if (is_keyword(&token, MYSQL_KW_AS)) {
+            mysql_lexer_next(&lexer, &token);
+            alias = token.start;
+            alias_end = token.start + token.length;
+            mysql_lexer_next(&lexer, &token);
+            if (token.type == TOKEN_LPAREN) {
+                /* Column aliases stay with the row alias */
+                alias_end = skip_group(&lexer, &token);
+            }
+        }
+    } else if (is_keyword(&token, MYSQL_KW_SET)) {
+        clause_scan scan;
+        zval row;
+        
+        start = token.start + token.length;
+        mysql_lexer_next(&lexer, &token);
+        find_on_duplicate(&lexer, &token);
+        
+        ZVAL_EMPTY_ARRAY(&row);
+        clause_scan_run(&scan, start, token.start - start);
+        split_list(components, &scan, start, scan.end - start, &row, add_assignment);
+        clause_scan_free(&scan);
+        if (Z_REFCOUNTED(row)) {
+            component_append(&components->values, &row);
+        }
+    } else if (token.type != TOKEN_EOF && token.type != TOKEN_ERROR && token.type != TOKEN_SEMICOLON) {
+        const char *source_end;
+        
+        start = token.start;
+        find_on_duplicate(&lexer, &token);
+        for (source_end = token.start; source_end > start && isspace((unsigned char) *(source_end - 1)); source_end--);
+        component_text(components, start, source_end - start, &components->values);
     }
     
-    /* Extract ORDER BY */
-    if (order_pos) {
-        const char *end_pos = limit_pos;
-        if (!end_pos) end_pos = query + strlen(query);
+    if (is_keyword(&token, MYSQL_KW_ON)) {
+        clause_scan scan;
         
-        size_t order_len = end_pos - order_pos - 8; /* Skip "ORDER BY" */
-        char *order_str = estrndup(order_pos + 8, order_len);
-        add_next_index_string(components->order_by, order_str);
-        efree(order_str);
+        mysql_lexer_next(&lexer, &token);       /* DUPLICATE */
+        mysql_lexer_next(&lexer, &token);       /* KEY */
+        mysql_lexer_next(&lexer, &token);       /* UPDATE */
+        if (is_keyword(&token, MYSQL_KW_UPDATE)) {
+            start = token.start + token.length;
+            clause_scan_run(&scan, start, end - start);
+            split_list(components, &scan, start, scan.end - start, &components->on_duplicate, add_field);
+            clause_scan_free(&scan);
+        }
     }
     
-    /* Extract LIMIT */
-    if (limit_pos) {
-        const char *end_pos = query + strlen(query);
-        size_t limit_len = end_pos - limit_pos - 5; /* Skip "LIMIT" */
-        char *limit_str = estrndup(limit_pos + 5, limit_len);
-        add_next_index_string(components->limit_clause, limit_str);
-        efree(limit_str);
+    array_init_size(&table_info, 2);
+    zend_hash_real_init_mixed(Z_ARRVAL(table_info));
+    component_text(components, table, table_end - table, &value);
+    _zend_hash_append(Z_ARRVAL(table_info), query_component_keys[COMPONENT_TABLE], &value);
+    if (alias) {
+        component_text(components, alias, alias_end - alias, &value);
+    } else {
+        component_text(components, table_end, 0, &value);
     }
+    _zend_hash_append(Z_ARRVAL(table_info), query_component_keys[COMPONENT_ALIAS], &value);
+    component_append(&components->tables, &table_info);
     
     return SUCCESS;
 }
 
-/* Main query decomposition function */
-query_components* mysql_decompose_query(const char *query, size_t query_len) {
-    query_components *components = init_query_components();
-    
+/* Main query decomposition function; components must have been initialized */
+void mysql_decompose_query(zend_string *query, int flags, query_components *components) {
     /* Determine query type and extract components accordingly */
-    int query_type = mysql_get_query_type(query);
+    int query_type = mysql_get_query_type(ZSTR_VAL(query), ZSTR_LEN(query));
+    
+    if (flags & MYSQL_QP_SPANS) {
+        components->spans_base = ZSTR_VAL(query);
+    }
     
     switch (query_type) {
         case QUERY_TYPE_SELECT:
-            extract_select_components(query, components);
+            /* WITH, TABLE, VALUES and (SELECT ...) keep their type and no clauses */
+            if (!mysql_is_plain_select(ZSTR_VAL(query), ZSTR_LEN(query))) {
+                components->type = mysql_decomposed_type(query_type);
+                break;
+            }
+            extract_select_components(ZSTR_VAL(query), ZSTR_LEN(query), components);
             break;
         case QUERY_TYPE_INSERT:
-            // TODO: Implement INSERT extraction
-            components->type = estrdup("INSERT");
+        case QUERY_TYPE_REPLACE:
+            extract_insert_components(query, components);
             break;
         case QUERY_TYPE_UPDATE:
             // TODO: Implement UPDATE extraction  
-            components->type = estrdup("UPDATE");
-            break;
         case QUERY_TYPE_DELETE:
             // TODO: Implement DELETE extraction
-            components->type = estrdup("DELETE");
-            break;
         default:
-            components->type = estrdup("UNKNOWN");
+            components->type = mysql_decomposed_type(query_type);
     }
-    
-    return components;
 }
 
 /* Build SELECT query from components - SAFE VERSION */
@@ -279,11 +981,11 @@ char* build_select_query(query_components *components) {
     smart_str_appends(&str, "SELECT ");
     
     /* Add fields */
-    if (Z_TYPE_P(components->fields) == IS_ARRAY) {
+    if (Z_TYPE(components->fields) == IS_ARRAY && zend_hash_num_elements(Z_ARRVAL(components->fields)) > 0) {
         zval *field;
         int first = 1;
         
-        ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(components->fields), field) {
+        ZEND_HASH_FOREACH_VAL(Z_ARRVAL(components->fields), field) {
             if (!first) {
                 smart_str_appends(&str, ", ");
             }
@@ -297,13 +999,13 @@ char* build_select_query(query_components *components) {
     }
     
     /* Add FROM clause */
-    if (Z_TYPE_P(components->tables) == IS_ARRAY && zend_hash_num_elements(Z_ARRVAL_P(components->tables)) > 0) {
+    if (Z_TYPE(components->tables) == IS_ARRAY && zend_hash_num_elements(Z_ARRVAL(components->tables)) > 0) {
         smart_str_appends(&str, " FROM ");
         
         zval *table;
         int first = 1;
         
-        ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(components->tables), table) {
+        ZEND_HASH_FOREACH_VAL(Z_ARRVAL(components->tables), table) {
             if (!first) {
                 smart_str_appends(&str, ", ");
             }
@@ -325,11 +1027,40 @@ char* build_select_query(query_components *components) {
     }
     
     /* Add WHERE clause */
-    if (Z_TYPE_P(components->where_conditions) == IS_ARRAY && zend_hash_num_elements(Z_ARRVAL_P(components->where_conditions)) > 0) {
+    if (Z_TYPE(components->where_conditions) == IS_ARRAY && zend_hash_num_elements(Z_ARRVAL(components->where_conditions)) > 0) {
         smart_str_appends(&str, " WHERE");
         
         zval *condition;
-        ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(components->where_conditions), condition) {
+        ZEND_HASH_FOREACH_VAL(Z_ARRVAL(components->where_conditions), condition) {
+            if (Z_TYPE_P(condition) == IS_STRING) {
+                smart_str_appends(&str, Z_STRVAL_P(condition));
+            }
+            break; /* For now, just use the first condition */
+        } ZEND_HASH_FOREACH_END();
+    }
+    
+    /* Add GROUP BY clause */
+    if (Z_TYPE(components->group_by) == IS_ARRAY && zend_hash_num_elements(Z_ARRVAL(components->group_by)) > 0) {
+        zval *group;
+        int first = 1;
+        
+        smart_str_appends(&str, " GROUP BY ");
+        ZEND_HASH_FOREACH_VAL(Z_ARRVAL(components->group_by), group) {
+            if (Z_TYPE_P(group) != IS_STRING) continue;
+            if (!first) {
+                smart_str_appends(&str, ", ");
+            }
+            smart_str_appends(&str, Z_STRVAL_P(group));
+            first = 0;
+        } ZEND_HASH_FOREACH_END();
+    }
+    
+    /* Add HAVING clause */
+    if (Z_TYPE(components->having) == IS_ARRAY && zend_hash_num_elements(Z_ARRVAL(components->having)) > 0) {
+        smart_str_appends(&str, " HAVING");
+        
+        zval *condition;
+        ZEND_HASH_FOREACH_VAL(Z_ARRVAL(components->having), condition) {
             if (Z_TYPE_P(condition) == IS_STRING) {
                 smart_str_appends(&str, Z_STRVAL_P(condition));
             }
@@ -338,11 +1069,11 @@ char* build_select_query(query_components *components) {
     }
     
     /* Add ORDER BY clause */
-    if (Z_TYPE_P(components->order_by) == IS_ARRAY && zend_hash_num_elements(Z_ARRVAL_P(components->order_by)) > 0) {
+    if (Z_TYPE(components->order_by) == IS_ARRAY && zend_hash_num_elements(Z_ARRVAL(components->order_by)) > 0) {
         smart_str_appends(&str, " ORDER BY");
         
         zval *order;
-        ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(components->order_by), order) {
+        ZEND_HASH_FOREACH_VAL(Z_ARRVAL(components->order_by), order) {
             if (Z_TYPE_P(order) == IS_STRING) {
                 smart_str_appends(&str, Z_STRVAL_P(order));
             }
@@ -351,11 +1082,11 @@ char* build_select_query(query_components *components) {
     }
     
     /* Add LIMIT clause */
-    if (Z_TYPE_P(components->limit_clause) == IS_ARRAY && zend_hash_num_elements(Z_ARRVAL_P(components->limit_clause)) > 0) {
+    if (Z_TYPE(components->limit_clause) == IS_ARRAY && zend_hash_num_elements(Z_ARRVAL(components->limit_clause)) > 0) {
         smart_str_appends(&str, " LIMIT");
         
         zval *limit;
-        ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(components->limit_clause), limit) {
+        ZEND_HASH_FOREACH_VAL(Z_ARRVAL(components->limit_clause), limit) {
             if (Z_TYPE_P(limit) == IS_STRING) {
                 smart_str_appends(&str, Z_STRVAL_P(limit));
             }
@@ -380,18 +1111,103 @@ char* build_select_query(query_components *components) {
     }
 }
 
+static void append_list(smart_str *str, HashTable *list) {
+    zval *item;
+    int first = 1;
+    
+    ZEND_HASH_FOREACH_VAL(list, item) {
+        if (Z_TYPE_P(item) != IS_STRING) continue;
+        if (!first) {
+            smart_str_appends(str, ", ");
+        }
+        smart_str_append(str, Z_STR_P(item));
+        first = 0;
+    } ZEND_HASH_FOREACH_END();
+}
+
+/* Build INSERT or REPLACE; rows still in a MysqlQp\InsertRows are copied from the query as they are */
+char* build_insert_query(query_components *components) {
+    smart_str str = {0};
+    zval *table, *name, *alias = NULL, *row;
+    const char *rows;
+    size_t rows_len;
+    char *result;
+    
+    smart_str_append(&str, components->type);
+    smart_str_appends(&str, " INTO ");
+    
+    if (Z_TYPE(components->tables) == IS_ARRAY && (table = zend_hash_index_find(Z_ARRVAL(components->tables), 0)) &&
+        Z_TYPE_P(table) == IS_ARRAY) {
+        name = zend_hash_find(Z_ARRVAL_P(table), query_component_keys[COMPONENT_TABLE]);
+        alias = zend_hash_find(Z_ARRVAL_P(table), query_component_keys[COMPONENT_ALIAS]);
+        if (name && Z_TYPE_P(name) == IS_STRING) {
+            smart_str_append(&str, Z_STR_P(name));
+        }
+    }
+    
+    if (Z_TYPE(components->fields) == IS_ARRAY && zend_hash_num_elements(Z_ARRVAL(components->fields)) > 0) {
+        smart_str_appends(&str, " (");
+        append_list(&str, Z_ARRVAL(components->fields));
+        smart_str_appendc(&str, ')');
+    }
+    
+    if (mysql_insert_rows_text(&components->values, &rows, &rows_len) == SUCCESS) {
+        while (rows_len > 0 && isspace((unsigned char) *rows)) {
+            rows++;
+            rows_len--;
+        }
+        smart_str_appends(&str, " VALUES ");
+        smart_str_appendl(&str, rows, rows_len);
+    } else if (Z_TYPE(components->values) == IS_ARRAY && zend_hash_num_elements(Z_ARRVAL(components->values)) > 0) {
+        int first = 1;
+        
+        smart_str_appends(&str, " VALUES ");
+        ZEND_HASH_FOREACH_VAL(Z_ARRVAL(components->values), row) {
+            if (Z_TYPE_P(row) != IS_ARRAY) continue;
+            if (!first) {
+                smart_str_appends(&str, ", ");
+            }
+            smart_str_appendc(&str, '(');
+            append_list(&str, Z_ARRVAL_P(row));
+            smart_str_appendc(&str, ')');
+            first = 0;
+        } ZEND_HASH_FOREACH_END();
+    } else if (Z_TYPE(components->values) == IS_STRING) {
+        smart_str_appendc(&str, ' ');
+        smart_str_append(&str, Z_STR(components->values));
+    }
+    
+    if (alias && Z_TYPE_P(alias) == IS_STRING && Z_STRLEN_P(alias) > 0) {
+        smart_str_appends(&str, " AS ");
+        smart_str_append(&str, Z_STR_P(alias));
+    }
+    
+    if (Z_TYPE(components->on_duplicate) == IS_ARRAY && zend_hash_num_elements(Z_ARRVAL(components->on_duplicate)) > 0) {
+        smart_str_appends(&str, " ON DUPLICATE KEY UPDATE ");
+        append_list(&str, Z_ARRVAL(components->on_duplicate));
+    }
+    
+    smart_str_0(&str);
+    result = estrndup(ZSTR_VAL(str.s), ZSTR_LEN(str.s));
+    smart_str_free(&str);
+    return result;
+}
+
 /* Main query reconstruction function */
 char* mysql_reconstruct_query(query_components *components) {
     if (!components || !components->type) {
         return estrdup("/* Invalid components */");
     }
     
-    if (strcmp(components->type, "SELECT") == 0) {
+    if (zend_string_equals_literal(components->type, "SELECT")) {
         return build_select_query(components);
     }
+    if (zend_string_equals_literal(components->type, "INSERT") || zend_string_equals_literal(components->type, "REPLACE")) {
+        return build_insert_query(components);
+    }
     
     /* Fallback for unsupported types */
     char *fallback = emalloc(256);
-    snprintf(fallback, 256, "/* %s query reconstruction not yet implemented */", components->type);
+    snprintf(fallback, 256, "/* %s query reconstruction not yet implemented */", ZSTR_VAL(components->type));
     return fallback;
 }
\ No newline at end of file
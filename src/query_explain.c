@@ -0,0 +1,176 @@
+#include "php.h"
+#include "zend_smart_str.h"
+#include "ext/json/php_json.h"
+#include "../include/php_mysql_qp.h"
+#include "../include/mysql_query_parser.h"
+#include "../include/query_explain.h"
+#include "../include/query_stats.h"
+#include <mysql.h>
+#include <string.h>
+
+/* Run EXPLAIN FORMAT=JSON over the parser connection; NULL on failure */
+zend_string* mysql_explain_real(const char *query, size_t query_len, int *error_code, char **error_message) {
+    MYSQL *parser_mysql;
+    MYSQL_RES *res;
+    MYSQL_ROW row;
+    zend_string *json = NULL;
+    smart_str sql = {0};
+    unsigned int server_error;
+    zend_hrtime_t start, elapsed;
+    int status;
+
+    *error_code = 0;
+    *error_message = NULL;
+
+    if (mysql_connect_parser() != SUCCESS) {
+        *error_message = estrdup("Could not connect to MySQL for EXPLAIN");
+        return NULL;
+    }
+    parser_mysql = MYSQL_QP_G(parser_lease).conn;
+
+    smart_str_appends(&sql, "EXPLAIN FORMAT=JSON ");
+    smart_str_appendl(&sql, query, query_len);
+    smart_str_0(&sql);
+
+    MYSQL_QP_PROBE2(explain__start, query, query_len);
+    start = zend_hrtime();
+    status = mysql_real_query(parser_mysql, ZSTR_VAL(sql.s), ZSTR_LEN(sql.s));
+    elapsed = mysql_qp_stats_round_trip(MYSQL_QP_STAT_EXPLAIN, start);
+    MYSQL_QP_PROBE4(explain__done, query, query_len, status == 0 ? 0 : mysql_errno(parser_mysql), elapsed);
+
+    if (status != 0) {
+        server_error = mysql_errno(parser_mysql);
+        *error_message = estrdup(mysql_error(parser_mysql));
+        if (mysql_is_connection_error(server_error)) {
+            /* Reconnect on the next call; the statement itself wasn't judged */
+            mysql_disconnect_parser();
+        } else {
+            *error_code = server_error;
+        }
+        smart_str_free(&sql);
+        return NULL;
+    }
+    smart_str_free(&sql);
+
+    if ((res = mysql_store_result(parser_mysql))) {
+        if ((row = mysql_fetch_row(res)) && row[0]) {
+            json = zend_string_init(row[0], mysql_fetch_lengths(res)[0], 0);
+        }
+        mysql_free_result(res);
+    }
+    if (!json) {
+        *error_message = estrdup("EXPLAIN returned no plan");
+    }
+    return json;
+}
+
+/* Flattened plan */
+
+static double cost_value(HashTable *node, const char *name) {
+    zval *value = zend_hash_str_find(node, name, strlen(name));
+    return value ? zval_get_double(value) : 0.0;
+}
+
+static void add_table(zval *tables, HashTable *table, zend_bool *full_scan) {
+    zval entry, *value, *cost_info;
+
+    array_init_size(&entry, 7);
+
+    value = zend_hash_str_find(table, "table_name", sizeof("table_name") - 1);
+    if (value && Z_TYPE_P(value) == IS_STRING) {
+        add_assoc_str(&entry, "table", zend_string_copy(Z_STR_P(value)));
+    } else {
+        add_assoc_null(&entry, "table");
+    }
+
+    value = zend_hash_str_find(table, "access_type", sizeof("access_type") - 1);
+    if (value && Z_TYPE_P(value) == IS_STRING) {
+        add_assoc_str(&entry, "access_type", zend_string_copy(Z_STR_P(value)));
+        if (zend_string_equals_literal(Z_STR_P(value), "ALL")) {
+            *full_scan = 1;
+        }
+    } else {
+        add_assoc_null(&entry, "access_type");
+    }
+
+    value = zend_hash_str_find(table, "key", sizeof("key") - 1);
+    if (value && Z_TYPE_P(value) == IS_STRING) {
+        add_assoc_str(&entry, "key", zend_string_copy(Z_STR_P(value)));
+    } else {
+        add_assoc_null(&entry, "key");
+    }
+
+    value = zend_hash_str_find(table, "rows_examined_per_scan", sizeof("rows_examined_per_scan") - 1);
+    add_assoc_long(&entry, "rows_examined_per_scan", value ? zval_get_long(value) : 0);
+    value = zend_hash_str_find(table, "rows_produced_per_join", sizeof("rows_produced_per_join") - 1);
+    add_assoc_long(&entry, "rows_produced_per_join", value ? zval_get_long(value) : 0);
+    add_assoc_double(&entry, "filtered", cost_value(table, "filtered"));
+
+    cost_info = zend_hash_str_find(table, "cost_info", sizeof("cost_info") - 1);
+    add_assoc_double(&entry, "prefix_cost",
+                     cost_info && Z_TYPE_P(cost_info) == IS_ARRAY ? cost_value(Z_ARRVAL_P(cost_info), "prefix_cost") : 0.0);
+
+    add_next_index_zval(tables, &entry);
+}
+
+/*
+ * Collect every "table" object and the filesort/temporary flags wherever they
+ * sit: directly under query_block, in nested_loop, ordering_operation,
+ * grouping_operation, or inside materialized and attached subqueries.
+ */
+static void flatten_node(HashTable *node, zval *tables, zend_bool *flags) {
+    zend_string *key;
+    zval *value;
+
+    ZEND_HASH_FOREACH_STR_KEY_VAL(node, key, value) {
+        if (Z_TYPE_P(value) == IS_TRUE && key) {
+            if (zend_string_equals_literal(key, "using_filesort")) flags[0] = 1;
+            else if (zend_string_equals_literal(key, "using_temporary_table")) flags[1] = 1;
+            continue;
+        }
+        if (Z_TYPE_P(value) != IS_ARRAY) continue;
+
+        if (key && zend_string_equals_literal(key, "table")) {
+            add_table(tables, Z_ARRVAL_P(value), &flags[2]);
+        }
+        flatten_node(Z_ARRVAL_P(value), tables, flags);
+    } ZEND_HASH_FOREACH_END();
+}
+
+/* Decode EXPLAIN JSON into the full tree, or the flattened plan when tree is false */
+int mysql_explain_decode(const char *json, size_t json_len, zend_bool tree, zval *plan) {
+    zval decoded, tables, *query_block, *cost_info;
+    zend_bool flags[3] = {0, 0, 0};     /* filesort, temporary table, full scan */
+
+    /* The parser builds arrays straight from the row buffer */
+    if (php_json_decode_ex(&decoded, json, json_len, PHP_JSON_OBJECT_AS_ARRAY, PHP_JSON_PARSER_DEFAULT_DEPTH) != SUCCESS ||
+        Z_TYPE(decoded) != IS_ARRAY) {
+        zval_ptr_dtor(&decoded);
+        return FAILURE;
+    }
+
+    if (tree) {
+        ZVAL_COPY_VALUE(plan, &decoded);
+        return SUCCESS;
+    }
+
+    array_init(&tables);
+    flatten_node(Z_ARRVAL(decoded), &tables, flags);
+
+    array_init_size(plan, 5);
+    query_block = zend_hash_str_find(Z_ARRVAL(decoded), "query_block", sizeof("query_block") - 1);
+    cost_info = query_block && Z_TYPE_P(query_block) == IS_ARRAY
+        ? zend_hash_str_find(Z_ARRVAL_P(query_block), "cost_info", sizeof("cost_info") - 1) : NULL;
+    if (cost_info && Z_TYPE_P(cost_info) == IS_ARRAY) {
+        add_assoc_double(plan, "query_cost", cost_value(Z_ARRVAL_P(cost_info), "query_cost"));
+    } else {
+        add_assoc_null(plan, "query_cost");
+    }
+    add_assoc_bool(plan, "full_scan", flags[2]);
+    add_assoc_bool(plan, "using_filesort", flags[0]);
+    add_assoc_bool(plan, "using_temporary", flags[1]);
+    add_assoc_zval(plan, "tables", &tables);
+
+    zval_ptr_dtor(&decoded);
+    return SUCCESS;
+}
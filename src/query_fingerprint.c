@@ -0,0 +1,251 @@
+#include "php.h"
+#include "zend_smart_str.h"
+#include "ext/hash/php_hash_sha.h"
+#include "../include/php_mysql_qp.h"
+#include "../include/query_fingerprint.h"
+#include "../include/sql_lexer.h"
+#include <string.h>
+
+/*
+ * Statement fingerprints. Tokens come straight from the lexer (comments
+ * are already gone) and are written out one space apart: keywords upper
+ * case, identifiers back-quoted, literals as "?". A short history of the
+ * last tokens written lets value lists collapse the way MySQL's digest
+ * does: "?, ..." for lists, "(?)" or "(...)" for rows, and a trailing
+ * ", ..." comment for repeated rows.
+ */
+
+enum fp_kind {
+    FP_NONE = 0,
+    FP_OTHER,
+    FP_OPERAND,         /* identifier, variable or ")" */
+    FP_SIGN,            /* "+" or "-", unary unless it follows an operand */
+    FP_COMMA,
+    FP_LPAREN,
+    FP_VALUE,
+    FP_VALUE_LIST,
+    FP_ROW_SINGLE,
+    FP_ROW_SINGLE_LIST,
+    FP_ROW_MULTI,
+    FP_ROW_MULTI_LIST
+};
+
+#define FP_HISTORY 8
+
+typedef struct {
+    smart_str text;
+    struct {
+        enum fp_kind kind;
+        size_t offset;      /* length of text before this token was written */
+    } history[FP_HISTORY];
+    int depth;
+} fp_state;
+
+static enum fp_kind fp_peek(const fp_state *st, int back) {
+    return st->depth > back ? st->history[st->depth - 1 - back].kind : FP_NONE;
+}
+
+static int fp_is_operand(enum fp_kind kind) {
+    return kind == FP_OPERAND || kind >= FP_VALUE;
+}
+
+static void fp_push(fp_state *st, enum fp_kind kind, const char *text, size_t len) {
+    size_t offset = st->text.s ? ZSTR_LEN(st->text.s) : 0;
+
+    if (st->depth == FP_HISTORY) {
+        memmove(st->history, st->history + 1, sizeof(st->history[0]) * (FP_HISTORY - 1));
+        st->depth--;
+    }
+    st->history[st->depth].kind = kind;
+    st->history[st->depth].offset = offset;
+    st->depth++;
+
+    if (offset > 0) {
+        smart_str_appendc(&st->text, ' ');
+    }
+    smart_str_appendl(&st->text, text, len);
+}
+
+/* Drop the last count tokens from the text; callers peek first, so they exist */
+static void fp_pop(fp_state *st, int count) {
+    st->depth -= count;
+    ZSTR_LEN(st->text.s) = st->history[st->depth].offset;
+}
+
+static void fp_value(fp_state *st) {
+    /* Fold unary signs into the literal: "= -1" and "(-1" become "= ?" and "(?" */
+    if (fp_peek(st, 0) == FP_SIGN && !fp_is_operand(fp_peek(st, 1))) {
+        fp_pop(st, 1);
+    }
+    if (fp_peek(st, 0) == FP_COMMA && (fp_peek(st, 1) == FP_VALUE || fp_peek(st, 1) == FP_VALUE_LIST)) {
+        fp_pop(st, 2);
+        fp_push(st, FP_VALUE_LIST, "?, ...", sizeof("?, ...") - 1);
+        return;
+    }
+    fp_push(st, FP_VALUE, "?", 1);
+}
+
+static void fp_rparen(fp_state *st) {
+    enum fp_kind row, list;
+
+    if (fp_peek(st, 1) != FP_LPAREN) {
+        fp_push(st, FP_OPERAND, ")", 1);
+        return;
+    }
+    if (fp_peek(st, 0) == FP_VALUE) {
+        row = FP_ROW_SINGLE;
+        list = FP_ROW_SINGLE_LIST;
+    } else if (fp_peek(st, 0) == FP_VALUE_LIST) {
+        row = FP_ROW_MULTI;
+        list = FP_ROW_MULTI_LIST;
+    } else {
+        fp_push(st, FP_OPERAND, ")", 1);
+        return;
+    }
+
+    fp_pop(st, 2);
+    if (fp_peek(st, 0) == FP_COMMA && (fp_peek(st, 1) == row || fp_peek(st, 1) == list)) {
+        fp_pop(st, 2);
+        if (list == FP_ROW_SINGLE_LIST) {
+            fp_push(st, list, "(?) /* , ... */", sizeof("(?) /* , ... */") - 1);
+        } else {
+            fp_push(st, list, "(...) /* , ... */", sizeof("(...) /* , ... */") - 1);
+        }
+    } else if (row == FP_ROW_SINGLE) {
+        fp_push(st, row, "(?)", 3);
+    } else {
+        fp_push(st, row, "(...)", 5);
+    }
+}
+
+/* Bare identifiers are back-quoted; called function names are folded to upper case instead */
+static void fp_identifier(fp_state *st, const mysql_token *token, int is_call) {
+    size_t start;
+
+    fp_push(st, FP_OPERAND, "`", is_call ? 0 : 1);
+    start = ZSTR_LEN(st->text.s);
+    smart_str_appendl(&st->text, token->start, token->length);
+    if (is_call) {
+        zend_str_toupper(ZSTR_VAL(st->text.s) + start, token->length);
+    } else {
+        smart_str_appendc(&st->text, '`');
+    }
+}
+
+/* A name before "(" is a function call, except where a table name can be followed by a column list */
+static int fp_is_call(int previous_keyword, const mysql_token *next) {
+    if (next->type != TOKEN_LPAREN) {
+        return 0;
+    }
+    switch (previous_keyword) {
+        case MYSQL_KW_INTO:
+        case MYSQL_KW_INSERT:
+        case MYSQL_KW_REPLACE:
+        case MYSQL_KW_TABLE:
+        case MYSQL_KW_REFERENCES:
+        case MYSQL_KW_RECURSIVE:
+        case MYSQL_KW_WITH:
+            return 0;
+        default:
+            return 1;
+    }
+}
+
+/* Normalize a statement and hash it; FAILURE if it doesn't tokenize */
+int mysql_compute_fingerprint(const char *query, size_t query_len, mysql_fingerprint *fingerprint) {
+    mysql_lexer lexer;
+    mysql_token token, next;
+    fp_state st;
+    PHP_SHA256_CTX context;
+    int previous_keyword = MYSQL_KEYWORD_NONE;
+
+    memset(&st, 0, sizeof(st));
+    mysql_lexer_init(&lexer, query, query_len, 0);
+    mysql_lexer_next(&lexer, &next);
+
+    while (next.type != TOKEN_EOF) {
+        token = next;
+        if (token.type == TOKEN_ERROR) {
+            smart_str_free(&st.text);
+            return FAILURE;
+        }
+        mysql_lexer_next(&lexer, &next);
+
+        switch (token.type) {
+            case TOKEN_STRING:
+            case TOKEN_HEX_STRING:
+            case TOKEN_BIT_STRING:
+            case TOKEN_INTEGER:
+            case TOKEN_DECIMAL:
+            case TOKEN_FLOAT:
+            case TOKEN_PLACEHOLDER:
+            case TOKEN_NAMED_PLACEHOLDER:
+                fp_value(&st);
+                break;
+
+            case TOKEN_KEYWORD:
+                if (token.keyword == MYSQL_KW_NULL || token.keyword == MYSQL_KW_TRUE || token.keyword == MYSQL_KW_FALSE) {
+                    fp_value(&st);
+                } else {
+                    const char *name = mysql_keyword_name(token.keyword);
+                    fp_push(&st, FP_OTHER, name, strlen(name));
+                }
+                break;
+
+            case TOKEN_IDENTIFIER:
+                fp_identifier(&st, &token, fp_is_call(previous_keyword, &next));
+                break;
+
+            case TOKEN_QUOTED_IDENTIFIER:
+            case TOKEN_VARIABLE:
+                fp_push(&st, FP_OPERAND, token.start, token.length);
+                break;
+
+            case TOKEN_LPAREN:
+                fp_push(&st, FP_LPAREN, "(", 1);
+                break;
+
+            case TOKEN_RPAREN:
+                fp_rparen(&st);
+                break;
+
+            case TOKEN_COMMA:
+                fp_push(&st, FP_COMMA, ",", 1);
+                break;
+
+            case TOKEN_OPERATOR:
+                fp_push(&st, token.length == 1 && (*token.start == '-' || *token.start == '+') ? FP_SIGN : FP_OTHER,
+                        token.start, token.length);
+                break;
+
+            case TOKEN_SEMICOLON:
+                /* A terminating semicolon doesn't change the statement */
+                if (next.type != TOKEN_EOF) {
+                    fp_push(&st, FP_OTHER, ";", 1);
+                }
+                break;
+
+            default:
+                fp_push(&st, FP_OTHER, token.start, token.length);
+                break;
+        }
+        previous_keyword = token.keyword;
+    }
+
+    fingerprint->text = smart_str_extract(&st.text);
+
+    PHP_SHA256Init(&context);
+    PHP_SHA256Update(&context, (const unsigned char *) ZSTR_VAL(fingerprint->text), ZSTR_LEN(fingerprint->text));
+    PHP_SHA256Final(fingerprint->digest, &context);
+    return SUCCESS;
+}
+
+/* The first 64 bits of the digest, as a signed integer usable as an array key */
+zend_long mysql_fingerprint_hash(const mysql_fingerprint *fingerprint) {
+    uint64_t hash = 0;
+
+    for (int i = 0; i < 8; i++) {
+        hash = (hash << 8) | fingerprint->digest[i];
+    }
+    return (zend_long) hash;
+}
@@ -0,0 +1,121 @@
+#include "php.h"
+#include "../include/php_mysql_qp.h"
+#include "../include/query_interpolate.h"
+#include "../include/sql_lexer.h"
+#include <string.h>
+
+/*
+ * Emulated prepares. Unlike a template, the SQL is used once, so nothing
+ * is compiled: a single lexer pass finds the placeholders (those inside
+ * literals and comments never come back as tokens), looks up and measures
+ * each value, and the result is then written into one buffer of the exact
+ * size.
+ */
+
+#define INTERPOLATE_STACK_SLOTS 16
+
+typedef struct {
+    size_t start;               /* of the placeholder in the SQL */
+    size_t length;
+    mysql_literal literal;
+} interpolate_slot;
+
+static const char* token_label(const mysql_token *token, uint32_t position, char *buf, size_t size) {
+    if (token->type == TOKEN_NAMED_PLACEHOLDER) {
+        snprintf(buf, size, "%.*s", (int) MIN(token->length, size - 1), token->start);
+    } else {
+        snprintf(buf, size, "%u", position);
+    }
+    return buf;
+}
+
+/* :name binds params["name"] or params[":name"]; each ? binds the next position from 0 */
+static zval* bound_value(HashTable *params, const mysql_token *token, uint32_t *position) {
+    zval *value;
+
+    if (token->type == TOKEN_PLACEHOLDER) {
+        return zend_hash_index_find(params, (*position)++);
+    }
+    if (!(value = zend_hash_str_find(params, token->start + 1, token->length - 1))) {
+        value = zend_hash_str_find(params, token->start, token->length);
+    }
+    return value;
+}
+
+/*
+ * Replace every placeholder in sql with its value as a literal escaped for
+ * charset, assuming the default sql_mode (backslash escapes on). Returns NULL
+ * with *error set when sql doesn't tokenize, or with an exception thrown when
+ * a value is missing or can't be a literal.
+ */
+zend_string* mysql_interpolate(zend_string *sql, HashTable *params, const mysql_charset *charset, const char **error) {
+    interpolate_slot stack_slots[INTERPOLATE_STACK_SLOTS], *slots = stack_slots;
+    uint32_t count = 0, capacity = INTERPOLATE_STACK_SLOTS, position = 0;
+    size_t total = ZSTR_LEN(sql), copied = 0;
+    zend_string *result = NULL;
+    mysql_lexer lexer;
+    mysql_token token;
+    char *out;
+
+    *error = NULL;
+    mysql_lexer_init(&lexer, ZSTR_VAL(sql), ZSTR_LEN(sql), 0);
+    while (mysql_lexer_next(&lexer, &token) != TOKEN_EOF) {
+        interpolate_slot *slot;
+        char label[64];
+        zval *value;
+
+        if (token.type == TOKEN_ERROR) {
+            *error = lexer.error;
+            goto done;
+        }
+        if (token.type != TOKEN_PLACEHOLDER && token.type != TOKEN_NAMED_PLACEHOLDER) {
+            continue;
+        }
+
+        if (!(value = bound_value(params, &token, &position))) {
+            zend_value_error("No value bound to placeholder %s", token_label(&token, position - 1, label, sizeof(label)));
+            goto done;
+        }
+        ZVAL_DEREF(value);
+
+        if (count == capacity) {
+            capacity *= 2;
+            if (slots == stack_slots) {
+                slots = safe_emalloc(capacity, sizeof(interpolate_slot), 0);
+                memcpy(slots, stack_slots, sizeof(stack_slots));
+            } else {
+                slots = safe_erealloc(slots, capacity, sizeof(interpolate_slot), 0);
+            }
+        }
+        slot = &slots[count];
+        if (mysql_literal_measure(&slot->literal, value, charset) != SUCCESS) {
+            mysql_literal_throw(value, token_label(&token, position - 1, label, sizeof(label)));
+            goto done;
+        }
+        slot->start = token.start - ZSTR_VAL(sql);
+        slot->length = token.length;
+        total += slot->literal.len - token.length;
+        count++;
+    }
+
+    if (count == 0) {
+        result = zend_string_copy(sql);
+        goto done;
+    }
+
+    result = zend_string_alloc(total, 0);
+    out = ZSTR_VAL(result);
+    for (uint32_t i = 0; i < count; i++) {
+        memcpy(out, ZSTR_VAL(sql) + copied, slots[i].start - copied);
+        out = mysql_literal_write(out + (slots[i].start - copied), &slots[i].literal, charset);
+        copied = slots[i].start + slots[i].length;
+    }
+    memcpy(out, ZSTR_VAL(sql) + copied, ZSTR_LEN(sql) - copied);
+    ZSTR_VAL(result)[total] = '\0';
+
+done:
+    if (slots != stack_slots) {
+        efree(slots);
+    }
+    return result;
+}
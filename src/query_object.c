@@ -0,0 +1,479 @@
+#include "php.h"
+#include "zend_smart_str.h"
+#include "../include/php_mysql_qp.h"
+#include "../include/query_decomposer.h"
+#include "../include/mysql_query_parser.h"
+#include "../include/insert_rows.h"
+#include "../include/query_object.h"
+#include <ctype.h>
+
+zend_class_entry *mysql_qp_query_ce;
+static zend_object_handlers query_handlers;
+
+/* Every top-level key, i.e. each clause has been built */
+#define QUERY_ALL_LOADED ((1u << COMPONENT_TABLE) - 1)
+
+/*
+ * The query string is shared with the caller. A SELECT is scanned for its
+ * clause boundaries once, up front; a clause array is built from the scan
+ * the first time its property is read and then kept in components.
+ */
+typedef struct {
+    zend_string *query;
+    int query_type;             /* QUERY_TYPE_* */
+    uint32_t loaded;            /* bit per COMPONENT_* already in components */
+    zend_bool modified;         /* a clause was replaced, so __toString() rebuilds */
+    zend_bool scanned;
+    clause_scan scan;
+    const char *unmodelled;     /* what a rebuild would lose, or NULL; see clause_scan_unmodelled() */
+    const char *tail;           /* locking clause a rebuild carries through verbatim */
+    size_t tail_len;
+    query_components components;
+    zend_object std;
+} query_object;
+
+static zend_always_inline query_object* query_from_obj(zend_object *obj) {
+    return (query_object *) ((char *) obj - XtOffsetOf(query_object, std));
+}
+
+/* Top-level key a property name refers to, or -1 */
+static int query_component_index(zend_string *name) {
+    for (int i = COMPONENT_TYPE; i < COMPONENT_TABLE; i++) {
+        if (zend_string_equals(name, query_component_keys[i])) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void query_object_init(query_object *object, zend_string *query) {
+    object->query = zend_string_copy(query);
+    object->query_type = mysql_get_query_type(ZSTR_VAL(query), ZSTR_LEN(query));
+    init_query_components(&object->components);
+    object->components.type = mysql_decomposed_type(object->query_type);
+    object->loaded = 1u << COMPONENT_TYPE;
+
+    switch (object->query_type) {
+        case QUERY_TYPE_SELECT:
+            if (!mysql_is_plain_select(ZSTR_VAL(query), ZSTR_LEN(query))) {
+                /* Not decomposed, and the SELECT builder would drop whatever comes before SELECT */
+                object->unmodelled = "a leading WITH, TABLE, VALUES or parenthesis";
+                object->loaded = QUERY_ALL_LOADED;
+                break;
+            }
+            clause_scan_run(&object->scan, ZSTR_VAL(query), ZSTR_LEN(query));
+            object->scanned = 1;
+            object->unmodelled = clause_scan_unmodelled(&object->scan, ZSTR_VAL(query), ZSTR_LEN(query),
+                                                        &object->tail, &object->tail_len);
+            break;
+        case QUERY_TYPE_INSERT:
+        case QUERY_TYPE_REPLACE:
+            break;
+        default:
+            /* Nothing else is decomposed, so every clause is already final */
+            object->loaded = QUERY_ALL_LOADED;
+    }
+}
+
+static void query_object_load(query_object *object, int component) {
+    query_components all;
+
+    if (object->loaded & (1u << component)) {
+        return;
+    }
+    if (object->scanned) {
+        extract_select_clause(&object->components, &object->scan, component);
+        object->loaded |= 1u << component;
+        return;
+    }
+
+    /* INSERT and REPLACE come out of a single lexer pass, so the first read builds them all */
+    init_query_components(&all);
+    extract_insert_components(object->query, &all);
+    for (int i = COMPONENT_FIELDS; i < COMPONENT_TABLE; i++) {
+        zval *clause = mysql_query_component(&object->components, i);
+
+        if (object->loaded & (1u << i)) {
+            /* Replaced by the caller before the first read */
+            zval_ptr_dtor(mysql_query_component(&all, i));
+        } else {
+            zval_ptr_dtor(clause);
+            ZVAL_COPY_VALUE(clause, mysql_query_component(&all, i));
+        }
+    }
+    object->loaded = QUERY_ALL_LOADED;
+}
+
+static void query_object_load_all(query_object *object) {
+    for (int i = COMPONENT_FIELDS; i < COMPONENT_TABLE && object->loaded != QUERY_ALL_LOADED; i++) {
+        query_object_load(object, i);
+    }
+}
+
+/* Replace a clause with a single text item, taking over text */
+static void query_object_set_text(query_object *object, int component, zend_string *text) {
+    zval *clause = mysql_query_component(&object->components, component);
+    zval item;
+
+    zval_ptr_dtor(clause);
+    array_init_size(clause, 1);
+    ZVAL_STR(&item, text);
+    zend_hash_next_index_insert_new(Z_ARRVAL_P(clause), &item);
+    object->loaded |= 1u << component;
+    object->modified = 1;
+}
+
+/* The same array mysql_decompose_query() returns; the clauses are shared, not copied */
+static void query_object_to_array(query_object *object, zval *array) {
+    query_components copy;
+
+    query_object_load_all(object);
+    init_query_components(&copy);
+    copy.type = object->components.type;
+    for (int i = COMPONENT_FIELDS; i < COMPONENT_TABLE; i++) {
+        ZVAL_COPY(mysql_query_component(&copy, i), mysql_query_component(&object->components, i));
+    }
+    mysql_query_components_to_zval(&copy, array);
+}
+
+/* Object handlers */
+
+static zend_object* query_create(zend_class_entry *ce) {
+    query_object *object = zend_object_alloc(sizeof(query_object), ce);
+
+    /* Stays uninitialized until __construct() runs */
+    memset(object, 0, XtOffsetOf(query_object, std));
+    zend_object_std_init(&object->std, ce);
+    object_properties_init(&object->std, ce);
+    object->std.handlers = &query_handlers;
+    return &object->std;
+}
+
+static void query_free(zend_object *obj) {
+    query_object *object = query_from_obj(obj);
+
+    if (object->query) {
+        mysql_free_query_components(&object->components);
+        if (object->scanned) {
+            clause_scan_free(&object->scan);
+        }
+        zend_string_release(object->query);
+    }
+    zend_object_std_dtor(obj);
+}
+
+/* Clauses already built are shared with the clone; both replace rather than modify them */
+static zend_object* query_clone(zend_object *old_obj) {
+    query_object *old = query_from_obj(old_obj);
+    zend_object *new_obj = query_create(old_obj->ce);
+    query_object *clone = query_from_obj(new_obj);
+
+    zend_objects_clone_members(new_obj, old_obj);
+    if (!old->query) {
+        return new_obj;
+    }
+    query_object_init(clone, old->query);
+    for (int i = COMPONENT_FIELDS; i < COMPONENT_TABLE; i++) {
+        if (old->loaded & (1u << i)) {
+            ZVAL_COPY(mysql_query_component(&clone->components, i), mysql_query_component(&old->components, i));
+        }
+    }
+    clone->loaded |= old->loaded;
+    clone->modified = old->modified;
+    return new_obj;
+}
+
+static zval* query_read_property(zend_object *obj, zend_string *name, int type, void **cache_slot, zval *rv) {
+    query_object *object = query_from_obj(obj);
+    int component = query_component_index(name);
+
+    if (component < 0 || !object->query) {
+        return zend_std_read_property(obj, name, type, cache_slot, rv);
+    }
+    if (type == BP_VAR_W || type == BP_VAR_RW || type == BP_VAR_UNSET) {
+        zend_error(E_NOTICE, "Indirect modification of overloaded property %s::$%s has no effect",
+                   ZSTR_VAL(obj->ce->name), ZSTR_VAL(name));
+    }
+    if (component == COMPONENT_TYPE) {
+        ZVAL_STR_COPY(rv, object->components.type);
+        return rv;
+    }
+    query_object_load(object, component);
+    ZVAL_COPY(rv, mysql_query_component(&object->components, component));
+    return rv;
+}
+
+static zval* query_write_property(zend_object *obj, zend_string *name, zval *value, void **cache_slot) {
+    query_object *object = query_from_obj(obj);
+    int component = query_component_index(name);
+    zval *clause;
+
+    if (component < 0 || !object->query) {
+        return zend_std_write_property(obj, name, value, cache_slot);
+    }
+    if (component == COMPONENT_TYPE) {
+        zend_throw_error(NULL, "Cannot modify %s::$type", ZSTR_VAL(obj->ce->name));
+        return &EG(error_zval);
+    }
+    if (object->unmodelled) {
+        zend_throw_error(NULL, "Cannot modify %s::$%s: the SELECT has %s, which a rebuild would lose",
+                         ZSTR_VAL(obj->ce->name), ZSTR_VAL(name), object->unmodelled);
+        return &EG(error_zval);
+    }
+    if (Z_TYPE_P(value) != IS_ARRAY &&
+        !(component == COMPONENT_VALUES && Z_TYPE_P(value) == IS_OBJECT && Z_OBJCE_P(value) == mysql_qp_insert_rows_ce)) {
+        zend_type_error("Cannot assign %s to property %s::$%s of type array",
+                        zend_zval_type_name(value), ZSTR_VAL(obj->ce->name), ZSTR_VAL(name));
+        return &EG(error_zval);
+    }
+
+    clause = mysql_query_component(&object->components, component);
+    zval_ptr_dtor(clause);
+    ZVAL_COPY(clause, value);
+    object->loaded |= 1u << component;
+    object->modified = 1;
+    return clause;
+}
+
+static int query_has_property(zend_object *obj, zend_string *name, int has_set_exists, void **cache_slot) {
+    query_object *object = query_from_obj(obj);
+    int component = query_component_index(name);
+
+    if (component < 0 || !object->query) {
+        return zend_std_has_property(obj, name, has_set_exists, cache_slot);
+    }
+    /* Clauses are never null */
+    if (has_set_exists != ZEND_PROPERTY_NOT_EMPTY || component == COMPONENT_TYPE) {
+        return 1;
+    }
+    query_object_load(object, component);
+    return zend_is_true(mysql_query_component(&object->components, component));
+}
+
+static void query_unset_property(zend_object *obj, zend_string *name, void **cache_slot) {
+    if (query_component_index(name) >= 0) {
+        zend_throw_error(NULL, "Cannot unset %s::$%s", ZSTR_VAL(obj->ce->name), ZSTR_VAL(name));
+        return;
+    }
+    zend_std_unset_property(obj, name, cache_slot);
+}
+
+/* No direct pointers into a clause: writes go through query_write_property() */
+static zval* query_get_property_ptr_ptr(zend_object *obj, zend_string *name, int type, void **cache_slot) {
+    if (query_component_index(name) >= 0) {
+        return NULL;
+    }
+    return zend_std_get_property_ptr_ptr(obj, name, type, cache_slot);
+}
+
+static HashTable* query_get_debug_info(zend_object *obj, int *is_temp) {
+    query_object *object = query_from_obj(obj);
+    zval array;
+
+    if (!object->query) {
+        *is_temp = 0;
+        return zend_std_get_properties(obj);
+    }
+    query_object_to_array(object, &array);
+    *is_temp = 1;
+    return Z_ARRVAL(array);
+}
+
+/* Methods */
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_query_construct, 0, 0, 1)
+    ZEND_ARG_TYPE_INFO(0, query, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_query_set_limit, 0, 1, IS_STATIC, 0)
+    ZEND_ARG_TYPE_INFO(0, count, IS_LONG, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, offset, IS_LONG, 0, "0")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_query_add_where, 0, 1, IS_STATIC, 0)
+    ZEND_ARG_TYPE_INFO(0, condition, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_query_to_array, 0, 0, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_query_to_string, 0, 0, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+static query_object* query_this(zval *this_ptr) {
+    query_object *object = query_from_obj(Z_OBJ_P(this_ptr));
+
+    if (!object->query) {
+        zend_throw_error(NULL, "MysqlQp\\Query object is not initialized");
+        return NULL;
+    }
+    return object;
+}
+
+/* Mutators rebuild through the SELECT builder, so they only take SELECTs it can rebuild whole */
+static query_object* query_this_select(zval *this_ptr, const char *method) {
+    query_object *object = query_this(this_ptr);
+
+    if (object && object->query_type != QUERY_TYPE_SELECT) {
+        zend_throw_error(NULL, "MysqlQp\\Query::%s() is only supported for SELECT queries", method);
+        return NULL;
+    }
+    if (object && object->unmodelled) {
+        zend_throw_error(NULL, "MysqlQp\\Query::%s() can't rebuild a SELECT with %s", method, object->unmodelled);
+        return NULL;
+    }
+    return object;
+}
+
+PHP_METHOD(MysqlQp_Query, __construct)
+{
+    zend_string *query;
+    query_object *object = query_from_obj(Z_OBJ_P(ZEND_THIS));
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_STR(query)
+    ZEND_PARSE_PARAMETERS_END();
+
+    if (object->query) {
+        zend_throw_error(NULL, "Cannot call MysqlQp\\Query::__construct() twice");
+        RETURN_THROWS();
+    }
+    query_object_init(object, query);
+}
+
+PHP_METHOD(MysqlQp_Query, setLimit)
+{
+    zend_long count, offset = 0;
+    query_object *object;
+
+    ZEND_PARSE_PARAMETERS_START(1, 2)
+        Z_PARAM_LONG(count)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_LONG(offset)
+    ZEND_PARSE_PARAMETERS_END();
+
+    if (count < 0) {
+        zend_argument_value_error(1, "must be greater than or equal to 0");
+        RETURN_THROWS();
+    }
+    if (offset < 0) {
+        zend_argument_value_error(2, "must be greater than or equal to 0");
+        RETURN_THROWS();
+    }
+    if (!(object = query_this_select(ZEND_THIS, "setLimit"))) {
+        RETURN_THROWS();
+    }
+
+    /* Clause text keeps the space that follows the keyword, as decomposition does */
+    query_object_set_text(object, COMPONENT_LIMIT, offset
+        ? zend_strpprintf(0, " " ZEND_LONG_FMT ", " ZEND_LONG_FMT, offset, count)
+        : zend_strpprintf(0, " " ZEND_LONG_FMT, count));
+    RETURN_OBJ_COPY(Z_OBJ_P(ZEND_THIS));
+}
+
+/* AND a condition onto the WHERE clause; both sides are parenthesized */
+PHP_METHOD(MysqlQp_Query, addWhere)
+{
+    zend_string *condition;
+    query_object *object;
+    smart_str where = {0};
+    zval *existing;
+    const char *start = NULL, *end = NULL;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_STR(condition)
+    ZEND_PARSE_PARAMETERS_END();
+
+    if (!(object = query_this_select(ZEND_THIS, "addWhere"))) {
+        RETURN_THROWS();
+    }
+
+    query_object_load(object, COMPONENT_WHERE);
+    existing = zend_hash_index_find(Z_ARRVAL(object->components.where_conditions), 0);
+    if (existing && Z_TYPE_P(existing) == IS_STRING) {
+        start = Z_STRVAL_P(existing);
+        end = start + Z_STRLEN_P(existing);
+        while (start < end && isspace((unsigned char) *start)) start++;
+        while (end > start && isspace((unsigned char) *(end - 1))) end--;
+    }
+
+    if (start < end) {
+        smart_str_appends(&where, " (");
+        smart_str_appendl(&where, start, end - start);
+        smart_str_appends(&where, ") AND (");
+        smart_str_append(&where, condition);
+        smart_str_appendc(&where, ')');
+    } else {
+        smart_str_appendc(&where, ' ');
+        smart_str_append(&where, condition);
+    }
+    smart_str_0(&where);
+
+    query_object_set_text(object, COMPONENT_WHERE, where.s);
+    RETURN_OBJ_COPY(Z_OBJ_P(ZEND_THIS));
+}
+
+PHP_METHOD(MysqlQp_Query, toArray)
+{
+    query_object *object;
+
+    ZEND_PARSE_PARAMETERS_NONE();
+    if (!(object = query_this(ZEND_THIS))) {
+        RETURN_THROWS();
+    }
+    query_object_to_array(object, return_value);
+}
+
+/* The original query until a clause is replaced, then the reconstruction */
+PHP_METHOD(MysqlQp_Query, __toString)
+{
+    query_object *object;
+    char *rebuilt_query;
+
+    ZEND_PARSE_PARAMETERS_NONE();
+    if (!(object = query_this(ZEND_THIS))) {
+        RETURN_THROWS();
+    }
+    if (!object->modified) {
+        RETURN_STR_COPY(object->query);
+    }
+
+    query_object_load_all(object);
+    rebuilt_query = mysql_reconstruct_query(&object->components);
+    if (object->tail_len) {
+        RETVAL_STR(zend_strpprintf(0, "%s %.*s", rebuilt_query, (int) object->tail_len, object->tail));
+    } else {
+        RETVAL_STRING(rebuilt_query);
+    }
+    efree(rebuilt_query);
+}
+
+static const zend_function_entry query_methods[] = {
+    PHP_ME(MysqlQp_Query, __construct, arginfo_query_construct, ZEND_ACC_PUBLIC)
+    PHP_ME(MysqlQp_Query, setLimit, arginfo_query_set_limit, ZEND_ACC_PUBLIC)
+    PHP_ME(MysqlQp_Query, addWhere, arginfo_query_add_where, ZEND_ACC_PUBLIC)
+    PHP_ME(MysqlQp_Query, toArray, arginfo_query_to_array, ZEND_ACC_PUBLIC)
+    PHP_ME(MysqlQp_Query, __toString, arginfo_query_to_string, ZEND_ACC_PUBLIC)
+    PHP_FE_END
+};
+
+/* Register the class; called from MINIT */
+void mysql_query_object_startup(void) {
+    zend_class_entry ce;
+
+    INIT_CLASS_ENTRY(ce, "MysqlQp\\Query", query_methods);
+    mysql_qp_query_ce = zend_register_internal_class(&ce);
+    mysql_qp_query_ce->ce_flags |= ZEND_ACC_FINAL | ZEND_ACC_NO_DYNAMIC_PROPERTIES | ZEND_ACC_NOT_SERIALIZABLE;
+    mysql_qp_query_ce->create_object = query_create;
+
+    memcpy(&query_handlers, zend_get_std_object_handlers(), sizeof(zend_object_handlers));
+    query_handlers.offset = XtOffsetOf(query_object, std);
+    query_handlers.free_obj = query_free;
+    query_handlers.clone_obj = query_clone;
+    query_handlers.read_property = query_read_property;
+    query_handlers.write_property = query_write_property;
+    query_handlers.has_property = query_has_property;
+    query_handlers.unset_property = query_unset_property;
+    query_handlers.get_property_ptr_ptr = query_get_property_ptr_ptr;
+    query_handlers.get_debug_info = query_get_debug_info;
+}
@@ -0,0 +1,356 @@
+#include "php.h"
+#include "zend_smart_str.h"
+#include "../include/php_mysql_qp.h"
+#include "../include/query_parameterize.h"
+#include "../include/sql_lexer.h"
+#include <errno.h>
+#include <string.h>
+
+/*
+ * Auto-parameterization. Every literal a prepared statement could take as
+ * a ? is cut out of the SQL and returned as a typed value, exactly as the
+ * server would have read it: integers as int (or string past PHP_INT_MAX),
+ * floats as float, fixed-point decimals as their exact text, strings
+ * unescaped. Literals that are syntax rather than values stay in place:
+ * ORDER BY/GROUP BY positions, type lengths, DATE '...' and other typed
+ * literals, quoted aliases, JSON paths after -> and ->>, INTO OUTFILE clauses,
+ * window frame offsets, hex, bit and introducer strings, and anything in a
+ * version comment.
+ */
+
+#define PARAMETERIZE_MAX_PARAMS 65535   /* the most ? a prepared statement can have */
+
+typedef struct {
+    mysql_token *tokens;
+    size_t count;
+} token_list;
+
+static int lex_all(zend_string *sql, token_list *list, const char **error) {
+    mysql_lexer lexer;
+    mysql_token token;
+    size_t capacity = 64;
+
+    list->tokens = safe_emalloc(capacity, sizeof(mysql_token), 0);
+    list->count = 0;
+
+    mysql_lexer_init(&lexer, ZSTR_VAL(sql), ZSTR_LEN(sql), 0);
+    while (mysql_lexer_next(&lexer, &token) != TOKEN_EOF) {
+        if (token.type == TOKEN_ERROR) {
+            *error = lexer.error;
+            return FAILURE;
+        }
+        if (list->count == capacity) {
+            capacity *= 2;
+            list->tokens = safe_erealloc(list->tokens, capacity, sizeof(mysql_token), 0);
+        }
+        list->tokens[list->count++] = token;
+    }
+    return SUCCESS;
+}
+
+static zend_bool is_keyword(const token_list *list, size_t i, int keyword) {
+    return i < list->count && mysql_token_is_keyword(&list->tokens[i], keyword);
+}
+
+static zend_bool is_word(const mysql_token *token, const char *word) {
+    size_t len = strlen(word);
+    return (token->type == TOKEN_IDENTIFIER || token->type == TOKEN_KEYWORD)
+        && token->length == len && strncasecmp(token->start, word, len) == 0;
+}
+
+/* Only data statements take parameters; one statement, optionally ended by ";" */
+static zend_bool parameterizable(const token_list *list) {
+    const mysql_token *first;
+
+    if (list->count == 0) {
+        return 0;
+    }
+    for (size_t i = 0; i + 1 < list->count; i++) {
+        if (list->tokens[i].type == TOKEN_SEMICOLON) {
+            return 0;
+        }
+    }
+    first = &list->tokens[0];
+    return first->type == TOKEN_LPAREN
+        || mysql_token_is_keyword(first, MYSQL_KW_SELECT)
+        || mysql_token_is_keyword(first, MYSQL_KW_INSERT)
+        || mysql_token_is_keyword(first, MYSQL_KW_UPDATE)
+        || mysql_token_is_keyword(first, MYSQL_KW_DELETE)
+        || mysql_token_is_keyword(first, MYSQL_KW_REPLACE)
+        || mysql_token_is_keyword(first, MYSQL_KW_WITH);
+}
+
+/* Keywords whose parentheses hold a length or precision, not values */
+static zend_bool is_type_keyword(const mysql_token *token) {
+    if (token->type != TOKEN_KEYWORD) {
+        return 0;
+    }
+    switch (token->keyword) {
+        case MYSQL_KW_CHAR:
+        case MYSQL_KW_VARCHAR:
+        case MYSQL_KW_NCHAR:
+        case MYSQL_KW_BINARY:
+        case MYSQL_KW_VARBINARY:
+        case MYSQL_KW_DECIMAL:
+        case MYSQL_KW_DEC:
+        case MYSQL_KW_NUMERIC:
+        case MYSQL_KW_FLOAT:
+        case MYSQL_KW_DOUBLE:
+        case MYSQL_KW_DATETIME:
+        case MYSQL_KW_TIME:
+        case MYSQL_KW_TIMESTAMP:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/* String literal value: quotes removed, doubled quotes and backslash escapes undone */
+static zend_string* unescape_string(const mysql_token *token) {
+    const char *p = token->start, *end = token->start + token->length - 1;
+    char quote = *p++;
+    zend_string *value = zend_string_alloc(token->length - 2, 0);
+    char *out = ZSTR_VAL(value);
+
+    while (p < end) {
+        if (*p == quote) {
+            *out++ = quote;     /* '' inside '...' */
+            p += 2;
+        } else if (*p == '\\' && p + 1 < end) {
+            switch (p[1]) {
+                case '0': *out++ = '\0'; break;
+                case 'b': *out++ = '\b'; break;
+                case 'n': *out++ = '\n'; break;
+                case 'r': *out++ = '\r'; break;
+                case 't': *out++ = '\t'; break;
+                case 'Z': *out++ = '\032'; break;
+                case '%':
+                case '_':
+                    /* Kept for LIKE, as the server does */
+                    *out++ = '\\';
+                    *out++ = p[1];
+                    break;
+                default: *out++ = p[1]; break;
+            }
+            p += 2;
+        } else {
+            *out++ = *p++;
+        }
+    }
+    *out = '\0';
+    ZSTR_LEN(value) = out - ZSTR_VAL(value);
+    return value;
+}
+
+/* Append a literal's value to params and its type letter to types */
+static void add_param(const mysql_token *token, zval *params, smart_str *types) {
+    char buf[32];
+
+    switch (token->type) {
+        case TOKEN_INTEGER:
+            if (token->length < sizeof(buf)) {
+                zend_long value;
+                memcpy(buf, token->start, token->length);
+                buf[token->length] = '\0';
+                errno = 0;
+                value = ZEND_STRTOL(buf, NULL, 10);
+                if (errno != ERANGE) {
+                    add_next_index_long(params, value);
+                    smart_str_appendc(types, 'i');
+                    return;
+                }
+            }
+            /* Too large for an int: exact digits as a string */
+            add_next_index_stringl(params, token->start, token->length);
+            smart_str_appendc(types, 's');
+            return;
+        case TOKEN_FLOAT:
+            add_next_index_double(params, zend_strtod(token->start, NULL));
+            smart_str_appendc(types, 'd');
+            return;
+        case TOKEN_DECIMAL:
+            /* A double would round 0.1; the text is what the server reads */
+            add_next_index_stringl(params, token->start, token->length);
+            smart_str_appendc(types, 's');
+            return;
+        default:
+            add_next_index_str(params, unescape_string(token));
+            smart_str_appendc(types, 's');
+            return;
+    }
+}
+
+static zend_bool is_value_literal(const mysql_token *token) {
+    switch (token->type) {
+        case TOKEN_INTEGER:
+        case TOKEN_DECIMAL:
+        case TOKEN_FLOAT:
+            return !(token->flags & TOKEN_FLAG_VERSIONED);
+        case TOKEN_STRING:
+            return !(token->flags & (TOKEN_FLAG_VERSIONED | TOKEN_FLAG_NATIONAL | TOKEN_FLAG_INTRODUCER));
+        default:
+            return 0;
+    }
+}
+
+/* Whether the literal at i is syntax that has to stay in the SQL */
+static zend_bool keep_literal(const token_list *list, size_t i, zend_bool in_by_list, zend_bool in_type, zend_bool in_file) {
+    const mysql_token *token = &list->tokens[i], *prev = i > 0 ? &list->tokens[i - 1] : NULL;
+
+    if (in_type || in_file) {
+        return 1;
+    }
+    if (prev && prev->type == TOKEN_STRING) {
+        return 1;       /* tail of _utf8mb4'a' 'b', which has to stay one literal */
+    }
+    if (prev && token->type == TOKEN_INTEGER && in_by_list
+        && (mysql_token_is_keyword(prev, MYSQL_KW_BY) || prev->type == TOKEN_COMMA)) {
+        return 1;       /* ORDER BY 2 is a column position */
+    }
+    if (prev && token->type == TOKEN_STRING) {
+        if (mysql_token_is_keyword(prev, MYSQL_KW_DATE) || mysql_token_is_keyword(prev, MYSQL_KW_TIME)
+            || mysql_token_is_keyword(prev, MYSQL_KW_TIMESTAMP) || mysql_token_is_keyword(prev, MYSQL_KW_COLLATE)
+            || mysql_token_is_keyword(prev, MYSQL_KW_AS)) {
+            return 1;   /* typed literal, collation, quoted alias */
+        }
+        if (prev->type == TOKEN_OPERATOR && prev->length >= 2 && prev->start[0] == '-' && prev->start[1] == '>') {
+            return 1;   /* JSON path */
+        }
+    }
+    if (is_keyword(list, i + 1, MYSQL_KW_PRECEDING) || is_keyword(list, i + 1, MYSQL_KW_FOLLOWING)) {
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * Fill result with ["sql" => ..., "params" => [...], "types" => "..."].
+ * Statements that can't be prepared come back unchanged with no params.
+ * FAILURE with *error set when sql doesn't tokenize or already has
+ * placeholders.
+ */
+int mysql_parameterize(zend_string *sql, zval *result, const char **error) {
+    token_list list;
+    zval params;
+    smart_str out = {0}, types = {0};
+    size_t copied = 0, count = 0;
+    int depth = 0, by_list_depth = -1, type_depth = -1;
+    zend_bool in_file = 0;
+
+    *error = NULL;
+    if (lex_all(sql, &list, error) != SUCCESS) {
+        efree(list.tokens);
+        return FAILURE;
+    }
+    for (size_t i = 0; i < list.count; i++) {
+        if (list.tokens[i].type == TOKEN_PLACEHOLDER || list.tokens[i].type == TOKEN_NAMED_PLACEHOLDER) {
+            *error = "the query already has placeholders";
+            efree(list.tokens);
+            return FAILURE;
+        }
+    }
+
+    array_init(&params);
+    if (!parameterizable(&list)) {
+        goto unchanged;
+    }
+
+    for (size_t i = 0; i < list.count; i++) {
+        const mysql_token *token = &list.tokens[i];
+        size_t last = i;
+
+        switch (token->type) {
+            case TOKEN_LPAREN:
+                if (i > 0 && type_depth < 0 && is_type_keyword(&list.tokens[i - 1])) {
+                    type_depth = depth;
+                }
+                depth++;
+                continue;
+            case TOKEN_RPAREN:
+                depth--;
+                if (type_depth == depth) type_depth = -1;
+                if (by_list_depth > depth) by_list_depth = -1;
+                continue;
+            case TOKEN_SEMICOLON:
+                by_list_depth = -1;
+                continue;
+            case TOKEN_IDENTIFIER:
+                if (is_word(token, "DUMPFILE")) {
+                    in_file = 1;
+                }
+                continue;
+            case TOKEN_KEYWORD:
+                /* INTO OUTFILE 'name' FIELDS TERMINATED BY ',' ... is all syntax */
+                if (token->keyword == MYSQL_KW_OUTFILE) {
+                    in_file = 1;
+                } else if (token->keyword == MYSQL_KW_FROM) {
+                    in_file = 0;
+                }
+                if (token->keyword == MYSQL_KW_BY && i > 0
+                    && (is_keyword(&list, i - 1, MYSQL_KW_ORDER) || is_keyword(&list, i - 1, MYSQL_KW_GROUP))) {
+                    by_list_depth = depth;
+                } else if (by_list_depth == depth && token->keyword != MYSQL_KW_ASC && token->keyword != MYSQL_KW_DESC) {
+                    by_list_depth = -1;
+                }
+                continue;
+            default:
+                break;
+        }
+
+        if (!is_value_literal(token) || keep_literal(&list, i, by_list_depth >= 0 && by_list_depth == depth, type_depth >= 0, in_file)) {
+            continue;
+        }
+
+        /* 'a' 'b' is one string to the server */
+        if (token->type == TOKEN_STRING) {
+            while (last + 1 < list.count && list.tokens[last + 1].type == TOKEN_STRING
+                   && is_value_literal(&list.tokens[last + 1])) {
+                last++;
+            }
+        }
+        if (++count > PARAMETERIZE_MAX_PARAMS) {
+            goto unchanged;
+        }
+
+        if (last == i) {
+            add_param(token, &params, &types);
+        } else {
+            smart_str joined = {0};
+            for (size_t j = i; j <= last; j++) {
+                zend_string *part = unescape_string(&list.tokens[j]);
+                smart_str_append(&joined, part);
+                zend_string_release(part);
+            }
+            add_next_index_str(&params, smart_str_extract(&joined));
+            smart_str_appendc(&types, 's');
+        }
+
+        smart_str_appendl(&out, ZSTR_VAL(sql) + copied, (token->start - ZSTR_VAL(sql)) - copied);
+        smart_str_appendc(&out, '?');
+        copied = (list.tokens[last].start - ZSTR_VAL(sql)) + list.tokens[last].length;
+        i = last;
+    }
+
+    if (count == 0) {
+        goto unchanged;
+    }
+    smart_str_appendl(&out, ZSTR_VAL(sql) + copied, ZSTR_LEN(sql) - copied);
+
+    array_init_size(result, 3);
+    add_assoc_str(result, "sql", smart_str_extract(&out));
+    add_assoc_zval(result, "params", &params);
+    add_assoc_str(result, "types", smart_str_extract(&types));
+    efree(list.tokens);
+    return SUCCESS;
+
+unchanged:
+    smart_str_free(&out);
+    smart_str_free(&types);
+    zend_hash_clean(Z_ARRVAL(params));
+    array_init_size(result, 3);
+    add_assoc_str(result, "sql", zend_string_copy(sql));
+    add_assoc_zval(result, "params", &params);
+    add_assoc_str(result, "types", ZSTR_EMPTY_ALLOC());
+    efree(list.tokens);
+    return SUCCESS;
+}
@@ -1,16 +1,2026 @@
 #include "php.h"
 #include "../include/php_mysql_qp.h"
+#include "../include/sql_lexer.h"
+#include "../include/query_parser.h"
+#include "../include/mysql_query_parser.h"
+#include <string.h>
 
-/* Query parser implementation - placeholder for now */
-int parse_mysql_query(const char *query, size_t query_len)
-{
-    /* TODO: Implement actual MySQL query parsing */
-    return (query && query_len > 0) ? 1 : 0;
+/*
+ * Native recursive-descent parser for the DML subset: SELECT (joins,
+ * subqueries, CTEs, window functions, set operations), INSERT, REPLACE,
+ * UPDATE and DELETE. Anything outside that subset fails with an
+ * "unsupported" error so callers can fall back to the server.
+ */
+
+#define SQL_PARSER_MAX_DEPTH 256
+
+typedef struct {
+    const char *query;
+    size_t query_len;
+    sql_arena *arena;
+    mysql_token *tokens;
+    size_t count;
+    size_t pos;
+    int depth;
+    int placeholders;
+    int unchecked;          /* see sql_parse_result */
+    const char *error;
+    const char *error_pos;
+} sql_parser;
+
+static const char *const sql_node_type_names[SQL_NODE_TYPE_COUNT] = {
+    "list", "select", "union", "insert", "replace", "update", "delete", "cte",
+    "table", "derived", "join", "table_group", "column", "star", "literal",
+    "placeholder", "variable", "binary", "unary", "is", "in", "between", "like",
+    "exists", "subquery", "function", "keyword", "data_type", "interval", "case",
+    "when", "row", "collate", "match", "window", "name"
+};
+
+const char* sql_node_type_name(enum sql_node_type type) {
+    return type < SQL_NODE_TYPE_COUNT ? sql_node_type_names[type] : "unknown";
+}
+
+/* Node construction */
+
+static sql_node* node_new(sql_parser *p, enum sql_node_type type) {
+    sql_node *node = sql_arena_calloc(p->arena, sizeof(sql_node));
+    node->type = type;
+    node->attrs_tail = &node->attrs;
+    node->items_tail = &node->items;
+    return node;
+}
+
+static sql_attr* attr_add(sql_parser *p, sql_node *node, const char *key, enum sql_attr_kind kind) {
+    sql_attr *attr = sql_arena_calloc(p->arena, sizeof(sql_attr));
+    attr->key = key;
+    attr->kind = kind;
+    *node->attrs_tail = attr;
+    node->attrs_tail = &attr->next;
+    return attr;
+}
+
+static void attr_node(sql_parser *p, sql_node *node, const char *key, sql_node *value) {
+    attr_add(p, node, key, SQL_ATTR_NODE)->node = value;
+}
+
+static void attr_text(sql_parser *p, sql_node *node, const char *key, const char *text, size_t len) {
+    sql_attr *attr = attr_add(p, node, key, SQL_ATTR_TEXT);
+    attr->text = text;
+    attr->text_len = len;
+}
+
+static void attr_static(sql_parser *p, sql_node *node, const char *key, const char *text) {
+    attr_text(p, node, key, text, strlen(text));
+}
+
+static void attr_ident(sql_parser *p, sql_node *node, const char *key, const mysql_token *token) {
+    sql_attr *attr = attr_add(p, node, key, SQL_ATTR_IDENT);
+    attr->text = token->start;
+    attr->text_len = token->length;
+}
+
+static void attr_bool(sql_parser *p, sql_node *node, const char *key) {
+    attr_add(p, node, key, SQL_ATTR_BOOL)->text_len = 1;
+}
+
+/* Put an attribute in front, for clauses parsed before their owner (WITH) */
+static sql_attr* attr_prepend(sql_parser *p, sql_node *node, const char *key, enum sql_attr_kind kind) {
+    sql_attr *attr = sql_arena_calloc(p->arena, sizeof(sql_attr));
+    attr->key = key;
+    attr->kind = kind;
+    attr->next = node->attrs;
+    if (!node->attrs) {
+        node->attrs_tail = &attr->next;
+    }
+    node->attrs = attr;
+    return attr;
+}
+
+static void list_append(sql_node *list, sql_node *item) {
+    *list->items_tail = item;
+    list->items_tail = &item->next;
+    list->count++;
+}
+
+static sql_node* name_node(sql_parser *p, const mysql_token *token) {
+    sql_node *node = node_new(p, SQL_NODE_NAME);
+    attr_ident(p, node, "value", token);
+    return node;
+}
+
+static sql_node* keyword_node(sql_parser *p, const char *keyword) {
+    sql_node *node = node_new(p, SQL_NODE_KEYWORD);
+    attr_static(p, node, "value", keyword);
+    return node;
+}
+
+sql_node* sql_node_attr(const sql_node *node, const char *key) {
+    for (sql_attr *attr = node ? node->attrs : NULL; attr; attr = attr->next) {
+        if (attr->kind == SQL_ATTR_NODE && strcmp(attr->key, key) == 0) {
+            return attr->node;
+        }
+    }
+    return NULL;
+}
+
+/* Token cursor */
+
+static mysql_token* peek(sql_parser *p, size_t ahead) {
+    size_t index = p->pos + ahead;
+    return &p->tokens[index < p->count ? index : p->count - 1];
+}
+
+static mysql_token* advance(sql_parser *p) {
+    mysql_token *token = peek(p, 0);
+    if (p->pos < p->count - 1) p->pos++;
+    return token;
+}
+
+static int at_kw(sql_parser *p, int keyword) {
+    return mysql_token_is_keyword(peek(p, 0), keyword);
+}
+
+static int at_kw_ahead(sql_parser *p, size_t ahead, int keyword) {
+    return mysql_token_is_keyword(peek(p, ahead), keyword);
+}
+
+static int accept_kw(sql_parser *p, int keyword) {
+    if (at_kw(p, keyword)) {
+        advance(p);
+        return 1;
+    }
+    return 0;
+}
+
+static int at_type(sql_parser *p, enum mysql_token_type type) {
+    return peek(p, 0)->type == type;
+}
+
+static int accept_type(sql_parser *p, enum mysql_token_type type) {
+    if (at_type(p, type)) {
+        advance(p);
+        return 1;
+    }
+    return 0;
+}
+
+static int token_is_op(const mysql_token *token, const char *op) {
+    size_t len = strlen(op);
+    return token->type == TOKEN_OPERATOR && token->length == len && memcmp(token->start, op, len) == 0;
+}
+
+static int at_op(sql_parser *p, const char *op) {
+    return token_is_op(peek(p, 0), op);
+}
+
+static int accept_op(sql_parser *p, const char *op) {
+    if (at_op(p, op)) {
+        advance(p);
+        return 1;
+    }
+    return 0;
+}
+
+/* Any word, keyword or not, by its spelling */
+static int token_is_word(const mysql_token *token, const char *word) {
+    size_t len = strlen(word);
+    return (token->type == TOKEN_IDENTIFIER || token->type == TOKEN_KEYWORD) &&
+        token->length == len && strncasecmp(token->start, word, len) == 0;
+}
+
+static int token_in_words(const mysql_token *token, const char *const *words) {
+    for (; *words; words++) {
+        if (token_is_word(token, *words)) return 1;
+    }
+    return 0;
+}
+
+/* Unlisted words (SOUNDS, MEMBER, ...) come through as plain identifiers */
+static int at_word(sql_parser *p, size_t ahead, const char *word) {
+    mysql_token *token = peek(p, ahead);
+    size_t len = strlen(word);
+    return token->type == TOKEN_IDENTIFIER && token->length == len && strncasecmp(token->start, word, len) == 0;
+}
+
+static void* fail(sql_parser *p, const char *message) {
+    if (!p->error) {
+        p->error = message;
+        p->error_pos = peek(p, 0)->start;
+    }
+    return NULL;
+}
+
+static int expect_kw(sql_parser *p, int keyword) {
+    if (accept_kw(p, keyword)) return 1;
+    fail(p, "unexpected token");
+    return 0;
+}
+
+static int expect_type(sql_parser *p, enum mysql_token_type type) {
+    if (accept_type(p, type)) return 1;
+    fail(p, "unexpected token");
+    return 0;
+}
+
+/* Source text between two tokens, inclusive */
+static void attr_span(sql_parser *p, sql_node *node, const char *key, size_t first, size_t last) {
+    const char *start = p->tokens[first].start;
+    attr_text(p, node, key, start, p->tokens[last].start + p->tokens[last].length - start);
+}
+
+/* Identifiers, quoted identifiers and non-reserved keywords */
+static int token_is_name(const mysql_token *token) {
+    return token->type == TOKEN_IDENTIFIER || token->type == TOKEN_QUOTED_IDENTIFIER ||
+        (token->type == TOKEN_KEYWORD && !(token->flags & TOKEN_FLAG_RESERVED));
+}
+
+/* After a qualifier dot every word is a name, reserved or not */
+static int token_is_qualified_name(const mysql_token *token) {
+    return token_is_name(token) || token->type == TOKEN_KEYWORD;
+}
+
+static mysql_token* expect_name(sql_parser *p) {
+    if (!token_is_name(peek(p, 0))) {
+        return fail(p, "expected identifier");
+    }
+    return advance(p);
+}
+
+static int enter(sql_parser *p) {
+    if (++p->depth > SQL_PARSER_MAX_DEPTH) {
+        fail(p, "query nested too deeply");
+        return 0;
+    }
+    return 1;
+}
+
+#define LEAVE(p, value) do { (p)->depth--; return (value); } while (0)
+
+/* Forward declarations */
+static sql_node* parse_expr(sql_parser *p);
+static sql_node* parse_bit_or(sql_parser *p);
+static sql_node* parse_predicate(sql_parser *p);
+static sql_node* parse_query_expression(sql_parser *p);
+static sql_node* parse_table_refs(sql_parser *p);
+static sql_node* parse_window_spec(sql_parser *p);
+
+static int at_query_start(sql_parser *p) {
+    return at_kw(p, MYSQL_KW_SELECT) || at_kw(p, MYSQL_KW_WITH);
+}
+
+/* Expressions */
+
+static sql_node* parse_expr_list(sql_parser *p) {
+    sql_node *list = node_new(p, SQL_NODE_LIST);
+    do {
+        sql_node *expr = parse_expr(p);
+        if (!expr) return NULL;
+        list_append(list, expr);
+    } while (accept_type(p, TOKEN_COMMA));
+    return list;
+}
+
+/* ORDER BY items: expressions with an optional direction */
+static sql_node* parse_order_list(sql_parser *p) {
+    sql_node *list = node_new(p, SQL_NODE_LIST);
+    do {
+        sql_node *expr = parse_expr(p);
+        if (!expr) return NULL;
+        if (accept_kw(p, MYSQL_KW_ASC)) {
+            attr_static(p, expr, "direction", "ASC");
+        } else if (accept_kw(p, MYSQL_KW_DESC)) {
+            attr_static(p, expr, "direction", "DESC");
+        }
+        list_append(list, expr);
+    } while (accept_type(p, TOKEN_COMMA));
+    return list;
+}
+
+/* Subquery body after the opening parenthesis has been consumed */
+static sql_node* parse_subquery_tail(sql_parser *p) {
+    sql_node *query = parse_query_expression(p);
+    if (!query || !expect_type(p, TOKEN_RPAREN)) return NULL;
+    return query;
+}
+
+/* Targets of CAST(... AS type) in the server's grammar; the first group takes (M[,D]) */
+static const char *const cast_types_sized[] = {"BINARY", "CHAR", "NCHAR", "DECIMAL", "FLOAT", "DATETIME", "TIME", NULL};
+static const char *const cast_types[] = {"DATE", "YEAR", "DOUBLE", "REAL", "JSON", "SIGNED", "UNSIGNED", NULL};
+
+/* INTERVAL and EXTRACT units */
+static const char *const interval_units[] = {
+    "MICROSECOND", "SECOND", "MINUTE", "HOUR", "DAY", "WEEK", "MONTH", "QUARTER", "YEAR",
+    "SECOND_MICROSECOND", "MINUTE_MICROSECOND", "MINUTE_SECOND", "HOUR_MICROSECOND", "HOUR_SECOND",
+    "HOUR_MINUTE", "DAY_MICROSECOND", "DAY_SECOND", "DAY_MINUTE", "DAY_HOUR", "YEAR_MONTH", NULL
+};
+
+/* Whether tokens [first, end) spell a cast type the server knows, e.g. SIGNED INTEGER or DECIMAL(10,2) */
+static int data_type_is_known(sql_parser *p, size_t first, size_t end) {
+    const mysql_token *type = &p->tokens[first];
+    int sized = token_in_words(type, cast_types_sized);
+    size_t i = first + 1;
+
+    if (!sized && !token_in_words(type, cast_types)) {
+        return 0;
+    }
+    if (i < end && (token_is_word(type, "SIGNED") || token_is_word(type, "UNSIGNED")) &&
+        (token_is_word(&p->tokens[i], "INTEGER") || token_is_word(&p->tokens[i], "INT"))) {
+        i++;
+    }
+    if (i < end && p->tokens[i].type == TOKEN_LPAREN) {
+        /* Only DECIMAL takes a scale */
+        if (!sized || (p->tokens[i + 2].type == TOKEN_COMMA && !token_is_word(type, "DECIMAL"))) {
+            return 0;
+        }
+        while (p->tokens[i].type != TOKEN_RPAREN) i++;
+        i++;
+    }
+    return i == end;
+}
+
+/* CAST/CONVERT target and charset names: words plus optional (M[,D]) */
+static sql_node* parse_data_type(sql_parser *p) {
+    size_t first = p->pos;
+    sql_node *node;
+
+    if (!token_is_qualified_name(peek(p, 0))) {
+        return fail(p, "expected data type");
+    }
+    while (token_is_qualified_name(peek(p, 0)) || at_type(p, TOKEN_LPAREN)) {
+        if (accept_type(p, TOKEN_LPAREN)) {
+            if (!expect_type(p, TOKEN_INTEGER)) return NULL;
+            if (accept_type(p, TOKEN_COMMA) && !expect_type(p, TOKEN_INTEGER)) return NULL;
+            if (!expect_type(p, TOKEN_RPAREN)) return NULL;
+        } else {
+            advance(p);
+        }
+    }
+
+    node = node_new(p, SQL_NODE_DATA_TYPE);
+    attr_span(p, node, "value", first, p->pos - 1);
+    return node;
+}
+
+/* Reserved words that are still valid function names */
+static int is_function_keyword(int keyword) {
+    switch (keyword) {
+        case MYSQL_KW_CHAR: case MYSQL_KW_CONVERT: case MYSQL_KW_CUME_DIST: case MYSQL_KW_CURRENT_DATE:
+        case MYSQL_KW_CURRENT_TIME: case MYSQL_KW_CURRENT_TIMESTAMP: case MYSQL_KW_CURRENT_USER:
+        case MYSQL_KW_DATABASE: case MYSQL_KW_DEFAULT: case MYSQL_KW_DENSE_RANK:
+        case MYSQL_KW_FIRST_VALUE: case MYSQL_KW_GROUPING: case MYSQL_KW_IF:
+        case MYSQL_KW_INSERT: case MYSQL_KW_LAG: case MYSQL_KW_LAST_VALUE:
+        case MYSQL_KW_LEAD: case MYSQL_KW_LEFT: case MYSQL_KW_LOCALTIME:
+        case MYSQL_KW_LOCALTIMESTAMP: case MYSQL_KW_MOD: case MYSQL_KW_NTH_VALUE:
+        case MYSQL_KW_NTILE: case MYSQL_KW_PERCENT_RANK: case MYSQL_KW_RANK:
+        case MYSQL_KW_REPEAT: case MYSQL_KW_REPLACE: case MYSQL_KW_RIGHT:
+        case MYSQL_KW_ROW_NUMBER: case MYSQL_KW_SCHEMA: case MYSQL_KW_UTC_DATE:
+        case MYSQL_KW_UTC_TIME: case MYSQL_KW_UTC_TIMESTAMP: case MYSQL_KW_VALUES:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/* Where a function takes OVER in the server's grammar */
+enum sql_function_window {
+    WINDOW_NONE = 0,
+    WINDOW_OPTIONAL,
+    WINDOW_REQUIRED
+};
+
+#define ANY_ARGS 255
+
+typedef struct {
+    const char *name;
+    unsigned char min_args;
+    unsigned char max_args;
+    unsigned char window;       /* enum sql_function_window */
+    unsigned char aggregate;    /* takes DISTINCT */
+} sql_function_rule;
+
+/*
+ * Functions with rules of their own in the server's grammar, checked in
+ * their plain name(expr, ...) form. Calls that don't fit are left to the
+ * server; so are the functions in unchecked_functions, whose other forms
+ * (TRIM(BOTH ...), GROUP_CONCAT(... SEPARATOR ...)) aren't checked here.
+ * Any other name is a loadable or stored function, which takes any
+ * number of plain arguments.
+ */
+static const sql_function_rule function_rules[] = {
+    {"COUNT", 1, 1, WINDOW_OPTIONAL, 1}, {"SUM", 1, 1, WINDOW_OPTIONAL, 1}, {"AVG", 1, 1, WINDOW_OPTIONAL, 1},
+    {"MIN", 1, 1, WINDOW_OPTIONAL, 1}, {"MAX", 1, 1, WINDOW_OPTIONAL, 1},
+    {"ROW_NUMBER", 0, 0, WINDOW_REQUIRED, 0}, {"RANK", 0, 0, WINDOW_REQUIRED, 0},
+    {"DENSE_RANK", 0, 0, WINDOW_REQUIRED, 0}, {"CUME_DIST", 0, 0, WINDOW_REQUIRED, 0},
+    {"PERCENT_RANK", 0, 0, WINDOW_REQUIRED, 0}, {"NTILE", 1, 1, WINDOW_REQUIRED, 0},
+    {"LAG", 1, 3, WINDOW_REQUIRED, 0}, {"LEAD", 1, 3, WINDOW_REQUIRED, 0},
+    {"FIRST_VALUE", 1, 1, WINDOW_REQUIRED, 0}, {"LAST_VALUE", 1, 1, WINDOW_REQUIRED, 0},
+    {"NTH_VALUE", 2, 2, WINDOW_REQUIRED, 0},
+    {"COALESCE", 1, ANY_ARGS, WINDOW_NONE, 0}, {"IF", 3, 3, WINDOW_NONE, 0}, {"CHAR", 1, ANY_ARGS, WINDOW_NONE, 0},
+    {"LEFT", 2, 2, WINDOW_NONE, 0}, {"RIGHT", 2, 2, WINDOW_NONE, 0}, {"INSERT", 4, 4, WINDOW_NONE, 0},
+    {"REPEAT", 2, 2, WINDOW_NONE, 0}, {"REPLACE", 3, 3, WINDOW_NONE, 0}, {"REVERSE", 1, 1, WINDOW_NONE, 0},
+    {"TRUNCATE", 2, 2, WINDOW_NONE, 0}, {"FORMAT", 2, 3, WINDOW_NONE, 0}, {"MOD", 2, 2, WINDOW_NONE, 0},
+    {"SUBSTRING", 2, 3, WINDOW_NONE, 0}, {"SUBSTR", 2, 3, WINDOW_NONE, 0},
+    {"DATE", 1, 1, WINDOW_NONE, 0}, {"TIME", 1, 1, WINDOW_NONE, 0}, {"TIMESTAMP", 1, 2, WINDOW_NONE, 0},
+    {"YEAR", 1, 1, WINDOW_NONE, 0}, {"QUARTER", 1, 1, WINDOW_NONE, 0}, {"MONTH", 1, 1, WINDOW_NONE, 0},
+    {"WEEK", 1, 2, WINDOW_NONE, 0}, {"DAY", 1, 1, WINDOW_NONE, 0}, {"HOUR", 1, 1, WINDOW_NONE, 0},
+    {"MINUTE", 1, 1, WINDOW_NONE, 0}, {"SECOND", 1, 1, WINDOW_NONE, 0}, {"MICROSECOND", 1, 1, WINDOW_NONE, 0},
+    {"CHARSET", 1, 1, WINDOW_NONE, 0}, {"COLLATION", 1, 1, WINDOW_NONE, 0},
+    {"DATABASE", 0, 0, WINDOW_NONE, 0}, {"SCHEMA", 0, 0, WINDOW_NONE, 0}, {"USER", 0, 0, WINDOW_NONE, 0},
+    {"CURRENT_USER", 0, 0, WINDOW_NONE, 0}, {"ROW_COUNT", 0, 0, WINDOW_NONE, 0},
+    /* The date and time functions also take a literal precision, which is left to the server */
+    {"NOW", 0, 0, WINDOW_NONE, 0}, {"SYSDATE", 0, 0, WINDOW_NONE, 0}, {"CURDATE", 0, 0, WINDOW_NONE, 0},
+    {"CURTIME", 0, 0, WINDOW_NONE, 0}, {"CURRENT_DATE", 0, 0, WINDOW_NONE, 0},
+    {"CURRENT_TIME", 0, 0, WINDOW_NONE, 0}, {"CURRENT_TIMESTAMP", 0, 0, WINDOW_NONE, 0},
+    {"LOCALTIME", 0, 0, WINDOW_NONE, 0}, {"LOCALTIMESTAMP", 0, 0, WINDOW_NONE, 0},
+    {"UTC_DATE", 0, 0, WINDOW_NONE, 0}, {"UTC_TIME", 0, 0, WINDOW_NONE, 0}, {"UTC_TIMESTAMP", 0, 0, WINDOW_NONE, 0},
+    {NULL, 0, 0, 0, 0}
+};
+
+static const char *const unchecked_functions[] = {
+    "CONVERT", "POSITION", "TRIM", "GROUP_CONCAT", "DATE_ADD", "DATE_SUB", "ADDDATE",
+    "SUBDATE", "TIMESTAMPADD", "TIMESTAMPDIFF", "GET_FORMAT", "WEIGHT_STRING", "BIT_AND", "BIT_OR",
+    "BIT_XOR", "STD", "STDDEV", "STDDEV_POP", "STDDEV_SAMP", "VARIANCE", "VAR_POP", "VAR_SAMP",
+    "JSON_ARRAYAGG", "JSON_OBJECTAGG", "ST_COLLECT", "GROUPING", "JSON_VALUE", "DEFAULT",
+    "INTERVAL", "PASSWORD", "OLD_PASSWORD", "CONTAINS", "POINT", "LINESTRING", "POLYGON",
+    "MULTIPOINT", "MULTILINESTRING", "MULTIPOLYGON", "GEOMETRYCOLLECTION", NULL
+};
+
+/* Shape of a parsed call, for checking it against the server's grammar */
+typedef struct {
+    const sql_node *args;
+    size_t values;          /* argument expressions */
+    int forms;              /* keyword separators and modifiers (FROM, SEPARATOR, ORDER BY, AS, ...) */
+    int star;
+    int distinct;
+    int over;
+    int cast_type_known;    /* CAST(... AS type) with a type from the server's list */
+} sql_function_call;
+
+static int function_call_is_checked(const mysql_token *name, int qualified, const sql_function_call *call) {
+    const sql_function_rule *rule;
+
+    /* A stored function: db.f(a, b) */
+    if (qualified) {
+        return !call->forms && !call->star && !call->distinct && !call->over;
+    }
+    if (call->distinct || call->over) {
+        /* Only the aggregates and window functions in function_rules take these */
+    } else if (token_is_word(name, "CAST")) {
+        return call->values == 1 && call->forms == 1 && call->cast_type_known;
+    } else if (token_is_word(name, "EXTRACT")) {
+        /* EXTRACT(unit FROM expr); the unit was checked when it was parsed */
+        const sql_node *unit = call->args->items;
+        const sql_attr *from = unit && unit->next ? unit->next->attrs : NULL;
+        return call->values == 1 && call->forms == 2 && unit->type == SQL_NODE_KEYWORD &&
+            from && from->text_len == 4 && memcmp(from->text, "FROM", 4) == 0;
+    } else if (token_is_word(name, "VALUES")) {
+        /* ON DUPLICATE KEY UPDATE a = VALUES(a) */
+        return call->values == 1 && !call->forms && call->args->items->type == SQL_NODE_COLUMN;
+    }
+    for (rule = function_rules; rule->name; rule++) {
+        if (!token_is_word(name, rule->name)) continue;
+        if (call->forms || (call->distinct && !rule->aggregate)) return 0;
+        if (call->over ? rule->window == WINDOW_NONE : rule->window == WINDOW_REQUIRED) return 0;
+        /* COUNT(*) and COUNT(DISTINCT a, b) */
+        if (call->star) return token_is_word(name, "COUNT") && call->values == 0 && !call->distinct;
+        if (call->distinct && token_is_word(name, "COUNT")) return call->values >= 1;
+        return call->values >= rule->min_args && (rule->max_args == ANY_ARGS || call->values <= rule->max_args);
+    }
+    if (name->type == TOKEN_KEYWORD || token_in_words(name, unchecked_functions)) {
+        return 0;
+    }
+    return !call->forms && !call->star && !call->distinct && !call->over;
+}
+
+/*
+ * Function arguments. Special-syntax functions (TRIM ... FROM, SUBSTRING ...
+ * FOR, GROUP_CONCAT ... SEPARATOR, CAST ... AS, CHAR ... USING) keep their
+ * separators as keyword nodes between the argument expressions. Calls the
+ * server's grammar might not take mark the parse unchecked.
+ */
+static sql_node* parse_function_args(sql_parser *p, sql_node *func, const mysql_token *name, int qualified) {
+    sql_node *args = node_new(p, SQL_NODE_LIST);
+    int is_position = name->length == 8 && strncasecmp(name->start, "POSITION", 8) == 0;
+    int is_extract = name->length == 7 && strncasecmp(name->start, "EXTRACT", 7) == 0;
+    sql_function_call call = {0};
+
+    if (accept_kw(p, MYSQL_KW_DISTINCT)) {
+        attr_bool(p, func, "distinct");
+        call.distinct = 1;
+    } else {
+        accept_kw(p, MYSQL_KW_ALL);
+    }
+
+    while (!at_type(p, TOKEN_RPAREN)) {
+        sql_node *arg;
+
+        if (at_kw(p, MYSQL_KW_BOTH) || at_kw(p, MYSQL_KW_LEADING) || at_kw(p, MYSQL_KW_TRAILING)) {
+            list_append(args, keyword_node(p, mysql_keyword_name(advance(p)->keyword)));
+            call.forms++;
+            continue;
+        }
+        if (args->count > 0 && (at_kw(p, MYSQL_KW_FROM) || at_kw(p, MYSQL_KW_FOR) ||
+                                at_kw(p, MYSQL_KW_SEPARATOR) || (is_position && at_kw(p, MYSQL_KW_IN)))) {
+            list_append(args, keyword_node(p, mysql_keyword_name(advance(p)->keyword)));
+            call.forms++;
+            continue;
+        }
+        if (args->count > 0 && (at_kw(p, MYSQL_KW_AS) || at_kw(p, MYSQL_KW_USING))) {
+            size_t first;
+            int is_as = at_kw(p, MYSQL_KW_AS);
+            list_append(args, keyword_node(p, mysql_keyword_name(advance(p)->keyword)));
+            first = p->pos;
+            if (!(arg = parse_data_type(p))) return NULL;
+            list_append(args, arg);
+            call.forms++;
+            call.cast_type_known = is_as && data_type_is_known(p, first, p->pos);
+        } else if (at_kw(p, MYSQL_KW_ORDER) && at_kw_ahead(p, 1, MYSQL_KW_BY)) {
+            sql_node *order;
+            advance(p);
+            advance(p);
+            list_append(args, keyword_node(p, "ORDER BY"));
+            if (!(order = parse_order_list(p))) return NULL;
+            for (sql_node *item = order->items, *next; item; item = next) {
+                next = item->next;
+                item->next = NULL;
+                list_append(args, item);
+            }
+            call.forms++;
+        } else if (at_op(p, "*") && args->count == 0) {
+            advance(p);
+            list_append(args, node_new(p, SQL_NODE_STAR));
+            if (!at_type(p, TOKEN_RPAREN)) {
+                return fail(p, "expected ) after *");
+            }
+            call.star = 1;
+        } else if (is_extract && args->count == 0 && token_is_qualified_name(peek(p, 0))) {
+            sql_node *unit = node_new(p, SQL_NODE_KEYWORD);
+            if (!token_in_words(peek(p, 0), interval_units)) {
+                return fail(p, "expected interval unit");
+            }
+            attr_ident(p, unit, "value", advance(p));
+            list_append(args, unit);
+            call.forms++;
+        } else {
+            if (!(arg = is_position && args->count == 0 ? parse_bit_or(p) : parse_expr(p))) return NULL;
+            list_append(args, arg);
+            call.values++;
+        }
+
+        if (accept_type(p, TOKEN_COMMA)) {
+            continue;
+        }
+        if (!at_type(p, TOKEN_RPAREN) && !at_kw(p, MYSQL_KW_FROM) && !at_kw(p, MYSQL_KW_FOR) &&
+            !at_kw(p, MYSQL_KW_SEPARATOR) && !at_kw(p, MYSQL_KW_AS) && !at_kw(p, MYSQL_KW_USING) &&
+            !at_kw(p, MYSQL_KW_ORDER) && !(is_position && at_kw(p, MYSQL_KW_IN))) {
+            return fail(p, "unexpected token in argument list");
+        }
+    }
+    advance(p);
+
+    attr_node(p, func, "args", args);
+
+    if (accept_kw(p, MYSQL_KW_OVER)) {
+        sql_node *window;
+        if (token_is_name(peek(p, 0))) {
+            window = node_new(p, SQL_NODE_WINDOW);
+            attr_ident(p, window, "ref", advance(p));
+        } else if (!(window = parse_window_spec(p))) {
+            return NULL;
+        }
+        attr_node(p, func, "over", window);
+        call.over = 1;
+    }
+
+    call.args = args;
+    if (!function_call_is_checked(name, qualified, &call)) {
+        p->unchecked = 1;
+    }
+    return func;
+}
+
+static sql_node* parse_function(sql_parser *p, size_t name_first) {
+    sql_node *func = node_new(p, SQL_NODE_FUNCTION);
+    mysql_token *name = peek(p, 0);
+    int qualified = p->pos != name_first;
+
+    attr_span(p, func, "name", name_first, p->pos);
+    advance(p);
+    advance(p); /* ( */
+    return parse_function_args(p, func, name, qualified);
+}
+
+static sql_node* parse_case(sql_parser *p) {
+    sql_node *node = node_new(p, SQL_NODE_CASE);
+    sql_node *whens = node_new(p, SQL_NODE_LIST);
+    sql_node *expr;
+
+    if (!at_kw(p, MYSQL_KW_WHEN)) {
+        if (!(expr = parse_expr(p))) return NULL;
+        attr_node(p, node, "operand", expr);
+    }
+    while (accept_kw(p, MYSQL_KW_WHEN)) {
+        sql_node *when = node_new(p, SQL_NODE_WHEN);
+        if (!(expr = parse_expr(p))) return NULL;
+        attr_node(p, when, "when", expr);
+        if (!expect_kw(p, MYSQL_KW_THEN) || !(expr = parse_expr(p))) return NULL;
+        attr_node(p, when, "then", expr);
+        list_append(whens, when);
+    }
+    if (whens->count == 0) {
+        return fail(p, "CASE without WHEN");
+    }
+    attr_node(p, node, "when", whens);
+    if (accept_kw(p, MYSQL_KW_ELSE)) {
+        if (!(expr = parse_expr(p))) return NULL;
+        attr_node(p, node, "else", expr);
+    }
+    if (!expect_kw(p, MYSQL_KW_END)) return NULL;
+    return node;
+}
+
+/* Column reference or qualified function name: name[.name[.name]] */
+static sql_node* parse_column_ref(sql_parser *p) {
+    mysql_token *parts[3];
+    int count = 0;
+    sql_node *node;
+
+    if (!(parts[count++] = expect_name(p))) return NULL;
+    while (count < 3 && at_type(p, TOKEN_DOT) && token_is_qualified_name(peek(p, 1))) {
+        advance(p);
+        parts[count++] = advance(p);
+    }
+
+    node = node_new(p, SQL_NODE_COLUMN);
+    if (count == 3) attr_ident(p, node, "schema", parts[0]);
+    if (count >= 2) attr_ident(p, node, "table", parts[count - 2]);
+    attr_ident(p, node, "name", parts[count - 1]);
+    return node;
+}
+
+static sql_node* literal_node(sql_parser *p, const char *kind, size_t first, size_t last) {
+    sql_node *node = node_new(p, SQL_NODE_LITERAL);
+    attr_static(p, node, "kind", kind);
+    attr_span(p, node, "value", first, last);
+    return node;
+}
+
+static sql_node* parse_primary(sql_parser *p) {
+    mysql_token *token = peek(p, 0);
+    size_t first = p->pos;
+    sql_node *node;
+
+    switch (token->type) {
+        case TOKEN_STRING:
+            /* Adjacent literals are concatenated: 'a' 'b' */
+            advance(p);
+            while (at_type(p, TOKEN_STRING) && !(peek(p, 0)->flags & TOKEN_FLAG_INTRODUCER)) advance(p);
+            return literal_node(p, "string", first, p->pos - 1);
+        case TOKEN_INTEGER:
+            advance(p);
+            return literal_node(p, "integer", first, first);
+        case TOKEN_DECIMAL:
+            advance(p);
+            return literal_node(p, "decimal", first, first);
+        case TOKEN_FLOAT:
+            advance(p);
+            return literal_node(p, "float", first, first);
+        case TOKEN_HEX_STRING:
+            advance(p);
+            return literal_node(p, "hex", first, first);
+        case TOKEN_BIT_STRING:
+            advance(p);
+            return literal_node(p, "bit", first, first);
+        case TOKEN_PLACEHOLDER:
+            advance(p);
+            p->placeholders++;
+            return node_new(p, SQL_NODE_PLACEHOLDER);
+        case TOKEN_NAMED_PLACEHOLDER:
+            advance(p);
+            p->placeholders++;
+            node = node_new(p, SQL_NODE_PLACEHOLDER);
+            attr_text(p, node, "name", token->start + 1, token->length - 1);
+            return node;
+        case TOKEN_VARIABLE:
+            advance(p);
+            node = node_new(p, SQL_NODE_VARIABLE);
+            attr_text(p, node, "name", token->start, token->length);
+            return node;
+        case TOKEN_LPAREN:
+            advance(p);
+            if (at_query_start(p) || (at_type(p, TOKEN_LPAREN) && (at_kw_ahead(p, 1, MYSQL_KW_SELECT) || at_kw_ahead(p, 1, MYSQL_KW_WITH)))) {
+                sql_node *query = parse_subquery_tail(p);
+                if (!query) return NULL;
+                node = node_new(p, SQL_NODE_SUBQUERY);
+                attr_node(p, node, "query", query);
+                return node;
+            } else {
+                sql_node *list = parse_expr_list(p);
+                if (!list || !expect_type(p, TOKEN_RPAREN)) return NULL;
+                if (list->count == 1) {
+                    return list->items;
+                }
+                node = node_new(p, SQL_NODE_ROW);
+                attr_node(p, node, "items", list);
+                return node;
+            }
+        case TOKEN_IDENTIFIER:
+        case TOKEN_QUOTED_IDENTIFIER:
+            if (peek(p, 1)->type == TOKEN_LPAREN && token->type == TOKEN_IDENTIFIER) {
+                return parse_function(p, first);
+            }
+            /* db.func( ... ) */
+            if (peek(p, 1)->type == TOKEN_DOT && token_is_qualified_name(peek(p, 2)) && peek(p, 3)->type == TOKEN_LPAREN) {
+                advance(p);
+                advance(p);
+                return parse_function(p, first);
+            }
+            break;
+        case TOKEN_KEYWORD:
+            break;
+        default:
+            return fail(p, "unexpected token in expression");
+    }
+
+    if (token->type == TOKEN_KEYWORD) {
+        switch (token->keyword) {
+            case MYSQL_KW_NULL:
+                advance(p);
+                return literal_node(p, "null", first, first);
+            case MYSQL_KW_TRUE:
+            case MYSQL_KW_FALSE:
+                advance(p);
+                return literal_node(p, "boolean", first, first);
+            case MYSQL_KW_DATE:
+            case MYSQL_KW_TIME:
+            case MYSQL_KW_TIMESTAMP:
+                if (peek(p, 1)->type == TOKEN_STRING) {
+                    advance(p);
+                    advance(p);
+                    return literal_node(p, "temporal", first, first + 1);
+                }
+                break;
+            case MYSQL_KW_EXISTS: {
+                sql_node *query;
+                advance(p);
+                if (!expect_type(p, TOKEN_LPAREN) || !(query = parse_subquery_tail(p))) return NULL;
+                node = node_new(p, SQL_NODE_EXISTS);
+                attr_node(p, node, "query", query);
+                return node;
+            }
+            case MYSQL_KW_CASE:
+                advance(p);
+                return parse_case(p);
+            case MYSQL_KW_INTERVAL: {
+                sql_node *value;
+                /* Only date arithmetic (d + INTERVAL 1 DAY) is checked; elsewhere it is up to the server */
+                if (first == 0 || !(token_is_op(&p->tokens[first - 1], "+") || token_is_op(&p->tokens[first - 1], "-"))) {
+                    p->unchecked = 1;
+                }
+                advance(p);
+                if (!(value = parse_expr(p))) return NULL;
+                if (!token_in_words(peek(p, 0), interval_units)) {
+                    return fail(p, "expected interval unit");
+                }
+                node = node_new(p, SQL_NODE_INTERVAL);
+                attr_node(p, node, "value", value);
+                attr_ident(p, node, "unit", advance(p));
+                return node;
+            }
+            case MYSQL_KW_ROW:
+                if (peek(p, 1)->type == TOKEN_LPAREN) {
+                    sql_node *list;
+                    advance(p);
+                    advance(p);
+                    if (!(list = parse_expr_list(p)) || !expect_type(p, TOKEN_RPAREN)) return NULL;
+                    if (list->count < 2) {
+                        return fail(p, "ROW needs at least two values");
+                    }
+                    node = node_new(p, SQL_NODE_ROW);
+                    attr_node(p, node, "items", list);
+                    return node;
+                }
+                break;
+            case MYSQL_KW_MATCH:
+                if (peek(p, 1)->type == TOKEN_LPAREN) {
+                    sql_node *columns = node_new(p, SQL_NODE_LIST);
+                    sql_node *against;
+                    size_t modifier;
+                    advance(p);
+                    advance(p);
+                    do {
+                        sql_node *column = parse_column_ref(p);
+                        if (!column) return NULL;
+                        list_append(columns, column);
+                    } while (accept_type(p, TOKEN_COMMA));
+                    if (!expect_type(p, TOKEN_RPAREN) || !expect_kw(p, MYSQL_KW_AGAINST) ||
+                        !expect_type(p, TOKEN_LPAREN) || !(against = parse_bit_or(p))) return NULL;
+                    node = node_new(p, SQL_NODE_MATCH);
+                    attr_node(p, node, "columns", columns);
+                    attr_node(p, node, "against", against);
+                    modifier = p->pos;
+                    while (token_is_qualified_name(peek(p, 0))) advance(p);
+                    if (p->pos > modifier) attr_span(p, node, "modifier", modifier, p->pos - 1);
+                    if (!expect_type(p, TOKEN_RPAREN)) return NULL;
+                    return node;
+                }
+                break;
+            case MYSQL_KW_CURRENT_DATE: case MYSQL_KW_CURRENT_TIME: case MYSQL_KW_CURRENT_TIMESTAMP:
+            case MYSQL_KW_CURRENT_USER: case MYSQL_KW_LOCALTIME: case MYSQL_KW_LOCALTIMESTAMP:
+            case MYSQL_KW_UTC_DATE: case MYSQL_KW_UTC_TIME: case MYSQL_KW_UTC_TIMESTAMP:
+            case MYSQL_KW_DEFAULT:
+                if (peek(p, 1)->type != TOKEN_LPAREN) {
+                    advance(p);
+                    return literal_node(p, "keyword", first, first);
+                }
+                break;
+            default:
+                break;
+        }
+
+        if (peek(p, 1)->type == TOKEN_LPAREN &&
+            (!(token->flags & TOKEN_FLAG_RESERVED) || is_function_keyword(token->keyword))) {
+            return parse_function(p, first);
+        }
+    }
+
+    if (!token_is_name(token)) {
+        return fail(p, "unexpected keyword in expression");
+    }
+    if (!(node = parse_column_ref(p))) return NULL;
+
+    /* JSON path shorthand: col->'$.a', col->>'$.a' */
+    if (at_op(p, "->") || at_op(p, "->>")) {
+        sql_node *binary = node_new(p, SQL_NODE_BINARY);
+        mysql_token *op = advance(p);
+        if (!at_type(p, TOKEN_STRING)) return fail(p, "expected JSON path");
+        attr_text(p, binary, "operator", op->start, op->length);
+        attr_node(p, binary, "left", node);
+        first = p->pos;
+        advance(p);
+        attr_node(p, binary, "right", literal_node(p, "string", first, first));
+        return binary;
+    }
+    return node;
+}
+
+static sql_node* parse_collate(sql_parser *p) {
+    sql_node *expr = parse_primary(p);
+    while (expr && accept_kw(p, MYSQL_KW_COLLATE)) {
+        sql_node *node = node_new(p, SQL_NODE_COLLATE);
+        mysql_token *name = peek(p, 0);
+        if (!token_is_name(name) && name->type != TOKEN_STRING) {
+            return fail(p, "expected collation name");
+        }
+        advance(p);
+        attr_node(p, node, "operand", expr);
+        attr_ident(p, node, "collation", name);
+        expr = node;
+    }
+    return expr;
+}
+
+static sql_node* parse_unary(sql_parser *p) {
+    mysql_token *token = peek(p, 0);
+    sql_node *node, *operand;
+
+    if (token_is_op(token, "-") || token_is_op(token, "+") || token_is_op(token, "~") ||
+        token_is_op(token, "!") || mysql_token_is_keyword(token, MYSQL_KW_BINARY)) {
+        if (!enter(p)) return NULL;
+        advance(p);
+        if (!(operand = parse_unary(p))) LEAVE(p, NULL);
+        node = node_new(p, SQL_NODE_UNARY);
+        if (token->type == TOKEN_KEYWORD) {
+            attr_static(p, node, "operator", "BINARY");
+        } else {
+            attr_text(p, node, "operator", token->start, token->length);
+        }
+        attr_node(p, node, "operand", operand);
+        LEAVE(p, node);
+    }
+    return parse_collate(p);
+}
+
+static sql_node* binary_node(sql_parser *p, const char *op, size_t op_len, sql_node *left, sql_node *right) {
+    sql_node *node = node_new(p, SQL_NODE_BINARY);
+    attr_text(p, node, "operator", op, op_len);
+    attr_node(p, node, "left", left);
+    attr_node(p, node, "right", right);
+    return node;
+}
+
+/*
+ * Binary operator levels, loosest first. Keyword operators are stored by
+ * their canonical spelling, symbolic ones as written.
+ */
+enum binary_level { LEVEL_BIT_OR, LEVEL_BIT_AND, LEVEL_SHIFT, LEVEL_ADD, LEVEL_MUL, LEVEL_BIT_XOR };
+
+static int level_operator(sql_parser *p, enum binary_level level) {
+    mysql_token *token = peek(p, 0);
+    switch (level) {
+        case LEVEL_BIT_OR:  return token_is_op(token, "|");
+        case LEVEL_BIT_AND: return token_is_op(token, "&");
+        case LEVEL_SHIFT:   return token_is_op(token, "<<") || token_is_op(token, ">>");
+        case LEVEL_ADD:     return token_is_op(token, "+") || token_is_op(token, "-");
+        case LEVEL_MUL:     return token_is_op(token, "*") || token_is_op(token, "/") || token_is_op(token, "%") ||
+                                   mysql_token_is_keyword(token, MYSQL_KW_DIV) || mysql_token_is_keyword(token, MYSQL_KW_MOD);
+        case LEVEL_BIT_XOR: return token_is_op(token, "^");
+    }
+    return 0;
+}
+
+static sql_node* parse_level(sql_parser *p, enum binary_level level) {
+    sql_node *left = level == LEVEL_BIT_XOR ? parse_unary(p) : parse_level(p, level + 1);
+
+    while (left && level_operator(p, level)) {
+        mysql_token *op = advance(p);
+        sql_node *right = level == LEVEL_BIT_XOR ? parse_unary(p) : parse_level(p, level + 1);
+        if (!right) return NULL;
+        if (op->type == TOKEN_KEYWORD) {
+            left = binary_node(p, mysql_keyword_name(op->keyword), strlen(mysql_keyword_name(op->keyword)), left, right);
+        } else {
+            left = binary_node(p, op->start, op->length, left, right);
+        }
+    }
+    return left;
+}
+
+static sql_node* parse_bit_or(sql_parser *p) {
+    return parse_level(p, LEVEL_BIT_OR);
+}
+
+/* [NOT] IN / BETWEEN / LIKE / REGEXP and SOUNDS LIKE */
+static sql_node* parse_predicate(sql_parser *p) {
+    sql_node *left = parse_bit_or(p);
+    sql_node *node;
+    int negated;
+
+    if (!left) return NULL;
+
+    negated = at_kw(p, MYSQL_KW_NOT) &&
+        (at_kw_ahead(p, 1, MYSQL_KW_IN) || at_kw_ahead(p, 1, MYSQL_KW_BETWEEN) || at_kw_ahead(p, 1, MYSQL_KW_LIKE) ||
+         at_kw_ahead(p, 1, MYSQL_KW_REGEXP) || at_kw_ahead(p, 1, MYSQL_KW_RLIKE));
+    if (negated) advance(p);
+
+    if (accept_kw(p, MYSQL_KW_IN)) {
+        node = node_new(p, SQL_NODE_IN);
+        attr_node(p, node, "operand", left);
+        if (negated) attr_bool(p, node, "not");
+        if (!expect_type(p, TOKEN_LPAREN)) return NULL;
+        if (at_query_start(p)) {
+            sql_node *query = parse_subquery_tail(p);
+            if (!query) return NULL;
+            attr_node(p, node, "query", query);
+        } else {
+            sql_node *list = parse_expr_list(p);
+            if (!list || !expect_type(p, TOKEN_RPAREN)) return NULL;
+            attr_node(p, node, "list", list);
+        }
+        return node;
+    }
+
+    if (accept_kw(p, MYSQL_KW_BETWEEN)) {
+        sql_node *low, *high;
+        if (!(low = parse_bit_or(p)) || !expect_kw(p, MYSQL_KW_AND) || !(high = parse_predicate(p))) return NULL;
+        node = node_new(p, SQL_NODE_BETWEEN);
+        attr_node(p, node, "operand", left);
+        if (negated) attr_bool(p, node, "not");
+        attr_node(p, node, "low", low);
+        attr_node(p, node, "high", high);
+        return node;
+    }
+
+    if (at_kw(p, MYSQL_KW_LIKE) || at_kw(p, MYSQL_KW_REGEXP) || at_kw(p, MYSQL_KW_RLIKE) ||
+        (!negated && at_word(p, 0, "SOUNDS") && at_kw_ahead(p, 1, MYSQL_KW_LIKE))) {
+        mysql_token *op = advance(p);
+        sql_node *pattern;
+        node = node_new(p, SQL_NODE_LIKE);
+        attr_node(p, node, "operand", left);
+        if (negated) attr_bool(p, node, "not");
+        if (op->type == TOKEN_IDENTIFIER) {
+            advance(p);
+            attr_static(p, node, "operator", "SOUNDS LIKE");
+        } else {
+            attr_static(p, node, "operator", mysql_keyword_name(op->keyword));
+        }
+        if (!(pattern = parse_bit_or(p))) return NULL;
+        attr_node(p, node, "pattern", pattern);
+        if (op->keyword == MYSQL_KW_LIKE && accept_kw(p, MYSQL_KW_ESCAPE)) {
+            sql_node *escape = parse_primary(p);
+            if (!escape) return NULL;
+            attr_node(p, node, "escape", escape);
+        }
+        return node;
+    }
+
+    if (negated) {
+        return fail(p, "unexpected NOT");
+    }
+    return left;
+}
+
+static int at_comparison(sql_parser *p) {
+    static const char *const ops[] = { "=", "<=>", ">=", ">", "<=", "<", "<>", "!=", NULL };
+    for (int i = 0; ops[i]; i++) {
+        if (at_op(p, ops[i])) return 1;
+    }
+    return 0;
+}
+
+static sql_node* parse_comparison(sql_parser *p) {
+    sql_node *left = parse_predicate(p);
+
+    while (left && (at_comparison(p) || at_kw(p, MYSQL_KW_IS))) {
+        if (accept_kw(p, MYSQL_KW_IS)) {
+            sql_node *node = node_new(p, SQL_NODE_IS);
+            attr_node(p, node, "operand", left);
+            if (accept_kw(p, MYSQL_KW_NOT)) attr_bool(p, node, "not");
+            if (!at_kw(p, MYSQL_KW_NULL) && !at_kw(p, MYSQL_KW_TRUE) &&
+                !at_kw(p, MYSQL_KW_FALSE) && !at_kw(p, MYSQL_KW_UNKNOWN)) {
+                return fail(p, "expected NULL, TRUE, FALSE or UNKNOWN");
+            }
+            attr_static(p, node, "value", mysql_keyword_name(advance(p)->keyword));
+            left = node;
+        } else {
+            mysql_token *op = advance(p);
+            sql_node *right;
+            if ((at_kw(p, MYSQL_KW_ANY) || at_kw(p, MYSQL_KW_SOME) || at_kw(p, MYSQL_KW_ALL)) &&
+                peek(p, 1)->type == TOKEN_LPAREN) {
+                mysql_token *quantifier = advance(p);
+                sql_node *query;
+                advance(p);
+                if (!(query = parse_subquery_tail(p))) return NULL;
+                right = node_new(p, SQL_NODE_SUBQUERY);
+                attr_node(p, right, "query", query);
+                left = binary_node(p, op->start, op->length, left, right);
+                attr_static(p, left, "quantifier", mysql_keyword_name(quantifier->keyword));
+                continue;
+            }
+            if (!(right = parse_predicate(p))) return NULL;
+            left = binary_node(p, op->start, op->length, left, right);
+        }
+    }
+    return left;
+}
+
+static sql_node* parse_not(sql_parser *p) {
+    if (at_kw(p, MYSQL_KW_NOT)) {
+        sql_node *node, *operand;
+        if (!enter(p)) return NULL;
+        advance(p);
+        if (!(operand = parse_not(p))) LEAVE(p, NULL);
+        node = node_new(p, SQL_NODE_UNARY);
+        attr_static(p, node, "operator", "NOT");
+        attr_node(p, node, "operand", operand);
+        LEAVE(p, node);
+    }
+    return parse_comparison(p);
+}
+
+static sql_node* parse_and(sql_parser *p) {
+    sql_node *left = parse_not(p);
+    while (left && (at_kw(p, MYSQL_KW_AND) || at_op(p, "&&"))) {
+        sql_node *right;
+        advance(p);
+        if (!(right = parse_not(p))) return NULL;
+        left = binary_node(p, "AND", 3, left, right);
+    }
+    return left;
+}
+
+static sql_node* parse_xor(sql_parser *p) {
+    sql_node *left = parse_and(p);
+    while (left && accept_kw(p, MYSQL_KW_XOR)) {
+        sql_node *right = parse_and(p);
+        if (!right) return NULL;
+        left = binary_node(p, "XOR", 3, left, right);
+    }
+    return left;
+}
+
+static sql_node* parse_expr(sql_parser *p) {
+    sql_node *left;
+
+    if (!enter(p)) return NULL;
+    left = parse_xor(p);
+    while (left && (at_kw(p, MYSQL_KW_OR) || at_op(p, "||"))) {
+        sql_node *right;
+        advance(p);
+        if (!(right = parse_xor(p))) LEAVE(p, NULL);
+        left = binary_node(p, "OR", 2, left, right);
+    }
+    LEAVE(p, left);
+}
+
+/* Windows */
+
+static int parse_frame_bound(sql_parser *p) {
+    if (accept_kw(p, MYSQL_KW_UNBOUNDED)) {
+        return accept_kw(p, MYSQL_KW_PRECEDING) || expect_kw(p, MYSQL_KW_FOLLOWING);
+    }
+    if (accept_kw(p, MYSQL_KW_CURRENT)) {
+        return expect_kw(p, MYSQL_KW_ROW);
+    }
+    if (!parse_bit_or(p)) return 0;
+    return accept_kw(p, MYSQL_KW_PRECEDING) || expect_kw(p, MYSQL_KW_FOLLOWING);
+}
+
+/* ( [base] [PARTITION BY ...] [ORDER BY ...] [frame] ) */
+static sql_node* parse_window_spec(sql_parser *p) {
+    sql_node *window = node_new(p, SQL_NODE_WINDOW);
+    sql_node *list;
+
+    if (!expect_type(p, TOKEN_LPAREN)) return NULL;
+    if (token_is_name(peek(p, 0))) {
+        attr_ident(p, window, "base", advance(p));
+    }
+    if (accept_kw(p, MYSQL_KW_PARTITION)) {
+        if (!expect_kw(p, MYSQL_KW_BY) || !(list = parse_expr_list(p))) return NULL;
+        attr_node(p, window, "partition_by", list);
+    }
+    if (accept_kw(p, MYSQL_KW_ORDER)) {
+        if (!expect_kw(p, MYSQL_KW_BY) || !(list = parse_order_list(p))) return NULL;
+        attr_node(p, window, "order_by", list);
+    }
+    if (at_kw(p, MYSQL_KW_ROWS) || at_kw(p, MYSQL_KW_RANGE)) {
+        size_t first = p->pos;
+        advance(p);
+        if (accept_kw(p, MYSQL_KW_BETWEEN)) {
+            if (!parse_frame_bound(p) || !expect_kw(p, MYSQL_KW_AND) || !parse_frame_bound(p)) return NULL;
+        } else if (!parse_frame_bound(p)) {
+            return NULL;
+        }
+        attr_span(p, window, "frame", first, p->pos - 1);
+    }
+    if (!expect_type(p, TOKEN_RPAREN)) return NULL;
+    return window;
+}
+
+/* Table references */
+
+static sql_node* parse_alias(sql_parser *p, sql_node *node, int allow_string) {
+    mysql_token *token;
+
+    if (accept_kw(p, MYSQL_KW_AS)) {
+        token = peek(p, 0);
+        if (!token_is_name(token) && !(allow_string && token->type == TOKEN_STRING)) {
+            return fail(p, "expected alias");
+        }
+    } else {
+        token = peek(p, 0);
+        if (!token_is_name(token) && !(allow_string && token->type == TOKEN_STRING)) {
+            return node;
+        }
+    }
+    attr_ident(p, node, "alias", advance(p));
+    return node;
+}
+
+static sql_node* parse_name_list(sql_parser *p) {
+    sql_node *list = node_new(p, SQL_NODE_LIST);
+    if (!expect_type(p, TOKEN_LPAREN)) return NULL;
+    do {
+        mysql_token *name = expect_name(p);
+        if (!name) return NULL;
+        list_append(list, name_node(p, name));
+    } while (accept_type(p, TOKEN_COMMA));
+    if (!expect_type(p, TOKEN_RPAREN)) return NULL;
+    return list;
+}
+
+/* USE|IGNORE|FORCE {INDEX|KEY} [FOR {JOIN|ORDER BY|GROUP BY}] ([names]) */
+static sql_node* parse_index_hints(sql_parser *p) {
+    sql_node *hints = node_new(p, SQL_NODE_LIST);
+
+    while (at_kw(p, MYSQL_KW_USE) || at_kw(p, MYSQL_KW_IGNORE) || at_kw(p, MYSQL_KW_FORCE)) {
+        size_t first = p->pos;
+        sql_node *hint = node_new(p, SQL_NODE_NAME);
+
+        advance(p);
+        if (!accept_kw(p, MYSQL_KW_INDEX) && !expect_kw(p, MYSQL_KW_KEY)) return NULL;
+        if (accept_kw(p, MYSQL_KW_FOR)) {
+            if (accept_kw(p, MYSQL_KW_ORDER) || accept_kw(p, MYSQL_KW_GROUP)) {
+                if (!expect_kw(p, MYSQL_KW_BY)) return NULL;
+            } else if (!expect_kw(p, MYSQL_KW_JOIN)) {
+                return NULL;
+            }
+        }
+        if (!expect_type(p, TOKEN_LPAREN)) return NULL;
+        while (!at_type(p, TOKEN_RPAREN)) {
+            if (!accept_kw(p, MYSQL_KW_PRIMARY) && !expect_name(p)) return NULL;
+            if (!accept_type(p, TOKEN_COMMA) && !at_type(p, TOKEN_RPAREN)) return fail(p, "unexpected token in index hint");
+        }
+        advance(p);
+        attr_span(p, hint, "text", first, p->pos - 1);
+        list_append(hints, hint);
+        accept_type(p, TOKEN_COMMA);
+        if (!at_kw(p, MYSQL_KW_USE) && !at_kw(p, MYSQL_KW_IGNORE) && !at_kw(p, MYSQL_KW_FORCE)) {
+            /* A trailing comma belongs to the table list */
+            if (p->tokens[p->pos - 1].type == TOKEN_COMMA) p->pos--;
+        }
+    }
+    return hints;
+}
+
+/* Plain table name: [schema.]table */
+static sql_node* parse_table_name(sql_parser *p) {
+    sql_node *table = node_new(p, SQL_NODE_TABLE);
+    mysql_token *name = expect_name(p);
+
+    if (!name) return NULL;
+    if (at_type(p, TOKEN_DOT) && token_is_qualified_name(peek(p, 1))) {
+        advance(p);
+        attr_ident(p, table, "schema", name);
+        name = advance(p);
+    }
+    attr_ident(p, table, "name", name);
+    return table;
+}
+
+static sql_node* parse_table_factor(sql_parser *p) {
+    sql_node *node;
+
+    if (at_kw(p, MYSQL_KW_DUAL)) {
+        node = node_new(p, SQL_NODE_TABLE);
+        attr_static(p, node, "name", "DUAL");
+        advance(p);
+        return node;
+    }
+
+    if (at_type(p, TOKEN_LPAREN) || (at_kw(p, MYSQL_KW_LATERAL) && peek(p, 1)->type == TOKEN_LPAREN)) {
+        int lateral = accept_kw(p, MYSQL_KW_LATERAL);
+        size_t saved = p->pos;
+        sql_node *query = NULL;
+
+        advance(p);
+        if (at_query_start(p) || at_type(p, TOKEN_LPAREN)) {
+            query = parse_query_expression(p);
+            if (!query || !at_type(p, TOKEN_RPAREN)) {
+                if (lateral || at_query_start(p)) {
+                    return query ? fail(p, "expected )") : NULL;
+                }
+                /* Not a query after all: ((t1 JOIN t2) ...) */
+                p->error = NULL;
+                p->error_pos = NULL;
+                p->pos = saved + 1;
+                query = NULL;
+            }
+        }
+
+        if (query) {
+            sql_node *columns;
+            advance(p);
+            node = node_new(p, SQL_NODE_DERIVED);
+            if (lateral) attr_bool(p, node, "lateral");
+            attr_node(p, node, "query", query);
+            if (!parse_alias(p, node, 0)) return NULL;
+            if (at_type(p, TOKEN_LPAREN)) {
+                if (!(columns = parse_name_list(p))) return NULL;
+                attr_node(p, node, "columns", columns);
+            }
+            return node;
+        }
+        if (lateral) return fail(p, "expected subquery after LATERAL");
+
+        node = node_new(p, SQL_NODE_TABLE_GROUP);
+        {
+            sql_node *tables = parse_table_refs(p);
+            if (!tables || !expect_type(p, TOKEN_RPAREN)) return NULL;
+            attr_node(p, node, "tables", tables);
+        }
+        return node;
+    }
+
+    if (!(node = parse_table_name(p))) return NULL;
+    if (accept_kw(p, MYSQL_KW_PARTITION)) {
+        sql_node *partitions = parse_name_list(p);
+        if (!partitions) return NULL;
+        attr_node(p, node, "partitions", partitions);
+    }
+    if (!parse_alias(p, node, 0)) return NULL;
+    if (at_kw(p, MYSQL_KW_USE) || at_kw(p, MYSQL_KW_IGNORE) || at_kw(p, MYSQL_KW_FORCE)) {
+        sql_node *hints = parse_index_hints(p);
+        if (!hints) return NULL;
+        attr_node(p, node, "index_hints", hints);
+    }
+    return node;
+}
+
+/* Join operator at the cursor, or NULL; *needs_condition is set for LEFT/RIGHT */
+static const char* parse_join_type(sql_parser *p, int *needs_condition, int *natural) {
+    *needs_condition = 0;
+    *natural = 0;
+
+    if (accept_kw(p, MYSQL_KW_JOIN)) return "JOIN";
+    if (at_kw(p, MYSQL_KW_INNER) && at_kw_ahead(p, 1, MYSQL_KW_JOIN)) {
+        p->pos += 2;
+        return "INNER JOIN";
+    }
+    if (at_kw(p, MYSQL_KW_CROSS) && at_kw_ahead(p, 1, MYSQL_KW_JOIN)) {
+        p->pos += 2;
+        return "CROSS JOIN";
+    }
+    if (accept_kw(p, MYSQL_KW_STRAIGHT_JOIN)) return "STRAIGHT_JOIN";
+    if (at_kw(p, MYSQL_KW_LEFT) || at_kw(p, MYSQL_KW_RIGHT)) {
+        int left = at_kw(p, MYSQL_KW_LEFT);
+        advance(p);
+        accept_kw(p, MYSQL_KW_OUTER);
+        if (!expect_kw(p, MYSQL_KW_JOIN)) return NULL;
+        *needs_condition = 1;
+        return left ? "LEFT JOIN" : "RIGHT JOIN";
+    }
+    if (accept_kw(p, MYSQL_KW_NATURAL)) {
+        const char *type = "NATURAL JOIN";
+        *natural = 1;
+        if (accept_kw(p, MYSQL_KW_LEFT)) {
+            accept_kw(p, MYSQL_KW_OUTER);
+            type = "NATURAL LEFT JOIN";
+        } else if (accept_kw(p, MYSQL_KW_RIGHT)) {
+            accept_kw(p, MYSQL_KW_OUTER);
+            type = "NATURAL RIGHT JOIN";
+        } else {
+            accept_kw(p, MYSQL_KW_INNER);
+        }
+        if (!expect_kw(p, MYSQL_KW_JOIN)) return NULL;
+        return type;
+    }
+    return NULL;
+}
+
+static int at_join(sql_parser *p) {
+    return at_kw(p, MYSQL_KW_JOIN) || at_kw(p, MYSQL_KW_INNER) || at_kw(p, MYSQL_KW_CROSS) ||
+        at_kw(p, MYSQL_KW_STRAIGHT_JOIN) || at_kw(p, MYSQL_KW_LEFT) || at_kw(p, MYSQL_KW_RIGHT) ||
+        at_kw(p, MYSQL_KW_NATURAL);
+}
+
+static sql_node* parse_table_ref(sql_parser *p) {
+    sql_node *left;
+
+    if (!enter(p)) return NULL;
+    if (!(left = parse_table_factor(p))) LEAVE(p, NULL);
+
+    while (at_join(p)) {
+        int needs_condition, natural;
+        const char *type = parse_join_type(p, &needs_condition, &natural);
+        sql_node *join, *right;
+
+        if (!type || !(right = parse_table_factor(p))) LEAVE(p, NULL);
+
+        join = node_new(p, SQL_NODE_JOIN);
+        attr_static(p, join, "join_type", type);
+        attr_node(p, join, "left", left);
+        attr_node(p, join, "right", right);
+
+        if (!natural && accept_kw(p, MYSQL_KW_ON)) {
+            sql_node *on = parse_expr(p);
+            if (!on) LEAVE(p, NULL);
+            attr_node(p, join, "on", on);
+        } else if (!natural && accept_kw(p, MYSQL_KW_USING)) {
+            sql_node *columns = parse_name_list(p);
+            if (!columns) LEAVE(p, NULL);
+            attr_node(p, join, "using", columns);
+        } else if (needs_condition) {
+            LEAVE(p, fail(p, "expected ON or USING"));
+        }
+        left = join;
+    }
+    LEAVE(p, left);
+}
+
+static sql_node* parse_table_refs(sql_parser *p) {
+    sql_node *list = node_new(p, SQL_NODE_LIST);
+    do {
+        sql_node *ref = parse_table_ref(p);
+        if (!ref) return NULL;
+        list_append(list, ref);
+    } while (accept_type(p, TOKEN_COMMA));
+    return list;
+}
+
+/* Query expressions */
+
+static sql_node* parse_with(sql_parser *p) {
+    sql_node *ctes = node_new(p, SQL_NODE_LIST);
+
+    do {
+        sql_node *cte = node_new(p, SQL_NODE_CTE);
+        mysql_token *name = expect_name(p);
+        sql_node *query;
+
+        if (!name) return NULL;
+        attr_ident(p, cte, "name", name);
+        if (at_type(p, TOKEN_LPAREN)) {
+            sql_node *columns = parse_name_list(p);
+            if (!columns) return NULL;
+            attr_node(p, cte, "columns", columns);
+        }
+        if (!expect_kw(p, MYSQL_KW_AS) || !expect_type(p, TOKEN_LPAREN) || !(query = parse_subquery_tail(p))) {
+            return NULL;
+        }
+        attr_node(p, cte, "query", query);
+        list_append(ctes, cte);
+    } while (accept_type(p, TOKEN_COMMA));
+
+    return ctes;
+}
+
+static sql_node* parse_select_item(sql_parser *p) {
+    sql_node *expr;
+
+    if (accept_op(p, "*")) {
+        return node_new(p, SQL_NODE_STAR);
+    }
+    /* t.* and db.t.* */
+    if (token_is_name(peek(p, 0)) && peek(p, 1)->type == TOKEN_DOT) {
+        size_t ahead = 2;
+        if (token_is_qualified_name(peek(p, 2)) && peek(p, 3)->type == TOKEN_DOT) ahead = 4;
+        if (token_is_op(peek(p, ahead), "*")) {
+            sql_node *star = node_new(p, SQL_NODE_STAR);
+            if (ahead == 4) {
+                attr_ident(p, star, "schema", peek(p, 0));
+                attr_ident(p, star, "table", peek(p, 2));
+            } else {
+                attr_ident(p, star, "table", peek(p, 0));
+            }
+            p->pos += ahead + 1;
+            return star;
+        }
+    }
+
+    if (!(expr = parse_expr(p))) return NULL;
+    return parse_alias(p, expr, 1);
+}
+
+/* A LIMIT value: an integer or a placeholder; a name is a stored program variable, left to the server */
+static sql_node* parse_limit_value(sql_parser *p) {
+    if (at_type(p, TOKEN_INTEGER) || at_type(p, TOKEN_PLACEHOLDER) || at_type(p, TOKEN_NAMED_PLACEHOLDER)) {
+        return parse_primary(p);
+    }
+    if (token_is_name(peek(p, 0))) {
+        p->unchecked = 1;
+        return parse_primary(p);
+    }
+    return fail(p, "expected row count");
+}
+
+/* LIMIT row_count | LIMIT offset, row_count | LIMIT row_count OFFSET offset */
+static int parse_limit(sql_parser *p, sql_node *node, int allow_offset) {
+    sql_node *count, *offset = NULL;
+
+    if (!accept_kw(p, MYSQL_KW_LIMIT)) return 1;
+    if (!(count = parse_limit_value(p))) return 0;
+    if (allow_offset && accept_type(p, TOKEN_COMMA)) {
+        offset = count;
+        if (!(count = parse_limit_value(p))) return 0;
+    } else if (allow_offset && accept_kw(p, MYSQL_KW_OFFSET)) {
+        if (!(offset = parse_limit_value(p))) return 0;
+    }
+    attr_node(p, node, "limit", count);
+    if (offset) attr_node(p, node, "offset", offset);
+    return 1;
+}
+
+/* FOR UPDATE | FOR SHARE [OF t, ...] [NOWAIT | SKIP LOCKED] | LOCK IN SHARE MODE */
+static int parse_locking(sql_parser *p, sql_node *node) {
+    while (at_kw(p, MYSQL_KW_FOR) || at_kw(p, MYSQL_KW_LOCK)) {
+        size_t first = p->pos;
+        if (accept_kw(p, MYSQL_KW_LOCK)) {
+            if (!expect_kw(p, MYSQL_KW_IN) || !expect_kw(p, MYSQL_KW_SHARE) || !expect_kw(p, MYSQL_KW_MODE)) return 0;
+        } else {
+            advance(p);
+            if (!accept_kw(p, MYSQL_KW_UPDATE) && !expect_kw(p, MYSQL_KW_SHARE)) return 0;
+            if (accept_kw(p, MYSQL_KW_OF)) {
+                do {
+                    if (!parse_table_name(p)) return 0;
+                } while (accept_type(p, TOKEN_COMMA));
+            }
+            if (accept_kw(p, MYSQL_KW_SKIP)) {
+                if (!expect_kw(p, MYSQL_KW_LOCKED)) return 0;
+            } else {
+                accept_kw(p, MYSQL_KW_NOWAIT);
+            }
+        }
+        attr_span(p, node, "lock", first, p->pos - 1);
+    }
+    return 1;
+}
+
+static int is_select_option(int keyword) {
+    switch (keyword) {
+        case MYSQL_KW_ALL: case MYSQL_KW_DISTINCT: case MYSQL_KW_DISTINCTROW:
+        case MYSQL_KW_HIGH_PRIORITY: case MYSQL_KW_STRAIGHT_JOIN: case MYSQL_KW_SQL_SMALL_RESULT:
+        case MYSQL_KW_SQL_BIG_RESULT: case MYSQL_KW_SQL_BUFFER_RESULT: case MYSQL_KW_SQL_NO_CACHE:
+        case MYSQL_KW_SQL_CACHE: case MYSQL_KW_SQL_CALC_FOUND_ROWS:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/* SELECT up to (not including) ORDER BY / LIMIT, which belong to the query expression */
+static sql_node* parse_select(sql_parser *p) {
+    sql_node *select = node_new(p, SQL_NODE_SELECT);
+    sql_node *options = NULL, *fields, *list, *expr;
+
+    if (!expect_kw(p, MYSQL_KW_SELECT)) return NULL;
+
+    while (peek(p, 0)->type == TOKEN_KEYWORD && is_select_option(peek(p, 0)->keyword)) {
+        if (!options) options = node_new(p, SQL_NODE_LIST);
+        list_append(options, name_node(p, advance(p)));
+    }
+    if (options) attr_node(p, select, "options", options);
+
+    fields = node_new(p, SQL_NODE_LIST);
+    do {
+        sql_node *item;
+        /* SELECT *, a is fine; SELECT a, * is not */
+        if (fields->count > 0 && at_op(p, "*")) {
+            return fail(p, "* must come first in the select list");
+        }
+        if (!(item = parse_select_item(p))) return NULL;
+        list_append(fields, item);
+    } while (accept_type(p, TOKEN_COMMA));
+    attr_node(p, select, "fields", fields);
+
+    if (at_kw(p, MYSQL_KW_INTO)) {
+        return fail(p, "SELECT ... INTO is not supported");
+    }
+
+    if (accept_kw(p, MYSQL_KW_FROM)) {
+        if (!(list = parse_table_refs(p))) return NULL;
+        attr_node(p, select, "from", list);
+    }
+    if (accept_kw(p, MYSQL_KW_WHERE)) {
+        if (!(expr = parse_expr(p))) return NULL;
+        attr_node(p, select, "where", expr);
+    }
+    if (accept_kw(p, MYSQL_KW_GROUP)) {
+        if (!expect_kw(p, MYSQL_KW_BY) || !(list = parse_order_list(p))) return NULL;
+        attr_node(p, select, "group_by", list);
+        if (at_kw(p, MYSQL_KW_WITH) && at_kw_ahead(p, 1, MYSQL_KW_ROLLUP)) {
+            p->pos += 2;
+            attr_bool(p, select, "with_rollup");
+        }
+    }
+    if (accept_kw(p, MYSQL_KW_HAVING)) {
+        if (!(expr = parse_expr(p))) return NULL;
+        attr_node(p, select, "having", expr);
+    }
+    if (accept_kw(p, MYSQL_KW_WINDOW)) {
+        list = node_new(p, SQL_NODE_LIST);
+        do {
+            mysql_token *name = expect_name(p);
+            sql_node *window;
+            sql_attr *attr;
+            if (!name || !expect_kw(p, MYSQL_KW_AS) || !(window = parse_window_spec(p))) return NULL;
+            attr = attr_prepend(p, window, "name", SQL_ATTR_IDENT);
+            attr->text = name->start;
+            attr->text_len = name->length;
+            list_append(list, window);
+        } while (accept_type(p, TOKEN_COMMA));
+        attr_node(p, select, "window", list);
+    }
+    return select;
+}
+
+static sql_node* parse_query_primary(sql_parser *p) {
+    sql_node *query;
+
+    if (!enter(p)) return NULL;
+    if (accept_type(p, TOKEN_LPAREN)) {
+        if (!(query = parse_subquery_tail(p))) LEAVE(p, NULL);
+        attr_bool(p, query, "parenthesized");
+        LEAVE(p, query);
+    }
+    LEAVE(p, parse_select(p));
+}
+
+static int has_attr(const sql_node *node, const char *key) {
+    for (sql_attr *attr = node->attrs; attr; attr = attr->next) {
+        if (strcmp(attr->key, key) == 0) return 1;
+    }
+    return 0;
+}
+
+/* [WITH ...] primary {UNION|EXCEPT|INTERSECT [ALL|DISTINCT] primary}* [ORDER BY] [LIMIT] [locking] */
+static sql_node* parse_query_expression(sql_parser *p) {
+    sql_node *with = NULL, *query, *list;
+    int recursive = 0;
+
+    if (accept_kw(p, MYSQL_KW_WITH)) {
+        recursive = accept_kw(p, MYSQL_KW_RECURSIVE);
+        if (!(with = parse_with(p))) return NULL;
+    }
+
+    if (!(query = parse_query_primary(p))) return NULL;
+
+    while (at_kw(p, MYSQL_KW_UNION) || at_kw(p, MYSQL_KW_EXCEPT) || at_kw(p, MYSQL_KW_INTERSECT)) {
+        sql_node *set = node_new(p, SQL_NODE_UNION);
+        sql_node *right;
+        mysql_token *op = advance(p);
+
+        attr_static(p, set, "operator", mysql_keyword_name(op->keyword));
+        if (accept_kw(p, MYSQL_KW_ALL)) {
+            attr_bool(p, set, "all");
+        } else if (accept_kw(p, MYSQL_KW_DISTINCT)) {
+            attr_bool(p, set, "distinct");
+        }
+        if (!(right = parse_query_primary(p))) return NULL;
+        attr_node(p, set, "left", query);
+        attr_node(p, set, "right", right);
+        query = set;
+    }
+
+    if (at_kw(p, MYSQL_KW_ORDER) || at_kw(p, MYSQL_KW_LIMIT)) {
+        if (has_attr(query, "order_by") || has_attr(query, "limit")) {
+            return fail(p, "nested ORDER BY/LIMIT is not supported");
+        }
+        if (accept_kw(p, MYSQL_KW_ORDER)) {
+            if (!expect_kw(p, MYSQL_KW_BY) || !(list = parse_order_list(p))) return NULL;
+            attr_node(p, query, "order_by", list);
+        }
+        if (!parse_limit(p, query, 1)) return NULL;
+    }
+    if (!parse_locking(p, query)) return NULL;
+
+    if (with) {
+        if (has_attr(query, "with")) {
+            return fail(p, "nested WITH is not supported");
+        }
+        if (recursive) {
+            attr_prepend(p, query, "recursive", SQL_ATTR_BOOL)->text_len = 1;
+        }
+        attr_prepend(p, query, "with", SQL_ATTR_NODE)->node = with;
+    }
+    return query;
+}
+
+/* Data-modifying statements */
+
+static sql_node* parse_assignments(sql_parser *p) {
+    sql_node *list = node_new(p, SQL_NODE_LIST);
+    do {
+        sql_node *column = parse_column_ref(p), *value;
+        if (!column) return NULL;
+        if (!accept_op(p, "=") && !accept_op(p, ":=")) return fail(p, "expected =");
+        if (!(value = parse_expr(p))) return NULL;
+        list_append(list, binary_node(p, "=", 1, column, value));
+    } while (accept_type(p, TOKEN_COMMA));
+    return list;
+}
+
+static sql_node* parse_statement_options(sql_parser *p, const int *allowed) {
+    sql_node *options = NULL;
+    int found = 1;
+
+    while (found) {
+        found = 0;
+        for (int i = 0; allowed[i]; i++) {
+            if (at_kw(p, allowed[i])) {
+                if (!options) options = node_new(p, SQL_NODE_LIST);
+                list_append(options, name_node(p, advance(p)));
+                found = 1;
+                break;
+            }
+        }
+    }
+    return options;
+}
+
+/* INSERT/REPLACE [options] [INTO] t [PARTITION] [(cols)] {VALUES ...|SET ...|query} [AS alias] [ON DUPLICATE KEY UPDATE ...] */
+static sql_node* parse_insert(sql_parser *p) {
+    static const int insert_options[] = { MYSQL_KW_LOW_PRIORITY, MYSQL_KW_DELAYED, MYSQL_KW_HIGH_PRIORITY, MYSQL_KW_IGNORE, 0 };
+    static const int replace_options[] = { MYSQL_KW_LOW_PRIORITY, MYSQL_KW_DELAYED, 0 };
+    int is_replace = at_kw(p, MYSQL_KW_REPLACE);
+    sql_node *node = node_new(p, is_replace ? SQL_NODE_REPLACE : SQL_NODE_INSERT);
+    sql_node *options, *table, *list;
+
+    advance(p);
+    if ((options = parse_statement_options(p, is_replace ? replace_options : insert_options))) {
+        attr_node(p, node, "options", options);
+    }
+    accept_kw(p, MYSQL_KW_INTO);
+    if (!(table = parse_table_name(p))) return NULL;
+    if (accept_kw(p, MYSQL_KW_PARTITION)) {
+        sql_node *partitions = parse_name_list(p);
+        if (!partitions) return NULL;
+        attr_node(p, table, "partitions", partitions);
+    }
+    attr_node(p, node, "table", table);
+
+    if (at_type(p, TOKEN_LPAREN) && !at_kw_ahead(p, 1, MYSQL_KW_SELECT) && !at_kw_ahead(p, 1, MYSQL_KW_WITH)) {
+        list = node_new(p, SQL_NODE_LIST);
+        advance(p);
+        while (!at_type(p, TOKEN_RPAREN)) {
+            sql_node *column = parse_column_ref(p);
+            if (!column) return NULL;
+            list_append(list, column);
+            if (!accept_type(p, TOKEN_COMMA) && !at_type(p, TOKEN_RPAREN)) return fail(p, "unexpected token in column list");
+        }
+        advance(p);
+        attr_node(p, node, "columns", list);
+    }
+
+    if (accept_kw(p, MYSQL_KW_VALUES) || accept_kw(p, MYSQL_KW_VALUE)) {
+        list = node_new(p, SQL_NODE_LIST);
+        do {
+            sql_node *row = node_new(p, SQL_NODE_ROW);
+            sql_node *items = node_new(p, SQL_NODE_LIST);
+            accept_kw(p, MYSQL_KW_ROW);
+            if (!expect_type(p, TOKEN_LPAREN)) return NULL;
+            if (!at_type(p, TOKEN_RPAREN) && !(items = parse_expr_list(p))) return NULL;
+            if (!expect_type(p, TOKEN_RPAREN)) return NULL;
+            attr_node(p, row, "items", items);
+            list_append(list, row);
+        } while (accept_type(p, TOKEN_COMMA));
+        attr_node(p, node, "values", list);
+    } else if (accept_kw(p, MYSQL_KW_SET)) {
+        if (!(list = parse_assignments(p))) return NULL;
+        attr_node(p, node, "set", list);
+    } else if (at_query_start(p) || at_type(p, TOKEN_LPAREN)) {
+        sql_node *query = parse_query_expression(p);
+        if (!query) return NULL;
+        attr_node(p, node, "query", query);
+    } else {
+        return fail(p, "expected VALUES, SET or SELECT");
+    }
+
+    if (!is_replace && accept_kw(p, MYSQL_KW_AS)) {
+        mysql_token *alias = expect_name(p);
+        if (!alias) return NULL;
+        attr_ident(p, node, "row_alias", alias);
+        if (at_type(p, TOKEN_LPAREN)) {
+            if (!(list = parse_name_list(p))) return NULL;
+            attr_node(p, node, "row_alias_columns", list);
+        }
+    }
+
+    if (!is_replace && accept_kw(p, MYSQL_KW_ON)) {
+        if (!expect_kw(p, MYSQL_KW_DUPLICATE) || !expect_kw(p, MYSQL_KW_KEY) || !expect_kw(p, MYSQL_KW_UPDATE) ||
+            !(list = parse_assignments(p))) return NULL;
+        attr_node(p, node, "on_duplicate", list);
+    }
+    return node;
+}
+
+/* WHERE / ORDER BY / LIMIT tail shared by UPDATE and DELETE */
+static int parse_dml_tail(sql_parser *p, sql_node *node, int single_table) {
+    sql_node *expr, *list;
+
+    if (accept_kw(p, MYSQL_KW_WHERE)) {
+        if (!(expr = parse_expr(p))) return 0;
+        attr_node(p, node, "where", expr);
+    }
+    if (single_table && accept_kw(p, MYSQL_KW_ORDER)) {
+        if (!expect_kw(p, MYSQL_KW_BY) || !(list = parse_order_list(p))) return 0;
+        attr_node(p, node, "order_by", list);
+    }
+    return !single_table || parse_limit(p, node, 0);
+}
+
+static sql_node* parse_update(sql_parser *p) {
+    static const int update_options[] = { MYSQL_KW_LOW_PRIORITY, MYSQL_KW_IGNORE, 0 };
+    sql_node *node = node_new(p, SQL_NODE_UPDATE);
+    sql_node *options, *tables, *set;
+
+    advance(p);
+    if ((options = parse_statement_options(p, update_options))) {
+        attr_node(p, node, "options", options);
+    }
+    if (!(tables = parse_table_refs(p))) return NULL;
+    attr_node(p, node, "tables", tables);
+    if (!expect_kw(p, MYSQL_KW_SET) || !(set = parse_assignments(p))) return NULL;
+    attr_node(p, node, "set", set);
+    if (!parse_dml_tail(p, node, tables->count == 1 && tables->items->type == SQL_NODE_TABLE)) return NULL;
+    return node;
+}
+
+/* Multi-table DELETE target: name[.*] */
+static sql_node* parse_delete_targets(sql_parser *p) {
+    sql_node *list = node_new(p, SQL_NODE_LIST);
+    do {
+        sql_node *table = parse_table_name(p);
+        if (!table) return NULL;
+        if (at_type(p, TOKEN_DOT) && token_is_op(peek(p, 1), "*")) {
+            p->pos += 2;
+        }
+        list_append(list, table);
+    } while (accept_type(p, TOKEN_COMMA));
+    return list;
+}
+
+static sql_node* parse_delete(sql_parser *p) {
+    static const int delete_options[] = { MYSQL_KW_LOW_PRIORITY, MYSQL_KW_QUICK, MYSQL_KW_IGNORE, 0 };
+    sql_node *node = node_new(p, SQL_NODE_DELETE);
+    sql_node *options, *targets, *refs;
+
+    advance(p);
+    if ((options = parse_statement_options(p, delete_options))) {
+        attr_node(p, node, "options", options);
+    }
+
+    if (accept_kw(p, MYSQL_KW_FROM)) {
+        size_t saved = p->pos;
+
+        /* DELETE FROM t1, t2 USING ... */
+        targets = parse_delete_targets(p);
+        if (targets && accept_kw(p, MYSQL_KW_USING)) {
+            if (!(refs = parse_table_refs(p))) return NULL;
+            attr_node(p, node, "tables", targets);
+            attr_node(p, node, "using", refs);
+            return parse_dml_tail(p, node, 0) ? node : NULL;
+        }
+        p->error = NULL;
+        p->pos = saved;
+
+        /* DELETE FROM t [AS a] [PARTITION (...)] */
+        refs = node_new(p, SQL_NODE_LIST);
+        {
+            sql_node *table = parse_table_name(p);
+            if (!table) return NULL;
+            if (accept_kw(p, MYSQL_KW_PARTITION)) {
+                sql_node *partitions = parse_name_list(p);
+                if (!partitions) return NULL;
+                attr_node(p, table, "partitions", partitions);
+            }
+            if (!parse_alias(p, table, 0)) return NULL;
+            list_append(refs, table);
+        }
+        attr_node(p, node, "from", refs);
+        return parse_dml_tail(p, node, 1) ? node : NULL;
+    }
+
+    /* DELETE t1, t2 FROM ... */
+    if (!(targets = parse_delete_targets(p)) || !expect_kw(p, MYSQL_KW_FROM) || !(refs = parse_table_refs(p))) {
+        return NULL;
+    }
+    attr_node(p, node, "tables", targets);
+    attr_node(p, node, "from", refs);
+    return parse_dml_tail(p, node, 0) ? node : NULL;
+}
+
+static sql_node* parse_statement(sql_parser *p) {
+    sql_node *statement;
+
+    if (at_query_start(p) || at_type(p, TOKEN_LPAREN)) {
+        statement = parse_query_expression(p);
+    } else if (at_kw(p, MYSQL_KW_INSERT) || at_kw(p, MYSQL_KW_REPLACE)) {
+        statement = parse_insert(p);
+    } else if (at_kw(p, MYSQL_KW_UPDATE)) {
+        statement = parse_update(p);
+    } else if (at_kw(p, MYSQL_KW_DELETE)) {
+        statement = parse_delete(p);
+    } else {
+        return fail(p, "unsupported statement");
+    }
+
+    if (!statement) return NULL;
+    accept_type(p, TOKEN_SEMICOLON);
+    if (!at_type(p, TOKEN_EOF)) {
+        return fail(p, "unexpected token after end of statement");
+    }
+    return statement;
+}
+
+/* Entry point */
+
+int mysql_native_parse(const char *query, size_t query_len, sql_arena *arena, sql_parse_result *result) {
+    sql_parser parser;
+    mysql_lexer lexer;
+    size_t capacity = 64;
+
+    memset(result, 0, sizeof(*result));
+    memset(&parser, 0, sizeof(parser));
+    parser.query = query;
+    parser.query_len = query_len;
+    parser.arena = arena;
+    parser.tokens = emalloc(capacity * sizeof(mysql_token));
+
+    mysql_lexer_init(&lexer, query, query_len, 0);
+    for (;;) {
+        mysql_token *token;
+        if (parser.count == capacity) {
+            capacity *= 2;
+            parser.tokens = erealloc(parser.tokens, capacity * sizeof(mysql_token));
+        }
+        token = &parser.tokens[parser.count++];
+        mysql_lexer_next(&lexer, token);
+        if (token->type == TOKEN_ERROR) {
+            result->error = lexer.error;
+            result->error_pos = token->start;
+            efree(parser.tokens);
+            return FAILURE;
+        }
+        if (token->type == TOKEN_EOF) break;
+    }
+
+    result->root = parse_statement(&parser);
+    efree(parser.tokens);
+
+    if (!result->root) {
+        result->error = parser.error ? parser.error : "syntax error";
+        result->error_pos = parser.error_pos;
+        return FAILURE;
+    }
+    result->placeholder_count = parser.placeholders;
+    result->unchecked = parser.unchecked;
+    return SUCCESS;
+}
+
+/* Conversion to PHP arrays */
+
+/* Strip identifier or string quotes, collapsing doubled quote characters */
+static zend_string* unquote_ident(const char *text, size_t len) {
+    zend_string *str;
+    char quote, *out;
+
+    if (len < 2 || (text[0] != '`' && text[0] != '\'' && text[0] != '"') || text[len - 1] != text[0]) {
+        return zend_string_init(text, len, 0);
+    }
+
+    quote = text[0];
+    str = zend_string_alloc(len - 2, 0);
+    out = ZSTR_VAL(str);
+    for (size_t i = 1; i < len - 1; i++) {
+        if (text[i] == quote && i + 1 < len - 1 && text[i + 1] == quote) {
+            i++;
+        } else if (text[i] == '\\' && quote != '`' && i + 1 < len - 1) {
+            i++;
+        }
+        *out++ = text[i];
+    }
+    *out = '\0';
+    ZSTR_LEN(str) = out - ZSTR_VAL(str);
+    return str;
+}
+
+/* Leaf text as a copy, or as a span when it lies inside the query at base */
+static void text_to_zval(const sql_attr *attr, const char *base, size_t base_len, zval *out) {
+    if (base && attr->text >= base && attr->text + attr->text_len <= base + base_len) {
+        mysql_span_to_zval(out, attr->text - base, attr->text_len);
+    } else if (attr->kind == SQL_ATTR_IDENT) {
+        ZVAL_STR(out, unquote_ident(attr->text, attr->text_len));
+    } else {
+        ZVAL_STRINGL(out, attr->text, attr->text_len);
+    }
+}
+
+static void node_to_zval(const sql_node *node, const char *base, size_t base_len, zval *out);
+
+static void attr_to_zval(const sql_attr *attr, const char *base, size_t base_len, zval *out) {
+    switch (attr->kind) {
+        case SQL_ATTR_NODE:
+            if (attr->node) {
+                node_to_zval(attr->node, base, base_len, out);
+            } else {
+                ZVAL_NULL(out);
+            }
+            break;
+        case SQL_ATTR_TEXT:
+        case SQL_ATTR_IDENT:
+            text_to_zval(attr, base, base_len, out);
+            break;
+        case SQL_ATTR_BOOL:
+            ZVAL_BOOL(out, attr->text_len != 0);
+            break;
+    }
+}
+
+static void node_to_zval(const sql_node *node, const char *base, size_t base_len, zval *out) {
+    zval value;
+
+    if (node->type == SQL_NODE_LIST) {
+        array_init_size(out, (uint32_t) node->count);
+        for (sql_node *item = node->items; item; item = item->next) {
+            node_to_zval(item, base, base_len, &value);
+            add_next_index_zval(out, &value);
+        }
+        return;
+    }
+
+    if (node->type == SQL_NODE_NAME) {
+        if (node->attrs) {
+            attr_to_zval(node->attrs, base, base_len, out);
+        } else {
+            ZVAL_EMPTY_STRING(out);
+        }
+        return;
+    }
+
+    array_init(out);
+    add_assoc_string(out, "type", (char *) sql_node_type_name(node->type));
+    for (sql_attr *attr = node->attrs; attr; attr = attr->next) {
+        attr_to_zval(attr, base, base_len, &value);
+        add_assoc_zval(out, attr->key, &value);
+    }
+}
+
+void sql_node_to_zval(const sql_node *node, zval *out) {
+    node_to_zval(node, NULL, 0, out);
+}
+
+/* Like sql_node_to_zval(), but text taken from query comes back as [offset, length] spans (identifiers keep their quotes) */
+void sql_node_to_zval_spans(const sql_node *node, const char *query, size_t query_len, zval *out) {
+    node_to_zval(node, query, query_len, out);
 }
 
-/* Query builder implementation - placeholder */
-char* build_mysql_query(zval *parse_tree)
-{
-    /* TODO: Implement query building from parse tree */
-    return estrdup("SELECT 1");
-}
\ No newline at end of file
@@ -0,0 +1,823 @@
+#include "php.h"
+#include "zend_smart_str.h"
+#include "../include/php_mysql_qp.h"
+#include "../include/sql_lexer.h"
+#include "../include/query_parser.h"
+#include <string.h>
+
+/*
+ * Turns a parse_tree array (as produced by the native parser, or built by
+ * hand in the same shape) back into SQL. Expressions are parenthesized from
+ * operator precedence, so trees don't need to remember the source parens.
+ */
+
+#define PREC_OR         10
+#define PREC_XOR        20
+#define PREC_AND        30
+#define PREC_NOT        40
+#define PREC_COMPARISON 60
+#define PREC_PREDICATE  65
+#define PREC_BIT_OR     70
+#define PREC_BIT_AND    80
+#define PREC_SHIFT      90
+#define PREC_ADD        100
+#define PREC_MUL        110
+#define PREC_BIT_XOR    120
+#define PREC_UNARY      130
+#define PREC_BANG       140
+#define PREC_COLLATE    150
+#define PREC_PRIMARY    1000
+
+static int print_expr(smart_str *s, zval *node, int min_prec);
+static int print_query(smart_str *s, zval *node);
+static int print_table_refs(smart_str *s, zval *list);
+
+static zval* attr(zval *node, const char *key) {
+    zval *value;
+    if (!node || Z_TYPE_P(node) != IS_ARRAY) return NULL;
+    value = zend_hash_str_find(Z_ARRVAL_P(node), key, strlen(key));
+    return (value && Z_TYPE_P(value) != IS_NULL) ? value : NULL;
+}
+
+static const char* attr_str(zval *node, const char *key) {
+    zval *value = attr(node, key);
+    return (value && Z_TYPE_P(value) == IS_STRING) ? Z_STRVAL_P(value) : NULL;
+}
+
+static int attr_true(zval *node, const char *key) {
+    zval *value = attr(node, key);
+    return value && zend_is_true(value);
+}
+
+static int is_list(zval *value) {
+    return value && Z_TYPE_P(value) == IS_ARRAY;
+}
+
+static int node_is(zval *node, const char *type) {
+    const char *actual = attr_str(node, "type");
+    return actual && strcmp(actual, type) == 0;
+}
+
+/* Backtick-quote names that aren't plain identifiers or that are reserved words */
+static void print_ident(smart_str *s, const char *name, size_t len) {
+    int quote = len == 0 || (name[0] >= '0' && name[0] <= '9');
+
+    for (size_t i = 0; i < len && !quote; i++) {
+        unsigned char c = (unsigned char) name[i];
+        if (!(c >= 0x80 || c == '_' || c == '$' || (c >= '0' && c <= '9') ||
+              (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))) {
+            quote = 1;
+        }
+    }
+    if (!quote) {
+        int keyword = mysql_lookup_keyword(name, len);
+        quote = keyword != MYSQL_KEYWORD_NONE && mysql_keyword_is_reserved(keyword);
+    }
+
+    if (!quote) {
+        smart_str_appendl(s, name, len);
+        return;
+    }
+    smart_str_appendc(s, '`');
+    for (size_t i = 0; i < len; i++) {
+        if (name[i] == '`') smart_str_appendc(s, '`');
+        smart_str_appendc(s, name[i]);
+    }
+    smart_str_appendc(s, '`');
+}
+
+static int print_ident_attr(smart_str *s, zval *node, const char *key) {
+    zval *value = attr(node, key);
+    if (!value || Z_TYPE_P(value) != IS_STRING) return FAILURE;
+    print_ident(s, Z_STRVAL_P(value), Z_STRLEN_P(value));
+    return SUCCESS;
+}
+
+/* Optional [schema.][table.] qualifier */
+static void print_qualifier(smart_str *s, zval *node) {
+    if (attr_str(node, "schema")) {
+        print_ident_attr(s, node, "schema");
+        smart_str_appendc(s, '.');
+    }
+    if (attr_str(node, "table")) {
+        print_ident_attr(s, node, "table");
+        smart_str_appendc(s, '.');
+    }
+}
+
+static void print_alias(smart_str *s, zval *node) {
+    if (attr_str(node, "alias") && *attr_str(node, "alias")) {
+        smart_str_appends(s, " AS ");
+        print_ident_attr(s, node, "alias");
+    }
+}
+
+static int print_name_list(smart_str *s, zval *list) {
+    zval *item;
+    int first = 1;
+
+    if (!is_list(list)) return FAILURE;
+    smart_str_appendc(s, '(');
+    ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(list), item) {
+        if (Z_TYPE_P(item) != IS_STRING) return FAILURE;
+        if (!first) smart_str_appends(s, ", ");
+        print_ident(s, Z_STRVAL_P(item), Z_STRLEN_P(item));
+        first = 0;
+    } ZEND_HASH_FOREACH_END();
+    smart_str_appendc(s, ')');
+    return SUCCESS;
+}
+
+/* Words (options, index hints) copied as written */
+static int print_word_list(smart_str *s, zval *list, const char *separator) {
+    zval *item;
+    int first = 1;
+
+    if (!is_list(list)) return FAILURE;
+    ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(list), item) {
+        if (Z_TYPE_P(item) != IS_STRING) return FAILURE;
+        if (!first) smart_str_appends(s, separator);
+        smart_str_append(s, Z_STR_P(item));
+        first = 0;
+    } ZEND_HASH_FOREACH_END();
+    return SUCCESS;
+}
+
+static int print_expr_list(smart_str *s, zval *list) {
+    zval *item;
+    int first = 1;
+
+    if (!is_list(list)) return FAILURE;
+    ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(list), item) {
+        if (!first) smart_str_appends(s, ", ");
+        if (print_expr(s, item, 0) != SUCCESS) return FAILURE;
+        first = 0;
+    } ZEND_HASH_FOREACH_END();
+    return SUCCESS;
+}
+
+static int print_order_list(smart_str *s, zval *list) {
+    zval *item;
+    int first = 1;
+
+    if (!is_list(list)) return FAILURE;
+    ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(list), item) {
+        const char *direction = attr_str(item, "direction");
+        if (!first) smart_str_appends(s, ", ");
+        if (print_expr(s, item, 0) != SUCCESS) return FAILURE;
+        if (direction) {
+            smart_str_appendc(s, ' ');
+            smart_str_appends(s, direction);
+        }
+        first = 0;
+    } ZEND_HASH_FOREACH_END();
+    return SUCCESS;
+}
+
+static int print_window_spec(smart_str *s, zval *window) {
+    const char *sep = "";
+
+    smart_str_appendc(s, '(');
+    if (attr_str(window, "base")) {
+        print_ident_attr(s, window, "base");
+        sep = " ";
+    }
+    if (attr(window, "partition_by")) {
+        smart_str_appends(s, sep);
+        smart_str_appends(s, "PARTITION BY ");
+        if (print_expr_list(s, attr(window, "partition_by")) != SUCCESS) return FAILURE;
+        sep = " ";
+    }
+    if (attr(window, "order_by")) {
+        smart_str_appends(s, sep);
+        smart_str_appends(s, "ORDER BY ");
+        if (print_order_list(s, attr(window, "order_by")) != SUCCESS) return FAILURE;
+        sep = " ";
+    }
+    if (attr_str(window, "frame")) {
+        smart_str_appends(s, sep);
+        smart_str_appends(s, attr_str(window, "frame"));
+    }
+    smart_str_appendc(s, ')');
+    return SUCCESS;
+}
+
+static int binary_prec(const char *op) {
+    if (strcasecmp(op, "OR") == 0 || strcmp(op, "||") == 0) return PREC_OR;
+    if (strcasecmp(op, "XOR") == 0) return PREC_XOR;
+    if (strcasecmp(op, "AND") == 0 || strcmp(op, "&&") == 0) return PREC_AND;
+    if (strcmp(op, "|") == 0) return PREC_BIT_OR;
+    if (strcmp(op, "&") == 0) return PREC_BIT_AND;
+    if (strcmp(op, "<<") == 0 || strcmp(op, ">>") == 0) return PREC_SHIFT;
+    if (strcmp(op, "+") == 0 || strcmp(op, "-") == 0) return PREC_ADD;
+    if (strcmp(op, "*") == 0 || strcmp(op, "/") == 0 || strcmp(op, "%") == 0 ||
+        strcasecmp(op, "DIV") == 0 || strcasecmp(op, "MOD") == 0) return PREC_MUL;
+    if (strcmp(op, "^") == 0) return PREC_BIT_XOR;
+    if (strcmp(op, "->") == 0 || strcmp(op, "->>") == 0) return PREC_PRIMARY;
+    return PREC_COMPARISON;
+}
+
+static int expr_prec(zval *node) {
+    const char *type = attr_str(node, "type");
+    const char *op = attr_str(node, "operator");
+
+    if (!type) return PREC_PRIMARY;
+    if (strcmp(type, "binary") == 0) return op ? binary_prec(op) : PREC_COMPARISON;
+    if (strcmp(type, "unary") == 0) {
+        if (op && strcasecmp(op, "NOT") == 0) return PREC_NOT;
+        if (op && strcmp(op, "!") == 0) return PREC_BANG;
+        return PREC_UNARY;
+    }
+    if (strcmp(type, "is") == 0) return PREC_COMPARISON;
+    if (strcmp(type, "in") == 0 || strcmp(type, "between") == 0 || strcmp(type, "like") == 0) return PREC_PREDICATE;
+    if (strcmp(type, "collate") == 0) return PREC_COLLATE;
+    return PREC_PRIMARY;
+}
+
+static int print_function(smart_str *s, zval *node) {
+    const char *name = attr_str(node, "name");
+    zval *args = attr(node, "args"), *arg, *over;
+    int first = 1, prev_keyword = 0;
+
+    if (!name) return FAILURE;
+    smart_str_appends(s, name);
+    smart_str_appendc(s, '(');
+    if (attr_true(node, "distinct")) smart_str_appends(s, "DISTINCT ");
+
+    /* Keyword separators (FROM, SEPARATOR, AS, ...) replace the comma */
+    if (args) {
+        if (!is_list(args)) return FAILURE;
+        ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(args), arg) {
+            int keyword = node_is(arg, "keyword");
+            if (!first) {
+                smart_str_appends(s, keyword || prev_keyword ? " " : ", ");
+            }
+            if (keyword) {
+                if (!attr_str(arg, "value")) return FAILURE;
+                smart_str_appends(s, attr_str(arg, "value"));
+            } else if (print_expr(s, arg, 0) != SUCCESS) {
+                return FAILURE;
+            } else if (attr_str(arg, "direction")) {
+                smart_str_appendc(s, ' ');
+                smart_str_appends(s, attr_str(arg, "direction"));
+            }
+            prev_keyword = keyword;
+            first = 0;
+        } ZEND_HASH_FOREACH_END();
+    }
+    smart_str_appendc(s, ')');
+
+    if ((over = attr(node, "over"))) {
+        smart_str_appends(s, " OVER ");
+        if (attr_str(over, "ref")) {
+            print_ident_attr(s, over, "ref");
+        } else if (print_window_spec(s, over) != SUCCESS) {
+            return FAILURE;
+        }
+    }
+    return SUCCESS;
+}
+
+static int print_subquery(smart_str *s, zval *query) {
+    smart_str_appendc(s, '(');
+    if (print_query(s, query) != SUCCESS) return FAILURE;
+    smart_str_appendc(s, ')');
+    return SUCCESS;
+}
+
+static int print_expr_node(smart_str *s, zval *node) {
+    const char *type = attr_str(node, "type");
+    zval *value;
+
+    if (!type) return FAILURE;
+
+    if (strcmp(type, "column") == 0) {
+        print_qualifier(s, node);
+        return print_ident_attr(s, node, "name");
+    }
+    if (strcmp(type, "star") == 0) {
+        print_qualifier(s, node);
+        smart_str_appendc(s, '*');
+        return SUCCESS;
+    }
+    if (strcmp(type, "literal") == 0 || strcmp(type, "keyword") == 0 || strcmp(type, "data_type") == 0) {
+        if (!attr_str(node, "value")) return FAILURE;
+        smart_str_appends(s, attr_str(node, "value"));
+        return SUCCESS;
+    }
+    if (strcmp(type, "placeholder") == 0) {
+        if (attr_str(node, "name")) {
+            smart_str_appendc(s, ':');
+            smart_str_appends(s, attr_str(node, "name"));
+        } else {
+            smart_str_appendc(s, '?');
+        }
+        return SUCCESS;
+    }
+    if (strcmp(type, "variable") == 0) {
+        if (!attr_str(node, "name")) return FAILURE;
+        smart_str_appends(s, attr_str(node, "name"));
+        return SUCCESS;
+    }
+    if (strcmp(type, "binary") == 0) {
+        const char *op = attr_str(node, "operator");
+        int prec;
+        if (!op) return FAILURE;
+        prec = binary_prec(op);
+        if (print_expr(s, attr(node, "left"), prec) != SUCCESS) return FAILURE;
+        if (prec == PREC_PRIMARY) {
+            smart_str_appends(s, op);
+            return print_expr(s, attr(node, "right"), PREC_PRIMARY);
+        } else {
+            smart_str_appendc(s, ' ');
+            smart_str_appends(s, op);
+            smart_str_appendc(s, ' ');
+        }
+        if (attr_str(node, "quantifier")) {
+            zval *right = attr(node, "right");
+            smart_str_appends(s, attr_str(node, "quantifier"));
+            smart_str_appendc(s, ' ');
+            return print_subquery(s, node_is(right, "subquery") ? attr(right, "query") : right);
+        }
+        return print_expr(s, attr(node, "right"), prec + 1);
+    }
+    if (strcmp(type, "unary") == 0) {
+        const char *op = attr_str(node, "operator");
+        int prec = expr_prec(node);
+        if (!op) return FAILURE;
+        smart_str_appends(s, op);
+        if (prec == PREC_NOT || strcasecmp(op, "BINARY") == 0) smart_str_appendc(s, ' ');
+        /* Nested sign operators get parentheses so "- -a" never prints as "--a" */
+        return print_expr(s, attr(node, "operand"), prec == PREC_NOT ? PREC_NOT : PREC_UNARY + 1);
+    }
+    if (strcmp(type, "is") == 0) {
+        if (print_expr(s, attr(node, "operand"), PREC_COMPARISON) != SUCCESS || !attr_str(node, "value")) return FAILURE;
+        smart_str_appends(s, attr_true(node, "not") ? " IS NOT " : " IS ");
+        smart_str_appends(s, attr_str(node, "value"));
+        return SUCCESS;
+    }
+    if (strcmp(type, "in") == 0) {
+        if (print_expr(s, attr(node, "operand"), PREC_BIT_OR) != SUCCESS) return FAILURE;
+        smart_str_appends(s, attr_true(node, "not") ? " NOT IN " : " IN ");
+        if ((value = attr(node, "query"))) return print_subquery(s, value);
+        smart_str_appendc(s, '(');
+        if (print_expr_list(s, attr(node, "list")) != SUCCESS) return FAILURE;
+        smart_str_appendc(s, ')');
+        return SUCCESS;
+    }
+    if (strcmp(type, "between") == 0) {
+        if (print_expr(s, attr(node, "operand"), PREC_BIT_OR) != SUCCESS) return FAILURE;
+        smart_str_appends(s, attr_true(node, "not") ? " NOT BETWEEN " : " BETWEEN ");
+        if (print_expr(s, attr(node, "low"), PREC_BIT_OR) != SUCCESS) return FAILURE;
+        smart_str_appends(s, " AND ");
+        return print_expr(s, attr(node, "high"), PREC_PREDICATE);
+    }
+    if (strcmp(type, "like") == 0) {
+        const char *op = attr_str(node, "operator");
+        if (print_expr(s, attr(node, "operand"), PREC_BIT_OR) != SUCCESS) return FAILURE;
+        smart_str_appends(s, attr_true(node, "not") ? " NOT " : " ");
+        smart_str_appends(s, op ? op : "LIKE");
+        smart_str_appendc(s, ' ');
+        if (print_expr(s, attr(node, "pattern"), PREC_BIT_OR) != SUCCESS) return FAILURE;
+        if ((value = attr(node, "escape"))) {
+            smart_str_appends(s, " ESCAPE ");
+            return print_expr(s, value, PREC_PRIMARY);
+        }
+        return SUCCESS;
+    }
+    if (strcmp(type, "exists") == 0) {
+        smart_str_appends(s, "EXISTS ");
+        return print_subquery(s, attr(node, "query"));
+    }
+    if (strcmp(type, "subquery") == 0) {
+        return print_subquery(s, attr(node, "query"));
+    }
+    if (strcmp(type, "function") == 0) {
+        return print_function(s, node);
+    }
+    if (strcmp(type, "interval") == 0) {
+        smart_str_appends(s, "INTERVAL ");
+        if (print_expr(s, attr(node, "value"), 0) != SUCCESS || !attr_str(node, "unit")) return FAILURE;
+        smart_str_appendc(s, ' ');
+        smart_str_appends(s, attr_str(node, "unit"));
+        return SUCCESS;
+    }
+    if (strcmp(type, "case") == 0) {
+        zval *when;
+        smart_str_appends(s, "CASE");
+        if ((value = attr(node, "operand"))) {
+            smart_str_appendc(s, ' ');
+            if (print_expr(s, value, 0) != SUCCESS) return FAILURE;
+        }
+        if (!is_list(attr(node, "when"))) return FAILURE;
+        ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(attr(node, "when")), when) {
+            smart_str_appends(s, " WHEN ");
+            if (print_expr(s, attr(when, "when"), 0) != SUCCESS) return FAILURE;
+            smart_str_appends(s, " THEN ");
+            if (print_expr(s, attr(when, "then"), 0) != SUCCESS) return FAILURE;
+        } ZEND_HASH_FOREACH_END();
+        if ((value = attr(node, "else"))) {
+            smart_str_appends(s, " ELSE ");
+            if (print_expr(s, value, 0) != SUCCESS) return FAILURE;
+        }
+        smart_str_appends(s, " END");
+        return SUCCESS;
+    }
+    if (strcmp(type, "row") == 0) {
+        smart_str_appendc(s, '(');
+        if (print_expr_list(s, attr(node, "items")) != SUCCESS) return FAILURE;
+        smart_str_appendc(s, ')');
+        return SUCCESS;
+    }
+    if (strcmp(type, "collate") == 0) {
+        if (print_expr(s, attr(node, "operand"), PREC_COLLATE) != SUCCESS) return FAILURE;
+        smart_str_appends(s, " COLLATE ");
+        return print_ident_attr(s, node, "collation");
+    }
+    if (strcmp(type, "match") == 0) {
+        smart_str_appends(s, "MATCH (");
+        if (print_expr_list(s, attr(node, "columns")) != SUCCESS) return FAILURE;
+        smart_str_appends(s, ") AGAINST (");
+        if (print_expr(s, attr(node, "against"), PREC_BIT_OR) != SUCCESS) return FAILURE;
+        if (attr_str(node, "modifier")) {
+            smart_str_appendc(s, ' ');
+            smart_str_appends(s, attr_str(node, "modifier"));
+        }
+        smart_str_appendc(s, ')');
+        return SUCCESS;
+    }
+    return FAILURE;
+}
+
+static int print_expr(smart_str *s, zval *node, int min_prec) {
+    int parens;
+
+    if (!node || Z_TYPE_P(node) != IS_ARRAY) return FAILURE;
+    parens = expr_prec(node) < min_prec;
+    if (parens) smart_str_appendc(s, '(');
+    if (print_expr_node(s, node) != SUCCESS) return FAILURE;
+    if (parens) smart_str_appendc(s, ')');
+    return SUCCESS;
+}
+
+/* Table references */
+
+static int print_table_ref(smart_str *s, zval *node) {
+    const char *type = attr_str(node, "type");
+    zval *value;
+
+    if (!type) return FAILURE;
+
+    if (strcmp(type, "table") == 0) {
+        const char *name = attr_str(node, "name");
+        if (!name) return FAILURE;
+        if (!attr_str(node, "schema") && strcasecmp(name, "DUAL") == 0) {
+            smart_str_appends(s, "DUAL");
+            return SUCCESS;
+        }
+        print_qualifier(s, node);
+        print_ident_attr(s, node, "name");
+        if ((value = attr(node, "partitions"))) {
+            smart_str_appends(s, " PARTITION ");
+            if (print_name_list(s, value) != SUCCESS) return FAILURE;
+        }
+        print_alias(s, node);
+        if ((value = attr(node, "index_hints"))) {
+            smart_str_appendc(s, ' ');
+            if (print_word_list(s, value, " ") != SUCCESS) return FAILURE;
+        }
+        return SUCCESS;
+    }
+    if (strcmp(type, "derived") == 0) {
+        if (attr_true(node, "lateral")) smart_str_appends(s, "LATERAL ");
+        if (print_subquery(s, attr(node, "query")) != SUCCESS) return FAILURE;
+        print_alias(s, node);
+        if ((value = attr(node, "columns"))) {
+            smart_str_appendc(s, ' ');
+            return print_name_list(s, value);
+        }
+        return SUCCESS;
+    }
+    if (strcmp(type, "join") == 0) {
+        zval *right = attr(node, "right");
+        const char *join_type = attr_str(node, "join_type");
+        int nested = node_is(right, "join");
+
+        if (print_table_ref(s, attr(node, "left")) != SUCCESS) return FAILURE;
+        smart_str_appendc(s, ' ');
+        smart_str_appends(s, join_type ? join_type : "JOIN");
+        smart_str_appendc(s, ' ');
+        if (nested) smart_str_appendc(s, '(');
+        if (print_table_ref(s, right) != SUCCESS) return FAILURE;
+        if (nested) smart_str_appendc(s, ')');
+        if ((value = attr(node, "on"))) {
+            smart_str_appends(s, " ON ");
+            return print_expr(s, value, 0);
+        }
+        if ((value = attr(node, "using"))) {
+            smart_str_appends(s, " USING ");
+            return print_name_list(s, value);
+        }
+        return SUCCESS;
+    }
+    if (strcmp(type, "table_group") == 0) {
+        smart_str_appendc(s, '(');
+        if (print_table_refs(s, attr(node, "tables")) != SUCCESS) return FAILURE;
+        smart_str_appendc(s, ')');
+        return SUCCESS;
+    }
+    return FAILURE;
+}
+
+static int print_table_refs(smart_str *s, zval *list) {
+    zval *item;
+    int first = 1;
+
+    if (!is_list(list)) return FAILURE;
+    ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(list), item) {
+        if (!first) smart_str_appends(s, ", ");
+        if (print_table_ref(s, item) != SUCCESS) return FAILURE;
+        first = 0;
+    } ZEND_HASH_FOREACH_END();
+    return SUCCESS;
+}
+
+/* Queries */
+
+static int print_with(smart_str *s, zval *node) {
+    zval *ctes = attr(node, "with"), *cte;
+    int first = 1;
+
+    if (!ctes) return SUCCESS;
+    if (!is_list(ctes)) return FAILURE;
+
+    smart_str_appends(s, attr_true(node, "recursive") ? "WITH RECURSIVE " : "WITH ");
+    ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(ctes), cte) {
+        if (!first) smart_str_appends(s, ", ");
+        if (print_ident_attr(s, cte, "name") != SUCCESS) return FAILURE;
+        if (attr(cte, "columns")) {
+            smart_str_appendc(s, ' ');
+            if (print_name_list(s, attr(cte, "columns")) != SUCCESS) return FAILURE;
+        }
+        smart_str_appends(s, " AS ");
+        if (print_subquery(s, attr(cte, "query")) != SUCCESS) return FAILURE;
+        first = 0;
+    } ZEND_HASH_FOREACH_END();
+    smart_str_appendc(s, ' ');
+    return SUCCESS;
+}
+
+static int print_limit(smart_str *s, zval *node) {
+    zval *limit = attr(node, "limit"), *offset = attr(node, "offset");
+
+    if (!limit) return SUCCESS;
+    smart_str_appends(s, " LIMIT ");
+    if (print_expr(s, limit, PREC_PRIMARY) != SUCCESS) return FAILURE;
+    if (offset) {
+        smart_str_appends(s, " OFFSET ");
+        return print_expr(s, offset, PREC_PRIMARY);
+    }
+    return SUCCESS;
+}
+
+/* ORDER BY / LIMIT / locking clauses shared by SELECT and set operations */
+static int print_query_tail(smart_str *s, zval *node) {
+    if (attr(node, "order_by")) {
+        smart_str_appends(s, " ORDER BY ");
+        if (print_order_list(s, attr(node, "order_by")) != SUCCESS) return FAILURE;
+    }
+    if (print_limit(s, node) != SUCCESS) return FAILURE;
+    if (attr_str(node, "lock")) {
+        smart_str_appendc(s, ' ');
+        smart_str_appends(s, attr_str(node, "lock"));
+    }
+    return SUCCESS;
+}
+
+static int print_select(smart_str *s, zval *node) {
+    zval *fields = attr(node, "fields"), *field, *value;
+    int first = 1;
+
+    smart_str_appends(s, "SELECT ");
+    if ((value = attr(node, "options"))) {
+        if (print_word_list(s, value, " ") != SUCCESS) return FAILURE;
+        smart_str_appendc(s, ' ');
+    }
+
+    if (!is_list(fields) || zend_hash_num_elements(Z_ARRVAL_P(fields)) == 0) return FAILURE;
+    ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(fields), field) {
+        if (!first) smart_str_appends(s, ", ");
+        if (print_expr(s, field, 0) != SUCCESS) return FAILURE;
+        print_alias(s, field);
+        first = 0;
+    } ZEND_HASH_FOREACH_END();
+
+    if ((value = attr(node, "from"))) {
+        smart_str_appends(s, " FROM ");
+        if (print_table_refs(s, value) != SUCCESS) return FAILURE;
+    }
+    if ((value = attr(node, "where"))) {
+        smart_str_appends(s, " WHERE ");
+        if (print_expr(s, value, 0) != SUCCESS) return FAILURE;
+    }
+    if ((value = attr(node, "group_by"))) {
+        smart_str_appends(s, " GROUP BY ");
+        if (print_order_list(s, value) != SUCCESS) return FAILURE;
+        if (attr_true(node, "with_rollup")) smart_str_appends(s, " WITH ROLLUP");
+    }
+    if ((value = attr(node, "having"))) {
+        smart_str_appends(s, " HAVING ");
+        if (print_expr(s, value, 0) != SUCCESS) return FAILURE;
+    }
+    if ((value = attr(node, "window"))) {
+        zval *window;
+        if (!is_list(value)) return FAILURE;
+        smart_str_appends(s, " WINDOW ");
+        first = 1;
+        ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(value), window) {
+            if (!first) smart_str_appends(s, ", ");
+            if (print_ident_attr(s, window, "name") != SUCCESS) return FAILURE;
+            smart_str_appends(s, " AS ");
+            if (print_window_spec(s, window) != SUCCESS) return FAILURE;
+            first = 0;
+        } ZEND_HASH_FOREACH_END();
+    }
+    return SUCCESS;
+}
+
+/* Set-operation operands carrying their own ORDER BY/LIMIT need parentheses */
+static int print_query_operand(smart_str *s, zval *node) {
+    int wrap = !attr_true(node, "parenthesized") &&
+        (attr(node, "order_by") || attr(node, "limit") || attr(node, "lock") || attr(node, "with"));
+
+    if (wrap) smart_str_appendc(s, '(');
+    if (print_query(s, node) != SUCCESS) return FAILURE;
+    if (wrap) smart_str_appendc(s, ')');
+    return SUCCESS;
+}
+
+static int print_query(smart_str *s, zval *node) {
+    int parenthesized = attr_true(node, "parenthesized");
+
+    if (!node || Z_TYPE_P(node) != IS_ARRAY) return FAILURE;
+
+    if (parenthesized) smart_str_appendc(s, '(');
+    if (print_with(s, node) != SUCCESS) return FAILURE;
+
+    if (node_is(node, "select")) {
+        if (print_select(s, node) != SUCCESS) return FAILURE;
+    } else if (node_is(node, "union")) {
+        const char *op = attr_str(node, "operator");
+        if (print_query_operand(s, attr(node, "left")) != SUCCESS) return FAILURE;
+        smart_str_appendc(s, ' ');
+        smart_str_appends(s, op ? op : "UNION");
+        if (attr_true(node, "all")) smart_str_appends(s, " ALL");
+        if (attr_true(node, "distinct")) smart_str_appends(s, " DISTINCT");
+        smart_str_appendc(s, ' ');
+        if (print_query_operand(s, attr(node, "right")) != SUCCESS) return FAILURE;
+    } else {
+        return FAILURE;
+    }
+
+    if (print_query_tail(s, node) != SUCCESS) return FAILURE;
+    if (parenthesized) smart_str_appendc(s, ')');
+    return SUCCESS;
+}
+
+/* Data-modifying statements */
+
+static int print_assignments(smart_str *s, zval *list) {
+    zval *item;
+    int first = 1;
+
+    if (!is_list(list)) return FAILURE;
+    ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(list), item) {
+        if (!first) smart_str_appends(s, ", ");
+        if (print_expr(s, attr(item, "left"), PREC_PRIMARY) != SUCCESS) return FAILURE;
+        smart_str_appends(s, " = ");
+        if (print_expr(s, attr(item, "right"), 0) != SUCCESS) return FAILURE;
+        first = 0;
+    } ZEND_HASH_FOREACH_END();
+    return SUCCESS;
+}
+
+static int print_options(smart_str *s, zval *node) {
+    zval *options = attr(node, "options");
+    if (!options) return SUCCESS;
+    smart_str_appendc(s, ' ');
+    return print_word_list(s, options, " ");
+}
+
+static int print_insert(smart_str *s, zval *node, const char *verb) {
+    zval *value;
+
+    smart_str_appends(s, verb);
+    if (print_options(s, node) != SUCCESS) return FAILURE;
+    smart_str_appends(s, " INTO ");
+    if (print_table_ref(s, attr(node, "table")) != SUCCESS) return FAILURE;
+
+    if ((value = attr(node, "columns"))) {
+        smart_str_appends(s, " (");
+        if (print_expr_list(s, value) != SUCCESS) return FAILURE;
+        smart_str_appendc(s, ')');
+    }
+
+    if ((value = attr(node, "values"))) {
+        smart_str_appends(s, " VALUES ");
+        if (print_expr_list(s, value) != SUCCESS) return FAILURE;
+    } else if ((value = attr(node, "set"))) {
+        smart_str_appends(s, " SET ");
+        if (print_assignments(s, value) != SUCCESS) return FAILURE;
+    } else if ((value = attr(node, "query"))) {
+        smart_str_appendc(s, ' ');
+        if (print_query(s, value) != SUCCESS) return FAILURE;
+    } else {
+        return FAILURE;
+    }
+
+    if (attr_str(node, "row_alias")) {
+        smart_str_appends(s, " AS ");
+        print_ident_attr(s, node, "row_alias");
+        if ((value = attr(node, "row_alias_columns"))) {
+            smart_str_appendc(s, ' ');
+            if (print_name_list(s, value) != SUCCESS) return FAILURE;
+        }
+    }
+    if ((value = attr(node, "on_duplicate"))) {
+        smart_str_appends(s, " ON DUPLICATE KEY UPDATE ");
+        return print_assignments(s, value);
+    }
+    return SUCCESS;
+}
+
+/* WHERE / ORDER BY / LIMIT shared by UPDATE and DELETE */
+static int print_dml_tail(smart_str *s, zval *node) {
+    zval *value;
+
+    if ((value = attr(node, "where"))) {
+        smart_str_appends(s, " WHERE ");
+        if (print_expr(s, value, 0) != SUCCESS) return FAILURE;
+    }
+    if ((value = attr(node, "order_by"))) {
+        smart_str_appends(s, " ORDER BY ");
+        if (print_order_list(s, value) != SUCCESS) return FAILURE;
+    }
+    return print_limit(s, node);
+}
+
+static int print_update(smart_str *s, zval *node) {
+    smart_str_appends(s, "UPDATE");
+    if (print_options(s, node) != SUCCESS) return FAILURE;
+    smart_str_appendc(s, ' ');
+    if (print_table_refs(s, attr(node, "tables")) != SUCCESS) return FAILURE;
+    smart_str_appends(s, " SET ");
+    if (print_assignments(s, attr(node, "set")) != SUCCESS) return FAILURE;
+    return print_dml_tail(s, node);
+}
+
+static int print_delete(smart_str *s, zval *node) {
+    zval *tables = attr(node, "tables"), *using = attr(node, "using");
+
+    smart_str_appends(s, "DELETE");
+    if (print_options(s, node) != SUCCESS) return FAILURE;
+
+    if (using) {
+        smart_str_appends(s, " FROM ");
+        if (print_table_refs(s, tables) != SUCCESS) return FAILURE;
+        smart_str_appends(s, " USING ");
+        if (print_table_refs(s, using) != SUCCESS) return FAILURE;
+    } else {
+        if (tables) {
+            smart_str_appendc(s, ' ');
+            if (print_table_refs(s, tables) != SUCCESS) return FAILURE;
+        }
+        smart_str_appends(s, " FROM ");
+        if (print_table_refs(s, attr(node, "from")) != SUCCESS) return FAILURE;
+    }
+    return print_dml_tail(s, node);
+}
+
+static int print_statement(smart_str *s, zval *node) {
+    if (node_is(node, "select") || node_is(node, "union")) return print_query(s, node);
+    if (node_is(node, "insert")) return print_insert(s, node, "INSERT");
+    if (node_is(node, "replace")) return print_insert(s, node, "REPLACE");
+    if (node_is(node, "update")) return print_update(s, node);
+    if (node_is(node, "delete")) return print_delete(s, node);
+    return FAILURE;
+}
+
+/* Render a parse tree as SQL; returns an emalloc'd string, or NULL if the tree is malformed */
+char* build_mysql_query(zval *parse_tree) {
+    smart_str str = {0};
+    char *result;
+
+    if (print_statement(&str, parse_tree) != SUCCESS || !str.s) {
+        smart_str_free(&str);
+        return NULL;
+    }
+
+    smart_str_0(&str);
+    result = estrndup(ZSTR_VAL(str.s), ZSTR_LEN(str.s));
+    smart_str_free(&str);
+    return result;
+}
@@ -0,0 +1,238 @@
+#include "php.h"
+#include "ext/standard/info.h"
+#include "../include/php_mysql_qp.h"
+#include "../include/query_stats.h"
+#include <inttypes.h>
+#include <string.h>
+
+#define SUB_BUCKETS (1 << MYSQL_QP_HIST_SUB_BITS)
+#define SUB_MASK (SUB_BUCKETS - 1)
+
+/* Keys of mysql_qp_stats()["latency"], in enum mysql_qp_stat order */
+static const char *stat_names[MYSQL_QP_STAT_COUNT] = {
+    "mysql_parse_query",
+    "mysql_build_query",
+    "mysql_validate_query",
+    "mysql_validate_queries",
+    "mysql_validate_query_async",
+    "mysql_fingerprint_query",
+    "mysql_explain_query",
+    "mysql_decompose_query",
+    "mysql_reconstruct_query",
+    "mysql_compile_template",
+    "mysql_interpolate_query",
+    "mysql_parameterize_query",
+    "mysql_split_sql",
+    "mysql_split_sql_file",
+    "mysql_validate_parallel",
+    "mysql_extract_tables",
+    "mysql_classify_query",
+    "prepare",
+    "explain",
+    "connect",
+};
+
+/* Histograms */
+
+static zend_always_inline uint32_t highest_bit(uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(value);
+#else
+    uint32_t bit = 0;
+    while (value >>= 1) bit++;
+    return bit;
+#endif
+}
+
+static zend_always_inline uint32_t bucket_index(uint64_t value) {
+    uint32_t bit;
+
+    if (value < SUB_BUCKETS) {
+        return (uint32_t) value;
+    }
+    if (value >> MYSQL_QP_HIST_MAX_BITS) {
+        return MYSQL_QP_HIST_BUCKETS - 1;
+    }
+    bit = highest_bit(value);
+    return ((bit - MYSQL_QP_HIST_SUB_BITS + 1) << MYSQL_QP_HIST_SUB_BITS)
+        | (uint32_t) ((value >> (bit - MYSQL_QP_HIST_SUB_BITS)) & SUB_MASK);
+}
+
+/* Largest value that lands in a bucket */
+static uint64_t bucket_upper_bound(uint32_t index) {
+    uint32_t shift;
+
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+    shift = (index >> MYSQL_QP_HIST_SUB_BITS) - 1;
+    return ((((uint64_t) SUB_BUCKETS | (index & SUB_MASK)) + 1) << shift) - 1;
+}
+
+static void histogram_add(mysql_qp_histogram *hist, uint64_t value) {
+    if (hist->count == 0 || value < hist->min) hist->min = value;
+    if (value > hist->max) hist->max = value;
+    hist->count++;
+    hist->sum += value;
+    hist->buckets[bucket_index(value)]++;
+}
+
+/* Upper bound of the bucket holding the given fraction of values, never above the largest seen */
+uint64_t mysql_qp_histogram_percentile(const mysql_qp_histogram *hist, double fraction) {
+    uint64_t rank, seen = 0;
+
+    if (hist->count == 0) {
+        return 0;
+    }
+    rank = (uint64_t) (fraction * hist->count + 0.999999);
+    if (rank == 0) rank = 1;
+
+    for (uint32_t i = 0; i < MYSQL_QP_HIST_BUCKETS; i++) {
+        seen += hist->buckets[i];
+        if (seen >= rank) {
+            uint64_t bound = bucket_upper_bound(i);
+            return bound < hist->max ? bound : hist->max;
+        }
+    }
+    return hist->max;
+}
+
+/* Recording */
+
+void mysql_qp_stats_record(enum mysql_qp_stat stat, zend_hrtime_t elapsed) {
+    histogram_add(&MYSQL_QP_G(stats).latency[stat], elapsed);
+}
+
+/* A function call: its latency, and the memory its result still holds */
+void mysql_qp_stats_call(enum mysql_qp_stat stat, zend_hrtime_t elapsed, size_t memory_before) {
+    size_t memory_after = zend_memory_usage(0);
+
+    histogram_add(&MYSQL_QP_G(stats).latency[stat], elapsed);
+    if (memory_after > memory_before) {
+        MYSQL_QP_G(stats).bytes_allocated += memory_after - memory_before;
+    }
+}
+
+/* A server call that started at start; returns its latency */
+zend_hrtime_t mysql_qp_stats_round_trip(enum mysql_qp_stat stat, zend_hrtime_t start) {
+    zend_hrtime_t elapsed = zend_hrtime() - start;
+
+    histogram_add(&MYSQL_QP_G(stats).latency[stat], elapsed);
+    MYSQL_QP_G(stats).round_trips++;
+    return elapsed;
+}
+
+void mysql_qp_stats_round_trips(zend_ulong count) {
+    MYSQL_QP_G(stats).round_trips += count;
+}
+
+void mysql_qp_stats_reconnect(void) {
+    MYSQL_QP_G(stats).reconnects++;
+}
+
+void mysql_qp_stats_reset(void) {
+    memset(&MYSQL_QP_G(stats), 0, sizeof(mysql_qp_stats));
+    MYSQL_QP_G(cache).hits = 0;
+    MYSQL_QP_G(cache).misses = 0;
+    MYSQL_QP_G(cache).evictions = 0;
+    MYSQL_QP_G(shm).hits = 0;
+    MYSQL_QP_G(shm).misses = 0;
+}
+
+/* mysql_qp_stats() */
+
+static void histogram_to_zval(const mysql_qp_histogram *hist, zval *entry) {
+    zval buckets;
+
+    array_init_size(entry, 9);
+    add_assoc_long(entry, "count", (zend_long) hist->count);
+    add_assoc_long(entry, "sum_ns", (zend_long) hist->sum);
+    add_assoc_long(entry, "min_ns", (zend_long) hist->min);
+    add_assoc_long(entry, "max_ns", (zend_long) hist->max);
+    add_assoc_long(entry, "p50_ns", (zend_long) mysql_qp_histogram_percentile(hist, 0.50));
+    add_assoc_long(entry, "p90_ns", (zend_long) mysql_qp_histogram_percentile(hist, 0.90));
+    add_assoc_long(entry, "p99_ns", (zend_long) mysql_qp_histogram_percentile(hist, 0.99));
+    add_assoc_long(entry, "p999_ns", (zend_long) mysql_qp_histogram_percentile(hist, 0.999));
+
+    /* Only the buckets that were hit, keyed by their upper bound in nanoseconds */
+    array_init(&buckets);
+    for (uint32_t i = 0; i < MYSQL_QP_HIST_BUCKETS; i++) {
+        if (hist->buckets[i]) {
+            add_index_long(&buckets, (zend_ulong) bucket_upper_bound(i), (zend_long) hist->buckets[i]);
+        }
+    }
+    add_assoc_zval(entry, "buckets", &buckets);
+}
+
+void mysql_qp_stats_to_zval(zval *result) {
+    mysql_qp_stats *stats = &MYSQL_QP_G(stats);
+    zval calls, cache, latency, entry;
+
+    array_init_size(&calls, MYSQL_QP_STAT_FUNCTIONS);
+    for (int i = 0; i < MYSQL_QP_STAT_FUNCTIONS; i++) {
+        add_assoc_long(&calls, stat_names[i], (zend_long) stats->latency[i].count);
+    }
+
+    array_init_size(&cache, 8);
+    add_assoc_long(&cache, "hits", (zend_long) MYSQL_QP_G(cache).hits);
+    add_assoc_long(&cache, "misses", (zend_long) MYSQL_QP_G(cache).misses);
+    add_assoc_long(&cache, "evictions", (zend_long) MYSQL_QP_G(cache).evictions);
+    add_assoc_long(&cache, "shm_hits", (zend_long) MYSQL_QP_G(shm).hits);
+    add_assoc_long(&cache, "shm_misses", (zend_long) MYSQL_QP_G(shm).misses);
+    add_assoc_long(&cache, "stmt_hits", (zend_long) stats->stmt_hits);
+    add_assoc_long(&cache, "stmt_misses", (zend_long) stats->stmt_misses);
+    add_assoc_long(&cache, "stmt_evictions", (zend_long) stats->stmt_evictions);
+
+    array_init_size(&latency, MYSQL_QP_STAT_COUNT);
+    for (int i = 0; i < MYSQL_QP_STAT_COUNT; i++) {
+        histogram_to_zval(&stats->latency[i], &entry);
+        add_assoc_zval(&latency, stat_names[i], &entry);
+    }
+
+    array_init_size(result, 9);
+    add_assoc_zval(result, "calls", &calls);
+    add_assoc_long(result, "round_trips", (zend_long) stats->round_trips);
+    add_assoc_long(result, "prepares", (zend_long) stats->latency[MYSQL_QP_STAT_PREPARE].count);
+    add_assoc_long(result, "explains", (zend_long) stats->latency[MYSQL_QP_STAT_EXPLAIN].count);
+    add_assoc_long(result, "connects", (zend_long) stats->latency[MYSQL_QP_STAT_CONNECT].count);
+    add_assoc_long(result, "reconnects", (zend_long) stats->reconnects);
+    add_assoc_long(result, "bytes_allocated", (zend_long) stats->bytes_allocated);
+    add_assoc_zval(result, "cache", &cache);
+    add_assoc_zval(result, "latency", &latency);
+}
+
+/* phpinfo() */
+
+static void print_latency_row(const char *name, const mysql_qp_histogram *hist) {
+    char count[32], p50[32], p99[32], p999[32];
+
+    snprintf(count, sizeof(count), "%" PRIu64, hist->count);
+    snprintf(p50, sizeof(p50), "%" PRIu64, mysql_qp_histogram_percentile(hist, 0.50));
+    snprintf(p99, sizeof(p99), "%" PRIu64, mysql_qp_histogram_percentile(hist, 0.99));
+    snprintf(p999, sizeof(p999), "%" PRIu64, mysql_qp_histogram_percentile(hist, 0.999));
+    php_info_print_table_row(5, name, count, p50, p99, p999);
+}
+
+void mysql_qp_stats_info(void) {
+    mysql_qp_stats *stats = &MYSQL_QP_G(stats);
+    char buf[32];
+
+    php_info_print_table_start();
+    php_info_print_table_header(2, "Statistics (this worker)", "");
+    snprintf(buf, sizeof(buf), ZEND_ULONG_FMT, stats->round_trips);
+    php_info_print_table_row(2, "Server round trips", buf);
+    snprintf(buf, sizeof(buf), ZEND_ULONG_FMT, stats->reconnects);
+    php_info_print_table_row(2, "Reconnects", buf);
+    snprintf(buf, sizeof(buf), ZEND_ULONG_FMT, stats->bytes_allocated);
+    php_info_print_table_row(2, "Bytes allocated", buf);
+    php_info_print_table_end();
+
+    php_info_print_table_start();
+    php_info_print_table_header(5, "Latency", "Count", "p50 (ns)", "p99 (ns)", "p99.9 (ns)");
+    for (int i = 0; i < MYSQL_QP_STAT_COUNT; i++) {
+        if (stats->latency[i].count) {
+            print_latency_row(stat_names[i], &stats->latency[i]);
+        }
+    }
+    php_info_print_table_end();
+}
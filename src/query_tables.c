@@ -0,0 +1,1026 @@
+#include "php.h"
+#include "../include/php_mysql_qp.h"
+#include "../include/query_tables.h"
+#include "../include/sql_lexer.h"
+#include <string.h>
+
+/*
+ * Referenced tables, from the token stream alone. One pass over the tokens
+ * tracks, per parenthesis depth, whether the tokens form a table reference
+ * list (after FROM, UPDATE, USING, LOCK TABLES, ...), where "," and JOIN
+ * start another table and ON/USING conditions are stepped over. Derived
+ * tables and nested joins are told apart by what follows their "(", CTE
+ * names are remembered so references to them aren't reported, and
+ * FROM inside EXTRACT(), TRIM() and friends is ignored because only depths
+ * holding a query start a table list.
+ *
+ * Tables are read unless the statement writes them: INSERT and REPLACE
+ * targets, DDL objects, LOCK ... WRITE, and in a multi-table UPDATE or
+ * DELETE only the tables named by a qualified SET column or by the delete
+ * list (matched by alias or name). EXPLAIN writes nothing.
+ *
+ * Typical statements lex into fewer tokens than fit on the stack, so
+ * nothing is allocated until the result array is built.
+ */
+
+#define TABLES_LOCAL_TOKENS 128
+#define TABLES_LOCAL_REFS 16
+#define TABLES_MAX_DEPTH 64
+#define TABLES_MAX_NAMES 32
+
+typedef struct {
+    const mysql_token *schema;      /* NULL when not qualified */
+    const mysql_token *table;
+    const mysql_token *alias;       /* NULL without one */
+    zend_bool write;
+    zend_bool top;                  /* in the statement's own table list */
+} table_ref;
+
+/* A possibly qualified name that isn't a table reference: a CTE, or an UPDATE or DELETE target */
+typedef struct {
+    const mysql_token *schema;
+    const mysql_token *name;
+} table_name;
+
+/* What the tokens at one parenthesis depth are */
+typedef struct {
+    zend_bool query;                /* a statement or subquery; FROM starts a table list */
+    zend_bool list;                 /* a table reference list: "," and JOIN start another table */
+    zend_bool write;                /* what tables in the list are */
+    zend_bool alias;                /* whether they can have an alias */
+    zend_bool top;                  /* the list belongs to the statement, not to a subquery */
+    unsigned char cte;              /* a CTE body opens here: 1, or 2 when its WITH began the statement */
+} table_level;
+
+enum table_statement {
+    TABLES_QUERY = 0,               /* SELECT, and anything without tables of its own */
+    TABLES_INSERT,
+    TABLES_UPDATE,
+    TABLES_DELETE,
+    TABLES_CREATE,
+    TABLES_ALTER,
+    TABLES_DROP,
+    TABLES_RENAME,
+    TABLES_LOCK,
+    TABLES_LOAD,
+    TABLES_SHOW,
+    TABLES_SKIP                     /* GRANT, REVOKE, CREATE USER, ...: names there aren't accesses */
+};
+
+typedef struct {
+    const mysql_token *tokens;
+    size_t count;
+    size_t pos;
+
+    table_ref *refs;
+    size_t ref_count;
+    size_t ref_capacity;
+
+    /* The current statement */
+    enum table_statement statement;
+    size_t first_ref;
+    table_level levels[TABLES_MAX_DEPTH];
+    int depth;
+    table_name ctes[TABLES_MAX_NAMES];
+    int cte_count;
+    table_name targets[TABLES_MAX_NAMES];
+    int target_count;
+    zend_bool targets_overflow;     /* too many to track: every table of the list is a target */
+    zend_bool at_start;             /* the next token may begin a statement */
+    zend_bool prefix;               /* EXPLAIN or WITH seen; the statement proper comes next */
+    zend_bool explain;              /* nothing is written */
+    zend_bool program;              /* in a stored program, whose body holds statements */
+    zend_bool expect;               /* a table name may come next */
+    zend_bool expect_write;
+    zend_bool expect_alias;
+    zend_bool set_clause;           /* in UPDATE ... SET */
+    zend_bool write_all;            /* an UPDATE assigns an unqualified column */
+    zend_bool on_target;            /* ON names the table (CREATE INDEX, CREATE TRIGGER, DROP INDEX) */
+    zend_bool like_source;          /* LIKE names a table (CREATE TABLE) */
+    zend_bool delete_from;          /* DELETE ... FROM seen */
+    size_t delete_list;             /* first ref of a DELETE FROM list */
+    unsigned char show_table;       /* SHOW COLUMNS/INDEX: 1 before FROM, 2 after it (a second FROM names the schema) */
+} table_scan;
+
+#define LEVEL(st) (&(st)->levels[(st)->depth < TABLES_MAX_DEPTH ? (st)->depth : TABLES_MAX_DEPTH - 1])
+
+static zend_always_inline const mysql_token* token_at(const table_scan *st, size_t i) {
+    return i < st->count ? &st->tokens[i] : NULL;
+}
+
+static zend_always_inline zend_bool keyword_at(const table_scan *st, size_t i, int keyword) {
+    return i < st->count && mysql_token_is_keyword(&st->tokens[i], keyword);
+}
+
+static zend_always_inline zend_bool type_at(const table_scan *st, size_t i, enum mysql_token_type type) {
+    return i < st->count && st->tokens[i].type == type;
+}
+
+/* Tokens that can name a table: identifiers and unreserved keywords */
+static zend_always_inline zend_bool is_name(const mysql_token *token) {
+    return token && (token->type == TOKEN_IDENTIFIER || token->type == TOKEN_QUOTED_IDENTIFIER ||
+                     (token->type == TOKEN_KEYWORD && !(token->flags & TOKEN_FLAG_RESERVED)));
+}
+
+/* After a "." anything is a name, reserved words included */
+static zend_always_inline zend_bool is_qualified_name(const mysql_token *token) {
+    return token && (token->type == TOKEN_IDENTIFIER || token->type == TOKEN_QUOTED_IDENTIFIER ||
+                     token->type == TOKEN_KEYWORD);
+}
+
+static zend_bool same_name(const mysql_token *a, const mysql_token *b) {
+    const char *a_text = a->start, *b_text = b->start;
+    size_t a_len = a->length, b_len = b->length;
+
+    if (a->type == TOKEN_QUOTED_IDENTIFIER) {
+        a_text++;
+        a_len -= 2;
+    }
+    if (b->type == TOKEN_QUOTED_IDENTIFIER) {
+        b_text++;
+        b_len -= 2;
+    }
+    return a_len == b_len && strncasecmp(a_text, b_text, a_len) == 0;
+}
+
+/* Past the ")" matching the "(" at i */
+static size_t skip_parens(const table_scan *st, size_t i) {
+    int depth = 0;
+
+    for (; i < st->count; i++) {
+        if (st->tokens[i].type == TOKEN_LPAREN) {
+            depth++;
+        } else if (st->tokens[i].type == TOKEN_RPAREN && --depth == 0) {
+            return i + 1;
+        }
+    }
+    return i;
+}
+
+static void expect_table(table_scan *st, zend_bool write, zend_bool alias) {
+    st->expect = 1;
+    st->expect_write = write;
+    st->expect_alias = alias;
+}
+
+/* Make the current depth a table list; the first table comes next */
+static void start_list(table_scan *st, zend_bool write, zend_bool alias) {
+    table_level *level = LEVEL(st);
+
+    level->list = 1;
+    level->write = write;
+    level->alias = alias;
+    expect_table(st, write, alias);
+}
+
+static void add_target(table_scan *st, const mysql_token *schema, const mysql_token *name) {
+    if (st->target_count == TABLES_MAX_NAMES) {
+        st->targets_overflow = 1;
+        return;
+    }
+    st->targets[st->target_count].schema = schema;
+    st->targets[st->target_count].name = name;
+    st->target_count++;
+}
+
+/* Record a table; references to a CTE of the statement aren't tables and give NULL */
+static table_ref* add_ref(table_scan *st, const mysql_token *schema, const mysql_token *table, zend_bool write, zend_bool top) {
+    table_ref *ref;
+
+    if (!schema) {
+        for (int i = 0; i < st->cte_count; i++) {
+            if (same_name(st->ctes[i].name, table)) {
+                return NULL;
+            }
+        }
+    }
+    if (st->ref_count == st->ref_capacity) {
+        table_ref *refs = safe_emalloc(st->ref_capacity, 2 * sizeof(table_ref), 0);
+
+        memcpy(refs, st->refs, st->ref_count * sizeof(table_ref));
+        if (st->ref_capacity > TABLES_LOCAL_REFS) {
+            efree(st->refs);
+        }
+        st->refs = refs;
+        st->ref_capacity *= 2;
+    }
+    ref = &st->refs[st->ref_count++];
+    ref->schema = schema;
+    ref->table = table;
+    ref->alias = NULL;
+    ref->write = write;
+    ref->top = top;
+    return ref;
+}
+
+/* [schema.]table [PARTITION (...)] [[AS] alias] at pos */
+static void table_factor(table_scan *st) {
+    const mysql_token *schema = NULL, *table = &st->tokens[st->pos++], *alias = NULL;
+    table_level *level = LEVEL(st);
+    table_ref *ref;
+
+    if (type_at(st, st->pos, TOKEN_DOT) && is_qualified_name(token_at(st, st->pos + 1))) {
+        schema = table;
+        table = &st->tokens[st->pos + 1];
+        st->pos += 2;
+    }
+    ref = add_ref(st, schema, table, st->expect_write, level->list && level->top);
+
+    if (keyword_at(st, st->pos, MYSQL_KW_PARTITION) && type_at(st, st->pos + 1, TOKEN_LPAREN)) {
+        st->pos = skip_parens(st, st->pos + 1);
+    }
+    if (st->expect_alias) {
+        if (keyword_at(st, st->pos, MYSQL_KW_AS) && is_name(token_at(st, st->pos + 1))) {
+            alias = &st->tokens[st->pos + 1];
+            st->pos += 2;
+        } else if (is_name(token_at(st, st->pos))) {
+            alias = &st->tokens[st->pos++];
+        }
+    }
+    if (ref) {
+        ref->alias = alias;
+    }
+}
+
+/* Words between the keyword that announces a table and its name */
+static zend_bool is_table_modifier(int keyword) {
+    switch (keyword) {
+        case MYSQL_KW_LOW_PRIORITY:
+        case MYSQL_KW_DELAYED:
+        case MYSQL_KW_HIGH_PRIORITY:
+        case MYSQL_KW_IGNORE:
+        case MYSQL_KW_INTO:
+        case MYSQL_KW_TABLE:
+        case MYSQL_KW_TABLES:
+        case MYSQL_KW_TEMPORARY:
+        case MYSQL_KW_LATERAL:
+        case MYSQL_KW_QUICK:
+        case MYSQL_KW_IF:
+        case MYSQL_KW_NOT:
+        case MYSQL_KW_EXISTS:
+        case MYSQL_KW_NO_WRITE_TO_BINLOG:
+        case MYSQL_KW_LOCAL:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/* Whether an UPDATE or DELETE target names ref, by alias or else by [schema.]table */
+static zend_bool target_matches(const table_name *target, const table_ref *ref) {
+    if (ref->alias) {
+        return !target->schema && same_name(target->name, ref->alias);
+    }
+    return same_name(target->name, ref->table) &&
+           (!target->schema || !ref->schema || same_name(target->schema, ref->schema));
+}
+
+/* Settle which tables of a multi-table UPDATE or DELETE are written */
+static void resolve_targets(table_scan *st) {
+    size_t top_count = 0, ref_count = st->ref_count;
+    zend_bool all;
+
+    for (size_t i = st->first_ref; i < ref_count; i++) {
+        top_count += st->refs[i].top;
+    }
+    all = st->targets_overflow ||
+          (st->statement == TABLES_UPDATE && (st->write_all || top_count == 1));
+
+    for (size_t i = st->first_ref; i < ref_count; i++) {
+        table_ref *ref = &st->refs[i];
+
+        if (!ref->top) {
+            continue;
+        }
+        for (int t = 0; !ref->write && (all || t < st->target_count); t++) {
+            ref->write = all || target_matches(&st->targets[t], ref);
+        }
+    }
+
+    /* A DELETE target missing from the list is still deleted from */
+    if (st->statement == TABLES_DELETE) {
+        for (int t = 0; t < st->target_count; t++) {
+            zend_bool found = 0;
+
+            for (size_t i = st->first_ref; i < ref_count && !found; i++) {
+                found = st->refs[i].top && target_matches(&st->targets[t], &st->refs[i]);
+            }
+            if (!found) {
+                add_ref(st, st->targets[t].schema, st->targets[t].name, 1, 0);
+            }
+        }
+    }
+}
+
+static void end_statement(table_scan *st) {
+    if (st->statement == TABLES_UPDATE ||
+        (st->statement == TABLES_DELETE && (st->target_count > 0 || st->targets_overflow))) {
+        resolve_targets(st);
+    }
+    if (st->explain) {
+        for (size_t i = st->first_ref; i < st->ref_count; i++) {
+            st->refs[i].write = 0;
+        }
+    }
+    st->explain = 0;
+    st->prefix = 0;
+}
+
+static void begin_statement(table_scan *st) {
+    st->statement = TABLES_QUERY;
+    st->first_ref = st->ref_count;
+    st->depth = 0;
+    memset(&st->levels[0], 0, sizeof(table_level));
+    st->levels[0].query = 1;
+    st->levels[0].top = 1;
+    st->cte_count = 0;
+    st->target_count = 0;
+    st->targets_overflow = 0;
+    st->expect = 0;
+    st->set_clause = 0;
+    st->write_all = 0;
+    st->on_target = 0;
+    st->like_source = 0;
+    st->delete_from = 0;
+    st->show_table = 0;
+}
+
+/* name [(columns)] AS ( at pos, after WITH [RECURSIVE] or a ","; the body is scanned as a subquery */
+static void cte_definition(table_scan *st, zend_bool statement_start) {
+    const mysql_token *name = token_at(st, st->pos);
+    size_t i = st->pos + 1;
+
+    if (!is_name(name) || !(keyword_at(st, i, MYSQL_KW_AS) || type_at(st, i, TOKEN_LPAREN))) {
+        st->prefix = 0;
+        return;
+    }
+    if (st->cte_count < TABLES_MAX_NAMES) {
+        st->ctes[st->cte_count].schema = NULL;
+        st->ctes[st->cte_count].name = name;
+        st->cte_count++;
+    }
+    if (type_at(st, i, TOKEN_LPAREN)) {
+        i = skip_parens(st, i);
+    }
+    if (keyword_at(st, i, MYSQL_KW_AS)) {
+        i++;
+    }
+    st->pos = i;
+    LEVEL(st)->cte = statement_start ? 2 : 1;
+}
+
+static void with_clause(table_scan *st, zend_bool statement_start) {
+    if (keyword_at(st, st->pos, MYSQL_KW_RECURSIVE)) {
+        st->pos++;
+    }
+    cte_definition(st, statement_start);
+}
+
+/* The first of a few DDL object keywords within reach of pos, or 0 */
+static int ddl_object(const table_scan *st, size_t *at) {
+    for (size_t i = st->pos; i < st->count && i < st->pos + 16; i++) {
+        const mysql_token *token = &st->tokens[i];
+
+        if (token->type == TOKEN_SEMICOLON || token->type == TOKEN_LPAREN) {
+            break;
+        }
+        if (token->type != TOKEN_KEYWORD) {
+            continue;
+        }
+        switch (token->keyword) {
+            case MYSQL_KW_TABLE:
+            case MYSQL_KW_TABLES:
+            case MYSQL_KW_VIEW:
+            case MYSQL_KW_INDEX:
+            case MYSQL_KW_TRIGGER:
+            case MYSQL_KW_PROCEDURE:
+            case MYSQL_KW_FUNCTION:
+            case MYSQL_KW_EVENT:
+                *at = i + 1;
+                return token->keyword;
+            case MYSQL_KW_DATABASE:
+            case MYSQL_KW_SCHEMA:
+            case MYSQL_KW_USER:
+            case MYSQL_KW_ROLE:
+                return 0;
+        }
+    }
+    return 0;
+}
+
+/* CREATE, ALTER or DROP: find what is being defined */
+static void ddl_statement(table_scan *st, int verb) {
+    size_t at;
+    int object = ddl_object(st, &at);
+
+    st->statement = verb == MYSQL_KW_CREATE ? TABLES_CREATE : verb == MYSQL_KW_ALTER ? TABLES_ALTER : TABLES_DROP;
+    switch (object) {
+        case MYSQL_KW_TABLE:
+        case MYSQL_KW_TABLES:
+        case MYSQL_KW_VIEW:
+            st->pos = at;
+            if (verb == MYSQL_KW_DROP) {
+                start_list(st, 1, 0);
+            } else {
+                st->like_source = verb == MYSQL_KW_CREATE;
+                expect_table(st, 1, 0);
+            }
+            return;
+        case MYSQL_KW_INDEX:
+            if (verb != MYSQL_KW_ALTER) {
+                st->pos = at;
+                st->on_target = 1;
+                return;
+            }
+            break;
+        case MYSQL_KW_TRIGGER:
+        case MYSQL_KW_PROCEDURE:
+        case MYSQL_KW_FUNCTION:
+        case MYSQL_KW_EVENT:
+            if (verb == MYSQL_KW_CREATE) {
+                st->pos = at;
+                st->program = 1;
+                st->on_target = object == MYSQL_KW_TRIGGER;
+                return;
+            }
+            break;
+    }
+    st->statement = TABLES_SKIP;
+}
+
+/* DELETE [modifiers] then either FROM, or the tables to delete from as "name[.*], ..." */
+static void delete_statement(table_scan *st) {
+    st->statement = TABLES_DELETE;
+    while (keyword_at(st, st->pos, MYSQL_KW_LOW_PRIORITY) || keyword_at(st, st->pos, MYSQL_KW_QUICK) ||
+           keyword_at(st, st->pos, MYSQL_KW_IGNORE)) {
+        st->pos++;
+    }
+    while (is_name(token_at(st, st->pos))) {
+        const mysql_token *schema = NULL, *name = &st->tokens[st->pos++];
+
+        if (type_at(st, st->pos, TOKEN_DOT) && is_qualified_name(token_at(st, st->pos + 1))) {
+            schema = name;
+            name = &st->tokens[st->pos + 1];
+            st->pos += 2;
+        }
+        if (type_at(st, st->pos, TOKEN_DOT) && type_at(st, st->pos + 1, TOKEN_OPERATOR) &&
+            st->tokens[st->pos + 1].length == 1 && st->tokens[st->pos + 1].start[0] == '*') {
+            st->pos += 2;
+        }
+        add_target(st, schema, name);
+        if (!type_at(st, st->pos, TOKEN_COMMA)) {
+            break;
+        }
+        st->pos++;
+    }
+}
+
+/* EXPLAIN/DESCRIBE: either a statement, whose tables are then only read, or a table */
+static void explain_statement(table_scan *st) {
+    zend_bool analyze = 0;
+
+    for (;;) {
+        if (keyword_at(st, st->pos, MYSQL_KW_EXTENDED) || keyword_at(st, st->pos, MYSQL_KW_PARTITIONS)) {
+            st->pos++;
+        } else if (keyword_at(st, st->pos, MYSQL_KW_ANALYZE)) {
+            analyze = 1;
+            st->pos++;
+        } else if (keyword_at(st, st->pos, MYSQL_KW_FORMAT)) {
+            st->pos += type_at(st, st->pos + 1, TOKEN_OPERATOR) ? 3 : 2;
+        } else {
+            break;
+        }
+    }
+    if (type_at(st, st->pos, TOKEN_LPAREN) || keyword_at(st, st->pos, MYSQL_KW_SELECT) ||
+        keyword_at(st, st->pos, MYSQL_KW_WITH) || keyword_at(st, st->pos, MYSQL_KW_TABLE) ||
+        keyword_at(st, st->pos, MYSQL_KW_INSERT) || keyword_at(st, st->pos, MYSQL_KW_REPLACE) ||
+        keyword_at(st, st->pos, MYSQL_KW_UPDATE) || keyword_at(st, st->pos, MYSQL_KW_DELETE)) {
+        /* EXPLAIN ANALYZE runs the statement */
+        st->explain = !analyze;
+        st->prefix = 1;
+        st->at_start = 1;
+    } else if (is_name(token_at(st, st->pos))) {
+        expect_table(st, 0, 0);
+    }
+}
+
+/* A statement keyword at pos, where a statement may begin; 0 if it isn't one */
+static zend_bool statement_start(table_scan *st, int keyword) {
+    switch (keyword) {
+        case MYSQL_KW_SELECT:
+        case MYSQL_KW_TABLE:
+        case MYSQL_KW_WITH:
+        case MYSQL_KW_INSERT:
+        case MYSQL_KW_REPLACE:
+        case MYSQL_KW_UPDATE:
+        case MYSQL_KW_DELETE:
+        case MYSQL_KW_CREATE:
+        case MYSQL_KW_ALTER:
+        case MYSQL_KW_DROP:
+        case MYSQL_KW_TRUNCATE:
+        case MYSQL_KW_RENAME:
+        case MYSQL_KW_LOCK:
+        case MYSQL_KW_ANALYZE:
+        case MYSQL_KW_OPTIMIZE:
+        case MYSQL_KW_REPAIR:
+        case MYSQL_KW_CHECK:
+        case MYSQL_KW_CHECKSUM:
+        case MYSQL_KW_LOAD:
+        case MYSQL_KW_SHOW:
+        case MYSQL_KW_EXPLAIN:
+        case MYSQL_KW_DESCRIBE:
+        case MYSQL_KW_DESC:
+        case MYSQL_KW_HANDLER:
+        case MYSQL_KW_GRANT:
+        case MYSQL_KW_REVOKE:
+            break;
+        default:
+            return 0;
+    }
+
+    if (!st->prefix) {
+        end_statement(st);
+        begin_statement(st);
+    }
+    st->prefix = 0;
+    st->pos++;
+
+    switch (keyword) {
+        case MYSQL_KW_TABLE:
+        case MYSQL_KW_HANDLER:
+            expect_table(st, 0, 0);
+            break;
+        case MYSQL_KW_WITH:
+            st->prefix = 1;
+            with_clause(st, 1);
+            break;
+        case MYSQL_KW_INSERT:
+        case MYSQL_KW_REPLACE:
+            st->statement = TABLES_INSERT;
+            expect_table(st, 1, 0);
+            break;
+        case MYSQL_KW_UPDATE:
+            st->statement = TABLES_UPDATE;
+            start_list(st, 0, 1);
+            break;
+        case MYSQL_KW_DELETE:
+            delete_statement(st);
+            break;
+        case MYSQL_KW_CREATE:
+        case MYSQL_KW_ALTER:
+        case MYSQL_KW_DROP:
+            ddl_statement(st, keyword);
+            break;
+        case MYSQL_KW_TRUNCATE:
+            expect_table(st, 1, 0);
+            break;
+        case MYSQL_KW_RENAME:
+            st->statement = TABLES_RENAME;
+            expect_table(st, 1, 0);
+            break;
+        case MYSQL_KW_LOCK:
+            st->statement = TABLES_LOCK;
+            start_list(st, 0, 1);
+            break;
+        case MYSQL_KW_ANALYZE:
+        case MYSQL_KW_OPTIMIZE:
+        case MYSQL_KW_REPAIR:
+            start_list(st, 1, 0);
+            break;
+        case MYSQL_KW_CHECK:
+        case MYSQL_KW_CHECKSUM:
+            start_list(st, 0, 0);
+            break;
+        case MYSQL_KW_LOAD:
+            st->statement = TABLES_LOAD;
+            break;
+        case MYSQL_KW_SHOW:
+            st->statement = TABLES_SHOW;
+            break;
+        case MYSQL_KW_EXPLAIN:
+        case MYSQL_KW_DESCRIBE:
+        case MYSQL_KW_DESC:
+            explain_statement(st);
+            break;
+        case MYSQL_KW_GRANT:
+        case MYSQL_KW_REVOKE:
+            st->statement = TABLES_SKIP;
+            break;
+    }
+    return 1;
+}
+
+/* At the start of an UPDATE assignment: a qualified column names the table written */
+static void assignment(table_scan *st) {
+    const mysql_token *parts[3];
+    int count = 0;
+
+    while (count < 3 && (count == 0 ? is_name(token_at(st, st->pos)) : is_qualified_name(token_at(st, st->pos)))) {
+        parts[count++] = &st->tokens[st->pos++];
+        if (!type_at(st, st->pos, TOKEN_DOT)) {
+            break;
+        }
+        st->pos++;
+    }
+    if (count == 1) {
+        st->write_all = 1;
+    } else if (count > 1) {
+        add_target(st, count == 3 ? parts[0] : NULL, parts[count - 2]);
+    }
+}
+
+static void open_paren(table_scan *st) {
+    const mysql_token *next = token_at(st, st->pos + 1);
+    zend_bool subquery = next && (mysql_token_is_keyword(next, MYSQL_KW_SELECT) ||
+                                  mysql_token_is_keyword(next, MYSQL_KW_WITH) ||
+                                  mysql_token_is_keyword(next, MYSQL_KW_TABLE) ||
+                                  mysql_token_is_keyword(next, MYSQL_KW_VALUES));
+    zend_bool join = st->expect && !subquery, write = st->expect_write, alias = st->expect_alias;
+    zend_bool top = LEVEL(st)->list && LEVEL(st)->top;
+    table_level *level;
+
+    st->expect = 0;
+    st->depth++;
+    level = LEVEL(st);
+    memset(level, 0, sizeof(table_level));
+    level->query = subquery;
+    if (join) {
+        /* (t1 JOIN t2 ...): the same list, one level down */
+        level->query = 1;
+        level->top = top;
+        start_list(st, write, alias);
+    }
+    st->pos++;
+}
+
+static void close_paren(table_scan *st) {
+    table_level *level;
+
+    if (st->depth > 0) {
+        st->depth--;
+    }
+    st->expect = 0;
+    st->pos++;
+
+    level = LEVEL(st);
+    if (level->cte) {
+        zend_bool statement_start = level->cte == 2;
+
+        level->cte = 0;
+        if (type_at(st, st->pos, TOKEN_COMMA)) {
+            st->pos++;
+            cte_definition(st, statement_start);
+        } else if (statement_start) {
+            st->at_start = 1;
+        }
+    }
+}
+
+static void comma(table_scan *st) {
+    table_level *level = LEVEL(st);
+
+    st->pos++;
+    if (level->list) {
+        expect_table(st, level->write, level->alias);
+    } else if (st->depth == 0 && st->set_clause) {
+        assignment(st);
+    } else if (st->depth == 0 && st->statement == TABLES_RENAME) {
+        expect_table(st, 1, 0);
+    }
+}
+
+/* SHOW at the top level: only SHOW COLUMNS, SHOW INDEX and SHOW CREATE TABLE|VIEW name a table */
+static void show_keyword(table_scan *st, int keyword) {
+    switch (keyword) {
+        case MYSQL_KW_COLUMNS:
+        case MYSQL_KW_FIELDS:
+        case MYSQL_KW_INDEX:
+        case MYSQL_KW_INDEXES:
+        case MYSQL_KW_KEYS:
+            st->show_table = 1;
+            break;
+        case MYSQL_KW_FROM:
+        case MYSQL_KW_IN:
+            if (st->show_table == 1) {
+                st->show_table = 2;
+                expect_table(st, 0, 0);
+            } else if (st->show_table == 2 && st->ref_count > st->first_ref && is_name(token_at(st, st->pos))) {
+                table_ref *ref = &st->refs[st->ref_count - 1];
+                if (!ref->schema) {
+                    ref->schema = &st->tokens[st->pos];
+                }
+                st->show_table = 0;
+            }
+            break;
+        case MYSQL_KW_CREATE:
+            if (keyword_at(st, st->pos, MYSQL_KW_TABLE) || keyword_at(st, st->pos, MYSQL_KW_VIEW)) {
+                st->pos++;
+                expect_table(st, 0, 0);
+            }
+            break;
+    }
+}
+
+static void keyword(table_scan *st, int keyword) {
+    table_level *level = LEVEL(st);
+    zend_bool top = st->depth == 0;
+
+    st->pos++;
+    if (st->statement == TABLES_SKIP) {
+        return;
+    }
+    if (st->statement == TABLES_SHOW && top) {
+        show_keyword(st, keyword);
+        return;
+    }
+
+    switch (keyword) {
+        case MYSQL_KW_FROM:
+            if (!level->query) {
+                break;      /* EXTRACT(... FROM ...), TRIM(... FROM ...) */
+            }
+            if (st->statement == TABLES_DELETE && top && !st->delete_from) {
+                st->delete_from = 1;
+                st->delete_list = st->ref_count;
+                /* DELETE t1 FROM t1 JOIN t2 reads the list; DELETE FROM t writes it */
+                start_list(st, st->target_count == 0 && !st->targets_overflow, 1);
+            } else {
+                start_list(st, 0, 1);
+            }
+            break;
+
+        case MYSQL_KW_JOIN:
+        case MYSQL_KW_STRAIGHT_JOIN:
+            if (level->list) {
+                expect_table(st, level->write, level->alias);
+            }
+            break;
+
+        case MYSQL_KW_ON:
+            if (top && st->on_target) {
+                st->on_target = 0;
+                expect_table(st, 1, 0);
+            }
+            break;
+
+        case MYSQL_KW_USING:
+            /* DELETE FROM t1, t2 USING t1 JOIN t2 ...: the FROM list held the targets */
+            if (st->statement == TABLES_DELETE && top && level->list && st->delete_from &&
+                st->target_count == 0 && !st->targets_overflow) {
+                for (size_t i = st->delete_list; i < st->ref_count; i++) {
+                    add_target(st, st->refs[i].schema, st->refs[i].table);
+                }
+                st->ref_count = st->delete_list;
+                start_list(st, 0, 1);
+            }
+            break;
+
+        case MYSQL_KW_SELECT:
+            level->query = 1;
+            level->list = 0;
+            break;
+
+        case MYSQL_KW_SET:
+            level->list = 0;
+            if (top && st->statement == TABLES_UPDATE) {
+                st->set_clause = 1;
+                assignment(st);
+            }
+            break;
+
+        case MYSQL_KW_INTO:
+            level->list = 0;
+            if (top && st->statement == TABLES_LOAD) {
+                expect_table(st, 1, 0);
+            }
+            break;
+
+        case MYSQL_KW_WHERE:
+        case MYSQL_KW_GROUP:
+        case MYSQL_KW_HAVING:
+        case MYSQL_KW_ORDER:
+        case MYSQL_KW_LIMIT:
+        case MYSQL_KW_WINDOW:
+        case MYSQL_KW_UNION:
+        case MYSQL_KW_EXCEPT:
+        case MYSQL_KW_INTERSECT:
+        case MYSQL_KW_FOR:
+        case MYSQL_KW_LOCK:
+        case MYSQL_KW_VALUES:
+        case MYSQL_KW_PROCEDURE:
+            level->list = 0;
+            if (top) {
+                st->set_clause = 0;
+            }
+            break;
+
+        case MYSQL_KW_TABLE:
+            /* UNION TABLE t, INSERT ... TABLE t; ALTER ... EXCHANGE PARTITION p WITH TABLE t */
+            if (st->statement == TABLES_ALTER) {
+                expect_table(st, 1, 0);
+            } else if (st->statement != TABLES_CREATE && st->statement != TABLES_DROP) {
+                expect_table(st, 0, 0);
+            }
+            break;
+
+        case MYSQL_KW_REFERENCES:
+            expect_table(st, 0, 0);
+            break;
+
+        case MYSQL_KW_LIKE:
+            if (st->like_source && is_name(token_at(st, st->pos))) {
+                st->like_source = 0;
+                expect_table(st, 0, 0);
+            }
+            break;
+
+        case MYSQL_KW_TO:
+            if (top && st->statement == TABLES_RENAME) {
+                expect_table(st, 1, 0);
+            }
+            break;
+
+        case MYSQL_KW_RENAME:
+            /* ALTER TABLE t RENAME [TO|AS] t2, but not RENAME COLUMN|INDEX|KEY */
+            if (top && st->statement == TABLES_ALTER && !keyword_at(st, st->pos, MYSQL_KW_COLUMN) &&
+                !keyword_at(st, st->pos, MYSQL_KW_INDEX) && !keyword_at(st, st->pos, MYSQL_KW_KEY)) {
+                if (keyword_at(st, st->pos, MYSQL_KW_TO) || keyword_at(st, st->pos, MYSQL_KW_AS)) {
+                    st->pos++;
+                }
+                expect_table(st, 1, 0);
+            }
+            break;
+
+        case MYSQL_KW_READ:
+        case MYSQL_KW_WRITE:
+            if (top && st->statement == TABLES_LOCK && st->ref_count > st->first_ref) {
+                st->refs[st->ref_count - 1].write = keyword == MYSQL_KW_WRITE;
+            }
+            break;
+
+        case MYSQL_KW_WITH:
+            with_clause(st, 0);
+            break;
+
+        /* Statements inside a stored program body */
+        case MYSQL_KW_BEGIN:
+        case MYSQL_KW_THEN:
+        case MYSQL_KW_ELSE:
+        case MYSQL_KW_DO:
+            st->at_start = st->program;
+            break;
+        case MYSQL_KW_ROW:
+            st->at_start = st->program && st->pos >= 2 && mysql_token_is_keyword(&st->tokens[st->pos - 2], MYSQL_KW_EACH);
+            break;
+    }
+}
+
+static void scan(table_scan *st) {
+    begin_statement(st);
+    st->at_start = 1;
+
+    while (st->pos < st->count) {
+        const mysql_token *token = &st->tokens[st->pos];
+
+        if (st->at_start) {
+            st->at_start = 0;
+            if (token->type == TOKEN_KEYWORD && statement_start(st, token->keyword)) {
+                continue;
+            }
+        }
+        if (st->expect) {
+            if (token->type == TOKEN_KEYWORD && is_table_modifier(token->keyword)) {
+                st->pos++;
+                continue;
+            }
+            if (is_name(token)) {
+                table_factor(st);
+                st->expect = 0;
+                continue;
+            }
+            if (token->type != TOKEN_LPAREN) {
+                st->expect = 0;
+            }
+        }
+
+        switch (token->type) {
+            case TOKEN_LPAREN:
+                open_paren(st);
+                break;
+            case TOKEN_RPAREN:
+                close_paren(st);
+                break;
+            case TOKEN_COMMA:
+                comma(st);
+                break;
+            case TOKEN_SEMICOLON:
+                end_statement(st);
+                begin_statement(st);
+                st->at_start = 1;
+                st->pos++;
+                break;
+            case TOKEN_KEYWORD:
+                keyword(st, token->keyword);
+                break;
+            default:
+                st->pos++;
+                break;
+        }
+    }
+    end_statement(st);
+}
+
+/* Identifier text with its backticks removed */
+static zend_string* name_string(const mysql_token *token) {
+    zend_string *name;
+    char *out;
+
+    if (token->type != TOKEN_QUOTED_IDENTIFIER || token->length < 2) {
+        return zend_string_init(token->start, token->length, 0);
+    }
+    name = zend_string_alloc(token->length - 2, 0);
+    out = ZSTR_VAL(name);
+    for (size_t i = 1; i < token->length - 1; i++) {
+        *out++ = token->start[i];
+        if (token->start[i] == '`') {
+            i++;        /* `` */
+        }
+    }
+    *out = '\0';
+    ZSTR_LEN(name) = out - ZSTR_VAL(name);
+    return name;
+}
+
+static void add_name(zval *entry, const char *key, size_t key_len, const mysql_token *token) {
+    if (token) {
+        add_assoc_str_ex(entry, key, key_len, name_string(token));
+    } else {
+        add_assoc_null_ex(entry, key, key_len);
+    }
+}
+
+/*
+ * Every table the statements in query reference, in order, as
+ * ["schema", "table", "alias", "access"]. FAILURE with error set when the
+ * query doesn't lex.
+ */
+int mysql_extract_tables(const char *query, size_t query_len, zval *tables, const char **error) {
+    mysql_token local_tokens[TABLES_LOCAL_TOKENS], *tokens = local_tokens;
+    table_ref local_refs[TABLES_LOCAL_REFS];
+    size_t capacity = TABLES_LOCAL_TOKENS, count = 0;
+    mysql_lexer lexer;
+    table_scan st;
+
+    mysql_lexer_init(&lexer, query, query_len, 0);
+    for (;;) {
+        if (count == capacity) {
+            mysql_token *grown = safe_emalloc(capacity, 2 * sizeof(mysql_token), 0);
+
+            memcpy(grown, tokens, count * sizeof(mysql_token));
+            if (tokens != local_tokens) {
+                efree(tokens);
+            }
+            tokens = grown;
+            capacity *= 2;
+        }
+        if (mysql_lexer_next(&lexer, &tokens[count]) == TOKEN_EOF) {
+            break;
+        }
+        if (tokens[count].type == TOKEN_ERROR) {
+            *error = lexer.error;
+            if (tokens != local_tokens) {
+                efree(tokens);
+            }
+            return FAILURE;
+        }
+        count++;
+    }
+
+    memset(&st, 0, sizeof(st));
+    st.tokens = tokens;
+    st.count = count;
+    st.refs = local_refs;
+    st.ref_capacity = TABLES_LOCAL_REFS;
+    scan(&st);
+
+    array_init_size(tables, (uint32_t) st.ref_count);
+    for (size_t i = 0; i < st.ref_count; i++) {
+        const table_ref *ref = &st.refs[i];
+        zval entry;
+
+        array_init_size(&entry, 4);
+        add_name(&entry, "schema", sizeof("schema") - 1, ref->schema);
+        add_name(&entry, "table", sizeof("table") - 1, ref->table);
+        add_name(&entry, "alias", sizeof("alias") - 1, ref->alias);
+        add_assoc_string(&entry, "access", ref->write ? "write" : "read");
+        add_next_index_zval(tables, &entry);
+    }
+
+    if (st.refs != local_refs) {
+        efree(st.refs);
+    }
+    if (tokens != local_tokens) {
+        efree(tokens);
+    }
+    return SUCCESS;
+}
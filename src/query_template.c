@@ -0,0 +1,258 @@
+#include "php.h"
+#include "../include/php_mysql_qp.h"
+#include "../include/query_template.h"
+#include "../include/sql_lexer.h"
+#include "../include/sql_literal.h"
+#include <string.h>
+
+zend_class_entry *mysql_qp_template_ce;
+static zend_object_handlers template_handlers;
+
+/* Compiling */
+
+/* Split sql at its ? and :name placeholders; NULL with a lexer message when sql doesn't tokenize */
+mysql_template* mysql_template_compile(zend_string *sql, zend_bool persistent, const char **error) {
+    mysql_lexer lexer;
+    mysql_token token;
+    mysql_template *tpl;
+    uint32_t count = 0, position = 0, i = 0;
+    size_t literal_start = 0, fixed_len = 0;
+
+    /* Count first so the template is a single allocation */
+    mysql_lexer_init(&lexer, ZSTR_VAL(sql), ZSTR_LEN(sql), 0);
+    while (mysql_lexer_next(&lexer, &token) != TOKEN_EOF) {
+        if (token.type == TOKEN_ERROR) {
+            *error = lexer.error;
+            return NULL;
+        }
+        if (token.type == TOKEN_PLACEHOLDER || token.type == TOKEN_NAMED_PLACEHOLDER) {
+            count++;
+        }
+    }
+
+    tpl = pemalloc(XtOffsetOf(mysql_template, slots) + sizeof(mysql_template_slot) * MAX(count, 1), persistent);
+    tpl->refcount = 1;
+    tpl->persistent = persistent;
+    tpl->slot_count = count;
+    tpl->sql = persistent ? zend_string_init(ZSTR_VAL(sql), ZSTR_LEN(sql), 1) : zend_string_copy(sql);
+
+    mysql_lexer_init(&lexer, ZSTR_VAL(tpl->sql), ZSTR_LEN(tpl->sql), 0);
+    while (i < count && mysql_lexer_next(&lexer, &token) != TOKEN_EOF) {
+        mysql_template_slot *slot;
+
+        if (token.type != TOKEN_PLACEHOLDER && token.type != TOKEN_NAMED_PLACEHOLDER) {
+            continue;
+        }
+        slot = &tpl->slots[i++];
+        slot->literal_end = token.start - ZSTR_VAL(tpl->sql);
+        slot->resume = slot->literal_end + token.length;
+        if (token.type == TOKEN_NAMED_PLACEHOLDER) {
+            slot->name = zend_string_init(token.start + 1, token.length - 1, persistent);
+            zend_string_hash_val(slot->name);
+            slot->position = 0;
+        } else {
+            slot->name = NULL;
+            slot->position = position++;
+        }
+        fixed_len += slot->literal_end - literal_start;
+        literal_start = slot->resume;
+    }
+    tpl->fixed_len = fixed_len + ZSTR_LEN(tpl->sql) - literal_start;
+
+    return tpl;
+}
+
+void mysql_template_release(mysql_template *tpl) {
+    if (--tpl->refcount > 0) {
+        return;
+    }
+    for (uint32_t i = 0; i < tpl->slot_count; i++) {
+        if (tpl->slots[i].name) {
+            zend_string_release(tpl->slots[i].name);
+        }
+    }
+    zend_string_release(tpl->sql);
+    pefree(tpl, tpl->persistent);
+}
+
+/* Rendering */
+
+/* ":name", or the position of a ? */
+static const char* placeholder_label(const mysql_template_slot *slot, char *buf, size_t size) {
+    if (slot->name) {
+        snprintf(buf, size, ":%s", ZSTR_VAL(slot->name));
+    } else {
+        snprintf(buf, size, "%u", slot->position);
+    }
+    return buf;
+}
+
+/* :name binds values["name"] or values[":name"], as in mysql_interpolate_query(); ? binds its position */
+static zval* slot_value(const mysql_template *tpl, const mysql_template_slot *slot, HashTable *values) {
+    zval *value;
+
+    if (!slot->name) {
+        return zend_hash_index_find(values, slot->position);
+    }
+    if (!(value = zend_hash_find(values, slot->name))) {
+        value = zend_hash_str_find(values, ZSTR_VAL(tpl->sql) + slot->literal_end, slot->resume - slot->literal_end);
+    }
+    return value;
+}
+
+/*
+ * Render the template with values bound by position (?) or name (:name).
+ * One pass measures every literal so the result is allocated once at its
+ * exact size; the second copies fixed fragments and literals into it.
+ * Strings are escaped for charset with the default sql_mode (backslash
+ * escapes on). NULL with an exception thrown when a value is missing or
+ * can't be a literal.
+ */
+zend_string* mysql_template_render(const mysql_template *tpl, HashTable *values, const mysql_charset *charset) {
+    const char *sql = ZSTR_VAL(tpl->sql);
+    size_t total = tpl->fixed_len, literal_start = 0;
+    mysql_literal *bound;
+    zend_string *result = NULL;
+    char *out;
+    ALLOCA_FLAG(use_heap);
+
+    bound = do_alloca(sizeof(mysql_literal) * MAX(tpl->slot_count, 1), use_heap);
+
+    for (uint32_t i = 0; i < tpl->slot_count; i++) {
+        const mysql_template_slot *slot = &tpl->slots[i];
+        zval *value = slot_value(tpl, slot, values);
+
+        if (!value) {
+            char label[64];
+            zend_value_error("No value bound to placeholder %s", placeholder_label(slot, label, sizeof(label)));
+            goto done;
+        }
+        ZVAL_DEREF(value);
+        if (mysql_literal_measure(&bound[i], value, charset) != SUCCESS) {
+            char label[64];
+            mysql_literal_throw(value, placeholder_label(slot, label, sizeof(label)));
+            goto done;
+        }
+        total += bound[i].len;
+    }
+
+    result = zend_string_alloc(total, 0);
+    out = ZSTR_VAL(result);
+    for (uint32_t i = 0; i < tpl->slot_count; i++) {
+        const mysql_template_slot *slot = &tpl->slots[i];
+
+        memcpy(out, sql + literal_start, slot->literal_end - literal_start);
+        out = mysql_literal_write(out + (slot->literal_end - literal_start), &bound[i], charset);
+        literal_start = slot->resume;
+    }
+    memcpy(out, sql + literal_start, ZSTR_LEN(tpl->sql) - literal_start);
+    ZSTR_VAL(result)[total] = '\0';
+
+done:
+    free_alloca(bound, use_heap);
+    return result;
+}
+
+/* MysqlQp\Template */
+
+typedef struct {
+    mysql_template *tpl;
+    zend_object std;
+} template_object;
+
+static zend_always_inline template_object* template_from_obj(zend_object *obj) {
+    return (template_object *) ((char *) obj - XtOffsetOf(template_object, std));
+}
+
+static zend_object* template_create(zend_class_entry *ce) {
+    template_object *object = zend_object_alloc(sizeof(template_object), ce);
+
+    zend_object_std_init(&object->std, ce);
+    object_properties_init(&object->std, ce);
+    object->std.handlers = &template_handlers;
+    return &object->std;
+}
+
+static void template_free(zend_object *obj) {
+    template_object *object = template_from_obj(obj);
+
+    if (object->tpl) {
+        mysql_template_release(object->tpl);
+    }
+    zend_object_std_dtor(obj);
+}
+
+/* Wrap a compiled template, taking over the caller's reference */
+void mysql_template_object_init(zval *object, mysql_template *tpl) {
+    object_init_ex(object, mysql_qp_template_ce);
+    template_from_obj(Z_OBJ_P(object))->tpl = tpl;
+}
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_template_construct, 0, 0, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_template_render, 0, 1, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO(0, values, IS_ARRAY, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, charset, IS_STRING, 1, "null")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_template_get_sql, 0, 0, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+/* Only mysql_compile_template() hands these out */
+PHP_METHOD(MysqlQp_Template, __construct)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+}
+
+PHP_METHOD(MysqlQp_Template, render)
+{
+    HashTable *values;
+    zend_string *sql, *charset_name = NULL;
+    const mysql_charset *charset;
+
+    ZEND_PARSE_PARAMETERS_START(1, 2)
+        Z_PARAM_ARRAY_HT(values)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_STR_OR_NULL(charset_name)
+    ZEND_PARSE_PARAMETERS_END();
+
+    if (!(charset = mysql_charset_resolve(charset_name, 2))) {
+        RETURN_THROWS();
+    }
+    if (!(sql = mysql_template_render(template_from_obj(Z_OBJ_P(ZEND_THIS))->tpl, values, charset))) {
+        RETURN_THROWS();
+    }
+    RETURN_NEW_STR(sql);
+}
+
+PHP_METHOD(MysqlQp_Template, getSql)
+{
+    mysql_template *tpl = template_from_obj(Z_OBJ_P(ZEND_THIS))->tpl;
+
+    ZEND_PARSE_PARAMETERS_NONE();
+    /* The cached copy is persistent and stays out of request refcounting */
+    RETURN_STRINGL(ZSTR_VAL(tpl->sql), ZSTR_LEN(tpl->sql));
+}
+
+static const zend_function_entry template_methods[] = {
+    PHP_ME(MysqlQp_Template, __construct, arginfo_template_construct, ZEND_ACC_PRIVATE)
+    PHP_ME(MysqlQp_Template, render, arginfo_template_render, ZEND_ACC_PUBLIC)
+    PHP_ME(MysqlQp_Template, getSql, arginfo_template_get_sql, ZEND_ACC_PUBLIC)
+    PHP_FE_END
+};
+
+/* Register the class; called from MINIT */
+void mysql_template_startup(void) {
+    zend_class_entry ce;
+
+    INIT_CLASS_ENTRY(ce, "MysqlQp\\Template", template_methods);
+    mysql_qp_template_ce = zend_register_internal_class(&ce);
+    mysql_qp_template_ce->ce_flags |= ZEND_ACC_FINAL | ZEND_ACC_NO_DYNAMIC_PROPERTIES | ZEND_ACC_NOT_SERIALIZABLE;
+    mysql_qp_template_ce->create_object = template_create;
+
+    memcpy(&template_handlers, zend_get_std_object_handlers(), sizeof(zend_object_handlers));
+    template_handlers.offset = XtOffsetOf(template_object, std);
+    template_handlers.free_obj = template_free;
+    template_handlers.clone_obj = NULL;
+}
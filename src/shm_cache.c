@@ -0,0 +1,485 @@
+#include "php.h"
+#include "../include/php_mysql_qp.h"
+#include "../include/shm_cache.h"
+#include <zend_atomic.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#ifndef PHP_WIN32
+#include <sys/mman.h>
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+/*
+ * Decomposition and parse results shared by every process forked from the
+ * one that ran MINIT, in the spirit of opcache's immutable arrays.
+ *
+ * The segment is one anonymous MAP_SHARED mapping made before the fork, so
+ * it sits at the same address in every worker and results can hold real
+ * pointers. Each result is copied in once, as an immutable array whose
+ * strings are marked interned, and a hit returns it to PHP as is: no copy,
+ * no refcounting, and any write separates it like any other immutable array.
+ *
+ * Entries are bump-allocated and published with a compare-and-swap on their
+ * bucket, so neither readers nor writers take a lock. Nothing is freed one
+ * entry at a time. When the segment fills up, a restart is requested: new
+ * requests stop using the segment, and the last request still holding
+ * results from it clears it on its way out.
+ *
+ * Requests are also counted per process, so a worker killed in the middle
+ * of a request (SIGKILL, a crash) can't hold a restart off forever: the
+ * first request of every worker that finds a restart pending checks the
+ * processes still counted, as opcache does with kill(pid, 0), and takes
+ * the dead ones' requests off the count.
+ */
+
+#define SHM_MAGIC 0x4d515053        /* "MQPS" */
+#define SHM_LAYOUT 2                /* bump when the header or entry format changes */
+#define SHM_MIN_BUCKETS 64
+#define SHM_BYTES_PER_BUCKET 2048   /* a typical decomposition, with room to spare */
+#define SHM_HOLDERS 1024            /* worker processes counted at once; more bypass the segment */
+
+enum {
+    SHM_READY = 0,
+    SHM_RESTART_PENDING,
+    SHM_RESTARTING
+};
+
+/* Requests of one process holding results from the current generation */
+typedef struct {
+    zend_atomic_int pid;            /* 0 for a slot never claimed */
+    zend_atomic_int count;
+} shm_holder;
+
+/* Everything in the header is found by offset from the start of the segment */
+typedef struct {
+    uint32_t magic;
+    uint32_t layout;
+    size_t size;
+    uint32_t bucket_count;          /* a power of two */
+    int data_start;
+    zend_atomic_int top;            /* next free byte */
+    zend_atomic_int state;          /* SHM_READY, SHM_RESTART_PENDING or SHM_RESTARTING */
+    zend_atomic_int users;          /* requests holding results from this generation, the sum of the holders' */
+    zend_atomic_int entries;
+    zend_atomic_int restarts;
+    zend_atomic_int holder_count;   /* slots claimed so far */
+    shm_holder holders[SHM_HOLDERS];
+    zend_atomic_int buckets[1];     /* offset of the newest entry in each chain, 0 for none */
+} shm_header;
+
+/* Written once before it is published, never changed afterwards */
+typedef struct {
+    int next;                       /* offset of the next entry in the chain, 0 at the end */
+    uint32_t key;                   /* kind and flags */
+    zend_ulong hash;
+    size_t query_len;
+    zval result;                    /* immutable; what it points to follows the entry */
+    char query[1];
+} shm_entry;
+
+static shm_header *shm = NULL;
+
+/* This process's holder slot, looked up again after a fork */
+static zend_atomic_int shm_holder_slot;
+static zend_atomic_int shm_holder_pid;
+
+#define SHM_ALIGNED(size) ZEND_MM_ALIGNED_SIZE(size)
+#define SHM_AT(offset) ((char *) shm + (offset))
+
+static zend_always_inline uint32_t shm_key(enum mysql_shm_kind kind, int flags) {
+    return (uint32_t) kind | ((uint32_t) flags << 8);
+}
+
+static int shm_fetch_add(zend_atomic_int *value, int delta) {
+    int old = zend_atomic_int_load(value);
+
+    while (!zend_atomic_int_compare_exchange(value, &old, old + delta));
+    return old;
+}
+
+/* Segment lifetime */
+
+void mysql_shm_startup(zend_long size) {
+#ifndef PHP_WIN32
+    uint32_t bucket_count = SHM_MIN_BUCKETS;
+    size_t header_size;
+    void *mem;
+
+    if (size <= 0) {
+        return;
+    }
+    /* Offsets are ints */
+    if (size > INT_MAX) {
+        size = INT_MAX;
+    }
+    while (bucket_count < (size_t) size / SHM_BYTES_PER_BUCKET) {
+        bucket_count <<= 1;
+    }
+    header_size = SHM_ALIGNED(XtOffsetOf(shm_header, buckets) + sizeof(zend_atomic_int) * bucket_count);
+    if (header_size * 2 > (size_t) size) {
+        php_error_docref(NULL, E_WARNING, "mysql_qp.shm_size is too small, shared result cache disabled");
+        return;
+    }
+
+    mem = mmap(NULL, (size_t) size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        php_error_docref(NULL, E_WARNING, "Cannot map " ZEND_LONG_FMT " bytes for the shared result cache: %s", size, strerror(errno));
+        return;
+    }
+
+    /* A fresh anonymous mapping is zeroed, so every bucket starts empty */
+    shm = mem;
+    shm->magic = SHM_MAGIC;
+    shm->layout = SHM_LAYOUT;
+    shm->size = (size_t) size;
+    shm->bucket_count = bucket_count;
+    shm->data_start = (int) header_size;
+    zend_atomic_int_store(&shm->top, (int) header_size);
+    zend_atomic_int_store(&shm->state, SHM_READY);
+#else
+    if (size > 0) {
+        php_error_docref(NULL, E_WARNING, "The shared result cache is not available on this platform");
+    }
+#endif
+}
+
+void mysql_shm_shutdown(void) {
+#ifndef PHP_WIN32
+    if (shm) {
+        munmap(shm, shm->size);
+        shm = NULL;
+    }
+#endif
+}
+
+/* Holders */
+
+static zend_bool shm_process_alive(int pid) {
+#ifndef PHP_WIN32
+    return kill((pid_t) pid, 0) == 0 || errno != ESRCH;
+#else
+    return 1;
+#endif
+}
+
+/* The holder slot of this process, claiming one on first use; -1 when all are taken */
+static int shm_holder_claim(void) {
+#ifndef PHP_WIN32
+    int pid = (int) getpid(), count, slot;
+
+    if (zend_atomic_int_load(&shm_holder_pid) == pid) {
+        return zend_atomic_int_load(&shm_holder_slot);
+    }
+
+    /* A slot is free when it was never claimed, or its process is gone and holds nothing */
+    count = zend_atomic_int_load(&shm->holder_count);
+    for (slot = 0; slot < count; slot++) {
+        shm_holder *holder = &shm->holders[slot];
+        int owner = zend_atomic_int_load(&holder->pid);
+
+        if (owner == pid) {
+            break;
+        }
+        if (owner != 0 && zend_atomic_int_load(&holder->count) == 0 && !shm_process_alive(owner) &&
+            zend_atomic_int_compare_exchange(&holder->pid, &owner, pid)) {
+            break;
+        }
+    }
+    while (slot == count) {
+        if (count == SHM_HOLDERS) {
+            return -1;
+        }
+        if (zend_atomic_int_compare_exchange(&shm->holder_count, &count, count + 1)) {
+            zend_atomic_int_store(&shm->holders[slot].pid, pid);
+        } else {
+            slot = count;   /* another process claimed it; try the next one */
+        }
+    }
+
+    zend_atomic_int_store(&shm_holder_slot, slot);
+    zend_atomic_int_store(&shm_holder_pid, pid);
+    return slot;
+#else
+    return -1;
+#endif
+}
+
+/* Take the requests of processes that died holding results off the count */
+static void shm_reclaim(void) {
+    int count = zend_atomic_int_load(&shm->holder_count);
+
+    for (int slot = 0; slot < count; slot++) {
+        shm_holder *holder = &shm->holders[slot];
+        int held = zend_atomic_int_load(&holder->count);
+
+        /* A dead process can't change its count any more; only this restart clears it */
+        if (held > 0 && !shm_process_alive(zend_atomic_int_load(&holder->pid))) {
+            zend_atomic_int_store(&holder->count, 0);
+            shm_fetch_add(&shm->users, -held);
+        }
+    }
+}
+
+/* Clear the segment; only ever runs once no request holds a result from it */
+static void shm_restart(zend_bool reclaim) {
+    int expected = SHM_RESTART_PENDING;
+
+    if (!zend_atomic_int_compare_exchange(&shm->state, &expected, SHM_RESTARTING)) {
+        return;
+    }
+    if (reclaim && zend_atomic_int_load(&shm->users) != 0) {
+        shm_reclaim();
+    }
+    if (zend_atomic_int_load(&shm->users) != 0) {
+        /* A request is backing out; it retries when it leaves */
+        zend_atomic_int_store(&shm->state, SHM_RESTART_PENDING);
+        return;
+    }
+
+    for (uint32_t i = 0; i < shm->bucket_count; i++) {
+        zend_atomic_int_store(&shm->buckets[i], 0);
+    }
+    zend_atomic_int_store(&shm->entries, 0);
+    zend_atomic_int_store(&shm->top, shm->data_start);
+    shm_fetch_add(&shm->restarts, 1);
+    zend_atomic_int_store(&shm->state, SHM_READY);
+}
+
+static void shm_release(int slot) {
+    shm_fetch_add(&shm->holders[slot].count, -1);
+    if (shm_fetch_add(&shm->users, -1) == 1 && zend_atomic_int_load(&shm->state) == SHM_RESTART_PENDING) {
+        shm_restart(0);
+    }
+}
+
+/* Count this request as a user of the current generation, once */
+static zend_bool shm_attach(mysql_shm_client *client) {
+    int slot;
+
+    if (client->attached) {
+        return 1;
+    }
+    if (!shm || shm->magic != SHM_MAGIC || shm->layout != SHM_LAYOUT) {
+        return 0;
+    }
+    if (zend_atomic_int_load(&shm->state) == SHM_RESTART_PENDING && !client->reclaimed) {
+        /* Once per request: the restart may only be waiting for dead workers */
+        client->reclaimed = 1;
+        shm_restart(1);
+    }
+    if (zend_atomic_int_load(&shm->state) != SHM_READY || (slot = shm_holder_claim()) < 0) {
+        return 0;
+    }
+
+    shm_fetch_add(&shm->holders[slot].count, 1);
+    shm_fetch_add(&shm->users, 1);
+    /* A restart requested in between must not see this request as a user */
+    if (zend_atomic_int_load(&shm->state) != SHM_READY) {
+        shm_release(slot);
+        return 0;
+    }
+    client->attached = 1;
+    client->holder = slot;
+    return 1;
+}
+
+/* Called from RSHUTDOWN; results taken from the segment are gone with the request */
+void mysql_shm_end_request(mysql_shm_client *client) {
+    client->reclaimed = 0;
+    if (client->attached) {
+        client->attached = 0;
+        shm_release(client->holder);
+    }
+}
+
+/* Copying results in */
+
+/*
+ * Bytes an immutable copy of value needs; FAILURE for anything but scalars,
+ * strings and arrays. The per-worker result cache makes its immutable parse
+ * trees the same way.
+ */
+int mysql_immutable_measure(zval *value, size_t *size) {
+    zend_string *key;
+    zval *item;
+
+    switch (Z_TYPE_P(value)) {
+        case IS_NULL:
+        case IS_FALSE:
+        case IS_TRUE:
+        case IS_LONG:
+        case IS_DOUBLE:
+            return SUCCESS;
+        case IS_STRING:
+            *size += SHM_ALIGNED(_ZSTR_STRUCT_SIZE(Z_STRLEN_P(value)));
+            return SUCCESS;
+        case IS_ARRAY:
+            if (zend_hash_num_elements(Z_ARRVAL_P(value)) == 0) {
+                return SUCCESS;     /* becomes the engine's empty array */
+            }
+            *size += SHM_ALIGNED(sizeof(zend_array)) + SHM_ALIGNED(HT_IS_PACKED(Z_ARRVAL_P(value))
+                ? HT_PACKED_USED_SIZE(Z_ARRVAL_P(value)) : HT_USED_SIZE(Z_ARRVAL_P(value)));
+            ZEND_HASH_FOREACH_STR_KEY_VAL(Z_ARRVAL_P(value), key, item) {
+                if (key) {
+                    *size += SHM_ALIGNED(_ZSTR_STRUCT_SIZE(ZSTR_LEN(key)));
+                }
+                if (mysql_immutable_measure(item, size) != SUCCESS) {
+                    return FAILURE;
+                }
+            } ZEND_HASH_FOREACH_END();
+            return SUCCESS;
+        default:
+            /* Objects such as MysqlQp\InsertRows belong to one process */
+            return FAILURE;
+    }
+}
+
+static zend_string* shm_copy_string(zend_string *str, char **pos) {
+    zend_string *copy = (zend_string *) *pos;
+
+    zend_string_hash_val(str);
+    memcpy(copy, str, _ZSTR_STRUCT_SIZE(ZSTR_LEN(str)));
+    GC_SET_REFCOUNT(copy, 1);
+    GC_TYPE_INFO(copy) = GC_STRING | ((IS_STR_INTERNED | IS_STR_PERMANENT) << GC_FLAGS_SHIFT);
+    *pos += SHM_ALIGNED(_ZSTR_STRUCT_SIZE(ZSTR_LEN(str)));
+    return copy;
+}
+
+/* Replace value with its immutable copy at *pos, laid out as mysql_immutable_measure() counted */
+void mysql_immutable_copy(zval *value, char **pos) {
+    HashTable *source, *ht;
+    size_t data_size;
+
+    switch (Z_TYPE_P(value)) {
+        case IS_STRING:
+            ZVAL_INTERNED_STR(value, shm_copy_string(Z_STR_P(value), pos));
+            break;
+        case IS_ARRAY:
+            source = Z_ARRVAL_P(value);
+            if (zend_hash_num_elements(source) == 0) {
+                ZVAL_EMPTY_ARRAY(value);
+                break;
+            }
+
+            ht = (HashTable *) *pos;
+            *pos += SHM_ALIGNED(sizeof(zend_array));
+            memcpy(ht, source, sizeof(zend_array));
+            data_size = HT_IS_PACKED(source) ? HT_PACKED_USED_SIZE(source) : HT_USED_SIZE(source);
+            memcpy(*pos, HT_GET_DATA_ADDR(source), data_size);
+            HT_SET_DATA_ADDR(ht, *pos);
+            *pos += SHM_ALIGNED(data_size);
+
+            GC_SET_REFCOUNT(ht, 2);
+            GC_TYPE_INFO(ht) = GC_ARRAY | ((IS_ARRAY_IMMUTABLE | GC_NOT_COLLECTABLE) << GC_FLAGS_SHIFT);
+            HT_FLAGS(ht) |= HASH_FLAG_STATIC_KEYS;
+            ht->nInternalPointer = 0;
+            ht->pDestructor = NULL;
+
+            if (HT_IS_PACKED(ht)) {
+                zval *item;
+                ZEND_HASH_PACKED_FOREACH_VAL(ht, item) {
+                    mysql_immutable_copy(item, pos);
+                } ZEND_HASH_FOREACH_END();
+            } else {
+                Bucket *bucket;
+                ZEND_HASH_MAP_FOREACH_BUCKET(ht, bucket) {
+                    if (bucket->key) {
+                        bucket->key = shm_copy_string(bucket->key, pos);
+                    }
+                    mysql_immutable_copy(&bucket->val, pos);
+                } ZEND_HASH_FOREACH_END();
+            }
+
+            ZVAL_ARR(value, ht);
+            Z_TYPE_FLAGS_P(value) = 0;
+            break;
+    }
+}
+
+/* Claim size bytes; when the segment is full, ask for a restart instead */
+static shm_entry* shm_alloc(size_t size) {
+    int top = zend_atomic_int_load(&shm->top);
+
+    do {
+        if (size > shm->size - (size_t) top) {
+            int expected = SHM_READY;
+            zend_atomic_int_compare_exchange(&shm->state, &expected, SHM_RESTART_PENDING);
+            return NULL;
+        }
+    } while (!zend_atomic_int_compare_exchange(&shm->top, &top, top + (int) size));
+
+    return (shm_entry *) SHM_AT(top);
+}
+
+/* Lookup and store */
+
+/* Hand out the shared copy of a result; returns 1 on a hit */
+int mysql_shm_find(mysql_shm_client *client, zend_string *query, enum mysql_shm_kind kind, int flags, zval *result) {
+    zend_ulong hash;
+    uint32_t key = shm_key(kind, flags);
+    int offset;
+
+    if (!shm_attach(client)) {
+        return 0;
+    }
+
+    hash = zend_string_hash_val(query);
+    offset = zend_atomic_int_load(&shm->buckets[hash & (shm->bucket_count - 1)]);
+    while (offset) {
+        shm_entry *entry = (shm_entry *) SHM_AT(offset);
+
+        if (entry->hash == hash && entry->key == key && entry->query_len == ZSTR_LEN(query) &&
+            memcmp(entry->query, ZSTR_VAL(query), ZSTR_LEN(query)) == 0) {
+            ZVAL_COPY_VALUE(result, &entry->result);
+            client->hits++;
+            return 1;
+        }
+        offset = entry->next;
+    }
+
+    client->misses++;
+    return 0;
+}
+
+/* Share a result computed by this worker; results that can't be shared are skipped */
+void mysql_shm_store(mysql_shm_client *client, zend_string *query, enum mysql_shm_kind kind, int flags, zval *result) {
+    size_t size = SHM_ALIGNED(XtOffsetOf(shm_entry, query) + ZSTR_LEN(query));
+    zend_atomic_int *bucket;
+    shm_entry *entry;
+    char *pos;
+    int head;
+
+    if (!shm_attach(client) || mysql_immutable_measure(result, &size) != SUCCESS || !(entry = shm_alloc(size))) {
+        return;
+    }
+
+    entry->key = shm_key(kind, flags);
+    entry->hash = zend_string_hash_val(query);
+    entry->query_len = ZSTR_LEN(query);
+    memcpy(entry->query, ZSTR_VAL(query), ZSTR_LEN(query));
+    pos = (char *) entry + SHM_ALIGNED(XtOffsetOf(shm_entry, query) + ZSTR_LEN(query));
+    ZVAL_COPY_VALUE(&entry->result, result);
+    mysql_immutable_copy(&entry->result, &pos);
+
+    /* Publish; a concurrent store of the same query only wastes its space */
+    bucket = &shm->buckets[entry->hash & (shm->bucket_count - 1)];
+    head = zend_atomic_int_load(bucket);
+    do {
+        entry->next = head;
+    } while (!zend_atomic_int_compare_exchange(bucket, &head, (int) ((char *) entry - (char *) shm)));
+    shm_fetch_add(&shm->entries, 1);
+}
+
+int mysql_shm_get_stats(mysql_shm_stats *stats) {
+    if (!shm) {
+        return FAILURE;
+    }
+    stats->size = shm->size;
+    stats->used = (size_t) zend_atomic_int_load(&shm->top);
+    stats->entries = (zend_ulong) zend_atomic_int_load(&shm->entries);
+    stats->restarts = (zend_ulong) zend_atomic_int_load(&shm->restarts);
+    stats->restart_pending = zend_atomic_int_load(&shm->state) != SHM_READY;
+    return SUCCESS;
+}
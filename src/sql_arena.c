@@ -0,0 +1,58 @@
+#include "php.h"
+#include "../include/php_mysql_qp.h"
+#include "../include/sql_arena.h"
+#include <string.h>
+
+#define SQL_ARENA_ALIGN(size) (((size) + 7) & ~((size_t) 7))
+
+void sql_arena_init(sql_arena *arena, size_t chunk_size) {
+    arena->head = NULL;
+    arena->chunk_size = chunk_size ? chunk_size : SQL_ARENA_DEFAULT_CHUNK;
+}
+
+void* sql_arena_alloc(sql_arena *arena, size_t size) {
+    sql_arena_chunk *chunk = arena->head;
+    void *ptr;
+    
+    size = SQL_ARENA_ALIGN(size);
+    
+    if (!chunk || chunk->size - chunk->used < size) {
+        /* Oversized requests get a chunk of their own */
+        size_t data_size = size > arena->chunk_size ? size : arena->chunk_size;
+        
+        chunk = emalloc(offsetof(sql_arena_chunk, data) + data_size);
+        chunk->prev = arena->head;
+        chunk->used = 0;
+        chunk->size = data_size;
+        arena->head = chunk;
+    }
+    
+    ptr = chunk->data + chunk->used;
+    chunk->used += size;
+    return ptr;
+}
+
+void* sql_arena_calloc(sql_arena *arena, size_t size) {
+    void *ptr = sql_arena_alloc(arena, size);
+    memset(ptr, 0, size);
+    return ptr;
+}
+
+char* sql_arena_strndup(sql_arena *arena, const char *str, size_t len) {
+    char *copy = sql_arena_alloc(arena, len + 1);
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+/* Release every chunk; the arena can be reused afterwards */
+void sql_arena_free(sql_arena *arena) {
+    sql_arena_chunk *chunk = arena->head;
+    
+    while (chunk) {
+        sql_arena_chunk *prev = chunk->prev;
+        efree(chunk);
+        chunk = prev;
+    }
+    arena->head = NULL;
+}
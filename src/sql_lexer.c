@@ -0,0 +1,630 @@
+#include "php.h"
+#include "../include/php_mysql_qp.h"
+#include "../include/sql_lexer.h"
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* Native tokenizer for MySQL's lexical grammar */
+
+#define CC_IDENT 1
+#define CC_SPACE 2
+#define CC_DIGIT 4
+#define CC_HEX   8
+
+static const unsigned char mysql_char_class[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 2, 2, 2, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    2, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 0, 0, 0, 0, 0, 0,
+    0, 9, 9, 9, 9, 9, 9, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 1,
+    0, 9, 9, 9, 9, 9, 9, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 5, 5, 1, 1, 1, 1, 1, 5, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+};
+
+#define IS_IDENT(c) (mysql_char_class[(unsigned char)(c)] & CC_IDENT)
+#define IS_SPACE(c) (mysql_char_class[(unsigned char)(c)] & CC_SPACE)
+#define IS_DIGIT(c) (mysql_char_class[(unsigned char)(c)] & CC_DIGIT)
+#define IS_HEX(c)   (mysql_char_class[(unsigned char)(c)] & CC_HEX)
+
+/*
+ * Run scanners. Identifier, whitespace and string runs make up most of a
+ * query's bytes, so with SSE2 they are classified 16 bytes at a time; the
+ * scalar loop finishes the tail.
+ */
+#ifdef __SSE2__
+/* Bytes with lo <= c <= hi (unsigned) */
+static zend_always_inline __m128i simd_in_range(__m128i c, char lo, char hi) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i ge = _mm_cmpeq_epi8(_mm_subs_epu8(_mm_set1_epi8(lo), c), zero);
+    __m128i le = _mm_cmpeq_epi8(_mm_subs_epu8(c, _mm_set1_epi8(hi)), zero);
+    return _mm_and_si128(ge, le);
+}
+
+/* Offset of the first byte of the 16 at p that isn't in mask, or 16 */
+static zend_always_inline int simd_first_clear(__m128i mask) {
+    int bits = _mm_movemask_epi8(mask) ^ 0xFFFF;
+    return bits ? __builtin_ctz(bits) : 16;
+}
+#endif
+
+/* Skip identifier characters: [A-Za-z0-9_$] and bytes >= 0x80 */
+static zend_always_inline const char* skip_ident(const char *p, const char *end) {
+#ifdef __SSE2__
+    while (end - p >= 16) {
+        __m128i c = _mm_loadu_si128((const __m128i *) p);
+        __m128i ident = _mm_or_si128(
+            _mm_or_si128(simd_in_range(_mm_or_si128(c, _mm_set1_epi8(0x20)), 'a', 'z'), simd_in_range(c, '0', '9')),
+            _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('_')), _mm_cmpeq_epi8(c, _mm_set1_epi8('$'))),
+                         _mm_cmplt_epi8(c, _mm_setzero_si128())));
+        int offset = simd_first_clear(ident);
+        if (offset < 16) {
+            return p + offset;
+        }
+        p += 16;
+    }
+#endif
+    while (p < end && IS_IDENT(*p)) p++;
+    return p;
+}
+
+/* Skip whitespace: space and \t through \r */
+static zend_always_inline const char* skip_space(const char *p, const char *end) {
+    /* Single separators are the common case; don't pay for a vector load */
+    if (p < end && IS_SPACE(*p)) p++;
+#ifdef __SSE2__
+    while (end - p >= 16 && IS_SPACE(*p)) {
+        __m128i c = _mm_loadu_si128((const __m128i *) p);
+        __m128i space = _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8(' ')), simd_in_range(c, '\t', '\r'));
+        int offset = simd_first_clear(space);
+        if (offset < 16) {
+            return p + offset;
+        }
+        p += 16;
+    }
+#endif
+    while (p < end && IS_SPACE(*p)) p++;
+    return p;
+}
+
+/* Skip bytes that can't end a quoted run: anything but the quote and backslash */
+static zend_always_inline const char* skip_quoted_body(const char *p, const char *end, char quote) {
+#ifdef __SSE2__
+    const __m128i q = _mm_set1_epi8(quote), backslash = _mm_set1_epi8('\\');
+    while (end - p >= 16) {
+        __m128i c = _mm_loadu_si128((const __m128i *) p);
+        int bits = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(c, q), _mm_cmpeq_epi8(c, backslash)));
+        if (bits) {
+            return p + __builtin_ctz(bits);
+        }
+        p += 16;
+    }
+#endif
+    while (p < end && *p != quote && *p != '\\') p++;
+    return p;
+}
+
+/* Keyword table, in the same order as enum mysql_keyword */
+static const struct {
+    const char *name;
+    unsigned char length;
+    unsigned char reserved;
+} mysql_keywords[] = {
+#define X(name, reserved) { #name, sizeof(#name) - 1, reserved },
+    MYSQL_KEYWORD_LIST(X)
+#undef X
+};
+
+#define MYSQL_KEYWORD_MAX_LEN 32
+
+/* Look up a word in the keyword table (case insensitive) */
+int mysql_lookup_keyword(const char *word, size_t word_len) {
+    char upper[MYSQL_KEYWORD_MAX_LEN + 1];
+    int low = 0, high = MYSQL_KEYWORD_COUNT - 2;
+    
+    if (word_len == 0 || word_len > MYSQL_KEYWORD_MAX_LEN) {
+        return MYSQL_KEYWORD_NONE;
+    }
+    
+    for (size_t i = 0; i < word_len; i++) {
+        unsigned char c = (unsigned char) word[i];
+        upper[i] = (c >= 'a' && c <= 'z') ? c - ('a' - 'A') : c;
+    }
+    upper[word_len] = '\0';
+    
+    while (low <= high) {
+        int mid = (low + high) / 2;
+        int cmp = strcmp(upper, mysql_keywords[mid].name);
+        if (cmp == 0) {
+            return mid + 1;
+        }
+        if (cmp < 0) {
+            high = mid - 1;
+        } else {
+            low = mid + 1;
+        }
+    }
+    
+    return MYSQL_KEYWORD_NONE;
+}
+
+const char* mysql_keyword_name(int keyword) {
+    if (keyword <= MYSQL_KEYWORD_NONE || keyword >= MYSQL_KEYWORD_COUNT) {
+        return NULL;
+    }
+    return mysql_keywords[keyword - 1].name;
+}
+
+int mysql_keyword_is_reserved(int keyword) {
+    if (keyword <= MYSQL_KEYWORD_NONE || keyword >= MYSQL_KEYWORD_COUNT) {
+        return 0;
+    }
+    return mysql_keywords[keyword - 1].reserved;
+}
+
+int mysql_token_is_keyword(const mysql_token *token, int keyword) {
+    return token->type == TOKEN_KEYWORD && token->keyword == keyword;
+}
+
+void mysql_lexer_init(mysql_lexer *lexer, const char *query, size_t query_len, unsigned int flags) {
+    lexer->query = query;
+    lexer->pos = query;
+    lexer->end = query + query_len;
+    lexer->flags = flags;
+    lexer->in_version_comment = 0;
+    lexer->last_type = TOKEN_EOF;
+    lexer->error = NULL;
+}
+
+/* Scan a quoted string or identifier; returns the position after the closing quote or NULL */
+static const char* scan_quoted(const char *p, const char *end, char quote) {
+    p++;
+    while ((p = skip_quoted_body(p, end, quote)) < end) {
+        if (*p == '\\') {
+            /* Backslash escapes inside strings; a plain character in `identifiers` */
+            p += quote == '`' ? 1 : 2;
+            continue;
+        }
+        if (p + 1 < end && p[1] == quote) {
+            p += 2;
+            continue;
+        }
+        return p + 1;
+    }
+    return NULL;
+}
+
+/* Find the end of a C-style comment; returns the position after the closing marker or NULL */
+static const char* scan_block_comment(const char *p, const char *end) {
+    p += 2;
+    while (p + 1 < end) {
+        if (p[0] == '*' && p[1] == '/') {
+            return p + 2;
+        }
+        p++;
+    }
+    return NULL;
+}
+
+static enum mysql_token_type lexer_emit(mysql_lexer *lexer, mysql_token *token,
+                                        enum mysql_token_type type, const char *stop) {
+    token->type = type;
+    token->length = stop - token->start;
+    lexer->pos = stop;
+    if (type != TOKEN_COMMENT && type != TOKEN_HINT) {
+        lexer->last_type = type;
+    }
+    return type;
+}
+
+static enum mysql_token_type lexer_fail(mysql_lexer *lexer, mysql_token *token, const char *message) {
+    lexer->error = message;
+    token->type = TOKEN_ERROR;
+    token->length = lexer->end - token->start;
+    lexer->pos = lexer->end;
+    return TOKEN_ERROR;
+}
+
+/* Scan a number starting at p: integer, decimal or float, or an identifier like 1abc */
+static enum mysql_token_type lexer_number(mysql_lexer *lexer, mysql_token *token, const char *p) {
+    const char *end = lexer->end;
+    enum mysql_token_type type = TOKEN_INTEGER;
+    
+    /* 0x1F and 0b101 (lower-case prefix only) */
+    if (p[0] == '0' && p + 2 < end && (p[1] == 'x' || p[1] == 'b')) {
+        const char *q = p + 2;
+        if (p[1] == 'x') {
+            while (q < end && IS_HEX(*q)) q++;
+        } else {
+            while (q < end && (*q == '0' || *q == '1')) q++;
+        }
+        if (q > p + 2 && (q == end || !IS_IDENT(*q))) {
+            return lexer_emit(lexer, token, p[1] == 'x' ? TOKEN_HEX_STRING : TOKEN_BIT_STRING, q);
+        }
+    }
+    
+    while (p < end && IS_DIGIT(*p)) p++;
+    
+    if (p < end && *p == '.') {
+        type = TOKEN_DECIMAL;
+        p++;
+        while (p < end && IS_DIGIT(*p)) p++;
+    }
+    
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char *q = p + 1;
+        if (q < end && (*q == '+' || *q == '-')) q++;
+        if (q < end && IS_DIGIT(*q)) {
+            while (q < end && IS_DIGIT(*q)) q++;
+            type = TOKEN_FLOAT;
+            p = q;
+        }
+    }
+    
+    /* Identifiers may start with digits: 1abc, 123_table */
+    if (type == TOKEN_INTEGER && p < end && IS_IDENT(*p)) {
+        while (p < end && IS_IDENT(*p)) p++;
+        return lexer_emit(lexer, token, TOKEN_IDENTIFIER, p);
+    }
+    
+    return lexer_emit(lexer, token, type, p);
+}
+
+/* Scan a bare word: keyword, identifier, or a prefixed string literal */
+static enum mysql_token_type lexer_word(mysql_lexer *lexer, mysql_token *token, const char *p) {
+    const char *end = lexer->end;
+    const char *start = p;
+    
+    /* X'..', B'..' and N'..' literals */
+    if (p + 1 < end && p[1] == '\'') {
+        char c = *p | 0x20;
+        if (c == 'x' || c == 'b' || c == 'n') {
+            const char *stop = scan_quoted(p + 1, end, '\'');
+            if (!stop) {
+                return lexer_fail(lexer, token, "unterminated string literal");
+            }
+            if (c == 'n') {
+                token->flags |= TOKEN_FLAG_NATIONAL;
+                return lexer_emit(lexer, token, TOKEN_STRING, stop);
+            }
+            return lexer_emit(lexer, token, c == 'x' ? TOKEN_HEX_STRING : TOKEN_BIT_STRING, stop);
+        }
+    }
+    
+    p = skip_ident(p, end);
+    
+    /* Character set introducer: _utf8mb4'abc' */
+    if (*start == '_' && p < end && (*p == '\'' || *p == '"')) {
+        const char *stop = scan_quoted(p, end, *p);
+        if (!stop) {
+            return lexer_fail(lexer, token, "unterminated string literal");
+        }
+        token->flags |= TOKEN_FLAG_INTRODUCER;
+        return lexer_emit(lexer, token, TOKEN_STRING, stop);
+    }
+    
+    token->keyword = mysql_lookup_keyword(start, p - start);
+    if (token->keyword != MYSQL_KEYWORD_NONE) {
+        if (mysql_keywords[token->keyword - 1].reserved) {
+            token->flags |= TOKEN_FLAG_RESERVED;
+        }
+        return lexer_emit(lexer, token, TOKEN_KEYWORD, p);
+    }
+    return lexer_emit(lexer, token, TOKEN_IDENTIFIER, p);
+}
+
+/* Scan an operator; returns TOKEN_ERROR for characters MySQL doesn't accept */
+static enum mysql_token_type lexer_operator(mysql_lexer *lexer, mysql_token *token, const char *p) {
+    static const char *const multi[] = {
+        "<=>", "->>", "<=", ">=", "<>", "!=", "<<", ">>", "&&", "||", ":=", "->", NULL
+    };
+    size_t avail = lexer->end - p;
+    
+    for (int i = 0; multi[i]; i++) {
+        size_t len = strlen(multi[i]);
+        if (avail >= len && memcmp(p, multi[i], len) == 0) {
+            return lexer_emit(lexer, token, TOKEN_OPERATOR, p + len);
+        }
+    }
+    
+    if (*p != '\0' && strchr("=<>!~+-*/%&|^:", *p)) {
+        return lexer_emit(lexer, token, TOKEN_OPERATOR, p + 1);
+    }
+    
+    return lexer_fail(lexer, token, "unexpected character");
+}
+
+/* Return the next token; comments are skipped unless MYSQL_LEX_KEEP_COMMENTS is set */
+enum mysql_token_type mysql_lexer_next(mysql_lexer *lexer, mysql_token *token) {
+    const char *end = lexer->end;
+    const char *p;
+    int keep_comments = lexer->flags & MYSQL_LEX_KEEP_COMMENTS;
+    
+restart:
+    p = skip_space(lexer->pos, end);
+    
+    token->start = p;
+    token->keyword = MYSQL_KEYWORD_NONE;
+    token->flags = lexer->in_version_comment ? TOKEN_FLAG_VERSIONED : 0;
+    
+    if (p >= end) {
+        if (lexer->in_version_comment) {
+            return lexer_fail(lexer, token, "unterminated version comment");
+        }
+        token->type = TOKEN_EOF;
+        token->length = 0;
+        lexer->pos = end;
+        return TOKEN_EOF;
+    }
+    
+    switch (*p) {
+        case '#':
+            while (p < end && *p != '\n') p++;
+            if (keep_comments) return lexer_emit(lexer, token, TOKEN_COMMENT, p);
+            lexer->pos = p;
+            goto restart;
+        
+        case '-':
+            if (p + 1 < end && p[1] == '-' &&
+                (p + 2 == end || IS_SPACE(p[2]) || (unsigned char) p[2] < 0x20)) {
+                while (p < end && *p != '\n') p++;
+                if (keep_comments) return lexer_emit(lexer, token, TOKEN_COMMENT, p);
+                lexer->pos = p;
+                goto restart;
+            }
+            return lexer_operator(lexer, token, p);
+        
+        case '/':
+            if (p + 1 < end && p[1] == '*') {
+                if (p + 2 < end && p[2] == '!' && !lexer->in_version_comment) {
+                    /* Version comment: the content is live SQL */
+                    const char *q = p + 3;
+                    while (q < end && IS_DIGIT(*q) && q - p < 9) q++;
+                    lexer->in_version_comment = 1;
+                    if (keep_comments) return lexer_emit(lexer, token, TOKEN_VERSION_COMMENT, q);
+                    lexer->pos = q;
+                    goto restart;
+                }
+                const char *stop = scan_block_comment(p, end);
+                if (!stop) {
+                    return lexer_fail(lexer, token, "unterminated comment");
+                }
+                if (keep_comments) {
+                    return lexer_emit(lexer, token, (p + 2 < end && p[2] == '+') ? TOKEN_HINT : TOKEN_COMMENT, stop);
+                }
+                lexer->pos = stop;
+                goto restart;
+            }
+            return lexer_operator(lexer, token, p);
+        
+        case '*':
+            if (lexer->in_version_comment && p + 1 < end && p[1] == '/') {
+                lexer->in_version_comment = 0;
+                if (keep_comments) {
+                    token->flags &= ~TOKEN_FLAG_VERSIONED;
+                    return lexer_emit(lexer, token, TOKEN_VERSION_COMMENT_END, p + 2);
+                }
+                lexer->pos = p + 2;
+                goto restart;
+            }
+            return lexer_operator(lexer, token, p);
+        
+        case '\'':
+        case '"': {
+            const char *stop = scan_quoted(p, end, *p);
+            if (!stop) {
+                return lexer_fail(lexer, token, "unterminated string literal");
+            }
+            if (*p == '"') token->flags |= TOKEN_FLAG_DOUBLE_QUOTE;
+            return lexer_emit(lexer, token, TOKEN_STRING, stop);
+        }
+        
+        case '`': {
+            const char *stop = scan_quoted(p, end, '`');
+            if (!stop) {
+                return lexer_fail(lexer, token, "unterminated quoted identifier");
+            }
+            return lexer_emit(lexer, token, TOKEN_QUOTED_IDENTIFIER, stop);
+        }
+        
+        case '?':
+            return lexer_emit(lexer, token, TOKEN_PLACEHOLDER, p + 1);
+        
+        case ':':
+            if (p + 1 < end && (IS_IDENT(p[1]) && p[1] != '$')) {
+                const char *q = p + 1;
+                while (q < end && IS_IDENT(*q)) q++;
+                return lexer_emit(lexer, token, TOKEN_NAMED_PLACEHOLDER, q);
+            }
+            return lexer_operator(lexer, token, p);
+        
+        case '@': {
+            const char *q = p + 1;
+            if (q < end && *q == '@') q++;
+            if (q < end && (*q == '\'' || *q == '"' || *q == '`')) {
+                q = scan_quoted(q, end, *q);
+                if (!q) {
+                    return lexer_fail(lexer, token, "unterminated variable name");
+                }
+            } else {
+                while (q < end && (IS_IDENT(*q) || *q == '.')) q++;
+            }
+            return lexer_emit(lexer, token, TOKEN_VARIABLE, q);
+        }
+        
+        case '(': return lexer_emit(lexer, token, TOKEN_LPAREN, p + 1);
+        case ')': return lexer_emit(lexer, token, TOKEN_RPAREN, p + 1);
+        case ',': return lexer_emit(lexer, token, TOKEN_COMMA, p + 1);
+        case ';': return lexer_emit(lexer, token, TOKEN_SEMICOLON, p + 1);
+        case '{': return lexer_emit(lexer, token, TOKEN_LBRACE, p + 1);
+        case '}': return lexer_emit(lexer, token, TOKEN_RBRACE, p + 1);
+        
+        case '.':
+            /* .5 is a number, but t.5col qualifies an identifier */
+            if (p + 1 < end && IS_DIGIT(p[1]) &&
+                lexer->last_type != TOKEN_IDENTIFIER &&
+                lexer->last_type != TOKEN_QUOTED_IDENTIFIER) {
+                return lexer_number(lexer, token, p);
+            }
+            return lexer_emit(lexer, token, TOKEN_DOT, p + 1);
+        
+        default:
+            break;
+    }
+    
+    if (IS_DIGIT(*p)) {
+        if (lexer->last_type == TOKEN_DOT) {
+            /* t.1col: identifier part after a qualifier */
+            const char *q = p;
+            while (q < end && IS_IDENT(*q)) q++;
+            return lexer_emit(lexer, token, TOKEN_IDENTIFIER, q);
+        }
+        return lexer_number(lexer, token, p);
+    }
+    
+    if (IS_IDENT(*p)) {
+        return lexer_word(lexer, token, p);
+    }
+    
+    return lexer_operator(lexer, token, p);
+}
+
+/* Words that can start a statement */
+static int is_statement_start(const mysql_token *token) {
+    if (token->type == TOKEN_LPAREN) {
+        return 1;
+    }
+    if (token->type != TOKEN_KEYWORD) {
+        return 0;
+    }
+    
+    switch (token->keyword) {
+        case MYSQL_KW_ALTER: case MYSQL_KW_ANALYZE: case MYSQL_KW_BEGIN:
+        case MYSQL_KW_BINLOG: case MYSQL_KW_CACHE: case MYSQL_KW_CALL:
+        case MYSQL_KW_CHANGE: case MYSQL_KW_CHECK: case MYSQL_KW_CHECKSUM:
+        case MYSQL_KW_CLONE: case MYSQL_KW_COMMIT: case MYSQL_KW_CREATE:
+        case MYSQL_KW_DEALLOCATE: case MYSQL_KW_DELETE: case MYSQL_KW_DESC:
+        case MYSQL_KW_DESCRIBE: case MYSQL_KW_DO: case MYSQL_KW_DROP:
+        case MYSQL_KW_EXECUTE: case MYSQL_KW_EXPLAIN: case MYSQL_KW_FLUSH:
+        case MYSQL_KW_GET: case MYSQL_KW_GRANT: case MYSQL_KW_HANDLER:
+        case MYSQL_KW_HELP: case MYSQL_KW_IMPORT: case MYSQL_KW_INSERT:
+        case MYSQL_KW_INSTALL: case MYSQL_KW_KILL: case MYSQL_KW_LOAD:
+        case MYSQL_KW_LOCK: case MYSQL_KW_OPTIMIZE: case MYSQL_KW_PREPARE:
+        case MYSQL_KW_PURGE: case MYSQL_KW_RELEASE: case MYSQL_KW_RENAME:
+        case MYSQL_KW_REPAIR: case MYSQL_KW_REPLACE: case MYSQL_KW_RESET:
+        case MYSQL_KW_RESIGNAL: case MYSQL_KW_RESTART: case MYSQL_KW_REVOKE:
+        case MYSQL_KW_ROLLBACK: case MYSQL_KW_SAVEPOINT: case MYSQL_KW_SELECT:
+        case MYSQL_KW_SET: case MYSQL_KW_SHOW: case MYSQL_KW_SHUTDOWN:
+        case MYSQL_KW_SIGNAL: case MYSQL_KW_START: case MYSQL_KW_STOP:
+        case MYSQL_KW_TABLE: case MYSQL_KW_TRUNCATE: case MYSQL_KW_UNINSTALL:
+        case MYSQL_KW_UNLOCK: case MYSQL_KW_UPDATE: case MYSQL_KW_USE:
+        case MYSQL_KW_VALUES: case MYSQL_KW_WITH: case MYSQL_KW_XA:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/* Build a server-style ER_PARSE_ERROR message pointing at `near` */
+char* mysql_syntax_error_message(const char *query, size_t query_len, const char *near) {
+    const char *end = query + query_len;
+    int line = 1;
+    size_t near_len;
+    char *message;
+    
+    if (!near || near > end) near = end;
+    for (const char *p = query; p < near; p++) {
+        if (*p == '\n') line++;
+    }
+    near_len = end - near;
+    if (near_len > 80) near_len = 80;
+    
+    spprintf(&message, 0,
+        "You have an error in your SQL syntax; check the manual that corresponds to your "
+        "MySQL server version for the right syntax to use near '%.*s' at line %d",
+        (int) near_len, near, line);
+    return message;
+}
+
+static int lex_reject(const char *query, size_t query_len, const char *near,
+                      int code, int *error_code, char **error_message) {
+    if (error_code) *error_code = code;
+    if (error_message) {
+        *error_message = (code == MYSQL_ER_EMPTY_QUERY)
+            ? estrdup("Query was empty")
+            : mysql_syntax_error_message(query, query_len, near);
+    }
+    return MYSQL_LEX_INVALID;
+}
+
+/*
+ * Local validation pre-pass. Rejects statements the lexer alone can prove
+ * invalid (unterminated literals or comments, unbalanced parentheses, an
+ * unknown leading word, several statements); anything else is left to the
+ * caller as MYSQL_LEX_UNDECIDED.
+ */
+int mysql_lex_validate(const char *query, size_t query_len, int *error_code, char **error_message) {
+    mysql_lexer lexer;
+    mysql_token token;
+    int depth = 0;
+    int first = 1;
+    int saw_semicolon = 0;
+    
+    if (error_code) *error_code = 0;
+    if (error_message) *error_message = NULL;
+    
+    mysql_lexer_init(&lexer, query, query_len, 0);
+    
+    while (mysql_lexer_next(&lexer, &token) != TOKEN_EOF) {
+        if (token.type == TOKEN_ERROR || saw_semicolon) {
+            return lex_reject(query, query_len, token.start, MYSQL_ER_PARSE_ERROR, error_code, error_message);
+        }
+        
+        if (first) {
+            if (!is_statement_start(&token)) {
+                return lex_reject(query, query_len, token.start, MYSQL_ER_PARSE_ERROR, error_code, error_message);
+            }
+            first = 0;
+        }
+        
+        switch (token.type) {
+            case TOKEN_LPAREN:
+                depth++;
+                break;
+            case TOKEN_RPAREN:
+                if (depth == 0) {
+                    return lex_reject(query, query_len, token.start, MYSQL_ER_PARSE_ERROR, error_code, error_message);
+                }
+                depth--;
+                break;
+            case TOKEN_SEMICOLON:
+                if (depth > 0) {
+                    return lex_reject(query, query_len, token.start, MYSQL_ER_PARSE_ERROR, error_code, error_message);
+                }
+                saw_semicolon = 1;
+                break;
+            default:
+                break;
+        }
+    }
+    
+    if (first) {
+        return lex_reject(query, query_len, NULL, MYSQL_ER_EMPTY_QUERY, error_code, error_message);
+    }
+    if (depth > 0) {
+        return lex_reject(query, query_len, query + query_len, MYSQL_ER_PARSE_ERROR, error_code, error_message);
+    }
+    
+    return MYSQL_LEX_UNDECIDED;
+}
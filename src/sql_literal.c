@@ -0,0 +1,318 @@
+#include "php.h"
+#include "../include/sql_literal.h"
+#include "../include/connection_pool.h"
+#include <string.h>
+
+/*
+ * Client character sets by name. UCS-2, UTF-16 and UTF-32 are left out:
+ * MySQL doesn't accept them for a connection, so there is nothing to escape
+ * for.
+ */
+static const mysql_charset charsets[] = {
+    {"utf8mb4", MYSQL_CHARSET_UTF8MB4},
+    {"utf8mb3", MYSQL_CHARSET_UTF8MB3},
+    {"utf8", MYSQL_CHARSET_UTF8MB3},
+    {"latin1", MYSQL_CHARSET_BYTES},
+    {"ascii", MYSQL_CHARSET_BYTES},
+    {"binary", MYSQL_CHARSET_BYTES},
+    {"big5", MYSQL_CHARSET_BIG5},
+    {"gbk", MYSQL_CHARSET_GBK},
+    {"gb18030", MYSQL_CHARSET_GB18030},
+    {"sjis", MYSQL_CHARSET_SJIS},
+    {"cp932", MYSQL_CHARSET_SJIS},
+    {"gb2312", MYSQL_CHARSET_BYTES},
+    {"euckr", MYSQL_CHARSET_BYTES},
+    {"ujis", MYSQL_CHARSET_BYTES},
+    {"eucjpms", MYSQL_CHARSET_BYTES},
+    {"armscii8", MYSQL_CHARSET_BYTES},
+    {"cp1250", MYSQL_CHARSET_BYTES},
+    {"cp1251", MYSQL_CHARSET_BYTES},
+    {"cp1256", MYSQL_CHARSET_BYTES},
+    {"cp1257", MYSQL_CHARSET_BYTES},
+    {"cp850", MYSQL_CHARSET_BYTES},
+    {"cp852", MYSQL_CHARSET_BYTES},
+    {"cp866", MYSQL_CHARSET_BYTES},
+    {"dec8", MYSQL_CHARSET_BYTES},
+    {"geostd8", MYSQL_CHARSET_BYTES},
+    {"greek", MYSQL_CHARSET_BYTES},
+    {"hebrew", MYSQL_CHARSET_BYTES},
+    {"hp8", MYSQL_CHARSET_BYTES},
+    {"keybcs2", MYSQL_CHARSET_BYTES},
+    {"koi8r", MYSQL_CHARSET_BYTES},
+    {"koi8u", MYSQL_CHARSET_BYTES},
+    {"latin2", MYSQL_CHARSET_BYTES},
+    {"latin5", MYSQL_CHARSET_BYTES},
+    {"latin7", MYSQL_CHARSET_BYTES},
+    {"macce", MYSQL_CHARSET_BYTES},
+    {"macroman", MYSQL_CHARSET_BYTES},
+    {"swe7", MYSQL_CHARSET_BYTES},
+    {"tis620", MYSQL_CHARSET_BYTES},
+};
+
+const mysql_charset mysql_charset_binary = {"binary", MYSQL_CHARSET_BYTES};
+
+/* NULL when name isn't a character set a client can connect with */
+const mysql_charset* mysql_charset_find(const char *name, size_t name_len) {
+    for (size_t i = 0; i < sizeof(charsets) / sizeof(charsets[0]); i++) {
+        if (strlen(charsets[i].name) == name_len && strncasecmp(charsets[i].name, name, name_len) == 0) {
+            return &charsets[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+ * The charset named by argument arg_num when the caller passed one, else the
+ * one in mysql_qp.dsn, else utf8mb4: what the connection the SQL is sent on
+ * most likely uses. NULL with a ValueError thrown when it isn't a charset a
+ * client can connect with.
+ */
+const mysql_charset* mysql_charset_resolve(zend_string *name, uint32_t arg_num) {
+    const mysql_charset *charset;
+
+    if (name) {
+        if (!(charset = mysql_charset_find(ZSTR_VAL(name), ZSTR_LEN(name)))) {
+            zend_argument_value_error(arg_num, "must be a character set MySQL accepts for a connection, \"%s\" given",
+                ZSTR_VAL(name));
+        }
+        return charset;
+    }
+    if (!mysql_qp_server_config.charset) {
+        return &charsets[0];
+    }
+    if (!(charset = mysql_charset_find(mysql_qp_server_config.charset, strlen(mysql_qp_server_config.charset)))) {
+        zend_value_error("The charset in mysql_qp.dsn must be a character set MySQL accepts for a connection, \"%s\" given",
+            mysql_qp_server_config.charset);
+    }
+    return charset;
+}
+
+/* Characters */
+
+/* Characters escaped inside a quoted literal, as mysql_real_escape_string() does */
+static const char escape_chars[256] = {
+    [0] = '0', ['\n'] = 'n', ['\r'] = 'r', ['\032'] = 'Z',
+    ['\\'] = '\\', ['\''] = '\'', ['"'] = '"'
+};
+
+#define IN_RANGE(c, lo, hi) ((unsigned char) (c) >= (lo) && (unsigned char) (c) <= (hi))
+
+static size_t utf8_char_length(const unsigned char *p, const unsigned char *end, size_t max) {
+    unsigned char c = p[0];
+
+    if (c < 0xC2) {
+        return 0;
+    }
+    if (c < 0xE0) {
+        return end - p >= 2 && IN_RANGE(p[1], 0x80, 0xBF) ? 2 : 0;
+    }
+    if (c < 0xF0) {
+        if (end - p < 3 || !IN_RANGE(p[1], 0x80, 0xBF) || !IN_RANGE(p[2], 0x80, 0xBF)) return 0;
+        if (c == 0xE0 && p[1] < 0xA0) return 0;     /* overlong */
+        if (c == 0xED && p[1] >= 0xA0) return 0;    /* surrogate */
+        return 3;
+    }
+    if (c < 0xF5 && max == 4) {
+        if (end - p < 4 || !IN_RANGE(p[1], 0x80, 0xBF) || !IN_RANGE(p[2], 0x80, 0xBF) || !IN_RANGE(p[3], 0x80, 0xBF)) return 0;
+        if (c == 0xF0 && p[1] < 0x90) return 0;     /* overlong */
+        if (c == 0xF4 && p[1] >= 0x90) return 0;    /* above U+10FFFF */
+        return 4;
+    }
+    return 0;
+}
+
+/* Bytes in the non-ASCII character at p, or 0 when it isn't a valid one */
+static size_t char_length(const mysql_charset *charset, const unsigned char *p, const unsigned char *end) {
+    unsigned char c = p[0];
+    size_t left = end - p;
+
+    switch (charset->kind) {
+        case MYSQL_CHARSET_BYTES:
+            return 1;
+        case MYSQL_CHARSET_UTF8MB3:
+            return utf8_char_length(p, end, 3);
+        case MYSQL_CHARSET_UTF8MB4:
+            return utf8_char_length(p, end, 4);
+        case MYSQL_CHARSET_BIG5:
+            return IN_RANGE(c, 0xA1, 0xF9) && left >= 2
+                && (IN_RANGE(p[1], 0x40, 0x7E) || IN_RANGE(p[1], 0xA1, 0xFE)) ? 2 : 0;
+        case MYSQL_CHARSET_GBK:
+            return IN_RANGE(c, 0x81, 0xFE) && left >= 2
+                && (IN_RANGE(p[1], 0x40, 0x7E) || IN_RANGE(p[1], 0x80, 0xFE)) ? 2 : 0;
+        case MYSQL_CHARSET_SJIS:
+            if (IN_RANGE(c, 0xA1, 0xDF)) {
+                return 1;   /* half-width katakana */
+            }
+            return (IN_RANGE(c, 0x81, 0x9F) || IN_RANGE(c, 0xE0, 0xFC)) && left >= 2
+                && (IN_RANGE(p[1], 0x40, 0x7E) || IN_RANGE(p[1], 0x80, 0xFC)) ? 2 : 0;
+        case MYSQL_CHARSET_GB18030:
+            if (!IN_RANGE(c, 0x81, 0xFE) || left < 2) {
+                return 0;
+            }
+            if (IN_RANGE(p[1], 0x30, 0x39)) {
+                return left >= 4 && IN_RANGE(p[2], 0x81, 0xFE) && IN_RANGE(p[3], 0x30, 0x39) ? 4 : 0;
+            }
+            return IN_RANGE(p[1], 0x40, 0x7E) || IN_RANGE(p[1], 0x80, 0xFE) ? 2 : 0;
+    }
+    return 0;
+}
+
+/* Whether bytes from 0x80 up only ever appear in multibyte characters, so escaping can go byte by byte */
+static zend_always_inline zend_bool ascii_safe(const mysql_charset *charset) {
+    return charset->kind <= MYSQL_CHARSET_UTF8MB4;
+}
+
+/* Literals */
+
+static size_t format_double(double value, char *buf, size_t size) {
+    return (size_t) snprintf(buf, size, "%.*H", (int) PG(serialize_precision), value);
+}
+
+/* Quoted length of a string, or its X'...' length when it isn't valid text in the charset */
+static size_t string_length(const zend_string *str, const mysql_charset *charset, zend_bool *hex) {
+    const unsigned char *p = (const unsigned char *) ZSTR_VAL(str), *end = p + ZSTR_LEN(str);
+    size_t escapes = 0, n;
+
+    *hex = 0;
+    if (charset->kind == MYSQL_CHARSET_BYTES) {
+        for (; p < end; p++) {
+            escapes += escape_chars[*p] != 0;
+        }
+        return ZSTR_LEN(str) + 2 + escapes;
+    }
+
+    while (p < end) {
+        if (*p < 0x80) {
+            escapes += escape_chars[*p++] != 0;
+        } else if ((n = char_length(charset, p, end))) {
+            p += n;
+        } else {
+            *hex = 1;
+            return ZSTR_LEN(str) * 2 + 3;
+        }
+    }
+    return ZSTR_LEN(str) + 2 + escapes;
+}
+
+/* Measure value as an SQL literal; FAILURE when it can't be one */
+int mysql_literal_measure(mysql_literal *literal, zval *value, const mysql_charset *charset) {
+    char buf[64];
+
+    literal->value = value;
+    literal->hex = 0;
+
+    switch (Z_TYPE_P(value)) {
+        case IS_NULL:
+            literal->len = sizeof("NULL") - 1;
+            return SUCCESS;
+        case IS_TRUE:
+            literal->len = sizeof("TRUE") - 1;
+            return SUCCESS;
+        case IS_FALSE:
+            literal->len = sizeof("FALSE") - 1;
+            return SUCCESS;
+        case IS_LONG:
+            literal->len = buf + sizeof(buf) - 1 - zend_print_long_to_buf(buf + sizeof(buf) - 1, Z_LVAL_P(value));
+            return SUCCESS;
+        case IS_DOUBLE:
+            if (!zend_finite(Z_DVAL_P(value))) {
+                return FAILURE;
+            }
+            literal->len = format_double(Z_DVAL_P(value), buf, sizeof(buf));
+            return SUCCESS;
+        case IS_STRING:
+            literal->len = string_length(Z_STR_P(value), charset, &literal->hex);
+            return SUCCESS;
+        default:
+            return FAILURE;
+    }
+}
+
+/* The exception for a value mysql_literal_measure() turned down; label names its placeholder */
+void mysql_literal_throw(zval *value, const char *label) {
+    if (Z_TYPE_P(value) == IS_DOUBLE) {
+        zend_value_error("Value for placeholder %s must be a finite number", label);
+    } else {
+        zend_type_error("Value for placeholder %s must be of type string|int|float|bool|null, %s given",
+                        label, zend_zval_type_name(value));
+    }
+}
+
+static char* write_string(char *out, const mysql_literal *literal, const mysql_charset *charset) {
+    const zend_string *str = Z_STR_P(literal->value);
+    const unsigned char *p = (const unsigned char *) ZSTR_VAL(str), *end = p + ZSTR_LEN(str);
+    char *q = out;
+
+    if (literal->hex) {
+        static const char digits[] = "0123456789ABCDEF";
+        *q++ = 'X';
+        *q++ = '\'';
+        for (; p < end; p++) {
+            *q++ = digits[*p >> 4];
+            *q++ = digits[*p & 0xF];
+        }
+        *q++ = '\'';
+        return q;
+    }
+
+    *q++ = '\'';
+    if (literal->len == ZSTR_LEN(str) + 2) {
+        /* Nothing to escape */
+        memcpy(q, p, ZSTR_LEN(str));
+        q += ZSTR_LEN(str);
+    } else if (ascii_safe(charset)) {
+        for (; p < end; p++) {
+            if (escape_chars[*p]) {
+                *q++ = '\\';
+                *q++ = escape_chars[*p];
+            } else {
+                *q++ = (char) *p;
+            }
+        }
+    } else {
+        /* A trail byte can be a backslash or a quote; it belongs to its character and isn't escaped */
+        while (p < end) {
+            if (*p >= 0x80) {
+                size_t n = char_length(charset, p, end);
+                memcpy(q, p, n);
+                q += n;
+                p += n;
+            } else if (escape_chars[*p]) {
+                *q++ = '\\';
+                *q++ = escape_chars[*p++];
+            } else {
+                *q++ = (char) *p++;
+            }
+        }
+    }
+    *q++ = '\'';
+    return q;
+}
+
+/* Write a measured literal; returns the end of what was written */
+char* mysql_literal_write(char *out, const mysql_literal *literal, const mysql_charset *charset) {
+    zval *value = literal->value;
+    char buf[64];
+
+    switch (Z_TYPE_P(value)) {
+        case IS_NULL:
+            memcpy(out, "NULL", literal->len);
+            break;
+        case IS_TRUE:
+            memcpy(out, "TRUE", literal->len);
+            break;
+        case IS_FALSE:
+            memcpy(out, "FALSE", literal->len);
+            break;
+        case IS_LONG:
+            memcpy(out, zend_print_long_to_buf(buf + sizeof(buf) - 1, Z_LVAL_P(value)), literal->len);
+            break;
+        case IS_DOUBLE:
+            format_double(Z_DVAL_P(value), buf, sizeof(buf));
+            memcpy(out, buf, literal->len);
+            break;
+        case IS_STRING:
+            return write_string(out, literal, charset);
+    }
+    return out + literal->len;
+}
@@ -0,0 +1,242 @@
+#include "php.h"
+#include "zend_interfaces.h"
+#include "zend_exceptions.h"
+#include "../include/php_mysql_qp.h"
+#include "../include/mysql_query_parser.h"
+#include "../include/sql_splitter.h"
+#include "../include/sql_script.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+zend_class_entry *mysql_qp_sql_script_ce;
+static zend_object_handlers sql_script_handlers;
+
+/* A script held either as the caller's string, shared, or as a read-only mapping of a file */
+typedef struct {
+    zend_string *sql;           /* NULL for a file */
+    char *map;                  /* NULL for a string or an empty file */
+    size_t map_len;
+    zend_bool spans;            /* statements as [offset, length] into the script */
+    zend_object std;
+} sql_script_object;
+
+/* One foreach over the script; only the current statement is ever held */
+typedef struct {
+    zend_object_iterator it;
+    mysql_splitter splitter;
+    zend_long key;
+    zval statement;
+} sql_script_iterator;
+
+static zend_always_inline sql_script_object* sql_script_from_obj(zend_object *obj) {
+    return (sql_script_object *) ((char *) obj - XtOffsetOf(sql_script_object, std));
+}
+
+static zend_object* sql_script_create(zend_class_entry *ce) {
+    sql_script_object *script = zend_object_alloc(sizeof(sql_script_object), ce);
+
+    zend_object_std_init(&script->std, ce);
+    object_properties_init(&script->std, ce);
+    script->std.handlers = &sql_script_handlers;
+    return &script->std;
+}
+
+static void sql_script_free(zend_object *obj) {
+    sql_script_object *script = sql_script_from_obj(obj);
+
+    if (script->sql) {
+        zend_string_release(script->sql);
+    }
+    if (script->map) {
+        munmap(script->map, script->map_len);
+    }
+    zend_object_std_dtor(obj);
+}
+
+/* Iterator */
+
+static void sql_script_fetch(sql_script_iterator *iter) {
+    sql_script_object *script = sql_script_from_obj(Z_OBJ(iter->it.data));
+    size_t offset, length;
+    int status;
+
+    zval_ptr_dtor(&iter->statement);
+    ZVAL_UNDEF(&iter->statement);
+    iter->key++;
+
+    status = mysql_splitter_next(&iter->splitter, &offset, &length);
+    if (status == FAILURE) {
+        zend_value_error("%s at offset %zu", iter->splitter.error,
+                         (size_t) (iter->splitter.pos - iter->splitter.script));
+    } else if (status == 1) {
+        if (script->spans) {
+            mysql_span_to_zval(&iter->statement, offset, length);
+        } else {
+            ZVAL_STRINGL_FAST(&iter->statement, iter->splitter.script + offset, length);
+        }
+    }
+}
+
+static void sql_script_it_dtor(zend_object_iterator *it) {
+    sql_script_iterator *iter = (sql_script_iterator *) it;
+
+    zval_ptr_dtor(&iter->statement);
+    zval_ptr_dtor(&it->data);
+}
+
+static zend_result sql_script_it_valid(zend_object_iterator *it) {
+    return Z_TYPE(((sql_script_iterator *) it)->statement) != IS_UNDEF ? SUCCESS : FAILURE;
+}
+
+static zval* sql_script_it_current(zend_object_iterator *it) {
+    return &((sql_script_iterator *) it)->statement;
+}
+
+static void sql_script_it_key(zend_object_iterator *it, zval *key) {
+    ZVAL_LONG(key, ((sql_script_iterator *) it)->key);
+}
+
+static void sql_script_it_move_forward(zend_object_iterator *it) {
+    sql_script_fetch((sql_script_iterator *) it);
+}
+
+static void sql_script_it_rewind(zend_object_iterator *it) {
+    sql_script_iterator *iter = (sql_script_iterator *) it;
+    sql_script_object *script = sql_script_from_obj(Z_OBJ(it->data));
+
+    if (script->sql) {
+        mysql_splitter_init(&iter->splitter, ZSTR_VAL(script->sql), ZSTR_LEN(script->sql));
+    } else {
+        mysql_splitter_init(&iter->splitter, script->map ? script->map : "", script->map_len);
+    }
+    iter->key = -1;
+    sql_script_fetch(iter);
+}
+
+static const zend_object_iterator_funcs sql_script_it_funcs = {
+    sql_script_it_dtor,
+    sql_script_it_valid,
+    sql_script_it_current,
+    sql_script_it_key,
+    sql_script_it_move_forward,
+    sql_script_it_rewind,
+    NULL,                       /* invalidate_current */
+    NULL                        /* get_gc */
+};
+
+static zend_object_iterator* sql_script_get_iterator(zend_class_entry *ce, zval *object, int by_ref) {
+    sql_script_iterator *iter;
+
+    if (by_ref) {
+        zend_throw_error(NULL, "An iterator cannot be used with foreach by reference");
+        return NULL;
+    }
+
+    iter = ecalloc(1, sizeof(sql_script_iterator));
+    zend_iterator_init(&iter->it);
+    ZVAL_OBJ_COPY(&iter->it.data, Z_OBJ_P(object));
+    iter->it.funcs = &sql_script_it_funcs;
+    ZVAL_UNDEF(&iter->statement);
+    return &iter->it;
+}
+
+/* Methods */
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_sql_script_construct, 0, 0, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_sql_script_get_iterator, 0, 0, Iterator, 0)
+ZEND_END_ARG_INFO()
+
+/* Only mysql_split_sql() and mysql_split_sql_file() hand these out */
+PHP_METHOD(MysqlQp_SqlScript, __construct)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+}
+
+PHP_METHOD(MysqlQp_SqlScript, getIterator)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    zend_create_internal_iterator_zval(return_value, ZEND_THIS);
+}
+
+static const zend_function_entry sql_script_methods[] = {
+    PHP_ME(MysqlQp_SqlScript, __construct, arginfo_sql_script_construct, ZEND_ACC_PRIVATE)
+    PHP_ME(MysqlQp_SqlScript, getIterator, arginfo_sql_script_get_iterator, ZEND_ACC_PUBLIC)
+    PHP_FE_END
+};
+
+/* Register the class; called from MINIT */
+void mysql_sql_script_startup(void) {
+    zend_class_entry ce;
+
+    INIT_CLASS_ENTRY(ce, "MysqlQp\\SqlScript", sql_script_methods);
+    mysql_qp_sql_script_ce = zend_register_internal_class(&ce);
+    mysql_qp_sql_script_ce->ce_flags |= ZEND_ACC_FINAL | ZEND_ACC_NO_DYNAMIC_PROPERTIES | ZEND_ACC_NOT_SERIALIZABLE;
+    mysql_qp_sql_script_ce->create_object = sql_script_create;
+    zend_class_implements(mysql_qp_sql_script_ce, 1, zend_ce_aggregate);
+    /* foreach goes straight to the C iterator; getIterator() wraps the same one */
+    mysql_qp_sql_script_ce->get_iterator = sql_script_get_iterator;
+
+    memcpy(&sql_script_handlers, zend_get_std_object_handlers(), sizeof(zend_object_handlers));
+    sql_script_handlers.offset = XtOffsetOf(sql_script_object, std);
+    sql_script_handlers.free_obj = sql_script_free;
+    sql_script_handlers.clone_obj = NULL;
+}
+
+/* A script in a string; the string is shared with the object */
+void mysql_sql_script_init(zval *script, zend_string *sql, zend_bool spans) {
+    sql_script_object *object;
+
+    object_init_ex(script, mysql_qp_sql_script_ce);
+    object = sql_script_from_obj(Z_OBJ_P(script));
+    object->sql = zend_string_copy(sql);
+    object->spans = spans;
+}
+
+/*
+ * A script in a file, mapped rather than read so a dump of any size costs
+ * only the pages the scan is passing through. FAILURE with a warning if it
+ * can't be opened.
+ */
+int mysql_sql_script_open(zval *script, const char *path, zend_bool spans) {
+    sql_script_object *object;
+    struct stat st;
+    char *map = NULL;
+    int fd;
+
+    if (php_check_open_basedir(path)) {
+        return FAILURE;
+    }
+    if ((fd = open(path, O_RDONLY)) < 0) {
+        php_error_docref(NULL, E_WARNING, "Cannot open %s: %s", path, strerror(errno));
+        return FAILURE;
+    }
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        php_error_docref(NULL, E_WARNING, "Cannot map %s: not a regular file", path);
+        close(fd);
+        return FAILURE;
+    }
+    if (st.st_size > 0) {
+        map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            php_error_docref(NULL, E_WARNING, "Cannot map %s: %s", path, strerror(errno));
+            close(fd);
+            return FAILURE;
+        }
+#ifdef MADV_SEQUENTIAL
+        madvise(map, (size_t) st.st_size, MADV_SEQUENTIAL);
+#endif
+    }
+    close(fd);
+
+    object_init_ex(script, mysql_qp_sql_script_ce);
+    object = sql_script_from_obj(Z_OBJ_P(script));
+    object->map = map;
+    object->map_len = (size_t) st.st_size;
+    object->spans = spans;
+    return SUCCESS;
+}
@@ -0,0 +1,289 @@
+#include "php.h"
+#include "../include/php_mysql_qp.h"
+#include "../include/sql_splitter.h"
+#include "../include/sql_lexer.h"
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/*
+ * Script splitter. Statements end at the current delimiter outside quotes
+ * and comments; DELIMITER lines change it, as in the mysql client. Most of
+ * a script is plain SQL, so the scan jumps between the few bytes that can
+ * matter (quotes, comment starts and the delimiter's first byte) 16 at a
+ * time with SSE2, and uses memchr() inside comments.
+ *
+ * With the default delimiter, a CREATE PROCEDURE, FUNCTION, TRIGGER or
+ * EVENT whose BEGIN ... END body was written without a DELIMITER change
+ * still comes out whole: its body is tracked with the lexer and a ";"
+ * inside it doesn't end the statement.
+ */
+
+#define IS_BLANK(c) ((c) == ' ' || ((c) >= '\t' && (c) <= '\r'))
+
+void mysql_splitter_init(mysql_splitter *splitter, const char *script, size_t script_len) {
+    memset(splitter, 0, sizeof(mysql_splitter));
+    splitter->script = script;
+    splitter->pos = script;
+    splitter->end = script + script_len;
+    splitter->delimiter[0] = ';';
+    splitter->delimiter_len = 1;
+}
+
+/* Skip to the next byte that can start a quote, a comment or the delimiter */
+static zend_always_inline const char* skip_plain(const char *p, const char *end, char first) {
+#ifdef __SSE2__
+    const __m128i d = _mm_set1_epi8(first);
+    while (end - p >= 16) {
+        __m128i c = _mm_loadu_si128((const __m128i *) p);
+        __m128i hit = _mm_or_si128(
+            _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('\'')), _mm_cmpeq_epi8(c, _mm_set1_epi8('"'))),
+                         _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('`')), _mm_cmpeq_epi8(c, _mm_set1_epi8('#')))),
+            _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('-')), _mm_cmpeq_epi8(c, _mm_set1_epi8('/'))),
+                         _mm_cmpeq_epi8(c, d)));
+        int bits = _mm_movemask_epi8(hit);
+        if (bits) {
+            return p + __builtin_ctz(bits);
+        }
+        p += 16;
+    }
+#endif
+    while (p < end && *p != '\'' && *p != '"' && *p != '`' && *p != '#' && *p != '-' && *p != '/' && *p != first) {
+        p++;
+    }
+    return p;
+}
+
+/* Past the closing quote of a run opened just before p; an unterminated run ends the script */
+static const char* skip_quoted(const char *p, const char *end, char quote) {
+    while (p < end) {
+        const char *q = memchr(p, quote, end - p);
+
+        if (!q) {
+            return end;
+        }
+        if (quote != '`') {
+            /* An odd number of backslashes before the quote escapes it */
+            const char *b = q;
+            while (b > p && b[-1] == '\\') b--;
+            if ((q - b) & 1) {
+                p = q + 1;
+                continue;
+            }
+        }
+        if (q + 1 < end && q[1] == quote) {
+            p = q + 2;      /* doubled quote */
+            continue;
+        }
+        return q + 1;
+    }
+    return end;
+}
+
+static const char* skip_line(const char *p, const char *end) {
+    const char *nl = memchr(p, '\n', end - p);
+    return nl ? nl + 1 : end;
+}
+
+/* Past the "*" "/" closing a comment whose body starts at p */
+static const char* skip_block_comment(const char *p, const char *end) {
+    while (p < end) {
+        const char *star = memchr(p, '*', end - p);
+
+        if (!star || star + 1 >= end) {
+            return end;
+        }
+        if (star[1] == '/') {
+            return star + 2;
+        }
+        p = star + 1;
+    }
+    return end;
+}
+
+/* "-- " starts a comment only with whitespace (or the end) after the dashes */
+static zend_always_inline int is_dash_comment(const char *p, const char *end) {
+    return p + 1 < end && p[1] == '-' && (p + 2 == end || IS_BLANK(p[2]));
+}
+
+/* Whitespace and comments before a statement; version comments and hints are part of it */
+static const char* skip_blank(const char *p, const char *end) {
+    while (p < end) {
+        if (IS_BLANK(*p)) {
+            p++;
+        } else if (*p == '#' || (*p == '-' && is_dash_comment(p, end))) {
+            p = skip_line(p, end);
+        } else if (*p == '/' && p + 2 < end && p[1] == '*' && p[2] != '!' && p[2] != '+') {
+            p = skip_block_comment(p + 2, end);
+        } else {
+            break;
+        }
+    }
+    return p;
+}
+
+/* The next delimiter at or after p outside quotes and comments, or end */
+static const char* find_delimiter(const mysql_splitter *splitter, const char *p) {
+    const char *end = splitter->end;
+    char first = splitter->delimiter[0];
+
+    while ((p = skip_plain(p, end, first)) < end) {
+        if (*p == first && (size_t) (end - p) >= splitter->delimiter_len &&
+            memcmp(p, splitter->delimiter, splitter->delimiter_len) == 0) {
+            return p;
+        }
+        switch (*p) {
+            case '\'':
+            case '"':
+            case '`':
+                p = skip_quoted(p + 1, end, *p);
+                break;
+            case '#':
+                p = skip_line(p, end);
+                break;
+            case '-':
+                p = is_dash_comment(p, end) ? skip_line(p, end) : p + 1;
+                break;
+            case '/':
+                p = p + 1 < end && p[1] == '*' ? skip_block_comment(p + 2, end) : p + 1;
+                break;
+            default:
+                p++;
+                break;
+        }
+    }
+    return end;
+}
+
+/* A DELIMITER line at p: set the new delimiter and return the start of the next line, or NULL if p isn't one.
+ * A bad one sets error and returns p. */
+static const char* delimiter_command(mysql_splitter *splitter, const char *p) {
+    const char *end = splitter->end, *arg, *arg_end;
+
+    if (end - p < 9 || strncasecmp(p, "DELIMITER", 9) != 0 || (p + 9 < end && !IS_BLANK(p[9]))) {
+        return NULL;
+    }
+    for (arg = p + 9; arg < end && (*arg == ' ' || *arg == '\t'); arg++);
+
+    if (arg < end && (*arg == '\'' || *arg == '"' || *arg == '`')) {
+        const char *close = memchr(arg + 1, *arg, end - arg - 1);
+        arg_end = close ? close : end;
+        arg++;
+    } else {
+        for (arg_end = arg; arg_end < end && !IS_BLANK(*arg_end); arg_end++);
+    }
+
+    if (arg_end == arg) {
+        splitter->error = "DELIMITER must be followed by a delimiter";
+        return p;
+    }
+    if ((size_t) (arg_end - arg) > MYSQL_SPLIT_MAX_DELIMITER || memchr(arg, '\\', arg_end - arg)) {
+        splitter->error = "DELIMITER must be at most 16 bytes long and cannot contain a backslash";
+        return p;
+    }
+    memcpy(splitter->delimiter, arg, arg_end - arg);
+    splitter->delimiter_len = arg_end - arg;
+    return skip_line(arg_end, end);
+}
+
+/* Whether [p, end) is a CREATE of a stored program, whose body may hold ";" */
+static int is_stored_program(const char *p, const char *end) {
+    mysql_lexer lexer;
+    mysql_token token;
+
+    mysql_lexer_init(&lexer, p, end - p, 0);
+    if (mysql_lexer_next(&lexer, &token) != TOKEN_KEYWORD || token.keyword != MYSQL_KW_CREATE) {
+        return 0;
+    }
+    /* CREATE [OR REPLACE] [DEFINER = user] [AGGREGATE] PROCEDURE|FUNCTION|TRIGGER|EVENT */
+    for (int i = 0; i < 12 && mysql_lexer_next(&lexer, &token) > TOKEN_ERROR; i++) {
+        if (token.type == TOKEN_LPAREN) {
+            return 0;
+        }
+        if (token.type == TOKEN_KEYWORD &&
+            (token.keyword == MYSQL_KW_PROCEDURE || token.keyword == MYSQL_KW_FUNCTION ||
+             token.keyword == MYSQL_KW_TRIGGER || token.keyword == MYSQL_KW_EVENT)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Blocks opened minus blocks closed in [p, end). BEGIN and CASE open a
+ * block and END closes it; END IF, END LOOP, END WHILE and END REPEAT close
+ * constructs that aren't counted. END CASE closes a CASE statement, and its
+ * CASE doesn't open another block.
+ */
+static int block_depth(const char *p, const char *end) {
+    mysql_lexer lexer;
+    mysql_token token, next;
+    int depth = 0;
+    enum mysql_token_type type;
+
+    mysql_lexer_init(&lexer, p, end - p, 0);
+    type = mysql_lexer_next(&lexer, &token);
+    while (type > TOKEN_ERROR) {
+        type = mysql_lexer_next(&lexer, &next);
+        if (token.type == TOKEN_KEYWORD) {
+            if (token.keyword == MYSQL_KW_BEGIN || token.keyword == MYSQL_KW_CASE) {
+                depth++;
+            } else if (token.keyword == MYSQL_KW_END &&
+                       !(type == TOKEN_KEYWORD && (next.keyword == MYSQL_KW_IF || next.keyword == MYSQL_KW_LOOP ||
+                                                   next.keyword == MYSQL_KW_WHILE || next.keyword == MYSQL_KW_REPEAT))) {
+                depth--;
+                if (type == TOKEN_KEYWORD && next.keyword == MYSQL_KW_CASE) {
+                    type = mysql_lexer_next(&lexer, &next);
+                }
+            }
+        }
+        token = next;
+    }
+    return depth;
+}
+
+/*
+ * The next statement as [offset, length] into the script, without the
+ * delimiter and surrounding whitespace. Returns 1 for a statement, 0 at the
+ * end of the script, or FAILURE with error set for a bad DELIMITER line,
+ * which pos is left at.
+ */
+int mysql_splitter_next(mysql_splitter *splitter, size_t *offset, size_t *length) {
+    const char *end = splitter->end, *start, *stop, *next;
+
+    while (!splitter->error) {
+        start = skip_blank(splitter->pos, end);
+        if (start == end) {
+            splitter->pos = end;
+            return 0;
+        }
+
+        if ((next = delimiter_command(splitter, start))) {
+            splitter->pos = next;
+            continue;
+        }
+
+        stop = find_delimiter(splitter, start);
+        if (splitter->delimiter_len == 1 && splitter->delimiter[0] == ';' && is_stored_program(start, stop)) {
+            const char *from = start;
+            int depth = 0;
+
+            while ((depth += block_depth(from, stop)) > 0 && stop < end) {
+                from = stop + 1;
+                stop = find_delimiter(splitter, from);
+            }
+        }
+        splitter->pos = stop < end ? stop + splitter->delimiter_len : end;
+
+        while (stop > start && IS_BLANK(stop[-1])) stop--;
+        if (stop == start) {
+            continue;       /* ";;" */
+        }
+        *offset = start - splitter->script;
+        *length = stop - start;
+        return 1;
+    }
+    return FAILURE;
+}
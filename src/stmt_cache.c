@@ -0,0 +1,288 @@
+#include "php.h"
+#include "../include/php_mysql_qp.h"
+#include "../include/stmt_cache.h"
+#include "../include/query_stats.h"
+#include <string.h>
+
+#define STMT_CACHE_MIN_BUCKETS 16
+
+/* The server's max_prepared_stmt_count is used up, by us or another client */
+#define MYSQL_ER_MAX_PREPARED_STMT_COUNT_REACHED 1461
+/* Tables changed under a statement; the server gave up re-preparing it */
+#define MYSQL_ER_NEED_REPREPARE 1615
+
+void mysql_stmt_cache_init(mysql_stmt_cache *cache, size_t capacity, size_t share) {
+    memset(cache, 0, sizeof(mysql_stmt_cache));
+    cache->configured = capacity;
+    cache->limit = capacity;
+    cache->capacity = capacity;
+    cache->share = share > 0 ? share : 1;
+}
+
+static void entry_free(mysql_stmt_entry *entry, zend_bool close_handle) {
+    if (close_handle && entry->stmt) {
+        mysql_stmt_close(entry->stmt);
+    }
+    for (unsigned int i = 0; i < entry->column_count; i++) {
+        pefree(entry->columns[i].name, 1);
+        pefree(entry->columns[i].org_table, 1);
+    }
+    if (entry->columns) pefree(entry->columns, 1);
+    pefree(entry, 1);
+}
+
+/*
+ * Without close_handles the statements are dropped but not closed: their
+ * connection was inherited across fork() and belongs to the parent, which
+ * still uses the statement ids.
+ */
+void mysql_stmt_cache_destroy(mysql_stmt_cache *cache, zend_bool close_handles) {
+    mysql_stmt_entry *entry = cache->lru_head, *next;
+    size_t configured = cache->configured, share = cache->share;
+
+    while (entry) {
+        next = entry->lru_next;
+        entry_free(entry, close_handles);
+        entry = next;
+    }
+    if (cache->buckets) pefree(cache->buckets, 1);
+
+    /* A reconnected session starts empty, sized afresh from the configured capacity */
+    mysql_stmt_cache_init(cache, configured, share);
+}
+
+static size_t bucket_index(const mysql_stmt_cache *cache, zend_ulong hash) {
+    return (size_t) hash & (cache->bucket_count - 1);
+}
+
+static void lru_unlink(mysql_stmt_cache *cache, mysql_stmt_entry *entry) {
+    if (entry->lru_prev) entry->lru_prev->lru_next = entry->lru_next;
+    else cache->lru_head = entry->lru_next;
+    if (entry->lru_next) entry->lru_next->lru_prev = entry->lru_prev;
+    else cache->lru_tail = entry->lru_prev;
+    entry->lru_prev = entry->lru_next = NULL;
+}
+
+static void lru_push_front(mysql_stmt_cache *cache, mysql_stmt_entry *entry) {
+    entry->lru_prev = NULL;
+    entry->lru_next = cache->lru_head;
+    if (cache->lru_head) cache->lru_head->lru_prev = entry;
+    cache->lru_head = entry;
+    if (!cache->lru_tail) cache->lru_tail = entry;
+}
+
+static void resize_buckets(mysql_stmt_cache *cache, size_t bucket_count) {
+    mysql_stmt_entry *entry;
+
+    if (cache->buckets) pefree(cache->buckets, 1);
+    cache->buckets = pecalloc(bucket_count, sizeof(mysql_stmt_entry *), 1);
+    cache->bucket_count = bucket_count;
+
+    for (entry = cache->lru_head; entry; entry = entry->lru_next) {
+        size_t index = bucket_index(cache, entry->hash);
+        entry->bucket_next = cache->buckets[index];
+        cache->buckets[index] = entry;
+    }
+}
+
+/* Close the least recently used statement, freeing its server-side slot */
+static void evict_tail(mysql_stmt_cache *cache) {
+    mysql_stmt_entry *victim = cache->lru_tail, **link;
+
+    link = &cache->buckets[bucket_index(cache, victim->hash)];
+    while (*link != victim) link = &(*link)->bucket_next;
+    *link = victim->bucket_next;
+
+    lru_unlink(cache, victim);
+    entry_free(victim, 1);
+    cache->count--;
+    MYSQL_QP_G(stats).stmt_evictions++;
+}
+
+static mysql_stmt_entry* lookup(mysql_stmt_cache *cache, zend_ulong hash, const char *query, size_t query_len) {
+    mysql_stmt_entry *entry;
+
+    if (cache->count == 0) {
+        return NULL;
+    }
+    for (entry = cache->buckets[bucket_index(cache, hash)]; entry; entry = entry->bucket_next) {
+        if (entry->hash == hash && entry->query_len == query_len && memcmp(entry->query, query, query_len) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/* Lower the capacity to this connection's share of max_prepared_stmt_count; one round trip per connection */
+static void size_cache(mysql_stmt_cache *cache, MYSQL *conn) {
+    static const char query[] = "SELECT @@max_prepared_stmt_count";
+    MYSQL_RES *res;
+    MYSQL_ROW row;
+
+    cache->sized = 1;
+    mysql_qp_stats_round_trips(1);
+    if (mysql_real_query(conn, query, sizeof(query) - 1) != 0 || !(res = mysql_store_result(conn))) {
+        return;
+    }
+    if ((row = mysql_fetch_row(res)) && row[0]) {
+        size_t share = (size_t) ZEND_STRTOUL(row[0], NULL, 10) / cache->share;
+        if (share < cache->limit) {
+            cache->limit = cache->capacity = share;
+        }
+    }
+    mysql_free_result(res);
+}
+
+/* Copy out what mysql_stmt_result_metadata() says about the result set, if there is one */
+static void read_columns(mysql_stmt_entry *entry) {
+    MYSQL_RES *meta = mysql_stmt_result_metadata(entry->stmt);
+    MYSQL_FIELD *fields;
+
+    if (!meta) {
+        return;
+    }
+    entry->column_count = mysql_num_fields(meta);
+    fields = mysql_fetch_fields(meta);
+    entry->columns = pecalloc(entry->column_count, sizeof(mysql_stmt_column), 1);
+    for (unsigned int i = 0; i < entry->column_count; i++) {
+        mysql_stmt_column *column = &entry->columns[i];
+
+        column->name = pestrndup(fields[i].name, fields[i].name_length, 1);
+        column->org_table = pestrndup(fields[i].org_table ? fields[i].org_table : "", fields[i].org_table_length, 1);
+        column->type = fields[i].type;
+        column->length = fields[i].length;
+        column->flags = fields[i].flags;
+        column->charsetnr = fields[i].charsetnr;
+    }
+    mysql_free_result(meta);
+}
+
+/*
+ * Prepare query on conn; when the server is out of statement slots, give
+ * back ours and retry. The cache then keeps no more than the server took,
+ * until acquiring shows there is room again. ER_NEED_REPREPARE means the
+ * schema changed under this session, so every cached statement may be
+ * stale: they are all dropped and the prepare is tried once more.
+ */
+static MYSQL_STMT* prepare(mysql_stmt_cache *cache, MYSQL *conn, const char *query, size_t query_len,
+                           int *error_code, char **error_message) {
+    MYSQL_STMT *stmt = mysql_stmt_init(conn);
+    zend_bool reprepared = 0;
+
+    if (!stmt) {
+        *error_code = 0;
+        *error_message = estrdup("Could not create MySQL statement");
+        return NULL;
+    }
+    while (mysql_qp_stmt_prepare(stmt, query, query_len) != 0) {
+        if (mysql_stmt_errno(stmt) == MYSQL_ER_MAX_PREPARED_STMT_COUNT_REACHED && cache && cache->count > 0) {
+            evict_tail(cache);
+            cache->capacity = cache->count;
+            continue;
+        }
+        if (mysql_stmt_errno(stmt) == MYSQL_ER_NEED_REPREPARE && !reprepared) {
+            while (cache && cache->count > 0) {
+                evict_tail(cache);
+            }
+            reprepared = 1;
+            continue;
+        }
+        *error_code = (int) mysql_stmt_errno(stmt);
+        *error_message = estrdup(mysql_stmt_error(stmt));
+        mysql_stmt_close(stmt);
+        return NULL;
+    }
+    return stmt;
+}
+
+/*
+ * A prepared statement for query on conn, reusing the cached handle when the
+ * same text was prepared before. Pass a NULL cache for connections that
+ * aren't pooled; the statement is then closed on release. Returns NULL with
+ * the server's error (error_code 0 for client failures).
+ */
+mysql_stmt_entry* mysql_stmt_cache_acquire(mysql_stmt_cache *cache, MYSQL *conn, const char *query, size_t query_len,
+                                           int *error_code, char **error_message) {
+    zend_ulong hash = zend_inline_hash_func(query, query_len);
+    mysql_stmt_entry *entry;
+    MYSQL_STMT *stmt;
+    size_t index;
+
+    *error_code = 0;
+    *error_message = NULL;
+
+    if (cache && (entry = lookup(cache, hash, query, query_len))) {
+        if (entry != cache->lru_head) {
+            lru_unlink(cache, entry);
+            lru_push_front(cache, entry);
+        }
+        MYSQL_QP_G(stats).stmt_hits++;
+        return entry;
+    }
+    if (cache && cache->limit > 0) {
+        MYSQL_QP_G(stats).stmt_misses++;
+        if (!cache->sized) {
+            size_cache(cache, conn);
+        }
+    }
+
+    if (!(stmt = prepare(cache, conn, query, query_len, error_code, error_message))) {
+        return NULL;
+    }
+
+    entry = pecalloc(1, sizeof(mysql_stmt_entry) + query_len, 1);
+    entry->hash = hash;
+    entry->query_len = query_len;
+    entry->stmt = stmt;
+    entry->param_count = (unsigned int) mysql_stmt_param_count(stmt);
+    memcpy(entry->query, query, query_len);
+    read_columns(entry);
+
+    if (!cache || cache->limit == 0) {
+        return entry;
+    }
+    /* The server had room for one more, so a capacity lowered under pressure grows back */
+    if (cache->capacity < cache->limit && cache->count >= cache->capacity) {
+        cache->capacity++;
+    }
+
+    while (cache->count >= cache->capacity) {
+        evict_tail(cache);
+    }
+    if (cache->count >= cache->bucket_count) {
+        resize_buckets(cache, cache->bucket_count ? cache->bucket_count * 2 : STMT_CACHE_MIN_BUCKETS);
+    }
+    index = bucket_index(cache, hash);
+    entry->bucket_next = cache->buckets[index];
+    cache->buckets[index] = entry;
+    lru_push_front(cache, entry);
+    cache->count++;
+    entry->cached = 1;
+    return entry;
+}
+
+/* Done with a statement; cached ones stay prepared for the next caller */
+void mysql_stmt_cache_release(mysql_stmt_entry *entry) {
+    if (!entry->cached) {
+        entry_free(entry, 1);
+    }
+}
+
+/* Result columns as a list of ["name", "org_table", "type", "length", "flags", "charsetnr"] */
+void mysql_stmt_columns_to_zval(const mysql_stmt_entry *entry, zval *columns) {
+    zval column;
+
+    array_init_size(columns, entry->column_count);
+    for (unsigned int i = 0; i < entry->column_count; i++) {
+        const mysql_stmt_column *meta = &entry->columns[i];
+
+        array_init_size(&column, 6);
+        add_assoc_string(&column, "name", meta->name);
+        add_assoc_string(&column, "org_table", meta->org_table);
+        add_assoc_long(&column, "type", (zend_long) meta->type);
+        add_assoc_long(&column, "length", (zend_long) meta->length);
+        add_assoc_long(&column, "flags", (zend_long) meta->flags);
+        add_assoc_long(&column, "charsetnr", (zend_long) meta->charsetnr);
+        add_next_index_zval(columns, &column);
+    }
+}
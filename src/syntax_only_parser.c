@@ -1,73 +1,228 @@
 #include "php.h"
+#include "zend_smart_str.h"
 #include "../include/php_mysql_qp.h"
 #include "../include/mysql_query_parser.h"
+#include "../include/sql_lexer.h"
+#include "../include/query_parser.h"
+#include "../include/connection_pool.h"
+#include "../include/query_stats.h"
+#include "../include/parallel_validator.h"
 #include <mysql.h>
 #include <string.h>
 
-/* Global MySQL connection for syntax-only parsing */
-static MYSQL *syntax_mysql = NULL;
-static int syntax_initialized = 0;
-
-/* Initialize syntax-only parser connection */
+/* Lease the current thread a syntax-only connection (no default database) from the pool */
 int mysql_connect_syntax_parser(void) {
-    if (syntax_initialized) {
-        return SUCCESS;
-    }
-    
-    syntax_mysql = mysql_init(NULL);
-    if (syntax_mysql == NULL) {
-        return FAILURE;
-    }
-    
-    /* Connect without selecting a database for pure syntax checking */
-    if (!mysql_real_connect(syntax_mysql, "localhost", "root", "", NULL, 0, NULL, 0)) {
-        mysql_close(syntax_mysql);
-        syntax_mysql = NULL;
-        return FAILURE;
-    }
-    
-    syntax_initialized = 1;
-    return SUCCESS;
+    return mysql_qp_pool_acquire(&mysql_qp_syntax_pool, &MYSQL_QP_G(syntax_lease));
 }
 
-/* Cleanup syntax parser connection */
+/* Close the current thread's syntax connection */
 void mysql_disconnect_syntax_parser(void) {
-    if (syntax_mysql) {
-        mysql_close(syntax_mysql);
-        syntax_mysql = NULL;
+    mysql_qp_pool_discard(&MYSQL_QP_G(syntax_lease));
+}
+
+/*
+ * Verdict without the server: what the lexer proves invalid, and with
+ * MYSQL_QP_LOCAL_VERDICT what the native parser accepts without leaving
+ * anything unchecked. MYSQL_LEX_UNDECIDED means only the server can tell.
+ */
+int mysql_check_syntax_locally(const char *query, size_t query_len, int flags, int *error_code, char **error_message) {
+    sql_arena arena;
+    sql_parse_result parsed;
+    int checked;
+    
+    /* Local pre-pass: statements the lexer can reject never reach the server */
+    if (mysql_lex_validate(query, query_len, error_code, error_message) == MYSQL_LEX_INVALID) {
+        return MYSQL_LEX_INVALID;
+    }
+    if (!(flags & MYSQL_QP_LOCAL_VERDICT)) {
+        return MYSQL_LEX_UNDECIDED;
     }
-    syntax_initialized = 0;
+    
+    sql_arena_init(&arena, SQL_ARENA_DEFAULT_CHUNK);
+    checked = mysql_native_parse(query, query_len, &arena, &parsed) == SUCCESS && !parsed.unchecked;
+    sql_arena_free(&arena);
+    return checked ? MYSQL_LEX_VALID : MYSQL_LEX_UNDECIDED;
 }
 
-/* Validate query syntax only (ignoring table/data constraints) */
-int mysql_validate_syntax_only(const char *query, size_t query_len) {
+/* Syntax verdict as MYSQL_LEX_VALID/INVALID, or MYSQL_LEX_UNDECIDED if the server couldn't be asked */
+int mysql_check_syntax(const char *query, size_t query_len, int flags, int *error_code, char **error_message) {
+    MYSQL *syntax_mysql;
     MYSQL_STMT *stmt;
-    int result = 0;
-    unsigned int error_code;
+    int result;
+    unsigned int server_error;
+    
+    if (error_code) *error_code = 0;
+    if (error_message) *error_message = NULL;
     
-    if (!syntax_initialized && mysql_connect_syntax_parser() != SUCCESS) {
-        return 0;
+    if ((result = mysql_check_syntax_locally(query, query_len, flags, error_code, error_message)) != MYSQL_LEX_UNDECIDED) {
+        return result;
     }
     
+    if (mysql_connect_syntax_parser() != SUCCESS) {
+        return MYSQL_LEX_UNDECIDED;
+    }
+    syntax_mysql = MYSQL_QP_G(syntax_lease).conn;
+    
     stmt = mysql_stmt_init(syntax_mysql);
     if (!stmt) {
-        return 0;
+        return MYSQL_LEX_UNDECIDED;
     }
     
     /* Try to prepare the statement */
-    if (mysql_stmt_prepare(stmt, query, query_len) == 0) {
-        result = 1;  /* Valid syntax */
+    if (mysql_qp_stmt_prepare(stmt, query, query_len) == 0) {
+        result = MYSQL_LEX_VALID;
     } else {
-        error_code = mysql_stmt_errno(stmt);
+        server_error = mysql_stmt_errno(stmt);
+        if (error_code) *error_code = server_error;
+        if (error_message) *error_message = estrdup(mysql_stmt_error(stmt));
         /* Only treat as invalid if it's a syntax error (1064) */
         /* Other errors like missing tables (1146) should be considered valid syntax */
-        if (error_code == 1064) {
-            result = 0;  /* Invalid syntax */
+        if (server_error == 1064) {
+            result = MYSQL_LEX_INVALID;
         } else {
-            result = 1;  /* Valid syntax, but other issues (tables, etc.) */
+            result = MYSQL_LEX_VALID;  /* Valid syntax, but other issues (tables, etc.) */
         }
     }
     
     mysql_stmt_close(stmt);
     return result;
-}
\ No newline at end of file
+}
+
+/* Validate query syntax only (ignoring table/data constraints) */
+int mysql_validate_syntax_only(const char *query, size_t query_len) {
+    return mysql_check_syntax(query, query_len, 0, NULL, NULL) == MYSQL_LEX_VALID;
+}
+
+/* Batch validation */
+
+#define BATCH_STATEMENT_NAME "mysql_qp_batch"
+#define BATCH_MAX_PACKET (1024 * 1024)
+
+/* Record a server error; only a syntax error (1064) makes the statement invalid */
+void mysql_batch_record_error(mysql_batch_item *item, unsigned int error_code, const char *error_message) {
+    item->decided = 1;
+    item->error_code = error_code;
+    item->is_valid = error_code != 1064;
+    item->error_message = estrdup(error_message);
+}
+
+/* Client-side errors (2000-2999) mean the connection, not the statement, failed */
+int mysql_is_connection_error(unsigned int error_code) {
+    return error_code >= 2000 && error_code < 3000;
+}
+
+/*
+ * Prepare every pending statement over the syntax connection, packing as many
+ * "PREPARE ... FROM '...'" statements into one multi-statement packet as fit.
+ * The server stops a multi-statement at the first failure, so after an error
+ * the next packet resumes with the statement that follows it.
+ */
+static void validate_batch_on_server(mysql_batch_item **pending, size_t count) {
+    MYSQL *syntax_mysql = MYSQL_QP_G(syntax_lease).conn;
+    smart_str sql = {0};
+    char *escaped = NULL;
+    size_t escaped_size = 0, start = 0;
+    
+    while (start < count) {
+        size_t end = start, current = start;
+        int status;
+        
+        smart_str_free(&sql);
+        while (end < count && (end == start || ZSTR_LEN(sql.s) < BATCH_MAX_PACKET)) {
+            zend_string *query = pending[end]->query;
+            size_t needed = ZSTR_LEN(query) * 2 + 1;
+            if (needed > escaped_size) {
+                escaped = erealloc(escaped, needed);
+                escaped_size = needed;
+            }
+            smart_str_appends(&sql, "PREPARE " BATCH_STATEMENT_NAME " FROM '");
+            smart_str_appendl(&sql, escaped, mysql_real_escape_string(syntax_mysql, escaped, ZSTR_VAL(query), ZSTR_LEN(query)));
+            smart_str_appends(&sql, "';");
+            end++;
+        }
+        if (end == count) {
+            smart_str_appends(&sql, "DEALLOCATE PREPARE " BATCH_STATEMENT_NAME);
+        }
+        
+        status = mysql_real_query(syntax_mysql, ZSTR_VAL(sql.s), ZSTR_LEN(sql.s));
+        mysql_qp_stats_round_trips(1);
+        while (current < end) {
+            MYSQL_RES *res;
+            
+            if (status != 0) {
+                unsigned int error_code = mysql_errno(syntax_mysql);
+                if (status < 0 || mysql_is_connection_error(error_code)) {
+                    /* Leave the rest undecided and reconnect on the next call */
+                    smart_str_free(&sql);
+                    if (escaped) efree(escaped);
+                    mysql_disconnect_syntax_parser();
+                    return;
+                }
+                mysql_batch_record_error(pending[current++], error_code, mysql_error(syntax_mysql));
+                break;
+            }
+            
+            pending[current]->decided = 1;
+            pending[current]->is_valid = 1;
+            current++;
+            
+            if ((res = mysql_store_result(syntax_mysql))) {
+                mysql_free_result(res);
+            }
+            status = mysql_next_result(syntax_mysql);
+        }
+        
+        /* Drain the trailing DEALLOCATE result (its failure is harmless) */
+        while (mysql_more_results(syntax_mysql) && mysql_next_result(syntax_mysql) == 0) {
+            MYSQL_RES *res = mysql_store_result(syntax_mysql);
+            if (res) mysql_free_result(res);
+        }
+        
+        start = current;
+    }
+    
+    smart_str_free(&sql);
+    if (escaped) efree(escaped);
+}
+
+/*
+ * Validate many statements: local checks first (see
+ * mysql_check_syntax_locally()), then one server round trip per packet for
+ * the rest, spread over up to threads connections when more than one is
+ * allowed.
+ */
+void mysql_validate_batch(mysql_batch_item *items, size_t count, int threads, int flags) {
+    mysql_batch_item **pending;
+    size_t pending_count = 0;
+    
+    pending = safe_emalloc(count, sizeof(mysql_batch_item *), 0);
+    
+    for (size_t i = 0; i < count; i++) {
+        mysql_batch_item *item = &items[i];
+        const char *query = ZSTR_VAL(item->query);
+        size_t query_len = ZSTR_LEN(item->query);
+        
+        if (item->decided) continue;
+        
+        switch (mysql_check_syntax_locally(query, query_len, flags, &item->error_code, &item->error_message)) {
+            case MYSQL_LEX_VALID:
+                item->decided = item->is_valid = item->local = 1;
+                continue;
+            case MYSQL_LEX_INVALID:
+                item->decided = 1;
+                item->is_valid = 0;
+                continue;
+        }
+        pending[pending_count++] = item;
+    }
+    
+    if (pending_count > 1 && threads > 1 && mysql_validate_parallel(pending, pending_count, threads) == SUCCESS) {
+        efree(pending);
+        return;
+    }
+    if (pending_count > 0 && mysql_connect_syntax_parser() == SUCCESS) {
+        validate_batch_on_server(pending, pending_count);
+    }
+    
+    efree(pending);
+}
@@ -23,6 +23,12 @@ echo "Has LIMIT: " . (count($components2['limit_clause']) > 0 ? "YES" : "NO") .
 
 $rebuilt2 = mysql_reconstruct_query($components2);
 echo "Complex rebuilt valid: " . (mysql_validate_query($rebuilt2) ? "YES" : "NO") . "\n";
+
+// SELECTs that don't start with SELECT keep their type, and no clauses
+foreach (["WITH c AS (SELECT 1 AS a) SELECT a FROM c LIMIT 1", "(SELECT a FROM t) UNION (SELECT a FROM u)", "TABLE t", "VALUES ROW(1, 2)"] as $sql) {
+    $components = mysql_decompose_query($sql);
+    echo $components['type'], " ", count($components['fields']) + count($components['tables']) + count($components['limit_clause']), "\n";
+}
 ?>
 --EXPECT--
 Query type: SELECT
@@ -33,4 +39,8 @@ Has WHERE: YES
 Rebuilt valid: YES
 Has ORDER BY: YES
 Has LIMIT: YES
-Complex rebuilt valid: YES
\ No newline at end of file
+Complex rebuilt valid: YES
+SELECT 0
+SELECT 0
+SELECT 0
+SELECT 0
\ No newline at end of file
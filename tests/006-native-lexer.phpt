@@ -0,0 +1,46 @@
+--TEST--
+Native lexer pre-validation and query typing
+--SKIPIF--
+<?php if (!extension_loaded("mysql_qp")) print "skip"; ?>
+--FILE--
+<?php
+// Rejected locally, without a server round trip
+$lexer_invalid = [
+    "SELECT 'unterminated FROM users",
+    "SELECT * FROM users WHERE (id = 1",
+    "SELECT * FROM users /* open comment",
+    "SELECT 1; SELECT 2",
+    "FROBNICATE users"
+];
+
+foreach ($lexer_invalid as $query) {
+    $result = mysql_parse_query($query);
+    echo "'" . $query . "' is " . (mysql_validate_query($query) ? "valid" : "invalid") . " (" . $result['error_code'] . ")\n";
+}
+
+$result = mysql_parse_query("  -- nothing here\n");
+echo "Empty query error code: " . $result['error_code'] . "\n";
+
+// Comments and quoting don't confuse type detection
+$typed = [
+    "/* leading comment */ SELECT 1",
+    "# hash comment\nUPDATE users SET name = 'DELETE'",
+    "desc users",
+    "`select` FROM users"
+];
+
+foreach ($typed as $query) {
+    echo "Type: " . mysql_parse_query($query)['query_type'] . "\n";
+}
+?>
+--EXPECT--
+'SELECT 'unterminated FROM users' is invalid (1064)
+'SELECT * FROM users WHERE (id = 1' is invalid (1064)
+'SELECT * FROM users /* open comment' is invalid (1064)
+'SELECT 1; SELECT 2' is invalid (1064)
+'FROBNICATE users' is invalid (1064)
+Empty query error code: 1065
+Type: 1
+Type: 3
+Type: 9
+Type: 0
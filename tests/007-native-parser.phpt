@@ -0,0 +1,54 @@
+--TEST--
+Native parser parse_tree and mysql_build_query() round trip
+--SKIPIF--
+<?php if (!extension_loaded("mysql_qp")) print "skip"; ?>
+--FILE--
+<?php
+$result = mysql_parse_query("SELECT u.id, COUNT(*) AS n FROM users u LEFT JOIN orders o ON o.user_id = u.id WHERE u.id = ? GROUP BY u.id", MYSQL_QP_LOCAL_VERDICT);
+$tree = $result['parse_tree'];
+echo "Root: " . $tree['type'] . "\n";
+echo "Parameter count: " . $result['parameter_count'] . "\n";
+echo "Join: " . $tree['from'][0]['join_type'] . "\n";
+echo "Alias: " . $tree['fields'][1]['alias'] . "\n";
+echo "Where: " . $tree['where']['operator'] . " " . $tree['where']['right']['type'] . "\n";
+
+// Round trips
+$queries = [
+    "select a, b from t where (a = 1 or b = 2) and c = 3",
+    "WITH RECURSIVE cte (n) AS (SELECT 1 UNION ALL SELECT n + 1 FROM cte WHERE n < 5) SELECT * FROM cte",
+    "SELECT id, ROW_NUMBER() OVER (PARTITION BY dept ORDER BY salary DESC) AS rn FROM emp",
+    "SELECT * FROM users WHERE id IN (SELECT user_id FROM orders WHERE status = 'active')",
+    "INSERT INTO t (a, b) VALUES (1, 2), (3, 4) ON DUPLICATE KEY UPDATE b = b + 1",
+    "REPLACE INTO t SET a = 1",
+    "UPDATE users SET name = ? WHERE id = ? LIMIT 1",
+    "DELETE FROM `order` WHERE id = 5",
+];
+foreach ($queries as $query) {
+    echo mysql_build_query(mysql_parse_query($query, MYSQL_QP_LOCAL_VERDICT)['parse_tree']) . "\n";
+}
+
+// Modified tree
+$tree = mysql_parse_query("SELECT id FROM users", MYSQL_QP_LOCAL_VERDICT)['parse_tree'];
+$tree['limit'] = ['type' => 'literal', 'kind' => 'integer', 'value' => '10'];
+echo mysql_build_query($tree) . "\n";
+
+var_dump(mysql_build_query(['type' => 'select']));
+?>
+--EXPECTF--
+Root: select
+Parameter count: 1
+Join: LEFT JOIN
+Alias: n
+Where: = placeholder
+SELECT a, b FROM t WHERE (a = 1 OR b = 2) AND c = 3
+WITH RECURSIVE cte (n) AS (SELECT 1 UNION ALL SELECT n + 1 FROM cte WHERE n < 5) SELECT * FROM cte
+SELECT id, ROW_NUMBER() OVER (PARTITION BY dept ORDER BY salary DESC) AS rn FROM emp
+SELECT * FROM users WHERE id IN (SELECT user_id FROM orders WHERE status = 'active')
+INSERT INTO t (a, b) VALUES (1, 2), (3, 4) ON DUPLICATE KEY UPDATE b = b + 1
+REPLACE INTO t SET a = 1
+UPDATE users SET name = ? WHERE id = ? LIMIT 1
+DELETE FROM `order` WHERE id = 5
+SELECT id FROM users LIMIT 10
+
+Warning: mysql_build_query(): Malformed parse tree in %s on line %d
+bool(false)
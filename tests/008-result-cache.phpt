@@ -0,0 +1,73 @@
+--TEST--
+Per-worker LRU cache for validation and parse results
+--SKIPIF--
+<?php if (!extension_loaded("mysql_qp")) print "skip"; ?>
+--INI--
+mysql_qp.cache_size=2
+--FILE--
+<?php
+function cache_counters() {
+    ob_start();
+    phpinfo(INFO_MODULES);
+    $info = ob_get_clean();
+    $counters = [];
+    foreach (['Entries', 'Hits', 'Misses', 'Evictions'] as $name) {
+        preg_match('/^' . $name . ' => (\d+)$/m', $info, $m);
+        $counters[] = $name . "=" . $m[1];
+    }
+    return implode(" ", $counters) . "\n";
+}
+
+echo "Cache size: " . ini_get("mysql_qp.cache_size") . "\n";
+
+var_dump(mysql_validate_query("SELECT 1"));
+var_dump(mysql_validate_query("SELECT 1"));
+var_dump(mysql_validate_query("SELECT 'unterminated"));
+var_dump(mysql_validate_query("SELECT 'unterminated"));
+echo cache_counters();
+
+// Parse results are cached separately from validation results
+$first = mysql_parse_query("SELECT 1 AS id FROM DUAL WHERE 1 = ?");
+$second = mysql_parse_query("SELECT 1 AS id FROM DUAL WHERE 1 = ?");
+var_dump($first == $second);
+echo cache_counters();
+
+// "SELECT 1" was least recently used and has been evicted
+var_dump(mysql_validate_query("SELECT 1"));
+echo cache_counters();
+
+// A hit returns the tree kept on the miss; the first lookup for the other shape builds that one
+$spans = mysql_parse_query("SELECT 1 AS id FROM DUAL WHERE 1 = ?", MYSQL_QP_SPANS);
+$again = mysql_parse_query("SELECT 1 AS id FROM DUAL WHERE 1 = ?", MYSQL_QP_SPANS);
+var_dump($spans === $again, $spans['parse_tree'] != $first['parse_tree']);
+echo cache_counters();
+
+// Trees handed out stay valid after their entry is evicted
+mysql_validate_query("SELECT 3");
+mysql_validate_query("SELECT 4");
+var_dump($second === $first);
+echo cache_counters();
+
+// A size of 0 disables the cache
+ini_set("mysql_qp.cache_size", "0");
+var_dump(mysql_validate_query("SELECT 2"));
+echo cache_counters();
+?>
+--EXPECT--
+Cache size: 2
+bool(true)
+bool(true)
+bool(false)
+bool(false)
+Entries=2 Hits=2 Misses=2 Evictions=0
+bool(true)
+Entries=2 Hits=3 Misses=3 Evictions=1
+bool(true)
+Entries=2 Hits=3 Misses=4 Evictions=2
+bool(true)
+bool(true)
+Entries=2 Hits=4 Misses=5 Evictions=2
+bool(true)
+Entries=2 Hits=4 Misses=7 Evictions=4
+bool(true)
+Entries=2 Hits=4 Misses=7 Evictions=4
@@ -0,0 +1,51 @@
+--TEST--
+Batch validation with mysql_validate_queries()
+--SKIPIF--
+<?php if (!extension_loaded("mysql_qp")) print "skip"; ?>
+--FILE--
+<?php
+$queries = [
+    'select' => "SELECT * FROM users WHERE id = ?",
+    'typo'   => "SELECTT * FROM users",
+    'show'   => "SHOW TABLES",
+    'broken' => "SHOW TABLEZ",
+    'after'  => "SHOW DATABASES",
+    7        => "SELECT 'unterminated",
+];
+
+foreach (mysql_validate_queries($queries) as $key => $result) {
+    echo $key . ": " . ($result['is_valid'] ? "valid" : "invalid") . " (" . $result['error_code'] . ")\n";
+}
+
+// Results agree with single-statement validation
+foreach ($queries as $query) {
+    echo mysql_validate_query($query) ? "valid\n" : "invalid\n";
+}
+
+var_dump(mysql_validate_queries([]));
+var_dump(mysql_validate_queries(["SELECT 1", 42]));
+
+// Elements held by reference are followed
+$refs = ["SELECT 1", "SHOW TABLEZ"];
+$refs[] = &$refs[0];
+echo implode(" ", array_map(fn($r) => $r['is_valid'] ? "valid" : "invalid", mysql_validate_queries($refs))), "\n";
+?>
+--EXPECTF--
+select: valid (0)
+typo: invalid (1064)
+show: valid (0)
+broken: invalid (1064)
+after: valid (0)
+7: invalid (1064)
+valid
+invalid
+valid
+invalid
+valid
+invalid
+array(0) {
+}
+
+Warning: mysql_validate_queries(): All queries must be strings in %s on line %d
+bool(false)
+valid invalid valid
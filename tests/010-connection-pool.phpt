@@ -0,0 +1,37 @@
+--TEST--
+Connection pool sizing and per-request leases
+--SKIPIF--
+<?php if (!extension_loaded("mysql_qp")) print "skip"; ?>
+--INI--
+mysql_qp.pool_size=3
+--FILE--
+<?php
+function pool_counters() {
+    ob_start();
+    phpinfo(INFO_MODULES);
+    $info = ob_get_clean();
+    $counters = [];
+    foreach (['Slots per pool', 'Parser connections in use', 'Syntax connections in use'] as $name) {
+        preg_match('/^' . $name . ' => (\d+)$/m', $info, $m);
+        $counters[] = $name . "=" . $m[1];
+    }
+    return implode(" ", $counters) . "\n";
+}
+
+echo "Pool size: " . ini_get("mysql_qp.pool_size") . "\n";
+
+// The pool size is fixed at startup
+var_dump(ini_set("mysql_qp.pool_size", "16"));
+echo "Pool size: " . ini_get("mysql_qp.pool_size") . "\n";
+
+// Lexer-level rejections never touch the pool
+ini_set("mysql_qp.cache_size", "0");
+var_dump(mysql_validate_query("SELECT 'unterminated"));
+echo pool_counters();
+?>
+--EXPECT--
+Pool size: 3
+bool(false)
+Pool size: 3
+bool(false)
+Slots per pool=3 Parser connections in use=0 Syntax connections in use=0
@@ -0,0 +1,39 @@
+--TEST--
+Non-blocking validation with mysql_validate_query_async() and mysql_qp_poll()
+--SKIPIF--
+<?php if (!extension_loaded("mysql_qp")) print "skip"; ?>
+--FILE--
+<?php
+// Nothing pending
+var_dump(mysql_qp_poll());
+
+// Statements decided locally finish without a round trip
+$valid = mysql_validate_query_async("SELECT id FROM users WHERE id = ?", MYSQL_QP_LOCAL_VERDICT);
+$invalid = mysql_validate_query_async("SELECT 'unterminated");
+var_dump($valid !== $invalid);
+var_dump(mysql_qp_async_socket($valid, $writable), $writable);
+
+$results = mysql_qp_poll();
+ksort($results);
+var_dump(array_keys($results) == [$valid, $invalid]);
+var_dump($results[$valid]['is_valid']);
+var_dump($results[$invalid]['is_valid']);
+
+// Results are collected once
+var_dump(mysql_qp_poll(0.01));
+
+// Unknown handles have no socket
+var_dump(mysql_qp_async_socket(12345));
+?>
+--EXPECT--
+array(0) {
+}
+bool(true)
+NULL
+NULL
+bool(true)
+bool(true)
+bool(false)
+array(0) {
+}
+NULL
@@ -0,0 +1,31 @@
+--TEST--
+Server connection settings
+--SKIPIF--
+<?php if (!extension_loaded("mysql_qp")) print "skip"; ?>
+--INI--
+mysql_qp.dsn=mysql:host=127.0.0.1;port=3306;dbname=mysql_qp_test
+mysql_qp.user=qp
+mysql_qp.password=secret
+--FILE--
+<?php
+echo ini_get("mysql_qp.dsn"), "\n";
+echo ini_get("mysql_qp.user"), "\n";
+var_dump(ini_get("mysql_qp.warmup"));
+
+// Connection settings are fixed at startup
+var_dump(ini_set("mysql_qp.dsn", "mysql:host=elsewhere"));
+
+// The password never appears in phpinfo()
+ob_start();
+phpinfo(INFO_MODULES);
+$info = ob_get_clean();
+var_dump(str_contains($info, "secret"));
+var_dump((bool) preg_match('/^mysql_qp\.password => \*{8} => \*{8}$/m', $info));
+?>
+--EXPECT--
+mysql:host=127.0.0.1;port=3306;dbname=mysql_qp_test
+qp
+string(1) "0"
+bool(false)
+bool(false)
+bool(true)
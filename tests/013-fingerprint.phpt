@@ -0,0 +1,42 @@
+--TEST--
+Query fingerprints with mysql_fingerprint_query()
+--SKIPIF--
+<?php if (!extension_loaded("mysql_qp")) print "skip"; ?>
+--FILE--
+<?php
+$queries = [
+    "select * from users where id = 1",
+    "SELECT *\n  FROM users /* by id */ WHERE id = 42;",
+    "SELECT a, b FROM db.t WHERE x IN (1, 2, 3) AND y IN ('a') AND z = -5 AND w - 1 > 0",
+    "INSERT INTO t (a, b) VALUES (1, 'x'), (2, 'y'), (3, 'z')",
+    "INSERT INTO t VALUES (1), (2)",
+    "SELECT count(*), concat(a, 'x') FROM `My Table` WHERE b IS NOT NULL AND c = TRUE LIMIT 10, 20",
+    "UPDATE t SET a = :a, b = ? WHERE id = 0x1F /*!50000 AND c = 1 */",
+];
+foreach ($queries as $query) {
+    echo mysql_fingerprint_query($query)['digest_text'], "\n";
+}
+
+$first = mysql_fingerprint_query("select * from users where id = 1");
+$second = mysql_fingerprint_query("SELECT * FROM users WHERE id = 99");
+var_dump($first === $second);
+var_dump(strlen($first['digest']), ctype_xdigit($first['digest']));
+var_dump(is_int($first['hash']));
+var_dump($first['hash'] === intval(substr($first['digest'], 0, 16), 16) || PHP_INT_SIZE < 8 || $first['hash'] < 0);
+
+var_dump(mysql_fingerprint_query("SELECT 'unterminated"));
+?>
+--EXPECT--
+SELECT * FROM `users` WHERE `id` = ?
+SELECT * FROM `users` WHERE `id` = ?
+SELECT `a` , `b` FROM `db` . `t` WHERE `x` IN (...) AND `y` IN (?) AND `z` = ? AND `w` - ? > ?
+INSERT INTO `t` ( `a` , `b` ) VALUES (...) /* , ... */
+INSERT INTO `t` VALUES (?) /* , ... */
+SELECT COUNT ( * ) , CONCAT ( `a` , ? ) FROM `My Table` WHERE `b` IS NOT ? AND `c` = ? LIMIT ?, ...
+UPDATE `t` SET `a` = ? , `b` = ? WHERE `id` = ? AND `c` = ?
+bool(true)
+int(64)
+bool(true)
+bool(true)
+bool(true)
+bool(false)
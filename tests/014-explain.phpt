@@ -0,0 +1,76 @@
+--TEST--
+Execution plans with mysql_explain_query()
+--SKIPIF--
+<?php
+if (!extension_loaded("mysql_qp")) print "skip";
+elseif (@mysql_explain_query("SELECT 1") === false) print "skip MySQL server not available";
+?>
+--FILE--
+<?php
+$query = "SELECT a FROM (SELECT 1 AS a UNION ALL SELECT 2) AS d WHERE a > 0 ORDER BY a";
+
+$plan = mysql_explain_query($query);
+var_dump(array_keys($plan));
+var_dump(is_float($plan['query_cost']));
+var_dump($plan['full_scan'], $plan['using_filesort']);
+
+$derived = $plan['tables'][0];
+var_dump(array_keys($derived));
+var_dump($derived['table'], $derived['access_type'], $derived['key']);
+var_dump(is_int($derived['rows_examined_per_scan']), is_float($derived['filtered']));
+
+// The full document
+$tree = mysql_explain_query($query, true);
+var_dump(isset($tree['query_block']['select_id']));
+
+// Only the literals differ: served from the cache
+var_dump(mysql_explain_query(str_replace("a > 0", "a > 1", $query)) == $plan);
+
+// No tables, no cost
+var_dump(mysql_explain_query("SELECT 1")['query_cost']);
+
+var_dump(mysql_explain_query("SELECT FROM WHERE"));
+?>
+--EXPECTF--
+array(5) {
+  [0]=>
+  string(10) "query_cost"
+  [1]=>
+  string(9) "full_scan"
+  [2]=>
+  string(14) "using_filesort"
+  [3]=>
+  string(15) "using_temporary"
+  [4]=>
+  string(6) "tables"
+}
+bool(true)
+bool(true)
+bool(true)
+array(7) {
+  [0]=>
+  string(5) "table"
+  [1]=>
+  string(11) "access_type"
+  [2]=>
+  string(3) "key"
+  [3]=>
+  string(22) "rows_examined_per_scan"
+  [4]=>
+  string(22) "rows_produced_per_join"
+  [5]=>
+  string(8) "filtered"
+  [6]=>
+  string(11) "prefix_cost"
+}
+string(1) "d"
+string(3) "ALL"
+NULL
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+NULL
+
+Warning: mysql_explain_query(): EXPLAIN failed (1064): %s in %s on line %d
+bool(false)
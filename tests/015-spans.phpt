@@ -0,0 +1,50 @@
+--TEST--
+MYSQL_QP_SPANS returns [offset, length] ranges instead of copies
+--SKIPIF--
+<?php if (!extension_loaded("mysql_qp")) print "skip"; ?>
+--FILE--
+<?php
+function text(string $query, array $span): string {
+    return substr($query, $span[0], $span[1]);
+}
+
+$query = "SELECT u.id, u.name FROM users AS u WHERE u.age > 18 ORDER BY u.name LIMIT 5";
+
+$copies = mysql_decompose_query($query);
+$spans = mysql_decompose_query($query, MYSQL_QP_SPANS);
+echo $spans['type'], "\n";
+var_dump($spans['fields'][0]);
+var_dump(array_map(fn($span) => text($query, $span), $spans['fields']) === $copies['fields']);
+echo text($query, $spans['tables'][0]['table']), " / ", text($query, $spans['tables'][0]['alias']), "\n";
+var_dump(text($query, $spans['where_conditions'][0]) === $copies['where_conditions'][0]);
+var_dump(text($query, $spans['limit_clause'][0]) === $copies['limit_clause'][0]);
+var_dump($spans['group_by']);
+
+// Parse trees: text from the query becomes a span, keywords stay strings
+$query = "SELECT id AS `my id` FROM users WHERE id = 'x'";
+$tree = mysql_parse_query($query, MYSQL_QP_SPANS | MYSQL_QP_LOCAL_VERDICT)['parse_tree'];
+$plain = mysql_parse_query($query, MYSQL_QP_LOCAL_VERDICT)['parse_tree'];
+echo $tree['type'], "\n";
+echo text($query, $tree['fields'][0]['alias']), " vs ", $plain['fields'][0]['alias'], "\n";
+
+// normalized_query is the input string itself
+$parsed = mysql_parse_query($query);
+var_dump($parsed['normalized_query'] === $query);
+?>
+--EXPECT--
+SELECT
+array(2) {
+  [0]=>
+  int(7)
+  [1]=>
+  int(4)
+}
+bool(true)
+users / u
+bool(true)
+bool(true)
+array(0) {
+}
+select
+`my id` vs my id
+bool(true)
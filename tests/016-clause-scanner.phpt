@@ -0,0 +1,60 @@
+--TEST--
+Decomposition ignores keywords and commas inside strings, comments and parentheses
+--SKIPIF--
+<?php if (!extension_loaded("mysql_qp")) print "skip"; ?>
+--FILE--
+<?php
+$c = mysql_decompose_query("SELECT COUNT(a, b) AS n, name /* FROM x */ FROM t WHERE name = 'ORDER BY' GROUP BY a, b HAVING n > 1 ORDER BY n DESC LIMIT 3");
+var_dump($c['fields']);
+var_dump(trim($c['where_conditions'][0]));
+var_dump($c['group_by']);
+var_dump(trim($c['having'][0]));
+var_dump(trim($c['order_by'][0]));
+
+$c = mysql_decompose_query("SELECT ROW_NUMBER() OVER (ORDER BY x) FROM (SELECT x FROM u WHERE y) AS sub, `db`.`t2` t2 UNION SELECT 1");
+var_dump($c['fields'], $c['tables'], $c['order_by']);
+
+$c = mysql_decompose_query("SELECT a FROM t;");
+var_dump($c['tables'][0]['table']);
+echo mysql_reconstruct_query(mysql_decompose_query("SELECT a FROM t GROUP BY a HAVING COUNT(*) > 1")), "\n";
+?>
+--EXPECT--
+array(2) {
+  [0]=>
+  string(16) "COUNT(a, b) AS n"
+  [1]=>
+  string(17) "name /* FROM x */"
+}
+string(17) "name = 'ORDER BY'"
+array(2) {
+  [0]=>
+  string(1) "a"
+  [1]=>
+  string(1) "b"
+}
+string(5) "n > 1"
+string(6) "n DESC"
+array(1) {
+  [0]=>
+  string(30) "ROW_NUMBER() OVER (ORDER BY x)"
+}
+array(2) {
+  [0]=>
+  array(2) {
+    ["table"]=>
+    string(25) "(SELECT x FROM u WHERE y)"
+    ["alias"]=>
+    string(3) "sub"
+  }
+  [1]=>
+  array(2) {
+    ["table"]=>
+    string(9) "`db`.`t2`"
+    ["alias"]=>
+    string(2) "t2"
+  }
+}
+array(0) {
+}
+string(1) "t"
+SELECT a FROM t GROUP BY a HAVING COUNT(*) > 1
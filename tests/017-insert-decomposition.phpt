@@ -0,0 +1,55 @@
+--TEST--
+INSERT and REPLACE decomposition with lazily parsed rows
+--SKIPIF--
+<?php if (!extension_loaded("mysql_qp")) print "skip"; ?>
+--FILE--
+<?php
+$c = mysql_decompose_query("INSERT INTO t (a, b) VALUES (1, 'x,y'), (2, 'it''s (not) a paren'), ROW(3, NOW()) ON DUPLICATE KEY UPDATE b = VALUES(b)");
+echo $c['type'], " ", $c['tables'][0]['table'], " ", implode(",", $c['fields']), "\n";
+var_dump($c['values'] instanceof Traversable);
+foreach ($c['values'] as $i => $row) {
+    echo $i, ": ", implode(" | ", $row), "\n";
+}
+var_dump($c['on_duplicate_key_update']);
+echo count(iterator_to_array($c['values']->getIterator())), "\n";
+echo mysql_reconstruct_query($c), "\n";
+
+// Rows are parsed on demand, one at a time
+$sql = "INSERT INTO big VALUES " . implode(",", array_fill(0, 50000, "(1, 'abc')"));
+$c = mysql_decompose_query($sql);
+$n = 0;
+foreach ($c['values'] as $row) {
+    $n++;
+}
+echo $n, "\n";
+
+$c = mysql_decompose_query("REPLACE INTO t SET a = 1, b = 'q=1'");
+echo $c['type'], " ", implode(",", $c['fields']), " ", implode(",", $c['values'][0]), "\n";
+echo mysql_reconstruct_query($c), "\n";
+
+$c = mysql_decompose_query("INSERT INTO t (a) SELECT x FROM u ON DUPLICATE KEY UPDATE a = 2");
+var_dump($c['values']);
+
+try {
+    new MysqlQp\InsertRows();
+} catch (Error $e) {
+    echo get_class($e), "\n";
+}
+?>
+--EXPECT--
+INSERT t a,b
+bool(true)
+0: 1 | 'x,y'
+1: 2 | 'it''s (not) a paren'
+2: 3 | NOW()
+array(1) {
+  [0]=>
+  string(13) "b = VALUES(b)"
+}
+3
+INSERT INTO t (a, b) VALUES (1, 'x,y'), (2, 'it''s (not) a paren'), ROW(3, NOW()) ON DUPLICATE KEY UPDATE b = VALUES(b)
+50000
+REPLACE a,b 1,'q=1'
+REPLACE INTO t (a, b) VALUES (1, 'q=1')
+string(15) "SELECT x FROM u"
+Error
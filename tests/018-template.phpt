@@ -0,0 +1,87 @@
+--TEST--
+mysql_compile_template() compiles placeholders once and renders escaped literals
+--SKIPIF--
+<?php if (!extension_loaded("mysql_qp")) print "skip"; ?>
+--FILE--
+<?php
+$template = mysql_compile_template("SELECT * FROM t WHERE a = ? AND b = ? AND c = ? AND d = ? AND e = ?");
+var_dump($template instanceof MysqlQp\Template);
+echo $template->render(["O'Brien\\\n", -42, 1.5, null, true]), "\n";
+echo $template->render(['', 0, -0.25, false, false]), "\n";
+
+// Placeholders inside strings and comments are left alone
+$template = mysql_compile_template("SELECT ':x', \"?\" FROM t WHERE id = :id /* ? */ LIMIT :n");
+echo $template->render(['id' => '7', 'n' => 5]), "\n";
+echo $template->render([':id' => '8', 'n' => 6, ':n' => 0]), "\n";
+echo $template->getSql(), "\n";
+
+// Compiling from decomposed components
+$components = mysql_decompose_query("SELECT id, name FROM users WHERE id = :id");
+$components['limit_clause'] = [' ?'];
+echo mysql_compile_template($components)->render(['id' => 3, 0 => 10]), "\n";
+
+// Cached templates are shared between objects
+$a = mysql_compile_template("SELECT ?");
+$b = mysql_compile_template("SELECT ?");
+unset($a);
+echo $b->render([1]), "\n";
+
+// Strings are escaped for the connection charset, utf8mb4 without one in mysql_qp.dsn.
+// In GBK 0xBF 0x5C is one character, so escaping byte by byte would let the quote through
+$template = mysql_compile_template("SELECT ?");
+echo $template->render(["\xbf'"], "gbk"), "\n";
+echo bin2hex($template->render(["\xbf\x5c'"], "gbk")), "\n";
+echo bin2hex($template->render(["\xbf\x5c'"], "latin1")), "\n";
+echo $template->render(["caf\u{e9}'"]), "\n";
+echo $template->render(["\xff"]), "\n";
+try {
+    $template->render([1], "ucs2");
+} catch (ValueError $e) {
+    echo $e->getMessage(), "\n";
+}
+
+foreach ([[], [INF], [[1]], ['x' => 1]] as $values) {
+    try {
+        mysql_compile_template("SELECT ?")->render($values);
+    } catch (Throwable $e) {
+        echo get_class($e), ": ", $e->getMessage(), "\n";
+    }
+}
+try {
+    mysql_compile_template("SELECT :name")->render([1]);
+} catch (ValueError $e) {
+    echo $e->getMessage(), "\n";
+}
+
+var_dump(mysql_compile_template("SELECT 'unterminated"));
+
+try {
+    new MysqlQp\Template();
+} catch (Error $e) {
+    echo get_class($e), "\n";
+}
+?>
+--EXPECTF--
+bool(true)
+SELECT * FROM t WHERE a = 'O\'Brien\\\n' AND b = -42 AND c = 1.5 AND d = NULL AND e = TRUE
+SELECT * FROM t WHERE a = '' AND b = 0 AND c = -0.25 AND d = FALSE AND e = FALSE
+SELECT ':x', "?" FROM t WHERE id = '7' /* ? */ LIMIT 5
+SELECT ':x', "?" FROM t WHERE id = '8' /* ? */ LIMIT 6
+SELECT ':x', "?" FROM t WHERE id = :id /* ? */ LIMIT :n
+SELECT id, name FROM users WHERE id = 3 LIMIT 10
+SELECT 1
+SELECT X'BF27'
+53454c4543542027bf5c5c2727
+53454c4543542027bf5c5c5c2727
+SELECT 'café\''
+SELECT X'FF'
+MysqlQp\Template::render(): Argument #2 ($charset) must be a character set MySQL accepts for a connection, "ucs2" given
+ValueError: No value bound to placeholder 0
+ValueError: Value for placeholder 0 must be a finite number
+TypeError: Value for placeholder 0 must be of type string|int|float|bool|null, array given
+ValueError: No value bound to placeholder 0
+No value bound to placeholder :name
+
+Warning: mysql_compile_template(): Cannot compile template: %s in %s on line %d
+bool(false)
+Error
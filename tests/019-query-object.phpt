@@ -0,0 +1,141 @@
+--TEST--
+MysqlQp\Query builds clauses on first read and rebuilds after changes
+--SKIPIF--
+<?php if (!extension_loaded("mysql_qp")) print "skip"; ?>
+--FILE--
+<?php
+$sql = "SELECT u.id, u.name FROM users AS u WHERE u.active = 1 OR u.admin = 1 ORDER BY u.name";
+$query = new MysqlQp\Query($sql);
+echo $query->type, "\n";
+var_dump($query->fields);
+echo $query->tables[0]['table'], " / ", $query->tables[0]['alias'], "\n";
+var_dump(isset($query->group_by), empty($query->group_by), empty($query->fields));
+var_dump($query->toArray() === mysql_decompose_query($sql));
+
+// Unchanged queries come back as they were given
+var_dump((string) $query === $sql);
+
+$limited = clone $query;
+$limited->setLimit(10, 20)->addWhere("u.deleted = 0");
+echo $limited, "\n";
+echo $query, "\n";
+
+$query->order_by = [' u.id DESC'];
+echo $query, "\n";
+
+$query = new MysqlQp\Query("SELECT * FROM t");
+echo $query->addWhere("a = 1")->setLimit(5), "\n";
+
+// A trailing locking clause is carried through
+$locked = new MysqlQp\Query("SELECT id FROM jobs WHERE done = 0 FOR UPDATE SKIP LOCKED;");
+echo $locked->setLimit(1), "\n";
+echo (new MysqlQp\Query("SELECT id FROM t LOCK IN SHARE MODE"))->addWhere("id > 5"), "\n";
+
+// Anything else the clauses don't keep can't be rebuilt
+$unmodelled = [
+    "SELECT a FROM t UNION SELECT a FROM u",
+    "SELECT a INTO @x FROM t",
+    "SELECT a FROM t INTO @x",
+    "SELECT ROW_NUMBER() OVER w FROM t WINDOW w AS (ORDER BY a)",
+    "WITH c AS (SELECT 1 AS a) SELECT a FROM c",
+    "(SELECT a FROM t) UNION (SELECT a FROM u)",
+    "TABLE t",
+    "VALUES ROW(1, 2)",
+];
+foreach ($unmodelled as $sql) {
+    $query = new MysqlQp\Query($sql);
+    try {
+        $query->setLimit(5);
+    } catch (Error $e) {
+        echo $e->getMessage(), "\n";
+    }
+    try {
+        $query->where_conditions = [' a = 1'];
+    } catch (Error $e) {
+        echo $e->getMessage(), "\n";
+    }
+    var_dump((string) $query === $sql);
+}
+try {
+    (new MysqlQp\Query("SELECT a FROM t UNION SELECT a FROM u"))->addWhere("a = 1");
+} catch (Error $e) {
+    echo $e->getMessage(), "\n";
+}
+
+$query = new MysqlQp\Query("SELECT * FROM t");
+$insert = new MysqlQp\Query("INSERT INTO t (a, b) VALUES (1, 2), (3, 4)");
+echo $insert->type, " ", implode(",", $insert->fields), "\n";
+foreach ($insert->values as $row) {
+    echo implode(",", $row), "\n";
+}
+
+$errors = [
+    fn() => $insert->setLimit(1),
+    fn() => $query->setLimit(-1),
+    fn() => $query->type = 'DELETE',
+    fn() => $query->fields = 'a',
+    function () use ($query) { unset($query->fields); },
+    fn() => $query->nope = 1,
+];
+foreach ($errors as $error) {
+    try {
+        $error();
+    } catch (Throwable $e) {
+        echo get_class($e), ": ", $e->getMessage(), "\n";
+    }
+}
+?>
+--EXPECT--
+SELECT
+array(2) {
+  [0]=>
+  string(4) "u.id"
+  [1]=>
+  string(6) "u.name"
+}
+users / u
+bool(true)
+bool(true)
+bool(false)
+bool(true)
+bool(true)
+SELECT u.id, u.name FROM users AS u WHERE (u.active = 1 OR u.admin = 1) AND (u.deleted = 0) ORDER BY u.name LIMIT 20, 10
+SELECT u.id, u.name FROM users AS u WHERE u.active = 1 OR u.admin = 1 ORDER BY u.name
+SELECT u.id, u.name FROM users AS u WHERE u.active = 1 OR u.admin = 1  ORDER BY u.id DESC
+SELECT * FROM t WHERE a = 1 LIMIT 5
+SELECT id FROM jobs WHERE done = 0  LIMIT 1 FOR UPDATE SKIP LOCKED
+SELECT id FROM t WHERE id > 5 LOCK IN SHARE MODE
+MysqlQp\Query::setLimit() can't rebuild a SELECT with text after its last clause (UNION, INTO, ...)
+Cannot modify MysqlQp\Query::$where_conditions: the SELECT has text after its last clause (UNION, INTO, ...), which a rebuild would lose
+bool(true)
+MysqlQp\Query::setLimit() can't rebuild a SELECT with text after its last clause (UNION, INTO, ...)
+Cannot modify MysqlQp\Query::$where_conditions: the SELECT has text after its last clause (UNION, INTO, ...), which a rebuild would lose
+bool(true)
+MysqlQp\Query::setLimit() can't rebuild a SELECT with text after its last clause (UNION, INTO, ...)
+Cannot modify MysqlQp\Query::$where_conditions: the SELECT has text after its last clause (UNION, INTO, ...), which a rebuild would lose
+bool(true)
+MysqlQp\Query::setLimit() can't rebuild a SELECT with a WINDOW clause
+Cannot modify MysqlQp\Query::$where_conditions: the SELECT has a WINDOW clause, which a rebuild would lose
+bool(true)
+MysqlQp\Query::setLimit() can't rebuild a SELECT with a leading WITH, TABLE, VALUES or parenthesis
+Cannot modify MysqlQp\Query::$where_conditions: the SELECT has a leading WITH, TABLE, VALUES or parenthesis, which a rebuild would lose
+bool(true)
+MysqlQp\Query::setLimit() can't rebuild a SELECT with a leading WITH, TABLE, VALUES or parenthesis
+Cannot modify MysqlQp\Query::$where_conditions: the SELECT has a leading WITH, TABLE, VALUES or parenthesis, which a rebuild would lose
+bool(true)
+MysqlQp\Query::setLimit() can't rebuild a SELECT with a leading WITH, TABLE, VALUES or parenthesis
+Cannot modify MysqlQp\Query::$where_conditions: the SELECT has a leading WITH, TABLE, VALUES or parenthesis, which a rebuild would lose
+bool(true)
+MysqlQp\Query::setLimit() can't rebuild a SELECT with a leading WITH, TABLE, VALUES or parenthesis
+Cannot modify MysqlQp\Query::$where_conditions: the SELECT has a leading WITH, TABLE, VALUES or parenthesis, which a rebuild would lose
+bool(true)
+MysqlQp\Query::addWhere() can't rebuild a SELECT with text after its last clause (UNION, INTO, ...)
+INSERT a,b
+1,2
+3,4
+Error: MysqlQp\Query::setLimit() is only supported for SELECT queries
+ValueError: MysqlQp\Query::setLimit(): Argument #1 ($count) must be greater than or equal to 0
+Error: Cannot modify MysqlQp\Query::$type
+TypeError: Cannot assign string to property MysqlQp\Query::$fields of type array
+Error: Cannot unset MysqlQp\Query::$fields
+Error: Cannot create dynamic property MysqlQp\Query::$nope
@@ -0,0 +1,68 @@
+--TEST--
+mysql_qp.shm_size shares immutable decomposition results
+--SKIPIF--
+<?php
+if (!extension_loaded("mysql_qp")) print "skip";
+if (PHP_OS_FAMILY === "Windows") print "skip no shared result cache on Windows";
+?>
+--INI--
+mysql_qp.shm_size=1M
+--FILE--
+<?php
+function shm_counters() {
+    ob_start();
+    phpinfo(INFO_MODULES);
+    $info = ob_get_clean();
+    preg_match('/^Shared result cache => (.*)$/m', $info, $state);
+    preg_match('/^Hits \(this worker\) => (\d+)$/m', $info, $hits);
+    preg_match('/^Misses \(this worker\) => (\d+)$/m', $info, $misses);
+    return "$state[1] hits=$hits[1] misses=$misses[1]\n";
+}
+
+$query = "SELECT id, name FROM users WHERE id = 1 ORDER BY name";
+$first = mysql_decompose_query($query);
+$second = mysql_decompose_query($query);
+var_dump($first === $second);
+echo shm_counters();
+
+// Writes separate the caller's copy, never the shared one
+$second['fields'][] = 'email';
+$second['type'] = 'CHANGED';
+$third = mysql_decompose_query($query);
+var_dump($third === $first, count($third['fields']));
+
+// Flags are part of the key
+var_dump(mysql_decompose_query($query, MYSQL_QP_SPANS)['fields'][0]);
+echo mysql_reconstruct_query($third), "\n";
+
+// INSERT rows are objects and stay per request
+$insert = "INSERT INTO t (a) VALUES (1), (2)";
+mysql_decompose_query($insert);
+foreach (mysql_decompose_query($insert)['values'] as $row) {
+    echo $row[0], "\n";
+}
+echo shm_counters();
+
+// Parse results are shared only when they hold for every schema: lexer errors and
+// local verdicts, not the server's
+foreach (["SELECT 'unterminated", $query, "SELECT * FROM no_such_table"] as $i => $sql) {
+    $flags = $i == 1 ? MYSQL_QP_LOCAL_VERDICT : 0;
+    mysql_parse_query($sql, $flags);
+    mysql_parse_query($sql, $flags);
+}
+echo shm_counters();
+?>
+--EXPECT--
+bool(true)
+enabled hits=1 misses=1
+bool(true)
+int(2)
+array(2) {
+  [0]=>
+  int(7)
+  [1]=>
+  int(2)
+}
+SELECT id, name FROM users WHERE id = 1  ORDER BY name
+enabled hits=2 misses=4
+enabled hits=4 misses=8
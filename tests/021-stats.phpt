@@ -0,0 +1,70 @@
+--TEST--
+mysql_qp_stats() counters and latency histograms
+--SKIPIF--
+<?php if (!extension_loaded("mysql_qp")) print "skip"; ?>
+--FILE--
+<?php
+mysql_qp_stats(true);
+
+for ($i = 0; $i < 100; $i++) {
+    $parts = mysql_decompose_query("SELECT id FROM users WHERE id = $i");
+}
+mysql_reconstruct_query($parts);
+mysql_fingerprint_query("SELECT 1");
+
+$stats = mysql_qp_stats();
+var_dump($stats['calls']['mysql_decompose_query']);
+var_dump($stats['calls']['mysql_reconstruct_query']);
+var_dump($stats['calls']['mysql_fingerprint_query']);
+var_dump($stats['calls']['mysql_parse_query']);
+var_dump($stats['bytes_allocated'] >= 0);
+
+$latency = $stats['latency']['mysql_decompose_query'];
+var_dump($latency['count']);
+var_dump(array_sum($latency['buckets']));
+var_dump($latency['min_ns'] <= $latency['p50_ns']);
+var_dump($latency['p50_ns'] <= $latency['p99_ns']);
+var_dump($latency['p99_ns'] <= $latency['p999_ns']);
+var_dump($latency['p999_ns'] <= $latency['max_ns']);
+var_dump($latency['sum_ns'] >= $latency['max_ns']);
+
+// Bucket bounds only ever grow
+$bounds = array_keys($latency['buckets']);
+$sorted = $bounds;
+sort($sorted);
+var_dump($bounds === $sorted);
+
+var_dump(array_keys($stats['latency']) === array_merge(array_keys($stats['calls']), ['prepare', 'explain', 'connect']));
+
+// Reading with reset returns the old figures, then starts over
+var_dump(mysql_qp_stats(true)['calls']['mysql_decompose_query']);
+$stats = mysql_qp_stats();
+var_dump($stats['calls']['mysql_decompose_query']);
+var_dump($stats['latency']['mysql_decompose_query']['buckets']);
+var_dump($stats['cache']['hits']);
+
+ob_start();
+phpinfo(INFO_MODULES);
+var_dump(str_contains(ob_get_clean(), 'Statistics (this worker)'));
+?>
+--EXPECT--
+int(100)
+int(1)
+int(1)
+int(0)
+bool(true)
+int(100)
+int(100)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+int(100)
+int(0)
+array(0) {
+}
+int(0)
+bool(true)
@@ -0,0 +1,63 @@
+--TEST--
+mysql_interpolate_query() emulates prepares with charset-aware escaping
+--SKIPIF--
+<?php if (!extension_loaded("mysql_qp")) print "skip"; ?>
+--FILE--
+<?php
+echo mysql_interpolate_query("SELECT * FROM t WHERE a = ? AND b = ? AND c = ? AND d = ? AND e = ?",
+    ["O'Brien\\\n", -42, 1.5, null, true]), "\n";
+
+// Named and positional placeholders; those in strings and comments stay
+echo mysql_interpolate_query("SELECT ':x', \"?\" FROM t WHERE id = :id /* ? */ AND n = :n LIMIT ?",
+    ['id' => '7', ':n' => 5, 10]), "\n";
+
+// No placeholders: the SQL comes back unchanged
+echo mysql_interpolate_query("SELECT 1", []), "\n";
+
+// Binary data that isn't valid UTF-8 becomes a hex literal
+echo mysql_interpolate_query("SELECT ?, ?", ["caf\u{e9}'", "\xff\x00'"]), "\n";
+echo mysql_interpolate_query("SELECT ?", ["\u{1F600}"], "utf8mb3"), "\n";
+echo bin2hex(mysql_interpolate_query("SELECT ?", ["\xff\x00'"], "latin1")), "\n";
+
+// 0x95 0x5C is one SJIS character; its second byte must not be escaped
+echo bin2hex(mysql_interpolate_query("SELECT ?", ["\x95\x5c'"], "sjis")), "\n";
+echo bin2hex(mysql_interpolate_query("SELECT ?", ["\x95\x5c'"], "latin1")), "\n";
+echo mysql_interpolate_query("SELECT ?", ["\x95'"], "cp932"), "\n";
+
+// Many placeholders
+echo mysql_interpolate_query("VALUES " . implode(", ", array_fill(0, 20, "(?)")), range(1, 20)), "\n";
+
+foreach ([[[], []], [[INF], []], [[[1]], []], [[1], ['charset' => 'ucs2']]] as [$params, $options]) {
+    try {
+        mysql_interpolate_query("SELECT ?", $params, $options['charset'] ?? null);
+    } catch (Throwable $e) {
+        echo get_class($e), ": ", $e->getMessage(), "\n";
+    }
+}
+try {
+    mysql_interpolate_query("SELECT :name", [1]);
+} catch (ValueError $e) {
+    echo $e->getMessage(), "\n";
+}
+
+var_dump(mysql_interpolate_query("SELECT 'unterminated ?", [1]));
+?>
+--EXPECTF--
+SELECT * FROM t WHERE a = 'O\'Brien\\\n' AND b = -42 AND c = 1.5 AND d = NULL AND e = TRUE
+SELECT ':x', "?" FROM t WHERE id = '7' /* ? */ AND n = 5 LIMIT 10
+SELECT 1
+SELECT 'café\'', X'FF0027'
+SELECT X'F09F9880'
+53454c4543542027ff5c305c2727
+53454c4543542027955c5c2727
+53454c4543542027955c5c5c2727
+SELECT X'9527'
+VALUES (1), (2), (3), (4), (5), (6), (7), (8), (9), (10), (11), (12), (13), (14), (15), (16), (17), (18), (19), (20)
+ValueError: No value bound to placeholder 0
+ValueError: Value for placeholder 0 must be a finite number
+TypeError: Value for placeholder 0 must be of type string|int|float|bool|null, array given
+ValueError: mysql_interpolate_query(): Argument #3 ($charset) must be a character set MySQL accepts for a connection, "ucs2" given
+No value bound to placeholder :name
+
+Warning: mysql_interpolate_query(): Cannot interpolate query: %s in %s on line %d
+bool(false)
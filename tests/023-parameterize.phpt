@@ -0,0 +1,58 @@
+--TEST--
+mysql_parameterize_query() lifts literals out into typed parameters
+--SKIPIF--
+<?php if (!extension_loaded("mysql_qp")) print "skip"; ?>
+--FILE--
+<?php
+function show(string $sql) {
+    $r = mysql_parameterize_query($sql);
+    if ($r === false) {
+        echo "false\n";
+        return;
+    }
+    echo $r['sql'], "\n  [", $r['types'], "] ", json_encode($r['params']), "\n";
+}
+
+// Exact values: ints, big ints and fixed-point as strings, floats, unescaped strings
+show("SELECT * FROM t WHERE a = 1 AND b = 'x''y\\n' AND c = 1.50 AND d = 1e3 AND e = 99999999999999999999");
+show("INSERT INTO t (a, b) VALUES (1, 'x'), (-2, 'y\\%z' 'w')");
+
+// Literals that are syntax stay in place
+show("SELECT a, b FROM t ORDER BY 2 DESC, 1 LIMIT 10 OFFSET 5");
+show("SELECT CAST(x AS DECIMAL(10,2)) AS 'alias' FROM t WHERE d > DATE '2020-01-01' AND j->>'$.b' = 2");
+show("SELECT SUM(x) OVER (ORDER BY y ROWS 2 PRECEDING), N'n', X'41', _utf8mb4'z' FROM t /*!80000 WHERE c = 3 */");
+show("SELECT a INTO OUTFILE '/tmp/x' FIELDS TERMINATED BY ',' FROM t WHERE a = 5");
+
+// Nothing to do: not DML, several statements, no literals
+show("CREATE TABLE t (a INT DEFAULT 5)");
+show("SELECT 1; SELECT 2");
+show("SELECT * FROM t");
+
+show("SELECT * FROM t WHERE a = ?");
+show("SELECT 'unterminated");
+?>
+--EXPECTF--
+SELECT * FROM t WHERE a = ? AND b = ? AND c = ? AND d = ? AND e = ?
+  [issds] [1,"x'y\n","1.50",1000.0,"99999999999999999999"]
+INSERT INTO t (a, b) VALUES (?, ?), (-?, ?)
+  [isis] [1,"x",2,"y\\%zw"]
+SELECT a, b FROM t ORDER BY 2 DESC, 1 LIMIT ? OFFSET ?
+  [ii] [10,5]
+SELECT CAST(x AS DECIMAL(10,2)) AS 'alias' FROM t WHERE d > DATE '2020-01-01' AND j->>'$.b' = ?
+  [i] [2]
+SELECT SUM(x) OVER (ORDER BY y ROWS 2 PRECEDING), N'n', X'41', _utf8mb4'z' FROM t /*!80000 WHERE c = 3 */
+  [] []
+SELECT a INTO OUTFILE '/tmp/x' FIELDS TERMINATED BY ',' FROM t WHERE a = ?
+  [i] [5]
+CREATE TABLE t (a INT DEFAULT 5)
+  [] []
+SELECT 1; SELECT 2
+  [] []
+SELECT * FROM t
+  [] []
+
+Warning: mysql_parameterize_query(): Cannot parameterize query: the query already has placeholders in %s on line %d
+false
+
+Warning: mysql_parameterize_query(): Cannot parameterize query: unterminated string literal in %s on line %d
+false
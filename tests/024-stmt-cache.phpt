@@ -0,0 +1,78 @@
+--TEST--
+Prepared statement cache and result metadata with MYSQL_QP_METADATA
+--SKIPIF--
+<?php
+if (!extension_loaded("mysql_qp")) print "skip";
+elseif (!mysql_parse_query("SELECT 1 FROM DUAL WHERE 1 = ?", MYSQL_QP_METADATA)['is_valid']) print "skip MySQL server not available";
+?>
+--INI--
+mysql_qp.stmt_cache_size=2
+--FILE--
+<?php
+var_dump(MYSQL_QP_METADATA);
+mysql_qp_stats(true);
+
+$query = "SELECT 1 AS one, 'x' AS two, ? AS three";
+$result = mysql_parse_query($query, MYSQL_QP_METADATA);
+var_dump($result['is_valid'], $result['parameter_count']);
+var_dump(array_column($result['columns'], 'name'));
+var_dump(array_keys($result['columns'][0]));
+var_dump($result['columns'][0]['org_table']);
+var_dump($result['columns'][0]['type'] === 8);     // MYSQLI_TYPE_LONGLONG
+
+// Without the flag there are no columns; the verdict still comes from the statement prepared above
+var_dump(array_key_exists('columns', mysql_parse_query($query)));
+
+// So does the next prepare
+var_dump(mysql_parse_query($query, MYSQL_QP_METADATA)['columns'] === $result['columns']);
+$cache = mysql_qp_stats()['cache'];
+var_dump($cache['stmt_hits'], $cache['stmt_misses']);
+
+// No result set
+var_dump(mysql_parse_query("DO ?", MYSQL_QP_METADATA)['columns']);
+
+// Two statements fit; a third evicts the least recently used
+mysql_parse_query("SELECT 2", MYSQL_QP_METADATA);
+var_dump(mysql_qp_stats()['cache']['stmt_evictions']);
+
+// Server errors aren't cached
+$result = mysql_parse_query("SELECT * FROM no_such_table_anywhere", MYSQL_QP_METADATA);
+var_dump($result['is_valid'], $result['error_code'], array_key_exists('columns', $result));
+?>
+--EXPECT--
+int(2)
+bool(true)
+int(1)
+array(3) {
+  [0]=>
+  string(3) "one"
+  [1]=>
+  string(3) "two"
+  [2]=>
+  string(5) "three"
+}
+array(6) {
+  [0]=>
+  string(4) "name"
+  [1]=>
+  string(9) "org_table"
+  [2]=>
+  string(4) "type"
+  [3]=>
+  string(6) "length"
+  [4]=>
+  string(5) "flags"
+  [5]=>
+  string(9) "charsetnr"
+}
+string(0) ""
+bool(true)
+bool(false)
+bool(true)
+int(2)
+int(1)
+NULL
+int(1)
+bool(false)
+int(1146)
+bool(false)
@@ -0,0 +1,89 @@
+--TEST--
+mysql_split_sql() and mysql_split_sql_file() split scripts like the mysql client
+--SKIPIF--
+<?php if (!extension_loaded("mysql_qp")) print "skip"; ?>
+--FILE--
+<?php
+$script = <<<'SQL'
+--
+-- Table structure
+--
+DROP TABLE IF EXISTS `t;1`;
+/*!40101 SET NAMES utf8mb4 */;
+INSERT INTO t VALUES ('a;b', "c\";", 'it''s;'); # trailing; comment
+SELECT 1 /* ; */ FROM dual;;
+DELIMITER ;;
+CREATE PROCEDURE p() BEGIN SELECT 1; SELECT 2; END ;;
+delimiter $$
+SELECT 3$$ SELECT 4 $$
+DELIMITER ;
+CREATE TRIGGER tr BEFORE INSERT ON t FOR EACH ROW
+BEGIN
+  IF NEW.a IS NULL THEN SET NEW.a = CASE WHEN 1 THEN 2 END; END IF;
+END;
+CREATE PROCEDURE q(x INT)
+BEGIN
+  CASE x WHEN 1 THEN SELECT 1; ELSE SELECT 2; END CASE;
+END;
+SELECT 5
+-- the end
+SQL;
+
+foreach (mysql_split_sql($script) as $i => $statement) {
+    echo $i, ": ", $statement, "\n";
+}
+
+// Spans point into the script
+foreach (mysql_split_sql("SELECT 1;  SELECT 2", MYSQL_QP_SPANS) as $span) {
+    echo json_encode($span), "\n";
+}
+
+// Files are mapped; each foreach starts over
+$path = tempnam(sys_get_temp_dir(), "qp");
+file_put_contents($path, $script);
+$file = mysql_split_sql_file($path);
+var_dump($file instanceof IteratorAggregate);
+var_dump(iterator_to_array($file) === iterator_to_array(mysql_split_sql($script)));
+var_dump(count(iterator_to_array($file)));
+file_put_contents($path, "");
+var_dump(iterator_to_array(mysql_split_sql_file($path)));
+unlink($path);
+
+var_dump(@mysql_split_sql_file($path));
+
+try {
+    foreach (mysql_split_sql("SELECT 1;\nDELIMITER\nSELECT 2") as $statement) {
+        echo $statement, "\n";
+    }
+} catch (ValueError $e) {
+    echo $e->getMessage(), "\n";
+}
+?>
+--EXPECT--
+0: DROP TABLE IF EXISTS `t;1`
+1: /*!40101 SET NAMES utf8mb4 */
+2: INSERT INTO t VALUES ('a;b', "c\";", 'it''s;')
+3: SELECT 1 /* ; */ FROM dual
+4: CREATE PROCEDURE p() BEGIN SELECT 1; SELECT 2; END
+5: SELECT 3
+6: SELECT 4
+7: CREATE TRIGGER tr BEFORE INSERT ON t FOR EACH ROW
+BEGIN
+  IF NEW.a IS NULL THEN SET NEW.a = CASE WHEN 1 THEN 2 END; END IF;
+END
+8: CREATE PROCEDURE q(x INT)
+BEGIN
+  CASE x WHEN 1 THEN SELECT 1; ELSE SELECT 2; END CASE;
+END
+9: SELECT 5
+-- the end
+[0,8]
+[11,8]
+bool(true)
+bool(true)
+int(10)
+array(0) {
+}
+bool(false)
+SELECT 1
+DELIMITER must be followed by a delimiter at offset 10
@@ -0,0 +1,78 @@
+--TEST--
+mysql_validate_parallel() agrees with mysql_validate_queries() and keeps the input order
+--SKIPIF--
+<?php if (!extension_loaded("mysql_qp")) print "skip"; ?>
+--INI--
+mysql_qp.cache_size=0
+--FILE--
+<?php
+$queries = [];
+for ($i = 0; $i < 200; $i++) {
+    $queries["q$i"] = match ($i % 5) {
+        0 => "SELECT $i",
+        1 => "SHOW TABLES",
+        2 => "SHOW TABLEZ $i",
+        3 => "SELECT 'unterminated $i",
+        4 => "CHECKSUM TABLE t$i",
+    };
+}
+
+$parallel = mysql_validate_parallel($queries, 8);
+var_dump(array_keys($parallel) === array_keys($queries));
+var_dump($parallel == mysql_validate_queries($queries));
+var_dump(mysql_validate_parallel($queries, 1) == $parallel);
+var_dump(mysql_validate_parallel($queries, 1000) == $parallel);
+
+// Any Traversable, consumed in chunks; results are by position, since keys can repeat
+function statements() {
+    yield 'a' => "SELECT 1";
+    yield 'a' => "SHOW TABLEZ";
+    yield 'c' => "SHOW DATABASES";
+}
+foreach (mysql_validate_parallel(statements(), 2) as $key => $result) {
+    echo $key . ": " . ($result['is_valid'] ? "valid" : "invalid") . " (" . $result['error_code'] . ")\n";
+}
+foreach (mysql_validate_parallel(mysql_split_sql("SELECT 1; SELECTT 2; SHOW DATABASES")) as $key => $result) {
+    echo $key . ": " . ($result['is_valid'] ? "valid" : "invalid") . " (" . $result['error_code'] . ")\n";
+}
+
+function many() {
+    for ($i = 0; $i < 2500; $i++) {
+        yield 'same' => $i % 2 ? "SELECT $i" : "SELECT 'unterminated $i";
+    }
+}
+$results = mysql_validate_parallel(many(), 4);
+var_dump(count($results), array_is_list($results), $results[2499]['is_valid'], $results[2498]['is_valid']);
+var_dump(mysql_validate_parallel(new ArrayIterator([])));
+
+var_dump(mysql_validate_parallel([]));
+var_dump(mysql_validate_parallel(["SELECT 1", 42]));
+try {
+    mysql_validate_parallel(["SELECT 1"], 0);
+} catch (ValueError $e) {
+    echo $e->getMessage(), "\n";
+}
+?>
+--EXPECTF--
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+0: valid (0)
+1: invalid (1064)
+2: valid (0)
+0: valid (0)
+1: invalid (1064)
+2: valid (0)
+int(2500)
+bool(true)
+bool(true)
+bool(false)
+array(0) {
+}
+array(0) {
+}
+
+Warning: mysql_validate_parallel(): All queries must be strings in %s on line %d
+bool(false)
+mysql_validate_parallel(): Argument #2 ($threads) must be greater than 0
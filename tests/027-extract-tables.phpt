@@ -0,0 +1,59 @@
+--TEST--
+mysql_extract_tables() reports referenced tables with read/write access
+--SKIPIF--
+<?php if (!extension_loaded("mysql_qp")) print "skip"; ?>
+--FILE--
+<?php
+function show(string $sql) {
+    $refs = array_map(
+        fn($t) => ($t['schema'] ?? '-') . "." . $t['table'] . " " . ($t['alias'] ?? '-') . " " . $t['access'],
+        mysql_extract_tables($sql)
+    );
+    echo implode(", ", $refs), "\n";
+}
+
+show("UPDATE shop.orders o JOIN users u ON u.id = o.uid SET o.status = 'paid'");
+show("SELECT o.id FROM `shop`.`orders` AS o JOIN users u ON u.id = o.uid WHERE u.id IN (SELECT uid FROM bans) AND YEAR(o.d) = EXTRACT(YEAR FROM NOW())");
+show("WITH recent AS (SELECT * FROM orders WHERE d > NOW() - INTERVAL 1 DAY) SELECT * FROM recent JOIN (customers c, (SELECT 1 AS x) AS d) ON 1");
+show("INSERT INTO archive (id) SELECT id FROM orders UNION TABLE old_orders");
+show("UPDATE a, b SET b.x = a.x");
+show("DELETE o FROM orders o LEFT JOIN users u ON u.id = o.uid WHERE u.id IS NULL");
+show("DELETE FROM t1, t2 USING t1 JOIN t2 JOIN t3");
+show("CREATE TABLE `copy` LIKE src");
+show("LOCK TABLES t1 READ, t2 AS w WRITE");
+show("EXPLAIN DELETE FROM t");
+show("SELECT 1; TRUNCATE log; SHOW COLUMNS FROM t IN db");
+show("GRANT SELECT ON db.t TO u");
+
+var_dump(mysql_extract_tables("SELECT * FROM `my``db`.t"));
+var_dump(mysql_extract_tables("SELECT 'unterminated FROM t"));
+?>
+--EXPECTF--
+shop.orders o write, -.users u read
+shop.orders o read, -.users u read, -.bans - read
+-.orders - read, -.customers c read
+-.archive - write, -.orders - read, -.old_orders - read
+-.a - read, -.b - write
+-.orders o write, -.users u read
+-.t1 - write, -.t2 - write, -.t3 - read
+-.copy - write, -.src - read
+-.t1 - read, -.t2 w write
+-.t - read
+-.log - write, db.t - read
+
+array(1) {
+  [0]=>
+  array(4) {
+    ["schema"]=>
+    string(5) "my`db"
+    ["table"]=>
+    string(1) "t"
+    ["alias"]=>
+    NULL
+    ["access"]=>
+    string(4) "read"
+  }
+}
+
+Warning: mysql_extract_tables(): Cannot extract tables: %s in %s on line %d
+bool(false)
@@ -0,0 +1,74 @@
+--TEST--
+mysql_classify_query() reports statement kind and routing flags
+--SKIPIF--
+<?php if (!extension_loaded("mysql_qp")) print "skip"; ?>
+--FILE--
+<?php
+function show(string $sql) {
+    $class = mysql_classify_query($sql);
+    $flags = [];
+    foreach ([
+        'READ_ONLY' => MYSQL_QP_READ_ONLY,
+        'LOCKING_READ' => MYSQL_QP_LOCKING_READ,
+        'TRANSACTION' => MYSQL_QP_TRANSACTION,
+        'IMPLICIT_COMMIT' => MYSQL_QP_IMPLICIT_COMMIT,
+        'NONDETERMINISTIC' => MYSQL_QP_NONDETERMINISTIC,
+    ] as $name => $flag) {
+        if ($class['flags'] & $flag) {
+            $flags[] = $name;
+        }
+    }
+    echo $class['type'], " ", $class['name'], " [", implode(" ", $flags), "]\n";
+}
+
+show("/* app:42 */ -- note\nSELECT /*+ MAX_EXECUTION_TIME(100) */ * FROM t");
+show("(SELECT 1) UNION (SELECT 2)");
+show("WITH x AS (SELECT 1) UPDATE t JOIN x SET t.a = 1");
+show("START TRANSACTION READ ONLY");
+show("SET autocommit = 0");
+show("SELECT * FROM t WHERE id = 1 FOR UPDATE");
+show("SELECT * FROM t LOCK IN SHARE MODE");
+show("SELECT NOW(), 'RAND()', t.uuid() FROM t");
+show("SELECT UNIX_TIMESTAMP(d) FROM t");
+show("SELECT UNIX_TIMESTAMP() FROM t");
+show("INSERT INTO t VALUES (LAST_INSERT_ID())");
+show("CREATE TEMPORARY TABLE tmp (id INT)");
+show("CREATE TABLE t (id INT)");
+show("EXPLAIN t");
+show("DESCRIBE SELECT 1");
+show("EXPLAIN ANALYZE DELETE FROM t");
+show("DROP PREPARE stmt");
+show("/*!40101 SET NAMES utf8 */");
+show("GRANT SELECT ON db.* TO u");
+show("`select` FROM users");
+show("SELECT 1; -- done");
+show("SELECT 1; DROP TABLE t");
+show("");
+
+var_dump(mysql_parse_query("START TRANSACTION")['query_type']);
+?>
+--EXPECT--
+1 SELECT [READ_ONLY]
+1 SELECT [READ_ONLY]
+3 UPDATE []
+14 BEGIN [TRANSACTION IMPLICIT_COMMIT]
+13 SET [TRANSACTION]
+1 SELECT [READ_ONLY LOCKING_READ]
+1 SELECT [READ_ONLY LOCKING_READ]
+1 SELECT [READ_ONLY NONDETERMINISTIC]
+1 SELECT [READ_ONLY]
+1 SELECT [READ_ONLY NONDETERMINISTIC]
+2 INSERT [NONDETERMINISTIC]
+5 CREATE []
+5 CREATE [IMPLICIT_COMMIT]
+10 EXPLAIN [READ_ONLY]
+9 DESCRIBE [READ_ONLY]
+10 EXPLAIN []
+31 DEALLOCATE []
+13 SET []
+24 GRANT [IMPLICIT_COMMIT]
+0 UNKNOWN []
+1 SELECT [READ_ONLY]
+1 SELECT []
+0 UNKNOWN []
+int(14)
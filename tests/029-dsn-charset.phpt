@@ -0,0 +1,28 @@
+--TEST--
+An unknown charset in mysql_qp.dsn is reported against the INI setting
+--SKIPIF--
+<?php if (!extension_loaded("mysql_qp")) print "skip"; ?>
+--INI--
+mysql_qp.dsn=mysql:host=localhost;dbname=mysql_qp_test;charset=ucs2
+--FILE--
+<?php
+try {
+    mysql_interpolate_query("SELECT ?", ['x']);
+} catch (ValueError $e) {
+    echo $e->getMessage(), "\n";
+}
+try {
+    mysql_compile_template("SELECT ?")->render(['x']);
+} catch (ValueError $e) {
+    echo $e->getMessage(), "\n";
+}
+
+// An explicit charset doesn't need the one in the DSN
+echo mysql_interpolate_query("SELECT ?", ['x'], "latin1"), "\n";
+echo mysql_compile_template("SELECT :x")->render([':x' => 'y'], "latin1"), "\n";
+?>
+--EXPECT--
+The charset in mysql_qp.dsn must be a character set MySQL accepts for a connection, "ucs2" given
+The charset in mysql_qp.dsn must be a character set MySQL accepts for a connection, "ucs2" given
+SELECT 'x'
+SELECT 'y'
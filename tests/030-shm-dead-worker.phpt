@@ -0,0 +1,56 @@
+--TEST--
+A worker killed while holding shared results doesn't hold up the restart
+--SKIPIF--
+<?php
+if (!extension_loaded("mysql_qp")) print "skip";
+if (PHP_OS_FAMILY === "Windows") print "skip no shared result cache on Windows";
+if (!function_exists("pcntl_fork") || !function_exists("posix_kill")) print "skip pcntl and posix required";
+?>
+--INI--
+mysql_qp.shm_size=1M
+--FILE--
+<?php
+function shm_state() {
+    ob_start();
+    phpinfo(INFO_MODULES);
+    $info = ob_get_clean();
+    preg_match('/^Shared result cache => (.*)$/m', $info, $state);
+    preg_match('/^Restarts => (\d+)$/m', $info, $restarts);
+    return "$state[1] restarts=$restarts[1]";
+}
+
+// The parent never uses the segment, so only its children hold results
+function in_child(callable $body) {
+    $pid = pcntl_fork();
+    if ($pid === 0) {
+        $body();
+        exit(0);
+    }
+    pcntl_waitpid($pid, $status);
+}
+
+// Killed while its request still holds results from the segment
+in_child(function () {
+    mysql_decompose_query("SELECT 1");
+    posix_kill(posix_getpid(), SIGKILL);
+});
+
+// Fills the segment, so a restart is requested
+in_child(function () {
+    for ($i = 0; $i < 100000 && ($i % 100 || !str_starts_with(shm_state(), "restart pending")); $i++) {
+        mysql_decompose_query("SELECT a, b, c FROM t WHERE id = $i ORDER BY " . str_repeat("c", 200));
+    }
+});
+echo shm_state(), "\n";
+
+// The next request finds the killed worker gone and restarts the segment
+in_child(function () {
+    mysql_decompose_query("SELECT 1");
+    echo shm_state(), "\n";
+});
+echo shm_state(), "\n";
+?>
+--EXPECT--
+restart pending restarts=0
+enabled restarts=1
+enabled restarts=1
@@ -0,0 +1,63 @@
+--TEST--
+The prepared statement cache shrinks while the server is out of statement slots and grows back
+--SKIPIF--
+<?php
+if (!extension_loaded("mysql_qp")) print "skip";
+elseif (!extension_loaded("mysqli")) print "skip mysqli required";
+elseif (!mysql_parse_query("SELECT 1 FROM DUAL WHERE 1 = ?", MYSQL_QP_METADATA)['is_valid']) print "skip MySQL server not available";
+else {
+    preg_match('/host=([^;]*)/', ini_get("mysql_qp.dsn"), $host);
+    $admin = @new mysqli($host[1] ?? "localhost", ini_get("mysql_qp.user"), ini_get("mysql_qp.password"));
+    if ($admin->connect_errno || !@$admin->query("SET GLOBAL max_prepared_stmt_count = @@global.max_prepared_stmt_count")) {
+        print "skip cannot change max_prepared_stmt_count";
+    }
+}
+?>
+--INI--
+mysql_qp.stmt_cache_size=4
+mysql_qp.pool_size=1
+--FILE--
+<?php
+preg_match('/host=([^;]*)/', ini_get("mysql_qp.dsn"), $host);
+$admin = @new mysqli($host[1] ?? "localhost", ini_get("mysql_qp.user"), ini_get("mysql_qp.password"));
+$limit = $admin->query("SELECT @@global.max_prepared_stmt_count")->fetch_row()[0];
+$admin->query("SET GLOBAL max_prepared_stmt_count = 1000");
+
+function parse(int $n) {
+    mysql_parse_query("SELECT $n AS n", MYSQL_QP_METADATA);
+}
+function stmt_counters() {
+    $cache = mysql_qp_stats()['cache'];
+    return "hits=$cache[stmt_hits] evictions=$cache[stmt_evictions]\n";
+}
+
+try {
+    mysql_qp_stats(true);
+    foreach ([1, 2, 3, 4] as $n) parse($n);
+    echo stmt_counters();
+
+    // Only two statements fit on the server: the cache gives back the rest
+    $admin->query("SET GLOBAL max_prepared_stmt_count = 2");
+    parse(5);
+    echo stmt_counters();
+
+    // Room again: the cache grows back to its configured size without evicting
+    $admin->query("SET GLOBAL max_prepared_stmt_count = 1000");
+    foreach ([6, 7] as $n) parse($n);
+    echo stmt_counters();
+    foreach ([4, 5, 6, 7] as $n) parse($n);
+    echo stmt_counters();
+
+    // Full again: the fifth statement evicts the least recently used
+    parse(8);
+    echo stmt_counters();
+} finally {
+    $admin->query("SET GLOBAL max_prepared_stmt_count = " . (int) $limit);
+}
+?>
+--EXPECT--
+hits=0 evictions=0
+hits=0 evictions=3
+hits=0 evictions=3
+hits=4 evictions=3
+hits=4 evictions=4
@@ -0,0 +1,102 @@
+--TEST--
+mysql_validate_parallel() asks the server unless MYSQL_QP_LOCAL_VERDICT accepts the native parser's verdict
+--SKIPIF--
+<?php
+if (!extension_loaded("mysql_qp")) print "skip";
+elseif (!mysql_validate_parallel(["SELECT 1"], 1)[0]['is_valid']) print "skip MySQL server not available";
+?>
+--INI--
+mysql_qp.cache_size=16
+--FILE--
+<?php
+var_dump(MYSQL_QP_LOCAL_VERDICT);
+
+$queries = [];
+for ($i = 0; $i < 200; $i++) {
+    $queries["q$i"] = match ($i % 4) {
+        0 => "SELECT $i",
+        1 => "SELECT COUNT(*) FROM t$i LIMIT 5",
+        2 => "SHOW TABLEZ $i",
+        3 => "SELECT 'unterminated $i",
+    };
+}
+
+// The native parser and the lexer decide all of these without the server
+mysql_qp_stats(true);
+$local = mysql_validate_parallel($queries, 4, MYSQL_QP_LOCAL_VERDICT);
+var_dump(mysql_qp_stats()['round_trips']);
+
+// By default the server is asked about what the lexer can't reject, and agrees
+mysql_qp_stats(true);
+$server = mysql_validate_parallel($queries, 4);
+var_dump(mysql_qp_stats()['round_trips'] > 0);
+var_dump(array_keys($server) === array_keys($queries));
+var_dump(array_column($server, 'is_valid') === array_column($local, 'is_valid'));
+var_dump($local['q2']['error_code'], $local['q3']['error_code']);
+
+// Constructs the native parser doesn't check still go to the server
+$unchecked = [
+    "SELECT CAST(1 AS FOO)",
+    "SELECT CONVERT(a, NOTATYPE) FROM t",
+    "SELECT COUNT(a SEPARATOR ',') FROM t",
+    "SELECT SUM(a ORDER BY b) FROM t",
+    "SELECT NOW() OVER () FROM t",
+    "SELECT ROW_NUMBER() FROM t",
+];
+mysql_qp_stats(true);
+foreach (mysql_validate_parallel($unchecked, 1, MYSQL_QP_LOCAL_VERDICT) as $result) {
+    var_dump($result['is_valid']);
+}
+var_dump(mysql_qp_stats()['round_trips'] > 0);
+
+// Local verdicts are not cached
+mysql_qp_stats(true);
+mysql_validate_parallel(["SELECT 1"], 1, MYSQL_QP_LOCAL_VERDICT);
+mysql_validate_queries(["SELECT 1"]);
+$stats = mysql_qp_stats();
+var_dump($stats['cache']['hits'], $stats['round_trips'] > 0);
+
+// Cached server verdicts still answer
+mysql_validate_queries(["SELECT CAST(1 AS FOO)"]);
+mysql_qp_stats(true);
+mysql_validate_parallel(["SELECT CAST(1 AS FOO)"], 1, MYSQL_QP_LOCAL_VERDICT);
+$stats = mysql_qp_stats();
+var_dump($stats['cache']['hits'], $stats['round_trips']);
+
+// Every validate entry point takes the flag
+mysql_qp_stats(true);
+var_dump(mysql_validate_query("SELECT 2 FROM t2", MYSQL_QP_LOCAL_VERDICT));
+var_dump(array_column(mysql_validate_queries(["SELECT 3", "SELECTT 3"], MYSQL_QP_LOCAL_VERDICT), 'is_valid'));
+$handle = mysql_validate_query_async("SELECT 4 FROM t4", MYSQL_QP_LOCAL_VERDICT);
+var_dump(mysql_qp_async_socket($handle), mysql_qp_poll()[$handle]['is_valid']);
+var_dump(mysql_qp_stats()['round_trips']);
+?>
+--EXPECT--
+int(4)
+int(0)
+bool(true)
+bool(true)
+bool(true)
+int(1064)
+int(1064)
+bool(false)
+bool(false)
+bool(false)
+bool(false)
+bool(false)
+bool(false)
+bool(true)
+int(0)
+bool(true)
+int(1)
+int(0)
+bool(true)
+array(2) {
+  [0]=>
+  bool(true)
+  [1]=>
+  bool(false)
+}
+NULL
+bool(true)
+int(0)
@@ -0,0 +1,71 @@
+--TEST--
+mysql_parse_query() asks the server unless MYSQL_QP_LOCAL_VERDICT accepts the native parser's verdict
+--SKIPIF--
+<?php
+if (!extension_loaded("mysql_qp")) print "skip";
+elseif (!mysql_parse_query("SELECT 1")['is_valid']) print "skip MySQL server not available";
+?>
+--FILE--
+<?php
+$query = "SELECT * FROM no_such_table_anywhere";
+
+// The server knows which tables exist
+mysql_qp_stats(true);
+$result = mysql_parse_query($query);
+var_dump($result['is_valid'], $result['error_code'], isset($result['parse_tree']));
+var_dump(mysql_qp_stats()['prepares'] > 0);
+
+// Valid syntax; the native parser doesn't know which tables exist
+mysql_qp_stats(true);
+$result = mysql_parse_query($query, MYSQL_QP_LOCAL_VERDICT);
+var_dump($result['is_valid'], isset($result['error_code']), isset($result['parse_tree']));
+var_dump(mysql_qp_stats()['prepares']);
+
+// Accepted by both: the tree is kept, the parameters come from the server
+$result = mysql_parse_query("SELECT ? + ?");
+var_dump($result['is_valid'], $result['parameter_count'], isset($result['parse_tree']));
+
+// Lexer errors need no server either way
+mysql_qp_stats(true);
+$result = mysql_parse_query("SELECT 'unterminated");
+var_dump($result['is_valid'], $result['error_code']);
+var_dump(mysql_qp_stats()['prepares']);
+
+// Accepted by the native parser but not checked by it: the server decides
+foreach (["SELECT CAST(1 AS FOO)", "SELECT 1 + INTERVAL 1 DAY", "SELECT NOW() OVER ()"] as $query) {
+    mysql_qp_stats(true);
+    $result = mysql_parse_query($query, MYSQL_QP_LOCAL_VERDICT);
+    echo $query, ": ", $result['is_valid'] ? "valid" : "invalid", ", ", mysql_qp_stats()['prepares'] > 0 ? "server" : "local", "\n";
+}
+
+// Rejected by the native parser
+foreach (["SELECT 1 LIMIT 'x'", "SELECT 1 LIMIT 1.5", "SELECT a, * FROM t", "SELECT COUNT(*, a) FROM t",
+          "SELECT ROW(1)", "SELECT INTERVAL 1 BOGUS + d FROM t", "SELECT EXTRACT(NOTAUNIT FROM a) FROM t"] as $query) {
+    echo $query, ": ", mysql_parse_query($query, MYSQL_QP_LOCAL_VERDICT)['is_valid'] ? "valid" : "invalid", "\n";
+}
+?>
+--EXPECT--
+bool(false)
+int(1146)
+bool(false)
+bool(true)
+bool(true)
+bool(false)
+bool(true)
+int(0)
+bool(true)
+int(2)
+bool(true)
+bool(false)
+int(1064)
+int(0)
+SELECT CAST(1 AS FOO): invalid, server
+SELECT 1 + INTERVAL 1 DAY: valid, local
+SELECT NOW() OVER (): invalid, server
+SELECT 1 LIMIT 'x': invalid
+SELECT 1 LIMIT 1.5: invalid
+SELECT a, * FROM t: invalid
+SELECT COUNT(*, a) FROM t: invalid
+SELECT ROW(1): invalid
+SELECT INTERVAL 1 BOGUS + d FROM t: invalid
+SELECT EXTRACT(NOTAUNIT FROM a) FROM t: invalid